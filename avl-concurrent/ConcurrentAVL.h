@@ -0,0 +1,171 @@
+/**
+ * ConcurrentAVL: an AVL tree that many threads can search at the same time
+ * as one thread changes it, with no locks for the searches.
+ */
+
+// Please first study the AVL example in ../avl. This tree uses the same
+// insert, remove and rotation logic, with the same helper names, so the
+// comments here focus on what is different: how searches run safely while
+// the tree is being changed.
+
+// There are two problems to solve.
+//
+// 1. A search could be led astray. If a rotation happens while a search is
+//    going down the tree, the search can end up in the wrong subtree and
+//    miss a key that is there. (Inserting a new leaf can't cause that: the
+//    new node appears in one step, when its parent's pointer is set.)
+//    To catch this, the tree has a version number, like a "seqlock". The
+//    writer makes the version odd before it rotates or removes anything,
+//    and even again when it's done. A search reads the version before and
+//    after it goes down the tree. If the version was odd, or changed, the
+//    search may have been misled, so it starts again. Writes are short, so
+//    a retry is rare, and the searches never make the writer wait.
+//
+// 2. A search could be looking at a node that the writer has just removed.
+//    The writer can't delete such a node right away. Instead, it uses
+//    "epoch-based reclamation": there is a global epoch number, and each
+//    search announces the epoch at which it started in a slot of its own.
+//    A removed node is tagged with the epoch when it was removed, and is
+//    only deleted once every search that is still running started after
+//    that. (A search that started later can't reach the node, because the
+//    node was already unlinked from the tree.)
+//
+// The child pointers are std::atomic, so that a search never reads a pointer
+// while the writer is halfway through writing it. The keys and data never
+// change after a node is added, so they don't need to be atomic. The
+// heights are only used by the writer.
+//
+// Only one thread may change the tree at a time. insert and remove take a
+// mutex, so several writer threads are allowed, but they take turns.
+//
+// Since a node may be deleted as soon as the search is over, find returns a
+// copy of the data, not a reference to it.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+template <typename K, typename D>
+class ConcurrentAVL {
+  public:
+    ConcurrentAVL();
+    ~ConcurrentAVL();
+
+    // The tree owns its nodes, so we don't allow shallow copies.
+    ConcurrentAVL(const ConcurrentAVL&) = delete;
+    ConcurrentAVL& operator=(const ConcurrentAVL&) = delete;
+
+    // Searches: Safe to call from any number of threads at once, and at the
+    // same time as insert or remove. They never wait for a lock.
+    //   find returns a copy of the data, and throws if the key is not found.
+    D find(const K& key) const;
+    bool contains(const K& key) const;
+    // tryFind: Copy the data into "data" and return true, or return false
+    // if the key is not found.
+    bool tryFind(const K& key, D& data) const;
+
+    // Changes: One at a time. insert throws if the key already exists, and
+    // remove throws if it doesn't, like the AVL class.
+    void insert(const K& key, const D& data);
+    D remove(const K& key);
+
+    // Statistics for testing and benchmarks: how many searches had to start
+    // over because the tree changed underneath them, and how many removed
+    // nodes are still waiting to be deleted.
+    std::uint64_t retries() const { return retries_.load(std::memory_order_relaxed); }
+    std::size_t pendingReclaim() const;
+
+  private:
+    class TreeNode {
+      public:
+        const K key;
+        const D data;
+        std::atomic<TreeNode*> left;
+        std::atomic<TreeNode*> right;
+        int height;
+
+        TreeNode(const K& keyArgument, const D& dataArgument)
+          : key(keyArgument), data(dataArgument), left(nullptr), right(nullptr), height(0) { }
+    };
+
+    // A slot where one search at a time announces its starting epoch. 0
+    // means the slot is free. Each slot has a cache line to itself, so that
+    // searches on different threads don't slow each other down.
+    static constexpr unsigned CACHE_LINE_SIZE = 64;
+    class ReaderSlot {
+      public:
+        std::atomic<std::uint64_t> epoch;
+        char padding[CACHE_LINE_SIZE - sizeof(std::atomic<std::uint64_t>)];
+        ReaderSlot() : epoch(0) { }
+    };
+    // The most searches that can run at the same moment. A search that finds
+    // every slot taken waits for one to become free.
+    static constexpr unsigned READER_SLOTS = 128;
+
+    // The longest path a search will follow. As in the AVL class, no real
+    // AVL tree is this deep. A search that goes further has been misled into
+    // a loop by a change in progress, and starts over.
+    static constexpr int MAX_PATH_LENGTH = 96;
+
+    // How many removed nodes to collect before trying to delete them.
+    static constexpr std::size_t RECLAIM_BATCH = 64;
+
+    std::atomic<TreeNode*> head_;
+    // Odd while the writer is rotating or removing.
+    std::atomic<std::uint64_t> version_;
+    std::atomic<std::uint64_t> epoch_;
+    mutable ReaderSlot slots_[READER_SLOTS];
+    mutable std::atomic<std::uint64_t> retries_;
+
+    // Only the writer uses these. (The lock is mutable so that the const
+    // pendingReclaim can take it too.)
+    mutable std::mutex writer_lock_;
+    // Removed nodes, with the epoch when they were removed.
+    std::vector<std::pair<TreeNode*, std::uint64_t>> retired_;
+    // Whether the current insert has made the version odd yet.
+    bool in_structural_change_;
+
+    // Searches: claim a slot, and release it afterwards.
+    ReaderSlot& _enterRead() const;
+    void _exitRead(ReaderSlot& slot) const;
+    // _search: The search loop, retried until it sees a consistent tree.
+    // Returns whether the key was found, and copies its data if so.
+    bool _search(const K& key, D* data) const;
+
+    // The writer's side of the version number.
+    void _beginStructuralChange();
+    void _endStructuralChange();
+
+    // The same helpers as in the AVL class, on atomic pointers. "cur" is the
+    // pointer in the tree (a parent's child pointer, or head_) that points to
+    // the subtree.
+    void _updateHeight(TreeNode* node);
+    int _get_height(const TreeNode* node) const { return node ? node->height : -1; }
+    int _get_balance_factor(const TreeNode* node) const;
+    void _ensureBalance(std::atomic<TreeNode*>& cur);
+    void _rotateLeft(std::atomic<TreeNode*>& cur);
+    void _rotateRight(std::atomic<TreeNode*>& cur);
+    void _rotateRightLeft(std::atomic<TreeNode*>& cur);
+    void _rotateLeftRight(std::atomic<TreeNode*>& cur);
+    // _iopRemove: Replace the node in "target" (which has two children) by
+    // its in-order predecessor, and rebalance below it.
+    void _iopRemove(std::atomic<TreeNode*>& target);
+
+    // Reclamation.
+    void _retire(TreeNode* node);
+    void _reclaim();
+    void _destroySubtree(TreeNode* node);
+
+    // Writer-side loads. The writer is the only thread that changes the
+    // pointers, and it holds writer_lock_, so it always sees its own latest
+    // values.
+    static TreeNode* _load(const std::atomic<TreeNode*>& pointer) {
+      return pointer.load(std::memory_order_relaxed);
+    }
+};
+
+#include "ConcurrentAVL.hpp"
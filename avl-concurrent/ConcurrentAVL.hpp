@@ -0,0 +1,413 @@
+/**
+ * ConcurrentAVL: an AVL tree that many threads can search at the same time
+ * as one thread changes it, with no locks for the searches.
+ */
+
+#pragma once
+
+#include "ConcurrentAVL.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+// A note about memory orders:
+// Every store of a child pointer by the writer is a "release", and every load
+// of one by a search is an "acquire". So when a search follows a pointer to a
+// new node, it is guaranteed to see that node's key and data as they were
+// written before the node was linked in.
+
+template <typename K, typename D>
+ConcurrentAVL<K, D>::ConcurrentAVL()
+  : head_(nullptr), version_(0), epoch_(1), retries_(0), in_structural_change_(false) { }
+
+template <typename K, typename D>
+ConcurrentAVL<K, D>::~ConcurrentAVL() {
+  // No search may still be running when the tree is destroyed, so
+  // everything can be deleted right away.
+  _destroySubtree(_load(head_));
+  for (const auto& retired : retired_) {
+    delete retired.first;
+  }
+}
+
+template <typename K, typename D>
+void ConcurrentAVL<K, D>::_destroySubtree(TreeNode* node) {
+  if (!node) return;
+  _destroySubtree(_load(node->left));
+  _destroySubtree(_load(node->right));
+  delete node;
+}
+
+// ---- Searches ----
+
+template <typename K, typename D>
+typename ConcurrentAVL<K, D>::ReaderSlot& ConcurrentAVL<K, D>::_enterRead() const {
+  // Each thread starts looking for a free slot at its own place, so that
+  // threads usually get the same slot every time and don't collide.
+  static std::atomic<unsigned> next_thread(0);
+  thread_local unsigned preferred = next_thread.fetch_add(1, std::memory_order_relaxed);
+
+  for (unsigned attempt = 0; ; attempt++) {
+    ReaderSlot& slot = slots_[(preferred + attempt) % READER_SLOTS];
+    std::uint64_t expected = 0;
+    std::uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+    if (slot.epoch.compare_exchange_strong(expected, epoch, std::memory_order_seq_cst)) {
+      // If the writer moved on to a new epoch before we claimed the slot,
+      // it may already have looked at our slot and seen it free. So we
+      // announce the new epoch instead, until the epoch we announced is
+      // still the current one. Then either the writer will see our slot,
+      // or we will see every node that it unlinked. (That "either/or" only
+      // holds because both sides use seq_cst: here, a store to the slot and
+      // then a load of epoch_; in _retire and _reclaim, a store to epoch_
+      // and then a load of the slot. See _reclaim.)
+      std::uint64_t now;
+      while ((now = epoch_.load(std::memory_order_seq_cst)) != epoch) {
+        slot.epoch.store(now, std::memory_order_seq_cst);
+        epoch = now;
+      }
+      return slot;
+    }
+    if (attempt % READER_SLOTS == READER_SLOTS - 1) {
+      // Every slot is taken. Let the other threads finish.
+      std::this_thread::yield();
+    }
+  }
+}
+
+template <typename K, typename D>
+void ConcurrentAVL<K, D>::_exitRead(ReaderSlot& slot) const {
+  // "release", so that when the writer sees the free slot, everything this
+  // search read happened before the writer deletes anything.
+  slot.epoch.store(0, std::memory_order_release);
+}
+
+template <typename K, typename D>
+bool ConcurrentAVL<K, D>::_search(const K& key, D* data) const {
+  ReaderSlot& slot = _enterRead();
+  bool found;
+  while (true) {
+    const std::uint64_t version = version_.load(std::memory_order_acquire);
+    if (version & 1) {
+      // The writer is in the middle of a rotation or a removal.
+      std::this_thread::yield();
+      continue;
+    }
+
+    // The same loop as AVL::_find, with a limit on the number of steps.
+    found = false;
+    const TreeNode* node = head_.load(std::memory_order_acquire);
+    int steps = 0;
+    while (node && steps++ < MAX_PATH_LENGTH) {
+      if (key == node->key) {
+        found = true;
+        break;
+      }
+      // Load both children first and then pick one. The two pointers are
+      // next to each other in memory, so the second load is nearly free, and
+      // this way the compiler can pick with a conditional move instead of a
+      // branch that the CPU guesses wrong half of the time. (For the plain
+      // pointers in the AVL class, the compiler does this on its own, but it
+      // won't move atomic loads around like that.) This about doubles the
+      // speed of random lookups in a large tree.
+      const TreeNode* left = node->left.load(std::memory_order_acquire);
+      const TreeNode* right = node->right.load(std::memory_order_acquire);
+      node = (key < node->key) ? left : right;
+    }
+
+    if (found && data) {
+      *data = node->data;
+    }
+
+    // If the version is still the same, no rotation or removal happened
+    // during the search, so the answer is right. (If the search had seen any
+    // pointer that the writer changed after making the version odd, then
+    // because of the release and acquire, it would see the odd version, or
+    // a later one, here.)
+    if (steps <= MAX_PATH_LENGTH && version_.load(std::memory_order_acquire) == version) {
+      break;
+    }
+    retries_.fetch_add(1, std::memory_order_relaxed);
+  }
+  _exitRead(slot);
+  return found;
+}
+
+template <typename K, typename D>
+D ConcurrentAVL<K, D>::find(const K& key) const {
+  D data;
+  if (!_search(key, &data)) {
+    throw std::runtime_error("error in find(): key not found");
+  }
+  return data;
+}
+
+template <typename K, typename D>
+bool ConcurrentAVL<K, D>::tryFind(const K& key, D& data) const {
+  return _search(key, &data);
+}
+
+template <typename K, typename D>
+bool ConcurrentAVL<K, D>::contains(const K& key) const {
+  return _search(key, nullptr);
+}
+
+// ---- The writer ----
+
+template <typename K, typename D>
+void ConcurrentAVL<K, D>::_beginStructuralChange() {
+  if (in_structural_change_) return;
+  in_structural_change_ = true;
+  // Make the version odd. Every pointer change after this is a "release",
+  // so a search that sees one of them also sees the odd version.
+  version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+template <typename K, typename D>
+void ConcurrentAVL<K, D>::_endStructuralChange() {
+  if (!in_structural_change_) return;
+  in_structural_change_ = false;
+  version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+template <typename K, typename D>
+void ConcurrentAVL<K, D>::insert(const K& key, const D& data) {
+  std::lock_guard<std::mutex> guard(writer_lock_);
+
+  // Go down to the empty spot where the key belongs, recording the path.
+  std::atomic<TreeNode*>* path[MAX_PATH_LENGTH];
+  int depth = 0;
+  std::atomic<TreeNode*>* cur = &head_;
+  while (TreeNode* node = _load(*cur)) {
+    if (key == node->key) {
+      throw std::runtime_error("error in insert(): key already exists");
+    }
+    path[depth++] = cur;
+    cur = (key < node->key) ? &node->left : &node->right;
+  }
+
+  // Linking in a new leaf is a single pointer store, so searches see either
+  // the tree without it or the tree with it, and are never misled.
+  cur->store(new TreeNode(key, data), std::memory_order_release);
+
+  // Rebalance on the way up. _ensureBalance makes the version odd if (and
+  // only if) it has to rotate.
+  while (depth > 0) {
+    _ensureBalance(*path[--depth]);
+  }
+  _endStructuralChange();
+}
+
+template <typename K, typename D>
+D ConcurrentAVL<K, D>::remove(const K& key) {
+  std::lock_guard<std::mutex> guard(writer_lock_);
+
+  std::atomic<TreeNode*>* path[MAX_PATH_LENGTH];
+  int depth = 0;
+  std::atomic<TreeNode*>* cur = &head_;
+  TreeNode* node;
+  while ((node = _load(*cur)) && !(key == node->key)) {
+    path[depth++] = cur;
+    cur = (key < node->key) ? &node->left : &node->right;
+  }
+  if (!node) {
+    throw std::runtime_error("error in remove(): key not found");
+  }
+  D data = node->data;
+
+  // A removal always moves things around, so searches must check for it.
+  _beginStructuralChange();
+
+  TreeNode* left = _load(node->left);
+  TreeNode* right = _load(node->right);
+  if (left && right) {
+    _iopRemove(*cur);
+  }
+  else {
+    // Zero or one child: the child (or nullptr) takes the node's place.
+    cur->store(left ? left : right, std::memory_order_release);
+  }
+  _retire(node);
+
+  while (depth > 0) {
+    _ensureBalance(*path[--depth]);
+  }
+  _endStructuralChange();
+
+  _reclaim();
+  return data;
+}
+
+template <typename K, typename D>
+void ConcurrentAVL<K, D>::_iopRemove(std::atomic<TreeNode*>& target) {
+  // The AVL class swaps the target node with its in-order predecessor (IOP)
+  // and then removes it. We can't change any node's key, since searches may
+  // be reading it, so here the IOP node itself is moved into the target's
+  // place, just as _swap_nodes does in the AVL class.
+  TreeNode* node = _load(target);
+
+  // Find the IOP: left once, then right as far as possible.
+  std::atomic<TreeNode*>* iop_slot = &node->left;
+  while (_load(_load(*iop_slot)->right)) {
+    iop_slot = &_load(*iop_slot)->right;
+  }
+  TreeNode* iop = _load(*iop_slot);
+
+  // Unlink the IOP from where it was (its left child takes its place), and
+  // give it the target's children and height.
+  iop_slot->store(_load(iop->left), std::memory_order_release);
+  iop->left.store(_load(node->left), std::memory_order_release);
+  iop->right.store(_load(node->right), std::memory_order_release);
+  iop->height = node->height;
+  target.store(iop, std::memory_order_release);
+
+  // Now rebalance the right edge of the IOP's new left subtree, from the
+  // bottom up, since that's where a node went missing, and then the IOP.
+  std::atomic<TreeNode*>* path[MAX_PATH_LENGTH];
+  int depth = 0;
+  for (std::atomic<TreeNode*>* slot = &iop->left; _load(*slot); slot = &_load(*slot)->right) {
+    path[depth++] = slot;
+  }
+  while (depth > 0) {
+    _ensureBalance(*path[--depth]);
+  }
+  _ensureBalance(target);
+}
+
+template <typename K, typename D>
+void ConcurrentAVL<K, D>::_updateHeight(TreeNode* node) {
+  if (!node) return;
+  node->height = 1 + std::max(_get_height(_load(node->left)), _get_height(_load(node->right)));
+}
+
+template <typename K, typename D>
+int ConcurrentAVL<K, D>::_get_balance_factor(const TreeNode* node) const {
+  if (!node) return 0;
+  return _get_height(_load(node->right)) - _get_height(_load(node->left));
+}
+
+template <typename K, typename D>
+void ConcurrentAVL<K, D>::_ensureBalance(std::atomic<TreeNode*>& cur) {
+  TreeNode* node = _load(cur);
+  if (!node) return;
+
+  // The same cases as AVL::_ensureBalance. Any rotation has to be inside a
+  // structural change, so that searches can tell it happened.
+  const int balance = _get_balance_factor(node);
+  if (balance == -2) {
+    _beginStructuralChange();
+    if (_get_balance_factor(_load(node->left)) == 1) {
+      _rotateLeftRight(cur);
+    }
+    else {
+      _rotateRight(cur);
+    }
+  }
+  else if (balance == 2) {
+    _beginStructuralChange();
+    if (_get_balance_factor(_load(node->right)) == -1) {
+      _rotateRightLeft(cur);
+    }
+    else {
+      _rotateLeft(cur);
+    }
+  }
+
+  _updateHeight(_load(cur));
+}
+
+template <typename K, typename D>
+void ConcurrentAVL<K, D>::_rotateLeft(std::atomic<TreeNode*>& cur) {
+  TreeNode* x = _load(cur);
+  TreeNode* y = _load(x->right);
+  TreeNode* z = _load(y->left);
+
+  x->right.store(z, std::memory_order_release);
+  y->left.store(x, std::memory_order_release);
+  cur.store(y, std::memory_order_release);
+
+  _updateHeight(x);
+  _updateHeight(y);
+}
+
+template <typename K, typename D>
+void ConcurrentAVL<K, D>::_rotateRight(std::atomic<TreeNode*>& cur) {
+  TreeNode* x = _load(cur);
+  TreeNode* y = _load(x->left);
+  TreeNode* z = _load(y->right);
+
+  x->left.store(z, std::memory_order_release);
+  y->right.store(x, std::memory_order_release);
+  cur.store(y, std::memory_order_release);
+
+  _updateHeight(x);
+  _updateHeight(y);
+}
+
+template <typename K, typename D>
+void ConcurrentAVL<K, D>::_rotateRightLeft(std::atomic<TreeNode*>& cur) {
+  _rotateRight(_load(cur)->right);
+  _rotateLeft(cur);
+}
+
+template <typename K, typename D>
+void ConcurrentAVL<K, D>::_rotateLeftRight(std::atomic<TreeNode*>& cur) {
+  _rotateLeft(_load(cur)->left);
+  _rotateRight(cur);
+}
+
+// ---- Reclamation ----
+
+template <typename K, typename D>
+void ConcurrentAVL<K, D>::_retire(TreeNode* node) {
+  // The node is already unlinked. Moving to a new epoch means that any
+  // search that starts from now on announces a later epoch than this one,
+  // and can't reach the node.
+  const std::uint64_t epoch = epoch_.fetch_add(1, std::memory_order_seq_cst);
+  retired_.push_back(std::make_pair(node, epoch));
+}
+
+template <typename K, typename D>
+void ConcurrentAVL<K, D>::_reclaim() {
+  if (retired_.size() < RECLAIM_BATCH) return;
+
+  // The oldest epoch that a running search announced. Nodes removed before
+  // that epoch can't be reached by any running search.
+  //   These loads must be seq_cst, not just acquire. The writer stores to
+  // epoch_ and then loads a slot, while a reader stores to its slot and then
+  // loads epoch_. With anything weaker than seq_cst on both sides, C++
+  // allows each of them to miss the other's store, so the writer could see
+  // a free slot while the reader sees the old epoch and reaches a node that
+  // is about to be deleted.
+  std::uint64_t oldest = UINT64_MAX;
+  for (unsigned i = 0; i < READER_SLOTS; i++) {
+    const std::uint64_t epoch = slots_[i].epoch.load(std::memory_order_seq_cst);
+    if (epoch != 0) {
+      oldest = std::min(oldest, epoch);
+    }
+  }
+
+  std::size_t kept = 0;
+  for (std::size_t i = 0; i < retired_.size(); i++) {
+    if (retired_[i].second < oldest) {
+      delete retired_[i].first;
+    }
+    else {
+      retired_[kept++] = retired_[i];
+    }
+  }
+  retired_.resize(kept);
+}
+
+template <typename K, typename D>
+std::size_t ConcurrentAVL<K, D>::pendingReclaim() const {
+  std::lock_guard<std::mutex> guard(writer_lock_);
+  return retired_.size();
+}
+
+// C++14 compatibility: out-of-class definitions of the static constexpr
+// members.
+template <typename K, typename D> constexpr unsigned ConcurrentAVL<K, D>::CACHE_LINE_SIZE;
+template <typename K, typename D> constexpr unsigned ConcurrentAVL<K, D>::READER_SLOTS;
+template <typename K, typename D> constexpr int ConcurrentAVL<K, D>::MAX_PATH_LENGTH;
+template <typename K, typename D> constexpr std::size_t ConcurrentAVL<K, D>::RECLAIM_BATCH;
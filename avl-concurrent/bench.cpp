@@ -0,0 +1,138 @@
+/**
+ * ConcurrentAVL read-scaling benchmark: lookups per second with 1 to 64
+ * reader threads, while one writer thread keeps inserting and removing keys.
+ * For comparison, the same test runs on the AVL tree from ../avl behind a
+ * reader/writer lock (std::shared_timed_mutex), where the readers share the
+ * lock and the writer takes it alone.
+ *
+ * Build and run with:
+ *   make bench
+ *   ./bench [number of keys] [seconds per test] [max readers]
+ *
+ * The defaults are 1,000,000 keys, 0.5 seconds, and 64 readers. With more
+ * reader threads than cores, the threads take turns on the cores, so the
+ * total can't keep growing past the number of cores.
+ */
+
+// Turn off the brute-force checks that AVL.h runs after every insert and
+// remove; otherwise we would mostly be timing those.
+#define AVL_DEBUGGING_CHECKS 0
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "ConcurrentAVL.h"
+#include "../avl/AVL.h"
+
+// Seconds elapsed since "start", as a double.
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// The baseline: the plain AVL tree and a reader/writer lock.
+class LockedAVL {
+  public:
+    bool contains(int key) {
+      std::shared_lock<std::shared_timed_mutex> guard(lock_);
+      return tree_.contains(key);
+    }
+    void insert(int key, int data) {
+      std::unique_lock<std::shared_timed_mutex> guard(lock_);
+      tree_.insert(key, data);
+    }
+    int remove(int key) {
+      std::unique_lock<std::shared_timed_mutex> guard(lock_);
+      return tree_.remove(key);
+    }
+  private:
+    AVL<int, int, HeapNodeAllocator, StoreKeysAndData> tree_;
+    std::shared_timed_mutex lock_;
+};
+
+// Run "readers" threads doing random lookups, and one writer thread that
+// removes a random key and puts it back, over and over. Report the total
+// lookups and writes per second, and the fraction of lookups that found their
+// key. (Every key is in the tree except the one the writer is moving, so that
+// should be almost 100%. Printing it also makes sure the compiler can't skip
+// the lookups.)
+template <typename Tree>
+void runTest(Tree& tree, int keys, int readers, double seconds) {
+  std::atomic<bool> done(false);
+  std::atomic<long long> total_lookups(0);
+  std::atomic<long long> total_found(0);
+  long long writes = 0;
+
+  std::vector<std::thread> threads;
+  for (int r = 0; r < readers; r++) {
+    threads.push_back(std::thread([&tree, &done, &total_lookups, &total_found, keys, r]() {
+      unsigned x = 12345 + r;
+      long long count = 0, found = 0;
+      while (!done.load(std::memory_order_relaxed)) {
+        x = x * 1664525u + 1013904223u;
+        found += tree.contains((int)(x % keys));
+        count++;
+      }
+      total_lookups += count;
+      total_found += found;
+    }));
+  }
+  threads.push_back(std::thread([&tree, &done, &writes, keys]() {
+    unsigned x = 999;
+    while (!done.load(std::memory_order_relaxed)) {
+      x = x * 1103515245u + 12345u;
+      const int key = (int)((x >> 4) % keys);
+      tree.insert(key, tree.remove(key));
+      writes++;
+    }
+  }));
+
+  auto start = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+  done = true;
+  for (std::thread& t : threads) {
+    t.join();
+  }
+  const double elapsed = secondsSince(start);
+  std::cout << (total_lookups / elapsed / 1e6) << " M lookups/s, "
+    << (writes / elapsed / 1e3) << " K writes/s, "
+    << (100.0 * total_found / std::max(total_lookups.load(), 1LL)) << "% found";
+}
+
+int main(int argc, char* argv[]) {
+  const int N = (argc > 1) ? std::atoi(argv[1]) : 1000000;
+  const double SECONDS = (argc > 2) ? std::atof(argv[2]) : 0.5;
+  const int MAX_READERS = (argc > 3) ? std::atoi(argv[3]) : 64;
+
+  ConcurrentAVL<int, int> concurrent;
+  LockedAVL locked;
+  std::vector<int> keys(N);
+  for (int i = 0; i < N; i++) {
+    keys[i] = i;
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(12345));
+  for (const int& key : keys) {
+    concurrent.insert(key, key);
+    locked.insert(key, key);
+  }
+
+  std::cout << "Read scaling, " << N << " keys, one writer, "
+    << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+  for (int readers = 1; readers <= MAX_READERS; readers *= 2) {
+    std::cout << readers << " readers:" << std::endl;
+    std::cout << "  ConcurrentAVL:      ";
+    runTest(concurrent, N, readers, SECONDS);
+    std::cout << ", " << concurrent.retries() << " retries so far" << std::endl;
+    std::cout << "  AVL + shared mutex: ";
+    runTest(locked, N, readers, SECONDS);
+    std::cout << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,116 @@
+/**
+ * ConcurrentAVL example usage, and a stress test with one writer thread and
+ * several reader threads.
+ *
+ * The stress test is most useful when built with ThreadSanitizer, which
+ * reports any data race it sees:
+ *   g++ -std=c++14 -g -O1 -pthread -fsanitize=thread main.cpp -o main-tsan
+ */
+
+#include <atomic>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ConcurrentAVL.h"
+
+// stressTest: The writer keeps inserting and removing the odd keys, while
+// the even keys stay in the tree the whole time. Every reader must always
+// find every even key, since it never leaves the tree, no matter which
+// rotations happen around it. An odd key may or may not be found, but if it
+// is, its data must be right.
+void stressTest() {
+  const int KEYS = 4000, READERS = 4, WRITES = 100000;
+  ConcurrentAVL<int, std::string> tree;
+  for (int key = 0; key < KEYS; key += 2) {
+    tree.insert(key, std::to_string(key));
+  }
+
+  std::atomic<bool> done(false);
+  std::atomic<long> lookups(0);
+  std::vector<std::thread> readers;
+  for (int r = 0; r < READERS; r++) {
+    readers.push_back(std::thread([&tree, &done, &lookups, r]() {
+      long count = 0;
+      unsigned key = r;
+      std::string data;
+      while (!done.load()) {
+        key = (key * 1103515245u + 12345u) % KEYS;
+        const bool found = tree.tryFind((int)key, data);
+        if (key % 2 == 0 && !found) {
+          throw std::runtime_error("ConcurrentAVL test failed: a key that was never removed was not found");
+        }
+        if (found && data != std::to_string(key)) {
+          throw std::runtime_error("ConcurrentAVL test failed: found the wrong data");
+        }
+        count++;
+      }
+      lookups += count;
+    }));
+  }
+
+  // The writer, on this thread. It mirrors its changes in a std::set.
+  std::set<int> present;
+  unsigned x = 99;
+  for (int i = 0; i < WRITES; i++) {
+    x = x * 1664525u + 1013904223u;
+    const int key = (int)((x >> 8) % (KEYS / 2)) * 2 + 1;
+    if (present.count(key)) {
+      if (tree.remove(key) != std::to_string(key)) {
+        throw std::runtime_error("ConcurrentAVL test failed: remove returned the wrong data");
+      }
+      present.erase(key);
+    }
+    else {
+      tree.insert(key, std::to_string(key));
+      present.insert(key);
+    }
+  }
+  done = true;
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+
+  // With nothing running, the tree must match the set exactly.
+  for (int key = 0; key < KEYS; key++) {
+    const bool expected = (key % 2 == 0) || present.count(key);
+    if (tree.contains(key) != expected) {
+      throw std::runtime_error("ConcurrentAVL test failed: wrong contents after the stress test");
+    }
+  }
+  std::cout << "Stress test: " << WRITES << " writes, " << lookups << " lookups on "
+    << READERS << " reader threads, " << tree.retries() << " retries, "
+    << tree.pendingReclaim() << " nodes waiting to be deleted" << std::endl;
+}
+
+int main() {
+  // On a single thread, ConcurrentAVL works just like AVL, except that
+  // find returns a copy of the data.
+  ConcurrentAVL<int, std::string> tree;
+  for (int i = 0; i < 100; i++) {
+    tree.insert(i, "value " + std::to_string(i));
+  }
+  std::cout << "tree.find(42): " << tree.find(42) << std::endl;
+  for (int i = 0; i < 100; i += 3) {
+    tree.remove(i);
+  }
+  for (int i = 0; i < 100; i++) {
+    if (tree.contains(i) != (i % 3 != 0)) {
+      throw std::runtime_error("ConcurrentAVL test failed: wrong contents");
+    }
+  }
+  try {
+    tree.find(42);
+  }
+  catch (const std::runtime_error& e) {
+    std::cout << "tree.find(42) after removing it: " << e.what() << std::endl;
+  }
+
+  stressTest();
+
+  std::cout << "ConcurrentAVL tests passed." << std::endl;
+  return 0;
+}
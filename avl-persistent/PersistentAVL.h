@@ -0,0 +1,177 @@
+/**
+ * PersistentAVL: an AVL tree where every change makes a new version of the
+ * tree and leaves the old versions untouched, so that any old version can
+ * still be read as a "snapshot".
+ */
+
+// Please first study the AVL example in ../avl. This tree keeps its balance
+// with the same rules and the same four kinds of rotations. What's different
+// is that a node is never changed after it's created.
+
+// How it works: "path copying".
+// To insert a key into the AVL class, we go down a path from the root to
+// the spot where the key belongs, add a node, and then fix the heights and
+// rotate on the way back up. Only the nodes on that path change. Everything
+// hanging off the path is left alone.
+//   So instead of changing the nodes on the path, we make new copies of
+// them, and each copy points to the same untouched subtrees as the original.
+// The copy of the root is the root of the new version. The old root still
+// points to the old nodes, so the old version is still all there, and the
+// two versions share every node except the O(log n) ones on the path.
+// Rotations just build their new nodes in the new arrangement, which adds
+// at most a few more new nodes per level.
+//   Making a snapshot is then trivial: a snapshot is just another pointer to
+// a root, so copying a PersistentAVL object takes O(1) time, no matter how
+// big the tree is.
+
+// Who deletes the nodes?
+// A node can be part of many versions at once, so no single version owns it.
+// We use std::shared_ptr, which counts how many pointers point to each node
+// (a "reference count"). When the last version that uses a node goes away,
+// the count drops to zero and the node is deleted, which in turn lets go of
+// its children. So an old version is reclaimed as soon as nobody holds it,
+// and any nodes it shares with newer versions stay alive.
+//   std::make_shared puts the reference count in the same allocation as the
+// node, so each node is one trip to the allocator.
+
+// Using snapshots from other threads:
+// Since a version never changes, any number of threads can read the same
+// version at the same time, while another thread is making new versions,
+// with no locks at all. The reference counts inside std::shared_ptr are
+// updated atomically, so it's also safe for threads to copy and drop
+// versions that share nodes. The only thing that needs care is a single
+// PersistentAVL variable that one thread assigns while others copy it (such
+// as "the latest version"): like any variable, that needs a mutex, or the
+// std::atomic_load and std::atomic_store functions for std::shared_ptr.
+// See main.cpp for an example.
+
+#pragma once
+
+// PERSISTENT_AVL_COUNT_NODES: Set this to 1 before including this file to
+// keep a count of the nodes that exist (see liveNodes below). Every node
+// that is created or deleted then updates one shared atomic counter, which
+// costs time and makes the threads that build versions compete for it, so
+// the default is 0, which leaves the counter out. Every file of a program
+// has to use the same setting.
+#ifndef PERSISTENT_AVL_COUNT_NODES
+#define PERSISTENT_AVL_COUNT_NODES 0
+#endif
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+template <typename K, typename D>
+class PersistentAVL {
+  public:
+    // An empty tree.
+    PersistentAVL() : head_(nullptr), size_(0) { }
+
+    // The default copy constructor and assignment operator are exactly what
+    // we want: they copy the root pointer, which makes a snapshot in O(1)
+    // time. (Compare the AVL class, which has to forbid shallow copies
+    // because each tree owns its nodes.)
+
+    // find: Return a reference to the data for the key, or throw if the key
+    // is not in this version. The reference stays valid as long as this
+    // version, or any other version that still has the same node, exists.
+    const D& find(const K& key) const;
+    bool contains(const K& key) const;
+
+    // insert and remove don't change this version. They return a new
+    // version with the change made. Each call creates O(log n) new nodes and
+    // shares all the rest with this version. As in the AVL class, insert
+    // throws if the key already exists, and remove throws if it doesn't.
+    //   Example:
+    //     PersistentAVL<int, std::string> v1;
+    //     PersistentAVL<int, std::string> v2 = v1.insert(5, "five");
+    //     // Now v1 is still empty, and v2 contains 5.
+    PersistentAVL insert(const K& key, const D& data) const;
+    PersistentAVL remove(const K& key) const;
+
+    bool empty() const { return !head_; }
+    std::size_t size() const { return size_; }
+    int height() const { return _get_height(head_.get()); }
+
+#if PERSISTENT_AVL_COUNT_NODES
+    // liveNodes: How many nodes exist right now, across all versions of all
+    // PersistentAVL<K, D> trees. This is meant for tests and benchmarks, to
+    // see how many nodes the versions share and that old ones are reclaimed.
+    // It only exists when PERSISTENT_AVL_COUNT_NODES is set (see above).
+    static std::size_t liveNodes() { return live_nodes_.load(std::memory_order_relaxed); }
+#endif
+
+    // runDebuggingChecks: Check the heights, the balance, and the order of
+    // the keys throughout this version, like the function of the same name
+    // in the AVL class. Throws if anything is wrong. This takes O(n) time.
+    void runDebuggingChecks() const;
+
+  private:
+    class TreeNode;
+    // The children are pointers to const nodes, since no node is ever
+    // changed after it's built.
+    using NodePtr = std::shared_ptr<const TreeNode>;
+
+    class TreeNode {
+      public:
+        // The key and data are copied into the node, since there's no single
+        // owner who could keep the originals alive for every version.
+        const K key;
+        const D data;
+        const NodePtr left;
+        const NodePtr right;
+        const int height;
+
+        TreeNode(const K& keyArgument, const D& dataArgument, NodePtr leftArgument,
+          NodePtr rightArgument, int heightArgument)
+          : key(keyArgument), data(dataArgument), left(std::move(leftArgument)),
+            right(std::move(rightArgument)), height(heightArgument) {
+#if PERSISTENT_AVL_COUNT_NODES
+          live_nodes_.fetch_add(1, std::memory_order_relaxed);
+#endif
+        }
+
+#if PERSISTENT_AVL_COUNT_NODES
+        ~TreeNode() {
+          live_nodes_.fetch_sub(1, std::memory_order_relaxed);
+        }
+#endif
+    };
+
+    // The root of this version, and how many keys it has.
+    NodePtr head_;
+    std::size_t size_;
+
+#if PERSISTENT_AVL_COUNT_NODES
+    static std::atomic<std::size_t> live_nodes_;
+#endif
+
+    PersistentAVL(NodePtr head, std::size_t size) : head_(std::move(head)), size_(size) { }
+
+    static int _get_height(const TreeNode* node) { return node ? node->height : -1; }
+
+    // _makeNode: Build a new node with the given children, with its height
+    // worked out from theirs. The children must already be balanced.
+    static NodePtr _makeNode(const K& key, const D& data, NodePtr left, NodePtr right);
+
+    // _balance: The persistent version of the AVL class's _ensureBalance.
+    // Build a node for key and data with new children "left" and "right",
+    // whose heights may differ by up to two, and perform whatever rotation
+    // is needed so that the result is balanced. Returns the new subtree.
+    static NodePtr _balance(const K& key, const D& data, NodePtr left, NodePtr right);
+
+    // The recursive helpers for insert and remove. Each returns the new root
+    // of the subtree that it was given. The original subtree is unchanged.
+    static NodePtr _insert(const NodePtr& node, const K& key, const D& data);
+    static NodePtr _remove(const NodePtr& node, const K& key);
+    // _removeMax: Return the subtree without its largest node, and point
+    // "max" at that node. This finds the in-order predecessor for _remove.
+    static NodePtr _removeMax(const NodePtr& node, NodePtr& max);
+
+    // Debugging checks. Each returns false if the subtree is wrong.
+    static bool _debugHeightAndBalanceCheck(const TreeNode* node);
+    static bool _debugOrderCheck(const TreeNode* node, const K* low, const K* high);
+};
+
+#include "PersistentAVL.hpp"
@@ -0,0 +1,198 @@
+/**
+ * PersistentAVL: Implementation. Please see the notes in PersistentAVL.h.
+ */
+
+#pragma once
+
+#include "PersistentAVL.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+// A note about recursion:
+// The AVL class writes insert and remove as loops that record the path, and
+// then fixes the nodes on the path afterwards. Here, every node on the path
+// is replaced by a new one, and a new node can only be built once its new
+// children exist. That fits recursion naturally: each call builds the new
+// subtree below it first, and then its own new node on the way back up. The
+// recursion only goes as deep as the height of the tree, which is O(log n).
+
+template <typename K, typename D>
+const D& PersistentAVL<K, D>::find(const K& key) const {
+  const TreeNode* node = head_.get();
+  while (node) {
+    if (key == node->key) {
+      return node->data;
+    }
+    node = (key < node->key) ? node->left.get() : node->right.get();
+  }
+  throw std::runtime_error("error in find(): key not found");
+}
+
+template <typename K, typename D>
+bool PersistentAVL<K, D>::contains(const K& key) const {
+  const TreeNode* node = head_.get();
+  while (node) {
+    if (key == node->key) {
+      return true;
+    }
+    node = (key < node->key) ? node->left.get() : node->right.get();
+  }
+  return false;
+}
+
+template <typename K, typename D>
+PersistentAVL<K, D> PersistentAVL<K, D>::insert(const K& key, const D& data) const {
+  return PersistentAVL(_insert(head_, key, data), size_ + 1);
+}
+
+template <typename K, typename D>
+PersistentAVL<K, D> PersistentAVL<K, D>::remove(const K& key) const {
+  return PersistentAVL(_remove(head_, key), size_ - 1);
+}
+
+template <typename K, typename D>
+typename PersistentAVL<K, D>::NodePtr PersistentAVL<K, D>::_makeNode(
+  const K& key, const D& data, NodePtr left, NodePtr right) {
+
+  const int height = 1 + std::max(_get_height(left.get()), _get_height(right.get()));
+  return std::make_shared<const TreeNode>(key, data, std::move(left), std::move(right), height);
+}
+
+template <typename K, typename D>
+typename PersistentAVL<K, D>::NodePtr PersistentAVL<K, D>::_balance(
+  const K& key, const D& data, NodePtr left, NodePtr right) {
+
+  // These are the same four cases as in AVL::_ensureBalance, but instead of
+  // moving pointers around, we build the nodes that come out of the
+  // rotation. The subtrees hanging below the rotated nodes (called A, B, C
+  // and D below) are reused as they are, so a rotation costs at most two
+  // extra new nodes.
+  const int balance = _get_height(right.get()) - _get_height(left.get());
+
+  if (balance == 2) {
+    const TreeNode& r = *right;
+    if (_get_height(r.left.get()) > _get_height(r.right.get())) {
+      // Right-left case: r's left child "rl" comes up to the top. Writing
+      // each subtree as (root left right):
+      //   (key A (r (rl B C) D))  becomes  (rl (key A B) (r C D))
+      const TreeNode& rl = *r.left;
+      return _makeNode(rl.key, rl.data,
+        _makeNode(key, data, std::move(left), rl.left),
+        _makeNode(r.key, r.data, rl.right, r.right));
+    }
+    // Right-right case: a single left rotation brings r up to the top.
+    return _makeNode(r.key, r.data, _makeNode(key, data, std::move(left), r.left), r.right);
+  }
+
+  if (balance == -2) {
+    const TreeNode& l = *left;
+    if (_get_height(l.right.get()) > _get_height(l.left.get())) {
+      // Left-right case: the mirror image of the right-left case.
+      const TreeNode& lr = *l.right;
+      return _makeNode(lr.key, lr.data,
+        _makeNode(l.key, l.data, l.left, lr.left),
+        _makeNode(key, data, lr.right, std::move(right)));
+    }
+    // Left-left case: a single right rotation.
+    return _makeNode(l.key, l.data, l.left, _makeNode(key, data, l.right, std::move(right)));
+  }
+
+  // Already balanced.
+  return _makeNode(key, data, std::move(left), std::move(right));
+}
+
+template <typename K, typename D>
+typename PersistentAVL<K, D>::NodePtr PersistentAVL<K, D>::_insert(
+  const NodePtr& node, const K& key, const D& data) {
+
+  if (!node) {
+    return _makeNode(key, data, nullptr, nullptr);
+  }
+  if (key == node->key) {
+    throw std::runtime_error("error in insert(): key already exists");
+  }
+  // Only one side changes. The other side is shared with the old version.
+  if (key < node->key) {
+    return _balance(node->key, node->data, _insert(node->left, key, data), node->right);
+  }
+  else {
+    return _balance(node->key, node->data, node->left, _insert(node->right, key, data));
+  }
+}
+
+template <typename K, typename D>
+typename PersistentAVL<K, D>::NodePtr PersistentAVL<K, D>::_remove(
+  const NodePtr& node, const K& key) {
+
+  if (!node) {
+    throw std::runtime_error("error in remove(): key not found");
+  }
+  if (key < node->key) {
+    return _balance(node->key, node->data, _remove(node->left, key), node->right);
+  }
+  if (node->key < key) {
+    return _balance(node->key, node->data, node->left, _remove(node->right, key));
+  }
+
+  // This is the node to remove. With zero or one child, the child (or
+  // nothing) simply takes its place in the new version.
+  if (!node->left) return node->right;
+  if (!node->right) return node->left;
+
+  // With two children, the in-order predecessor (IOP) takes its place, as
+  // in the AVL class. We can't swap anything in place, so instead we build
+  // a new node with the IOP's key and data, over the left subtree without
+  // the IOP.
+  NodePtr iop;
+  NodePtr left = _removeMax(node->left, iop);
+  return _balance(iop->key, iop->data, std::move(left), node->right);
+}
+
+template <typename K, typename D>
+typename PersistentAVL<K, D>::NodePtr PersistentAVL<K, D>::_removeMax(
+  const NodePtr& node, NodePtr& max) {
+
+  if (!node->right) {
+    max = node;
+    return node->left;
+  }
+  return _balance(node->key, node->data, node->left, _removeMax(node->right, max));
+}
+
+template <typename K, typename D>
+void PersistentAVL<K, D>::runDebuggingChecks() const {
+  if (!_debugHeightAndBalanceCheck(head_.get())) {
+    throw std::runtime_error("ERROR: _debugHeightAndBalanceCheck failed");
+  }
+  if (!_debugOrderCheck(head_.get(), nullptr, nullptr)) {
+    throw std::runtime_error("ERROR: _debugOrderCheck failed");
+  }
+}
+
+template <typename K, typename D>
+bool PersistentAVL<K, D>::_debugHeightAndBalanceCheck(const TreeNode* node) {
+  if (!node) return true;
+  if (!_debugHeightAndBalanceCheck(node->left.get())) return false;
+  if (!_debugHeightAndBalanceCheck(node->right.get())) return false;
+  const int left_height = _get_height(node->left.get());
+  const int right_height = _get_height(node->right.get());
+  if (node->height != 1 + std::max(left_height, right_height)) return false;
+  return std::abs(right_height - left_height) <= 1;
+}
+
+template <typename K, typename D>
+bool PersistentAVL<K, D>::_debugOrderCheck(const TreeNode* node, const K* low, const K* high) {
+  // Every key must be after "low" and before "high", when those are given.
+  if (!node) return true;
+  if (low && !(*low < node->key)) return false;
+  if (high && !(node->key < *high)) return false;
+  return _debugOrderCheck(node->left.get(), low, &node->key)
+    && _debugOrderCheck(node->right.get(), &node->key, high);
+}
+
+#if PERSISTENT_AVL_COUNT_NODES
+template <typename K, typename D>
+std::atomic<std::size_t> PersistentAVL<K, D>::live_nodes_(0);
+#endif
@@ -0,0 +1,165 @@
+/**
+ * PersistentAVL memory benchmark: keeping many snapshots of a large tree
+ * that changes a little between snapshots, compared with keeping a full
+ * copy of the AVL tree from ../avl for each snapshot.
+ *
+ * Build and run with:
+ *   make bench
+ *   ./bench [number of keys] [number of snapshots] [updates between snapshots]
+ *
+ * The defaults are 200,000 keys, 20 snapshots and 1,000 updates. An update
+ * removes a random key and puts it back with new data.
+ */
+
+// Turn off the brute-force checks that AVL.h runs after every insert and
+// remove; otherwise we would mostly be timing those.
+#define AVL_DEBUGGING_CHECKS 0
+// We report how many nodes all of the snapshots share. (See PersistentAVL.h.)
+#define PERSISTENT_AVL_COUNT_NODES 1
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "PersistentAVL.h"
+#include "../avl/AVL.h"
+
+// To measure memory, this program replaces the global operator new and
+// operator delete with versions that keep count of how many bytes are
+// allocated right now. Each block gets a small header that remembers its
+// size. The header is as big as the strictest alignment, so the memory
+// after it is still aligned for anything.
+static std::size_t allocated_bytes = 0;
+static constexpr std::size_t HEADER_SIZE = alignof(std::max_align_t);
+
+void* operator new(std::size_t size) {
+  void* block = std::malloc(size + HEADER_SIZE);
+  if (!block) throw std::bad_alloc();
+  *static_cast<std::size_t*>(block) = size;
+  allocated_bytes += size;
+  return static_cast<char*>(block) + HEADER_SIZE;
+}
+
+void operator delete(void* ptr) noexcept {
+  if (!ptr) return;
+  void* block = static_cast<char*>(ptr) - HEADER_SIZE;
+  allocated_bytes -= *static_cast<std::size_t*>(block);
+  std::free(block);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+  operator delete(ptr);
+}
+
+// Seconds elapsed since "start", as a double.
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+using Copied = AVL<int, int, HeapNodeAllocator, StoreKeysAndData>;
+
+// fullCopy: The fastest way to copy an AVL tree: read its items in order and
+// bulk-build a new tree from them, in O(n) time.
+static std::unique_ptr<Copied> fullCopy(const Copied& tree) {
+  std::vector<int> keys, data;
+  for (const auto& item : tree) {
+    keys.push_back(item.key);
+    data.push_back(item.data);
+  }
+  return std::unique_ptr<Copied>(new Copied(keys.begin(), keys.end(), data.begin()));
+}
+
+int main(int argc, char* argv[]) {
+  const int N = (argc > 1) ? std::atoi(argv[1]) : 200000;
+  const int SNAPSHOTS = (argc > 2) ? std::atoi(argv[2]) : 20;
+  const int UPDATES = (argc > 3) ? std::atoi(argv[3]) : 1000;
+
+  std::vector<int> keys(N);
+  for (int i = 0; i < N; i++) {
+    keys[i] = i;
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(12345));
+
+  std::cout << N << " keys, " << SNAPSHOTS << " snapshots, " << UPDATES
+    << " updates between snapshots" << std::endl;
+
+  // PersistentAVL: each snapshot is a copy of the current version.
+  {
+    const std::size_t start_bytes = allocated_bytes;
+    PersistentAVL<int, int> tree;
+    for (const int& key : keys) {
+      tree = tree.insert(key, key);
+    }
+    const std::size_t one_tree = allocated_bytes - start_bytes;
+
+    std::vector<PersistentAVL<int, int>> snapshots;
+    double snapshot_seconds = 0, update_seconds = 0;
+    unsigned x = 99;
+    for (int s = 0; s < SNAPSHOTS; s++) {
+      auto start = std::chrono::steady_clock::now();
+      for (int u = 0; u < UPDATES; u++) {
+        x = x * 1664525u + 1013904223u;
+        const int key = (int)(x % N);
+        tree = tree.remove(key).insert(key, s);
+      }
+      update_seconds += secondsSince(start);
+      start = std::chrono::steady_clock::now();
+      snapshots.push_back(tree);
+      snapshot_seconds += secondsSince(start);
+    }
+    const std::size_t total = allocated_bytes - start_bytes;
+
+    std::cout << "PersistentAVL:" << std::endl;
+    std::cout << "  one tree:           " << (one_tree / 1e6) << " MB" << std::endl;
+    std::cout << "  with all snapshots: " << (total / 1e6) << " MB ("
+      << PersistentAVL<int, int>::liveNodes() << " nodes, "
+      << ((double)total / one_tree) << "x one tree)" << std::endl;
+    std::cout << "  per snapshot:       " << (snapshot_seconds / SNAPSHOTS * 1e9) << " ns" << std::endl;
+    std::cout << "  per update:         " << (update_seconds / (SNAPSHOTS * UPDATES) * 1e9)
+      << " ns" << std::endl;
+  }
+
+  // AVL: each snapshot is a full copy of the current tree.
+  {
+    const std::size_t start_bytes = allocated_bytes;
+    Copied tree;
+    for (const int& key : keys) {
+      tree.insert(key, key);
+    }
+    const std::size_t one_tree = allocated_bytes - start_bytes;
+
+    std::vector<std::unique_ptr<Copied>> snapshots;
+    double snapshot_seconds = 0, update_seconds = 0;
+    unsigned x = 99;
+    for (int s = 0; s < SNAPSHOTS; s++) {
+      auto start = std::chrono::steady_clock::now();
+      for (int u = 0; u < UPDATES; u++) {
+        x = x * 1664525u + 1013904223u;
+        const int key = (int)(x % N);
+        tree.remove(key);
+        tree.insert(key, s);
+      }
+      update_seconds += secondsSince(start);
+      start = std::chrono::steady_clock::now();
+      snapshots.push_back(fullCopy(tree));
+      snapshot_seconds += secondsSince(start);
+    }
+    const std::size_t total = allocated_bytes - start_bytes;
+
+    std::cout << "AVL with full copies:" << std::endl;
+    std::cout << "  one tree:           " << (one_tree / 1e6) << " MB" << std::endl;
+    std::cout << "  with all snapshots: " << (total / 1e6) << " MB ("
+      << ((double)total / one_tree) << "x one tree)" << std::endl;
+    std::cout << "  per snapshot:       " << (snapshot_seconds / SNAPSHOTS * 1e9) << " ns" << std::endl;
+    std::cout << "  per update:         " << (update_seconds / (SNAPSHOTS * UPDATES) * 1e9)
+      << " ns" << std::endl;
+  }
+
+  return 0;
+}
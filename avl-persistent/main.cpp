@@ -0,0 +1,168 @@
+/**
+ * PersistentAVL example usage and tests.
+ */
+
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The sharing test below counts the nodes. (See PersistentAVL.h.)
+#define PERSISTENT_AVL_COUNT_NODES 1
+#include "PersistentAVL.h"
+
+using Tree = PersistentAVL<int, std::string>;
+
+// checkVersion: Make sure a version holds exactly the items in "expected",
+// for the keys from 0 to maxKey.
+void checkVersion(const Tree& tree, const std::map<int, std::string>& expected, int maxKey) {
+  tree.runDebuggingChecks();
+  if (tree.size() != expected.size()) {
+    throw std::runtime_error("PersistentAVL test failed: wrong size");
+  }
+  for (int key = 0; key <= maxKey; key++) {
+    auto it = expected.find(key);
+    if (tree.contains(key) != (it != expected.end())) {
+      throw std::runtime_error("PersistentAVL test failed: contains gave the wrong answer");
+    }
+    if (it != expected.end() && tree.find(key) != it->second) {
+      throw std::runtime_error("PersistentAVL test failed: find returned the wrong data");
+    }
+  }
+}
+
+// randomVersionsTest: Make a long series of random changes, keeping every
+// 50th version, along with a std::map copy of what it should contain. At the
+// end, every saved version must still be exactly as it was.
+void randomVersionsTest() {
+  const int MAX_KEY = 500;
+  std::vector<Tree> versions;
+  std::vector<std::map<int, std::string>> expected;
+
+  Tree tree;
+  std::map<int, std::string> items;
+  unsigned x = 7;
+  for (int i = 0; i < 5000; i++) {
+    x = x * 1664525u + 1013904223u;
+    const int key = (int)((x >> 8) % (MAX_KEY + 1));
+    if (items.count(key)) {
+      tree = tree.remove(key);
+      items.erase(key);
+    }
+    else {
+      tree = tree.insert(key, "v" + std::to_string(i));
+      items[key] = "v" + std::to_string(i);
+    }
+    if (i % 50 == 0) {
+      versions.push_back(tree);
+      expected.push_back(items);
+    }
+  }
+
+  for (std::size_t v = 0; v < versions.size(); v++) {
+    checkVersion(versions[v], expected[v], MAX_KEY);
+  }
+}
+
+// sharingTest: An update to a big tree must only create O(log n) new nodes,
+// and dropping versions must free their nodes.
+void sharingTest() {
+  {
+    PersistentAVL<int, int> tree;
+    for (int key = 0; key < 100000; key++) {
+      tree = tree.insert(key, key);
+    }
+    const std::size_t before = PersistentAVL<int, int>::liveNodes();
+    if (before != tree.size()) {
+      throw std::runtime_error("PersistentAVL test failed: old versions were not reclaimed");
+    }
+
+    // Keep the old version, so that nothing is freed.
+    PersistentAVL<int, int> newer = tree.remove(50000).insert(100000, 0);
+    const std::size_t created = PersistentAVL<int, int>::liveNodes() - before;
+    // Each level of the path gets a new node, plus at most two more for a
+    // rotation; over two updates that's at most 6 per level.
+    const std::size_t limit = 6 * (tree.height() + 2);
+    std::cout << "Two updates to a tree of " << tree.size() << " keys (height "
+      << tree.height() << ") created " << created << " new nodes" << std::endl;
+    if (created > limit) {
+      throw std::runtime_error("PersistentAVL test failed: an update copied too many nodes");
+    }
+    if (!tree.contains(50000) || tree.contains(100000) || newer.contains(50000) || !newer.contains(100000)) {
+      throw std::runtime_error("PersistentAVL test failed: versions are mixed up");
+    }
+  }
+  if (PersistentAVL<int, int>::liveNodes() != 0) {
+    throw std::runtime_error("PersistentAVL test failed: nodes leaked");
+  }
+}
+
+// snapshotThreadsTest: A writer thread keeps publishing new versions, where
+// version i holds exactly the keys 0 to i-1. Reader threads grab the latest
+// version and check that it's complete and consistent, no matter what the
+// writer does meanwhile. The latest version is shared through a
+// std::shared_ptr with std::atomic_load and std::atomic_store.
+void snapshotThreadsTest() {
+  using IntTree = PersistentAVL<int, int>;
+  const int VERSIONS = 2000;
+  std::shared_ptr<const IntTree> latest = std::make_shared<const IntTree>();
+
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 3; r++) {
+    readers.push_back(std::thread([&latest, VERSIONS]() {
+      while (true) {
+        std::shared_ptr<const IntTree> snapshot = std::atomic_load(&latest);
+        const int n = (int)snapshot->size();
+        for (int key = 0; key < n; key += 97) {
+          if (snapshot->find(key) != key * 10) {
+            throw std::runtime_error("PersistentAVL test failed: a snapshot changed");
+          }
+        }
+        if (snapshot->contains(n)) {
+          throw std::runtime_error("PersistentAVL test failed: a snapshot has a key from the future");
+        }
+        if (n == VERSIONS) break;
+      }
+    }));
+  }
+
+  IntTree tree;
+  for (int i = 0; i < VERSIONS; i++) {
+    tree = tree.insert(i, i * 10);
+    std::atomic_store(&latest, std::make_shared<const IntTree>(tree));
+  }
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+}
+
+int main() {
+  Tree v1;
+  Tree v2 = v1.insert(1, "one").insert(2, "two").insert(3, "three");
+  // A snapshot is just a copy.
+  Tree snapshot = v2;
+  Tree v3 = v2.remove(2).insert(4, "four");
+
+  std::cout << "v1 has " << v1.size() << " keys" << std::endl;
+  std::cout << "snapshot of v2: contains(2) = " << snapshot.contains(2)
+    << ", contains(4) = " << snapshot.contains(4) << std::endl;
+  std::cout << "v3: contains(2) = " << v3.contains(2)
+    << ", find(4) = " << v3.find(4) << std::endl;
+
+  try {
+    std::cout << "v3.find(2): " << v3.find(2) << std::endl;
+  }
+  catch (const std::runtime_error& e) {
+    std::cout << e.what() << std::endl;
+  }
+
+  randomVersionsTest();
+  sharingTest();
+  snapshotThreadsTest();
+
+  std::cout << "PersistentAVL tests passed." << std::endl;
+  return 0;
+}
@@ -0,0 +1,257 @@
+/**
+ * AVL tree - Bulk building from sorted input, and merging sorted batches.
+ */
+
+#pragma once
+
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#include "AVL.hpp"
+
+// A note about why the bulk build works:
+// If we always pick the middle item of a sorted range as the subtree root,
+// then build the left half and the right half the same way, the two halves
+// differ in size by at most one item. It can be shown that their heights
+// then differ by at most one as well, so every node is AVL-balanced and no
+// rotations are ever needed. Each item is visited once, so this takes O(n)
+// time, compared to O(n log n) for n separate calls to insert.
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+template <typename KeyIterator>
+std::size_t AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_checkSortedBatch(
+  KeyIterator keys_begin, KeyIterator keys_end) {
+
+  // The keys are read here, and then again to build the tree, so the
+  // iterator has to allow more than one pass. An input iterator such as
+  // std::istream_iterator would give us different keys the second time.
+  static_assert(std::is_base_of<std::forward_iterator_tag,
+      typename std::iterator_traits<KeyIterator>::iterator_category>::value,
+    "the bulk operations read the keys twice, so KeyIterator must be at least a forward iterator");
+
+  // We check the whole batch before we create any nodes, so that if there's
+  // a problem, we can throw without having to clean anything up.
+  std::size_t count = 0;
+  KeyIterator prev = keys_begin;
+  for (KeyIterator it = keys_begin; it != keys_end; ++it) {
+    if (count > 0 && _compare(*prev, *it) >= 0) {
+      throw std::runtime_error("error in bulk build: keys are not in strictly increasing order");
+    }
+    prev = it;
+    count++;
+  }
+  return count;
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+template <typename KeyIterator, typename DataIterator>
+AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::AVL(
+  KeyIterator keys_begin, KeyIterator keys_end, DataIterator data_begin)
+  : head_(nullptr) {
+
+  const std::size_t count = _checkSortedBatch(keys_begin, keys_end);
+  head_ = _buildFromSorted(keys_begin, data_begin, count);
+
+  runDebuggingChecks();
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+template <typename KeyIterator, typename DataIterator>
+typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::TreeNode* AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_buildFromSorted(
+  KeyIterator& key_it, DataIterator& data_it, std::size_t count) {
+
+  if (count == 0) return nullptr;
+
+  // The iterators only move forward, so we have to build the subtree in
+  // order: first the left half, then the root, then the right half.
+  const std::size_t left_count = (count - 1) / 2;
+  TreeNode* left = _buildFromSorted(key_it, data_it, left_count);
+
+  // Note that with the default storage policy, *key_it and *data_it must
+  // be references to the caller's items, since the node will store
+  // references to them.
+  //   If the storage policy copies the key or data, that copy can throw.
+  // Nothing points to the nodes that we've built so far except our local
+  // variables, so before we pass the exception on, we destroy them here.
+  // Otherwise they would leak. (Each level of the recursion cleans up its
+  // own part.)
+  TreeNode* node = nullptr;
+  try {
+    node = nodes_.create(*key_it, *data_it);
+    ++key_it;
+    ++data_it;
+  }
+  catch (...) {
+    _destroySubtree(left);
+    throw;
+  }
+
+  node->left = left;
+  try {
+    node->right = _buildFromSorted(key_it, data_it, count - 1 - left_count);
+  }
+  catch (...) {
+    _destroySubtree(node);
+    throw;
+  }
+  _updateHeight(node);
+  return node;
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::TreeNode* AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_buildFromNodes(
+  std::vector<TreeNode*>& nodes, std::size_t first, std::size_t last) {
+
+  // This is the same idea as _buildFromSorted, but the nodes already
+  // exist, so we only need to relink them.
+  if (first == last) return nullptr;
+
+  const std::size_t middle = first + (last - first - 1) / 2;
+  TreeNode* node = nodes[middle];
+  node->left = _buildFromNodes(nodes, first, middle);
+  node->right = _buildFromNodes(nodes, middle + 1, last);
+  _updateHeight(node);
+  return node;
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_collectInOrder(
+  TreeNode* node, std::vector<TreeNode*>& nodes) const {
+  if (!node) return;
+  _collectInOrder(node->left, nodes);
+  nodes.push_back(node);
+  _collectInOrder(node->right, nodes);
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+template <typename KeyIterator, typename DataIterator>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::insertSorted(
+  KeyIterator keys_begin, KeyIterator keys_end, DataIterator data_begin) {
+
+  const std::size_t m = _checkSortedBatch(keys_begin, keys_end);
+  if (m == 0) return;
+
+  // We don't keep a count of the nodes in the tree, but the height gives a
+  // rough estimate: a tree of height h has fewer than 2^(h+1) nodes, and a
+  // well-filled AVL tree has close to that many. That's good enough to
+  // decide which way to go.
+  const int h = std::min(_get_height(head_), 62);
+  const std::size_t n_estimate = (h < 0) ? 0 : (std::size_t(1) << h);
+
+  // Inserting m items one at a time costs about m * log2(n + m) steps,
+  // while the merge always costs about n + m steps. For a small batch
+  // going into a big tree, separate inserts are cheaper.
+  std::size_t log_n = 1;
+  while ((std::size_t(1) << log_n) < n_estimate + m) log_n++;
+
+  if (m * log_n < n_estimate + m) {
+    // Check for duplicates first, so we can keep the promise that the
+    // tree is unchanged if we throw.
+    for (KeyIterator it = keys_begin; it != keys_end; ++it) {
+      if (contains(*it)) {
+        throw std::runtime_error("error in insertSorted(): key already exists");
+      }
+    }
+    // Copying a key or data item into a new node can throw. So we make all
+    // of the new nodes first, and only then link them into the tree. If a
+    // copy throws, the tree hasn't been touched yet, and we only have to
+    // destroy the nodes that we made. (Removing the items again after an
+    // insert had failed wouldn't work: remove hands the data back, which
+    // can be one more copy that throws.)
+    std::vector<TreeNode*> created;
+    created.reserve(m);
+    try {
+      for (KeyIterator it = keys_begin; it != keys_end; ++it, ++data_begin) {
+        created.push_back(nodes_.create(*it, *data_begin));
+      }
+    }
+    catch (...) {
+      _destroyGarbage(created);
+      throw;
+    }
+    // To link a node in, we split the tree at its key (no node has that key,
+    // as we just checked) and join the two halves with the new node in the
+    // middle. Like insert, this takes O(log n) time. (See AVL-setops.hpp.)
+    //   The comparator has already worked on every key above, but if it
+    // throws now anyway, the split leaves the tree's nodes on a pile
+    // instead, and we can only destroy them, together with the new nodes
+    // that aren't linked in yet.
+    NodePile garbage;
+    for (std::size_t i = 0; i < created.size(); i++) {
+      TreeNode *less, *found, *greater;
+      try {
+        _split(std::exchange(head_, nullptr), created[i]->key, less, found, greater, garbage);
+      }
+      catch (...) {
+        _destroyPile(garbage);
+        for (std::size_t j = i; j < created.size(); j++) {
+          nodes_.destroy(created[j]);
+        }
+        throw;
+      }
+      head_ = _join(less, created[i], greater);
+    }
+
+    runDebuggingChecks();
+    return;
+  }
+
+  // Otherwise, merge. Collect the existing nodes in order. This doesn't
+  // change the tree yet.
+  std::vector<TreeNode*> existing;
+  _collectInOrder(head_, existing);
+
+  // Look for duplicate keys by walking both sorted sequences side by side,
+  // before we create any new nodes.
+  std::size_t i = 0;
+  for (KeyIterator key_it = keys_begin; key_it != keys_end; ++key_it) {
+    while (i < existing.size() && _compare(existing[i]->key, *key_it) < 0) i++;
+    if (i < existing.size() && _compare(*key_it, existing[i]->key) == 0) {
+      throw std::runtime_error("error in insertSorted(): key already exists");
+    }
+  }
+
+  // Now do a standard merge of the two sorted sequences, creating nodes
+  // for the new items as we go. The tree itself isn't changed until the
+  // very end, so if creating a node throws, we only have to destroy the
+  // new nodes (which we also keep in "created") to leave it unchanged.
+  // (Both vectors have all of their room reserved up front, so the
+  // push_back calls can't throw.)
+  std::vector<TreeNode*> merged, created;
+  merged.reserve(existing.size() + m);
+  created.reserve(m);
+  i = 0;
+  KeyIterator key_it = keys_begin;
+  DataIterator data_it = data_begin;
+  try {
+    while (key_it != keys_end) {
+      if (i < existing.size() && _compare(existing[i]->key, *key_it) < 0) {
+        merged.push_back(existing[i++]);
+      }
+      else {
+        created.push_back(nodes_.create(*key_it, *data_it));
+        merged.push_back(created.back());
+        ++key_it;
+        ++data_it;
+      }
+    }
+  }
+  catch (...) {
+    _destroyGarbage(created);
+    throw;
+  }
+  while (i < existing.size()) {
+    merged.push_back(existing[i++]);
+  }
+
+  head_ = _buildFromNodes(merged, 0, merged.size());
+
+  runDebuggingChecks();
+}
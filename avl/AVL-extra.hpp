@@ -13,29 +13,54 @@
 // printInOrder: Print the tree contents to std::cout using an in-order
 // traversal. The "_printInOrder" version is for internal use by the
 // public wrapper function "printInOrder".
-template <typename K, typename D>
-void AVL<K, D>::_printInOrder(TreeNode* node) const {
-  // Base case: if node is nullptr, then print a space and return.
-  if (!node) {
-    std::cout << " ";
-    return;
-  }
-  else {
-    // Recurse left:
-    _printInOrder(node->left);
-    // Print this node:
-    std::cout << "[" << node->key << " : " << node->data << "]";
-    // Recurse right:
-    _printInOrder(node->right);
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_printInOrder(TreeNode* node) const {
+  // This prints exactly what the simple recursive version would print:
+  //   if (!node) { print " "; return; }
+  //   _printInOrder(node->left); print node; _printInOrder(node->right);
+  // but it uses an explicit stack instead of the call stack. The stack
+  // holds the nodes whose left subtree we're still printing.
+  std::stack<TreeNode*> node_stack;
+  while (true) {
+    if (node) {
+      // Go left first, and remember to come back to this node.
+      node_stack.push(node);
+      node = node->left;
+    }
+    else {
+      // Base case: a nullptr prints as a space.
+      std::cout << " ";
+      if (node_stack.empty()) break;
+      // The left subtree of the top node is done. Print that node and
+      // then continue with its right subtree.
+      node = node_stack.top();
+      node_stack.pop();
+      std::cout << "[" << node->key << " : " << node->data << "]";
+      node = node->right;
+    }
   }
 }
 
 // public interface for _printInOrder
-template <typename K, typename D>
-void AVL<K, D>::printInOrder() const {
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::printInOrder() const {
   _printInOrder(head_);
 }
 
+// _destroySubtree: Post-order traversal that destroys each node after its
+// children. The recursion depth is the height of the tree, which is O(log n)
+// for an AVL tree.
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_destroySubtree(TreeNode* node) {
+  if (!node) return;
+  _destroySubtree(node->left);
+  _destroySubtree(node->right);
+  nodes_.destroy(node);
+}
+
 // Print a simple vertical tree diagram. Indentation shows level,
 // and children are listed under parents:
 //   parent
@@ -43,8 +68,9 @@ void AVL<K, D>::printInOrder() const {
 //     right child
 // This repeats iteratively with nested indentation. (This could be done
 // recursively as well.)
-template <typename K, typename D>
-void AVL<K, D>::printVertical() const {
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::printVertical() const {
 
   // Stacks maintain the next node contents to display as well as the
   // corresponding amount of indentation to show in the margin.
@@ -109,18 +135,23 @@ void AVL<K, D>::printVertical() const {
 // For practice, think about why the recursive checks in these functions are
 // logically valid.
 
-template <typename K, typename D>
-bool AVL<K, D>::runDebuggingChecks() {
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+bool AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::runDebuggingChecks() {
   if (ENABLE_DEBUGGING_CHECKS) {
     if (!_debugHeightCheck(head_)) throw std::runtime_error("ERROR: _debugHeightCheck failed");
     if (!_debugBalanceCheck(head_)) throw std::runtime_error("ERROR: _debugBalanceCheck failed");
     if (!_debugOrderCheck(head_)) throw std::runtime_error("ERROR: _debugOrderCheck failed");
+    if (!_debugSizeCheck(head_, std::integral_constant<bool, Augmentation<K, D>::KEEPS_SIZE>())) {
+      throw std::runtime_error("ERROR: _debugSizeCheck failed");
+    }
   }
   return true;
 }
 
-template <typename K, typename D>
-bool AVL<K, D>::_debugHeightCheck(TreeNode* cur) {
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+bool AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_debugHeightCheck(TreeNode* cur) {
 
   // a non-existent node implicitly has the correct height
   if (!cur) return true;
@@ -148,8 +179,9 @@ bool AVL<K, D>::_debugHeightCheck(TreeNode* cur) {
   return test_result;
 }
 
-template <typename K, typename D>
-bool AVL<K, D>::_debugBalanceCheck(TreeNode* cur) {
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+bool AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_debugBalanceCheck(TreeNode* cur) {
 
   // balanced non-existence
   if (!cur) return true;
@@ -166,8 +198,9 @@ bool AVL<K, D>::_debugBalanceCheck(TreeNode* cur) {
 
 }
 
-template <typename K, typename D>
-bool AVL<K, D>::_debugOrderCheck(TreeNode* cur) {
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+bool AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_debugOrderCheck(TreeNode* cur) {
 
   // An empty tree is well-ordered.
   if (!cur) return true;
@@ -222,7 +255,7 @@ bool AVL<K, D>::_debugOrderCheck(TreeNode* cur) {
     const K* second_key_ptr = key_ptrs[i+1];
 
     // Keys should have increasing order, with no duplicates.
-    if (*first_key_ptr >= *second_key_ptr) {
+    if (_compare(*first_key_ptr, *second_key_ptr) >= 0) {
       std::cerr << "ERROR: These keys should be in strictly increasing order:" << std::endl;
       std::cerr << *first_key_ptr << " followed by " << *second_key_ptr << std::endl;
       return false;
@@ -231,3 +264,68 @@ bool AVL<K, D>::_debugOrderCheck(TreeNode* cur) {
 
   return true;
 }
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+bool AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_debugSizeCheck(TreeNode* cur, std::true_type) {
+
+  // Like the height check: if both subtrees have the right sizes, then
+  // this node's size must be one more than their sum.
+  if (!cur) return true;
+  if (!_debugSizeCheck(cur->left, std::true_type())) return false;
+  if (!_debugSizeCheck(cur->right, std::true_type())) return false;
+  return cur->size == 1 + _subtreeSize(cur->left) + _subtreeSize(cur->right);
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_runLocalChecks(
+  TreeNode** const* path, int path_length, TreeNode* removed_at) {
+
+  // Only check once in every local_check_period_ calls.
+  if (local_check_period_ == 0) return;
+  if (--local_check_countdown_ > 0) return;
+  local_check_countdown_ = local_check_period_;
+
+  // Every pointer in "path" is still a pointer inside the tree (or head_),
+  // even after the rotations, so we can follow it. The node it points to
+  // now may not be the one that was there on the way down, but the nodes
+  // that moved are now the children of these.
+  for (int i = 0; i < path_length; i++) {
+    TreeNode* cur = *path[i];
+    if (!_debugLocalCheck(cur) || (cur && (!_debugLocalCheck(cur->left) || !_debugLocalCheck(cur->right)))) {
+      throw std::runtime_error("ERROR: local AVL check failed on the insert or remove path");
+    }
+  }
+
+  if (removed_at) {
+    if (!_debugLocalCheck(removed_at)) {
+      throw std::runtime_error("ERROR: local AVL check failed where a node was removed");
+    }
+    for (TreeNode* cur = removed_at->left; cur; cur = cur->right) {
+      if (!_debugLocalCheck(cur) || !_debugLocalCheck(cur->left)) {
+        throw std::runtime_error("ERROR: local AVL check failed below a removed node");
+      }
+    }
+  }
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+bool AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_debugLocalCheck(TreeNode* cur) const {
+
+  if (!cur) return true;
+
+  // The same tests as _debugHeightCheck, _debugBalanceCheck and
+  // _debugSizeCheck, but for this node only.
+  const int height_left = _get_height(cur->left);
+  const int height_right = _get_height(cur->right);
+  if (cur->height != 1 + std::max(height_left, height_right)) return false;
+  if (height_right - height_left < -1 || height_right - height_left > 1) return false;
+  if (!_debugLocalSizeCheck(cur, std::integral_constant<bool, Augmentation<K, D>::KEEPS_SIZE>())) return false;
+
+  // The left child's key has to be smaller, and the right child's larger.
+  if (cur->left && _compare(cur->left->key, cur->key) >= 0) return false;
+  if (cur->right && _compare(cur->key, cur->right->key) >= 0) return false;
+  return true;
+}
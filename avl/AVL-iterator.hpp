@@ -0,0 +1,146 @@
+/**
+ * AVL tree - Iterators, lower_bound/upper_bound/equal_range, and range scans.
+ */
+
+#pragma once
+
+#include "AVL.hpp"
+
+// A note about how the iterator moves:
+// To go from a node to the next one in key order, there are two cases.
+// If the node has a right subtree, the next node is the leftmost node of
+// that subtree, so we go right once and then left as far as possible.
+// Otherwise, the next node is the nearest ancestor that we reached by going
+// left, so we go back up the recorded path until we come up out of a left
+// child. Going backwards is the mirror image of this. Each edge of the tree
+// is walked down once and up once during a full scan, so a scan of n items
+// takes O(n) time, even though a single step can take O(log n).
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::const_iterator::_pushLeftmost(const TreeNode* node) {
+  while (node) {
+    path_[depth_++] = node;
+    node = node->left;
+  }
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::const_iterator::_pushRightmost(const TreeNode* node) {
+  while (node) {
+    path_[depth_++] = node;
+    node = node->right;
+  }
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::const_iterator&
+AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::const_iterator::operator++() {
+  const TreeNode* node = path_[depth_ - 1];
+  if (node->right) {
+    _pushLeftmost(node->right);
+    return *this;
+  }
+  // Go up until we come up out of a left child. If we never do, we were at
+  // the last node, and the path ends up empty, which is the end iterator.
+  const TreeNode* child;
+  do {
+    child = path_[--depth_];
+  } while (depth_ > 0 && path_[depth_ - 1]->left != child);
+  return *this;
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::const_iterator&
+AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::const_iterator::operator--() {
+  // Going back from end() gives the last node.
+  if (depth_ == 0) {
+    _pushRightmost(head_);
+    return *this;
+  }
+  const TreeNode* node = path_[depth_ - 1];
+  if (node->left) {
+    _pushRightmost(node->left);
+    return *this;
+  }
+  const TreeNode* child;
+  do {
+    child = path_[--depth_];
+  } while (depth_ > 0 && path_[depth_ - 1]->right != child);
+  return *this;
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::const_iterator
+AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::begin() const {
+  const_iterator it(head_);
+  it._pushLeftmost(head_);
+  return it;
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::const_iterator
+AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_bound(const K& key, bool inclusive) const {
+  // Go down towards the key, recording the path. The answer is the last
+  // node on the path where we went left (or stopped, for an equal key when
+  // "inclusive" is true), since everything after it in key order is on the
+  // path below it. So at the end, we cut the path back to that node.
+  const_iterator it(head_);
+  int answer_depth = 0;
+  const TreeNode* node = head_;
+  while (node) {
+    it.path_[it.depth_++] = node;
+    const int cmp = _compare(key, node->key);
+    if (cmp < 0) {
+      answer_depth = it.depth_;
+      node = node->left;
+    }
+    else if (inclusive && cmp == 0) {
+      answer_depth = it.depth_;
+      break;
+    }
+    else {
+      node = node->right;
+    }
+  }
+  it.depth_ = answer_depth;
+  return it;
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::const_iterator
+AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::lower_bound(const K& key) const {
+  return _bound(key, true);
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::const_iterator
+AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::upper_bound(const K& key) const {
+  return _bound(key, false);
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+std::pair<typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::const_iterator,
+  typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::const_iterator>
+AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::equal_range(const K& key) const {
+  return std::make_pair(lower_bound(key), upper_bound(key));
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::const_range
+AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::range(const K& lo, const K& hi) const {
+  // An empty range if hi isn't after lo, instead of an end before the start.
+  if (_compare(lo, hi) >= 0) {
+    return const_range(end(), end());
+  }
+  return const_range(lower_bound(lo), lower_bound(hi));
+}
@@ -0,0 +1,153 @@
+/**
+ * AVL tree - Order statistics (rank, select, countInRange) and range
+ * aggregates, using the subtree augmentation from NodeAugmentation.h.
+ */
+
+#pragma once
+
+#include "AVL.hpp"
+
+// A note about why these take O(log n) time:
+// Without subtree sizes, the only way to find the 1000th smallest key is to
+// walk through the first 1000 keys in order. But if each node knows the size
+// of its subtree, then at each node we know how many keys are to its left,
+// so we know whether the key we want is in the left subtree, at this node,
+// or in the right subtree, and we only need to go down one of them. That's
+// one path from the root, like a normal find.
+//   rangeAggregate works the same way. Walking down from the root towards
+// lo and towards hi, every subtree that hangs off those two paths on the
+// inside lies completely within the range, so we can use its stored
+// aggregate without looking inside it.
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+std::size_t AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::size() const {
+  static_assert(Augmentation<K, D>::KEEPS_SIZE,
+    "size() requires an augmentation that keeps subtree sizes, such as SubtreeSize");
+  return _subtreeSize(head_);
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+std::size_t AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_countBelow(
+  const K& key, bool inclusive) const {
+
+  static_assert(Augmentation<K, D>::KEEPS_SIZE,
+    "rank() and countInRange() require an augmentation that keeps subtree sizes, such as SubtreeSize");
+
+  // Whenever we go right, the node we leave and its whole left subtree are
+  // smaller than the key, so we count them.
+  std::size_t count = 0;
+  const TreeNode* node = head_;
+  while (node) {
+    const int cmp = _compare(node->key, key);
+    if (cmp < 0 || (inclusive && cmp == 0)) {
+      count += _subtreeSize(node->left) + 1;
+      node = node->right;
+    }
+    else {
+      node = node->left;
+    }
+  }
+  return count;
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+std::size_t AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::rank(const K& key) const {
+  return _countBelow(key, false);
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+std::size_t AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::countInRange(
+  const K& lo, const K& hi) const {
+  if (_compare(hi, lo) < 0) return 0;
+  return _countBelow(hi, true) - _countBelow(lo, false);
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+const K& AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::select(std::size_t i) const {
+  static_assert(Augmentation<K, D>::KEEPS_SIZE,
+    "select() requires an augmentation that keeps subtree sizes, such as SubtreeSize");
+
+  if (i >= _subtreeSize(head_)) {
+    throw std::runtime_error("error in select(): index out of range");
+  }
+
+  // "i" is always the rank we want within the current subtree.
+  const TreeNode* node = head_;
+  while (true) {
+    const std::size_t left_size = _subtreeSize(node->left);
+    if (i < left_size) {
+      node = node->left;
+    }
+    else if (i == left_size) {
+      return node->key;
+    }
+    else {
+      // Skip the left subtree and this node.
+      i -= left_size + 1;
+      node = node->right;
+    }
+  }
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+template <typename A>
+typename A::aggregate_type AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::rangeAggregate(
+  const K& lo, const K& hi) const {
+
+  static_assert(A::KEEPS_AGGREGATE,
+    "rangeAggregate() requires the SubtreeAggregate augmentation");
+  using Monoid = typename A::monoid_type;
+  using Value = typename A::aggregate_type;
+
+  if (_compare(hi, lo) < 0) return Monoid::identity();
+
+  // First, go down to the "split" node: the first node whose key is in the
+  // range. Above it, the whole range is on one side, so nothing counts.
+  const TreeNode* split = head_;
+  while (split) {
+    if (_compare(split->key, lo) < 0) { split = split->right; }
+    else if (_compare(hi, split->key) < 0) { split = split->left; }
+    else { break; }
+  }
+  if (!split) return Monoid::identity();
+
+  // The part of the range in the split node's left subtree: walk towards lo.
+  // When a node is in the range, it and its right subtree are too, and they
+  // come before everything we've collected so far, so they go in front.
+  Value left_part = Monoid::identity();
+  for (const TreeNode* node = split->left; node; ) {
+    if (_compare(node->key, lo) < 0) {
+      node = node->right;
+    }
+    else {
+      const Value right_of_node = node->right ? node->right->aggregate : Monoid::identity();
+      left_part = Monoid::combine(
+        Monoid::combine(Monoid::of(node->key, node->data), right_of_node), left_part);
+      node = node->left;
+    }
+  }
+
+  // The same thing on the other side, walking towards hi. Here the nodes
+  // we collect come after everything so far, so they go at the end.
+  Value right_part = Monoid::identity();
+  for (const TreeNode* node = split->right; node; ) {
+    if (_compare(hi, node->key) < 0) {
+      node = node->left;
+    }
+    else {
+      const Value left_of_node = node->left ? node->left->aggregate : Monoid::identity();
+      right_part = Monoid::combine(right_part,
+        Monoid::combine(left_of_node, Monoid::of(node->key, node->data)));
+      node = node->right;
+    }
+  }
+
+  return Monoid::combine(
+    Monoid::combine(left_part, Monoid::of(split->key, split->data)), right_part);
+}
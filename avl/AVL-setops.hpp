@@ -0,0 +1,479 @@
+/**
+ * AVL tree - join, split, and the set operations union, intersection and
+ * difference, built on join and split, with optional parallelism.
+ */
+
+#pragma once
+
+#include "AVL.hpp"
+
+// A note about join:
+// Suppose we have two AVL trees, where every key in "left" is less than some
+// middle key, which is less than every key in "right". If their heights
+// differ by at most one, we can just hang them under a node with the middle
+// key. If "left" is taller, we instead walk down its right edge until we
+// reach a subtree that is no more than one level taller than "right", and
+// hang that subtree and "right" under the middle node in its place. Only the
+// nodes on the way back up can be out of balance now, and each one is off by
+// at most 2, so _ensureBalance fixes each of them with the same rotations
+// that insert uses. This takes O(difference in heights) time.
+//
+// A note about split:
+// To split a tree at a key, we go down towards the key. Each node on the way
+// belongs on one side, together with the subtree that we didn't go into,
+// and we join those pieces back together on the way up. The joins along one
+// path add up to O(log n) time in total.
+//
+// A note about the set operations:
+// To take the union of trees A and B, we split B at the key of A's root.
+// Then the union of A's left subtree with B's smaller keys, and the union of
+// A's right subtree with B's larger keys, are two separate problems that
+// don't share any nodes. We solve those recursively and join the two results
+// under A's root node. Intersection and difference work the same way. The
+// two halves can be solved on different threads at the same time, so with
+// enough cores the whole thing takes O(log^2 n) time.
+//   We split the threads between the two halves at each level. For example,
+// with 8 threads, the top level runs its two halves on 2 threads, each of
+// those runs its halves on 2 threads, and so on until there are 8 threads
+// in total. Below that, each thread works alone. Since the tree is balanced,
+// each thread gets about the same amount of work. Every node is only ever
+// touched by one thread, so no locks are needed.
+//
+// A note about exceptions:
+// The comparator is user code, so it can throw at any point of a split.
+// By then, the pieces are scattered across the call stack (and maybe across
+// threads), and they can't be put back together in order. What we can do
+// is make sure that no node is lost. Every recursive call keeps track of the
+// pieces that it holds: the nodes it was given, and the results that have
+// come back from below. If something throws, it puts all of those onto the
+// garbage pile and passes the exception on. Each node is either in a piece
+// or on the pile, never both, and a call that throws has already piled up
+// everything it was given. So when the exception gets to the top, the pile
+// holds every node of both trees, and we destroy it there.
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::TreeNode*
+AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_join(
+  TreeNode* left, TreeNode* middle, TreeNode* right) {
+
+  if (_get_height(left) > _get_height(right) + 1) {
+    // Go down the right edge of the taller left tree.
+    left->right = _join(left->right, middle, right);
+    _ensureBalance(left);
+    return left;
+  }
+  if (_get_height(right) > _get_height(left) + 1) {
+    // The mirror image: go down the left edge of the taller right tree.
+    right->left = _join(left, middle, right->left);
+    _ensureBalance(right);
+    return right;
+  }
+  middle->left = left;
+  middle->right = right;
+  _updateHeight(middle);
+  return middle;
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::TreeNode*
+AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_splitLast(TreeNode* node, TreeNode*& last) {
+  if (!node->right) {
+    last = node;
+    return node->left;
+  }
+  TreeNode* rest = _splitLast(node->right, last);
+  return _join(node->left, node, rest);
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::TreeNode*
+AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_join2(TreeNode* left, TreeNode* right) {
+  // Use the last node of "left" as the middle node.
+  if (!left) return right;
+  TreeNode* last = nullptr;
+  TreeNode* rest = _splitLast(left, last);
+  return _join(rest, last, right);
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_split(
+  TreeNode* node, const K& key, TreeNode*& less, TreeNode*& found, TreeNode*& greater,
+  NodePile& garbage) {
+
+  if (!node) {
+    less = found = greater = nullptr;
+    return;
+  }
+  // We unhook the child that we go into before going there. Then, if
+  // anything throws, "node" with its other child is exactly what this call
+  // still holds, and the call below has taken care of the rest.
+  try {
+    const int cmp = _compare(key, node->key);
+    if (cmp == 0) {
+      less = node->left;
+      greater = node->right;
+      found = node;
+      found->left = found->right = nullptr;
+      _updateHeight(found);
+    }
+    else if (cmp < 0) {
+      // This node and its right subtree are all greater than the key.
+      TreeNode* right = node->right;
+      _split(std::exchange(node->left, nullptr), key, less, found, greater, garbage);
+      greater = _join(greater, node, right);
+    }
+    else {
+      TreeNode* left = node->left;
+      _split(std::exchange(node->right, nullptr), key, less, found, greater, garbage);
+      less = _join(left, node, less);
+    }
+  }
+  catch (...) {
+    garbage.addTree(node);
+    throw;
+  }
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+template <typename LeftTask, typename RightTask>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_inParallel(
+  unsigned threads, int height, NodePile& garbage, LeftTask left, RightTask right) {
+
+  if (threads < 2 || height < PARALLEL_MIN_HEIGHT) {
+    left(threads, garbage);
+    right(threads, garbage);
+    return;
+  }
+  // The left half gets its own garbage pile, so the two threads never
+  // touch the same one.
+  NodePile left_garbage;
+  const unsigned left_threads = threads / 2;
+  // Either half can throw from the comparator. An exception can't leave a
+  // thread, so the helper catches its own and we rethrow it here. And if
+  // the right half throws, we still have to join the helper before we
+  // leave: destroying a std::thread that hasn't been joined calls
+  // std::terminate. Either way, the helper's pile goes onto ours, since it
+  // may hold nodes that have to be destroyed.
+  std::exception_ptr left_error;
+  std::thread helper([&]() {
+    try {
+      left(left_threads, left_garbage);
+    } catch (...) {
+      left_error = std::current_exception();
+    }
+  });
+  try {
+    right(threads - left_threads, garbage);
+  } catch (...) {
+    helper.join();
+    garbage.addPile(left_garbage);
+    throw;
+  }
+  helper.join();
+  garbage.addPile(left_garbage);
+  if (left_error) std::rethrow_exception(left_error);
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::TreeNode*
+AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_union(
+  TreeNode* a, TreeNode* b, unsigned threads, NodePile& garbage) {
+
+  if (!a) return b;
+  if (!b) return a;
+
+  TreeNode *less, *duplicate, *greater;
+  try {
+    _split(b, a->key, less, duplicate, greater, garbage);
+  }
+  catch (...) {
+    garbage.addTree(a);
+    throw;
+  }
+  // Where both trees have the key, a's node wins.
+  if (duplicate) garbage.addNode(duplicate);
+
+  const int height = std::max(_get_height(a), _get_height(less) + 1);
+  TreeNode* a_left = std::exchange(a->left, nullptr);
+  TreeNode* a_right = std::exchange(a->right, nullptr);
+  TreeNode *left = nullptr, *right = nullptr;
+  // Each half takes its inputs out of our variables as it starts, so that
+  // if something throws, the variables hold exactly the pieces that are
+  // still ours. (See the note about exceptions at the top.)
+  try {
+    _inParallel(threads, height, garbage,
+      [&](unsigned t, NodePile& g) {
+        left = _union(std::exchange(a_left, nullptr), std::exchange(less, nullptr), t, g);
+      },
+      [&](unsigned t, NodePile& g) {
+        right = _union(std::exchange(a_right, nullptr), std::exchange(greater, nullptr), t, g);
+      });
+  }
+  catch (...) {
+    for (TreeNode* piece : {a, a_left, less, left, a_right, greater, right}) garbage.addTree(piece);
+    throw;
+  }
+  return _join(left, a, right);
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::TreeNode*
+AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_intersection(
+  TreeNode* a, TreeNode* b, unsigned threads, NodePile& garbage) {
+
+  if (!a || !b) {
+    // Nothing left in one tree means nothing in common: everything that's
+    // left in the other tree goes.
+    garbage.addTree(a);
+    garbage.addTree(b);
+    return nullptr;
+  }
+
+  TreeNode *less, *duplicate, *greater;
+  try {
+    _split(b, a->key, less, duplicate, greater, garbage);
+  }
+  catch (...) {
+    garbage.addTree(a);
+    throw;
+  }
+
+  const int height = std::max(_get_height(a), _get_height(less) + 1);
+  TreeNode* a_left = std::exchange(a->left, nullptr);
+  TreeNode* a_right = std::exchange(a->right, nullptr);
+  TreeNode *left = nullptr, *right = nullptr;
+  try {
+    _inParallel(threads, height, garbage,
+      [&](unsigned t, NodePile& g) {
+        left = _intersection(std::exchange(a_left, nullptr), std::exchange(less, nullptr), t, g);
+      },
+      [&](unsigned t, NodePile& g) {
+        right = _intersection(std::exchange(a_right, nullptr), std::exchange(greater, nullptr), t, g);
+      });
+  }
+  catch (...) {
+    for (TreeNode* piece : {a, duplicate, a_left, less, left, a_right, greater, right}) {
+      garbage.addTree(piece);
+    }
+    throw;
+  }
+
+  if (duplicate) {
+    // The key is in both trees: keep a's node, and drop b's.
+    garbage.addNode(duplicate);
+    return _join(left, a, right);
+  }
+  garbage.addNode(a);
+  return _join2(left, right);
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::TreeNode*
+AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_difference(
+  TreeNode* a, TreeNode* b, unsigned threads, NodePile& garbage) {
+
+  if (!a) {
+    garbage.addTree(b);
+    return nullptr;
+  }
+  if (!b) return a;
+
+  // This time we split a at the key of b's root, since b's keys are the
+  // ones to take out.
+  TreeNode *less, *removed, *greater;
+  try {
+    _split(a, b->key, less, removed, greater, garbage);
+  }
+  catch (...) {
+    garbage.addTree(b);
+    throw;
+  }
+  if (removed) garbage.addNode(removed);
+
+  const int height = std::max(_get_height(less), _get_height(greater)) + 1;
+  TreeNode* b_left = b->left;
+  TreeNode* b_right = b->right;
+  garbage.addNode(b);
+  TreeNode *left = nullptr, *right = nullptr;
+  try {
+    _inParallel(threads, height, garbage,
+      [&](unsigned t, NodePile& g) {
+        left = _difference(std::exchange(less, nullptr), std::exchange(b_left, nullptr), t, g);
+      },
+      [&](unsigned t, NodePile& g) {
+        right = _difference(std::exchange(greater, nullptr), std::exchange(b_right, nullptr), t, g);
+      });
+  }
+  catch (...) {
+    for (TreeNode* piece : {less, b_left, left, greater, b_right, right}) garbage.addTree(piece);
+    throw;
+  }
+  return _join2(left, right);
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::TreeNode*
+AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_takeNodesFrom(AVL& other) {
+  // With the arena allocator, other's nodes live in other's slabs, so this
+  // tree's arena has to take those over before it can destroy any of them.
+  nodes_.absorb(other.nodes_);
+  TreeNode* root = other.head_;
+  other.head_ = nullptr;
+  return root;
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_destroyGarbage(
+  const std::vector<TreeNode*>& garbage) {
+  for (TreeNode* node : garbage) {
+    nodes_.destroy(node);
+  }
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_destroyPile(NodePile& garbage) {
+  // Walk along the chain of right pointers. The subtree hanging to the left
+  // of each node in the chain came from one of the trees, so it's short
+  // enough for _destroySubtree's recursion.
+  TreeNode* node = garbage.first();
+  while (node) {
+    TreeNode* next = node->right;
+    _destroySubtree(node->left);
+    nodes_.destroy(node);
+    node = next;
+  }
+  garbage = NodePile();
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::join(AVL& other) {
+  if (&other == this || !other.head_) return;
+
+  // Check the order first, so that we can throw without changing anything:
+  // our largest key must be less than other's smallest key.
+  if (head_) {
+    const TreeNode* largest = head_;
+    while (largest->right) largest = largest->right;
+    const TreeNode* smallest = other.head_;
+    while (smallest->left) smallest = smallest->left;
+    if (_compare(largest->key, smallest->key) >= 0) {
+      throw std::runtime_error("error in join(): the other tree's keys must all be greater");
+    }
+  }
+
+  TreeNode* right = _takeNodesFrom(other);
+  head_ = _join2(head_, right);
+
+  if (ENABLE_DEBUGGING_CHECKS) {
+    runDebuggingChecks();
+  }
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::split(const K& key, AVL& other) {
+  if (&other == this || other.head_) {
+    throw std::runtime_error("error in split(): the other tree must be a different, empty tree");
+  }
+
+  TreeNode *less, *found, *greater;
+  NodePile garbage;
+  try {
+    _split(std::exchange(head_, nullptr), key, less, found, greater, garbage);
+  }
+  catch (...) {
+    // The whole tree is on the pile now.
+    _destroyPile(garbage);
+    throw;
+  }
+  // The node with the key itself stays in this tree.
+  head_ = found ? _join(less, found, nullptr) : less;
+  // The nodes for "other" stay where they are in memory, so other's
+  // allocator must keep our memory alive. (With the arena allocator, the
+  // two arenas now share the slabs, and each tree destroys its own nodes.)
+  other.head_ = greater;
+  other.nodes_.share(nodes_);
+
+  if (ENABLE_DEBUGGING_CHECKS) {
+    runDebuggingChecks();
+    other.runDebuggingChecks();
+  }
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::unionWith(AVL& other, unsigned threads) {
+  if (&other == this) return;
+  TreeNode* b = _takeNodesFrom(other);
+  NodePile garbage;
+  try {
+    head_ = _union(std::exchange(head_, nullptr), b, threads, garbage);
+  }
+  catch (...) {
+    // Every node of both trees is on the pile now, and both trees are empty.
+    _destroyPile(garbage);
+    throw;
+  }
+  _destroyPile(garbage);
+
+  if (ENABLE_DEBUGGING_CHECKS) {
+    runDebuggingChecks();
+  }
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::intersectionWith(AVL& other, unsigned threads) {
+  if (&other == this) return;
+  TreeNode* b = _takeNodesFrom(other);
+  NodePile garbage;
+  try {
+    head_ = _intersection(std::exchange(head_, nullptr), b, threads, garbage);
+  }
+  catch (...) {
+    // Every node of both trees is on the pile now, and both trees are empty.
+    _destroyPile(garbage);
+    throw;
+  }
+  _destroyPile(garbage);
+
+  if (ENABLE_DEBUGGING_CHECKS) {
+    runDebuggingChecks();
+  }
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::differenceWith(AVL& other, unsigned threads) {
+  if (&other == this) {
+    clear_tree();
+    return;
+  }
+  TreeNode* b = _takeNodesFrom(other);
+  NodePile garbage;
+  try {
+    head_ = _difference(std::exchange(head_, nullptr), b, threads, garbage);
+  }
+  catch (...) {
+    // Every node of both trees is on the pile now, and both trees are empty.
+    _destroyPile(garbage);
+    throw;
+  }
+  _destroyPile(garbage);
+
+  if (ENABLE_DEBUGGING_CHECKS) {
+    runDebuggingChecks();
+  }
+}
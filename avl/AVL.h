@@ -19,12 +19,12 @@
 // implementation choices here are not necessarily crucial to understanding
 // AVL in general. There are other, possibly simpler, ways to implement it.
 
-// The recursive nature of this example is a bit complicated so many comments
-// have been added to explain how it works. (Some of the comments may seem a
+// The insert and remove logic of this example is a bit complicated so many
+// comments have been added to explain how it works. (Some of the comments may seem a
 // bit redundant. I can't assume anyone will read the whole thing from start
 // to finish.) There are many helper functions that break out the logic into
 // small pieces. The easiest way to understand the correctness of the
-// recursion is to focus on the logical properties of the current state of
+// rebalancing is to focus on the logical properties of the current state of
 // the program (those conditions which are required or guaranteed by each of
 // the member functions) before and after each call is made. For example,
 // assume that calling _ensureBalance on a node will ensure that the subtree
@@ -56,15 +56,18 @@
 //   different, and now the function returns something. The swap algorithm
 //   is also discussed in the commentary on the bst example.)
 // - The _iopRemove method was changed to reflect the changes to the node
-//   swapping function. The _iopRemove function has an extra parameter to
-//   track whether it's the first step in recursion or not. In addition,
-//   there is a separate version of the _iopRemove provided as a wrapper
-//   function to simplify the beginning of the recursion process.
+//   swapping function. It records the path down to the IOP so that it can
+//   rebalance the nodes on that path afterward.
 // - The lectures implied the existence of a helper function called "height".
 //   For clarity, this has been renamed to "_get_height".
 // - The insert and remove methods have additional helper functions that are
-//   similar to _find, but help to simplify the rebalancing process during
-//   recursion.
+//   similar to _find, but help to simplify the rebalancing process.
+// - The lectures show _find, insert, and remove as recursive functions. Here
+//   they are written as loops instead. On the way down, insert and remove
+//   record the path they take in a small array (an explicit "path stack"),
+//   and then walk back up that path to rebalance, which is exactly what the
+//   recursive versions do as they return. This avoids the overhead of one
+//   function call per level on every lookup.
 // - The _ensureBalance function accounts for an additional possibility where
 //   there is a balance of 0 in the direction of an initial imbalance. This
 //   can only happen after a removal, not after an insertion.
@@ -77,25 +80,129 @@
 
 // We include <stdexcept> so we can throw std::runtime_error in some cases.
 #include <stdexcept>
-// We include <utility> for the std::swap function
+// We include <utility> for the std::swap and std::exchange functions
 #include <utility>
 // We'll add some tree printing functions to help us inspect the results.
 // This will require std::cout from <iostream>.
 #include <iostream>
 // We include <algorithm> for std::max
 #include <algorithm>
-
-template <typename K, typename D>
+// We include <vector> for the bulk operations in AVL-bulk.hpp
+#include <vector>
+// We include <type_traits> for std::true_type and std::false_type
+#include <type_traits>
+// We include <iterator> for std::bidirectional_iterator_tag
+#include <iterator>
+// We include <cstddef> for std::ptrdiff_t
+#include <cstddef>
+// We include <thread> for the parallel set operations in AVL-setops.hpp
+#include <thread>
+// We include <exception> for std::exception_ptr, which carries an exception
+// out of a helper thread in AVL-setops.hpp
+#include <exception>
+
+// The node allocation policies (HeapNodeAllocator, ArenaNodeAllocator)
+#include "NodeAllocator.h"
+// The node storage policies (StoreReferences, StoreKeys, StoreKeysAndData)
+#include "NodeStorage.h"
+// The node augmentation policies (NoAugmentation, SubtreeSize, SubtreeAggregate)
+#include "NodeAugmentation.h"
+// The key comparison policy (ThreeWayCompare)
+#include "KeyCompare.h"
+// The flat, read-only search array that freeze() builds
+#include "EytzingerIndex.h"
+
+// AVL_DEBUGGING_CHECKS: Set this to 0 before including AVL.h (or with
+// -DAVL_DEBUGGING_CHECKS=0 on the compiler command line) to turn off the
+// brute-force checks that run after every insert and remove. See the
+// ENABLE_DEBUGGING_CHECKS constant in the class below. Those checks visit
+// the whole tree every time, so if you don't choose, they are on only in
+// debug builds: a release build is normally compiled with -DNDEBUG (the
+// same macro that turns off assert()), and then they are off.
+#ifndef AVL_DEBUGGING_CHECKS
+#ifdef NDEBUG
+#define AVL_DEBUGGING_CHECKS 0
+#else
+#define AVL_DEBUGGING_CHECKS 1
+#endif
+#endif
+
+// AVL_LOCAL_CHECKS: Set this to a number N greater than 0 to check only the
+// nodes that an insert or remove actually changed, after one in every N of
+// them. That takes O(log n) time instead of O(n), so unlike the checks
+// above, it's cheap enough to leave on in a release build that you are
+// trying out on real work. The default is 0, which leaves this code out.
+// See ENABLE_LOCAL_CHECKS and setLocalCheckPeriod in the class below.
+#ifndef AVL_LOCAL_CHECKS
+#define AVL_LOCAL_CHECKS 0
+#endif
+
+// The NodeAllocator template parameter chooses where the tree nodes come
+// from. The default, HeapNodeAllocator, does a separate "new" and "delete"
+// for each node. ArenaNodeAllocator carves the nodes out of large slabs
+// instead. Please see NodeAllocator.h for details. (The parameter is a
+// "template template parameter": we pass the name of a class template,
+// and the AVL class decides what type to use it with, namely TreeNode.)
+//   The NodeStorage template parameter chooses how each node holds its key
+// and data. The default, StoreReferences, stores references to items that
+// the caller keeps somewhere else. StoreKeys and StoreKeysAndData copy the
+// key, or both the key and the data, into the node itself. Please see
+// NodeStorage.h for details.
+//   The Augmentation template parameter chooses what else each node knows
+// about its subtree. The default, NoAugmentation, adds nothing. SubtreeSize
+// keeps the number of nodes in each subtree, which makes rank, select and
+// countInRange possible in O(log n) time, and SubtreeAggregate also keeps
+// a combined value (such as a sum) for rangeAggregate. Please see
+// NodeAugmentation.h and AVL-order.hpp for details.
+//   The Compare template parameter is a three-way comparator for the keys,
+// which tells in one call whether one key is less than, equal to, or
+// greater than another. Every search calls it once per level. The default,
+// ThreeWayCompare, uses std::string::compare for strings and operator<
+// otherwise. It also allows lookups with other types than K, such as
+// find("text") on a tree with std::string keys, without building a
+// temporary key. Please see KeyCompare.h for details.
+template <typename K, typename D,
+  template <typename> class NodeAllocator = HeapNodeAllocator,
+  template <typename, typename> class NodeStorage = StoreReferences,
+  template <typename, typename> class Augmentation = NoAugmentation,
+  typename Compare = ThreeWayCompare>
 class AVL {
   public:
+    // The type that "remove" returns. When the nodes only store references,
+    // this is "const D&", a reference to the caller's data. When the nodes
+    // own their data, the data is destroyed along with the node, so remove
+    // returns a plain "D" value instead.
+    using removed_data_type = typename NodeStorage<K, D>::removed_data_type;
+
     // Let the constructor just initialize the head pointer to null.
-    // We'll skip implementing other constructors for this example.
     AVL() : head_(nullptr) { }
 
+    // Bulk-build constructor: Build the tree directly from keys that are
+    // already sorted in strictly increasing order, with the matching data
+    // items in the same order starting at data_begin. This takes O(n) time
+    // instead of O(n log n) for n separate inserts. Since the tree stores
+    // references, the iterators must refer to items that will outlive the
+    // tree (such as the elements of a std::vector), unless the storage
+    // policy copies the items into the nodes. The keys are read twice (once
+    // to check their order), so KeyIterator must be a forward iterator.
+    // If copying an item throws, the nodes built so far are destroyed.
+    // Please see AVL-bulk.hpp.
+    template <typename KeyIterator, typename DataIterator>
+    AVL(KeyIterator keys_begin, KeyIterator keys_end, DataIterator data_begin);
+
     // find, insert, remove: Please see AVL.hpp for comments on these.
     const D& find(const K& key);
     void insert(const K& key, const D& data);
-    const D& remove(const K& key);
+    removed_data_type remove(const K& key);
+
+    // These versions of insert are only available when the nodes own their
+    // key and data (StoreKeysAndData). With the rvalue-reference version,
+    // the key and data are moved into the new node instead of copied.
+    // emplace constructs the data directly inside the node from whatever
+    // constructor arguments you pass after the key.
+    void insert(K&& key, D&& data);
+    template <typename KeyArg, typename... DataArgs>
+    void emplace(KeyArg&& key, DataArgs&&... dataArgs);
 
     // "contains" is like "find", but it doesn't return a reference to
     // the data item. It just returns a bool indicating whether the item
@@ -103,13 +210,103 @@ class AVL {
     // an exception.
     bool contains(const K& key);
 
+    // Heterogeneous lookup: These versions of find and contains take any
+    // type Q that the comparator can compare with a key, such as a C string
+    // for a tree with std::string keys. They only exist when the comparator
+    // is transparent (see KeyCompare.h), which is what the
+    // "typename = typename C::is_transparent" part checks: for any other
+    // comparator, that type doesn't exist, so the compiler quietly skips
+    // these overloads. (This trick is called SFINAE, "substitution failure
+    // is not an error".) When you pass an actual K, the versions above are
+    // the better match and get used instead.
+    template <typename Q, typename C = Compare, typename = typename C::is_transparent>
+    const D& find(const Q& key) {
+      TreeNode*& node = _find(key, head_);
+      if (node == nullptr) { throw std::runtime_error("error in find(): key not found"); }
+      return node->data;
+    }
+    template <typename Q, typename C = Compare, typename = typename C::is_transparent>
+    bool contains(const Q& key) {
+      return _find(key, head_) != nullptr;
+    }
+
+    // insertSorted: Insert a batch of keys that are sorted in strictly
+    // increasing order, with matching data items, as with the bulk-build
+    // constructor. For a large batch, this merges the batch with the
+    // existing nodes and rebuilds the tree in O(n + m) time. For a small
+    // batch, it adds the items one at a time, in O(log n) time each, like
+    // insert. If any key already exists,
+    // or copying an item into a node throws, this throws and the tree is
+    // left unchanged. (Only if the comparator throws while a small batch is
+    // being linked in is the tree left empty instead, as with split.) As
+    // with the constructor, KeyIterator must be a forward iterator.
+    template <typename KeyIterator, typename DataIterator>
+    void insertSorted(KeyIterator keys_begin, KeyIterator keys_end, DataIterator data_begin);
+
+    // Set operations: These move whole subtrees of nodes from one tree to
+    // another instead of inserting the items one at a time, and nothing is
+    // copied. "other" must be a tree of the same type, and it's always left
+    // empty. Please see AVL-setops.hpp.
+    //   join and split take O(log n) time. The other three take
+    // O(m log(n/m + 1)) time for trees of sizes m <= n, which is O(n) for two
+    // trees of about the same size, and they can split the work across
+    // "threads" threads.
+
+    // join: Move every item of "other" into this tree. Every key in "other"
+    // must be greater than every key in this tree; if not, this throws and
+    // neither tree changes.
+    void join(AVL& other);
+    // split: Move every item whose key is greater than "key" into "other",
+    // which must be empty. This tree keeps the rest. If the comparator
+    // throws, this tree is left empty (see below).
+    void split(const K& key, AVL& other);
+    // unionWith: Move every item of "other" into this tree. Where both trees
+    // have the same key, this tree's item is kept and the other is dropped.
+    void unionWith(AVL& other, unsigned threads = 1);
+    // intersectionWith: Keep only the items whose keys are also in "other".
+    void intersectionWith(AVL& other, unsigned threads = 1);
+    // differenceWith: Remove the items whose keys are in "other".
+    void differenceWith(AVL& other, unsigned threads = 1);
+    //   If the comparator throws in the middle of one of these, or a thread
+    // can't be started, the pieces of the two trees can't be put back
+    // together in order any more. So the exception is passed on with both
+    // trees left empty, and every one of their items destroyed: nothing
+    // leaks, and both trees can still be used. (The nodes are only ever
+    // relinked, never copied, so nothing else in here can throw, as long as
+    // the augmentation's "augment" doesn't.)
+
+    // Order statistics: These need an augmentation that keeps subtree
+    // sizes (SubtreeSize or SubtreeAggregate), and each takes O(log n) time.
+    // Please see AVL-order.hpp.
+
+    // size: The number of keys in the tree.
+    std::size_t size() const;
+    // rank: The number of keys in the tree that are smaller than "key".
+    // The key itself doesn't have to be in the tree.
+    std::size_t rank(const K& key) const;
+    // select: The key with this rank, that is, the i-th smallest key,
+    // counting from 0. Throws if i is not less than size().
+    const K& select(std::size_t i) const;
+    // countInRange: The number of keys from lo to hi, including both.
+    std::size_t countInRange(const K& lo, const K& hi) const;
+
+    // rangeAggregate: The Monoid's combination of all of the items with keys
+    // from lo to hi, including both, in order. For an empty range, this is
+    // the Monoid's identity. This needs the SubtreeAggregate augmentation.
+    template <typename A = Augmentation<K, D>>
+    typename A::aggregate_type rangeAggregate(const K& lo, const K& hi) const;
+
   private:
-    class TreeNode {
+    // TreeNode inherits its "key" and "data" members from the storage
+    // policy class. With the default policy, these are the references:
+    //   const K& key;
+    //   const D& data;
+    //   TreeNode also inherits the members of the augmentation policy. With
+    // the default policy, there aren't any.
+    class TreeNode : public NodeStorage<K, D>, public Augmentation<K, D> {
       public:
         // *See note 1 at the bottom of this file for discussion about how
         // references are being used here.
-        const K& key;
-        const D& data;
         // Note that you can declare multiple pointers on the same line as
         // shorthand, like this:
         //   TreeNode *left, *right;
@@ -119,14 +316,25 @@ class AVL {
         TreeNode* left;
         TreeNode* right;
         int height;
-        // **See note 2 at the bottom of this file for discussion about how
-        // this initialization list is styled.
-        TreeNode(const K& key, const D& data)
-          : key(key), data(data), left(nullptr), right(nullptr), height(0) { }
+        // Whatever arguments we get are passed along to the storage
+        // policy's constructor, which initializes the key and data.
+        // ("Args&&..." together with std::forward is called "perfect
+        // forwarding". It passes each argument along exactly as it was
+        // given, whether it was a const reference, a temporary that can be
+        // moved from, and so on.)
+        //   **See note 2 at the bottom of this file for discussion about how
+        // the storage policy's initialization list is styled.
+        template <typename... Args>
+        TreeNode(Args&&... args)
+          : NodeStorage<K, D>(std::forward<Args>(args)...),
+            left(nullptr), right(nullptr), height(0) { }
     };
 
     TreeNode* head_;
 
+    // All of the nodes are created and destroyed through this object.
+    NodeAllocator<TreeNode> nodes_;
+
     // These internal helper functions are private because they are only
     // meant to be used by other member functions of our class. Please see
     // the comments in AVL.hpp for details about them.
@@ -138,37 +346,49 @@ class AVL {
     // insert -> _find_and_insert (-> possibly, rotations)
     // remove -> _find_and_remove -> _remove (-> _iopRemove, swapping, rotations)
 
-    // Find the node with this key and return its data.
-    TreeNode*& _find(const K& key, TreeNode*& cur) const;
+    // Find the node with this key and return its data. The key can be a K,
+    // or for heterogeneous lookup, anything the comparator accepts.
+    template <typename Q>
+    TreeNode*& _find(const Q& key, TreeNode*& cur) const;
+
+    // _compare: Compare two keys with the Compare policy. The result is
+    // negative, zero or positive when a is less than, equal to or greater
+    // than b.
+    template <typename A, typename B>
+    static int _compare(const A& a, const B& b) { return Compare()(a, b); }
 
     // Actually remove the node that this pointer points to.
     // (This may need to invoke _iopRemove in some cases.)
-    const D& _remove(TreeNode*& node);
-
-    // This is called by "insert" to recursively find the insertion point,
-    // insert, and rebalance as it returns.
-    void _find_and_insert(const K& key, const D& data, TreeNode*& cur);
-    // This is called by "remove" to recursively remove the correct node
-    // and rebalance as it returns.
-    const D& _find_and_remove(const K& key, TreeNode*& cur);
+    removed_data_type _remove(TreeNode*& node);
+
+    // This is called by "insert" to find the insertion point, insert, and
+    // then rebalance each node on the path back up to "cur". The search
+    // uses "key", and then nodeArgs are passed along to create the node.
+    // (For a plain insert, nodeArgs are just the key and data again, but
+    // for the moving insert, they are rvalue references to move from.)
+    template <typename... NodeArgs>
+    void _find_and_insert(const K& key, TreeNode*& cur, NodeArgs&&... nodeArgs);
+    // This is called by "remove" to remove the correct node and then
+    // rebalance each node on the path back up to "cur".
+    removed_data_type _find_and_remove(const K& key, TreeNode*& cur);
+
+    // MAX_PATH_LENGTH: The longest path from the root to any node that the
+    // loops above will ever need to record. An AVL tree with n nodes has a
+    // height of less than 1.45 * log2(n + 2), so even if every byte of a
+    // 64-bit address space held a node, the height would be less than 93.
+    // That lets us use a fixed-size array on the stack for the path, with
+    // no memory allocation.
+    static constexpr int MAX_PATH_LENGTH = 96;
 
     // _remove relies on the following functions. (The organization is a
     // little different from the bst directory example.)
 
     // _iopRemove: targetNode is the node to remove, we'll want to find the
     // in-order predecessor (IOP) and swap the target with it for removal.
-    // To recursively find the IOP, we traverse over the ancestors of the
-    // IOP until we find it. The single-argument version of _iopRemove calls
-    // the other version of _iopRemove on the first node to the left, which
-    // is the earliest ancestor; this makes things more convenient and helps
-    // us avoid making a mistake in the logic.
-    const D& _iopRemove(TreeNode*& targetNode);
-    // The iopAncestor argument tracks the nodes being traversed on the way
-    // down as we search for the IOP that can be swapped with the target.
-    // When the single-parameter version of _iopRemove calls this other
-    // version, it needs to pass "true" for the isInitialCall argument.
-    // We check that in the implementation to catch a certain edge case.
-    const D& _iopRemove(TreeNode*& targetNode, TreeNode*& iopAncestor, bool isInitialCall);
+    // To find the IOP, we go left once and then right as far as possible,
+    // recording the ancestors of the IOP along the way so that we can
+    // rebalance them after the removal.
+    removed_data_type _iopRemove(TreeNode*& targetNode);
 
     // _swap_nodes: This swaps the node positions (rewiring pointers as
     // necessary) and also swaps the node heights. The intended usage is
@@ -234,6 +454,122 @@ class AVL {
       }
     }
 
+  public:
+    // const_iterator: A bidirectional iterator over the tree's items in key
+    // order, like the iterators of std::map. Dereferencing it gives the
+    // node's storage policy object, so "it->key" and "it->data" read the
+    // key and data directly from the node, without copying anything.
+    //   There are no parent pointers in the nodes, so the iterator remembers
+    // the path from the root down to its current node instead, in a small
+    // fixed-size array, just like the path that insert and remove record.
+    // An AVL tree is never deeper than MAX_PATH_LENGTH, so the iterator
+    // never needs to allocate memory. Moving to the next node either goes
+    // down (to the leftmost node of the right subtree) or back up the
+    // recorded path, so a full scan of n nodes takes O(n) steps in total.
+    //   Any insert or remove invalidates all iterators, since rotations
+    // change the paths. Please see AVL-iterator.hpp.
+    class const_iterator {
+      public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = NodeStorage<K, D>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        const_iterator() : head_(nullptr), depth_(0) { }
+        // Only the used part of the path needs to be copied.
+        const_iterator(const const_iterator& other) { *this = other; }
+        const_iterator& operator=(const const_iterator& other) {
+          head_ = other.head_;
+          depth_ = other.depth_;
+          std::copy(other.path_, other.path_ + depth_, path_);
+          return *this;
+        }
+
+        reference operator*() const { return *path_[depth_ - 1]; }
+        pointer operator->() const { return path_[depth_ - 1]; }
+
+        const_iterator& operator++();
+        const_iterator& operator--();
+        const_iterator operator++(int) { const_iterator old(*this); ++(*this); return old; }
+        const_iterator operator--(int) { const_iterator old(*this); --(*this); return old; }
+
+        // Two iterators are equal if they are at the same node. The end
+        // iterator is at no node at all.
+        bool operator==(const const_iterator& other) const { return _node() == other._node(); }
+        bool operator!=(const const_iterator& other) const { return _node() != other._node(); }
+
+      private:
+        friend class AVL;
+
+        // The root of the tree, so that decrementing end() can find the
+        // last node.
+        const TreeNode* head_;
+        // path_[0] is the root, and path_[depth_ - 1] is the current node.
+        // An empty path means this is the end iterator.
+        const TreeNode* path_[MAX_PATH_LENGTH];
+        int depth_;
+
+        explicit const_iterator(const TreeNode* head) : head_(head), depth_(0) { }
+        const TreeNode* _node() const { return depth_ ? path_[depth_ - 1] : nullptr; }
+        // Push this node, and then its left children all the way down.
+        void _pushLeftmost(const TreeNode* node);
+        // Push this node, and then its right children all the way down.
+        void _pushRightmost(const TreeNode* node);
+    };
+    // The items can't be changed through an iterator, so both are the same.
+    using iterator = const_iterator;
+
+    // const_range: The pair of iterators returned by range(), which can be
+    // used in a range-based for loop.
+    class const_range {
+      public:
+        const_range(const_iterator first, const_iterator last) : begin_(first), end_(last) { }
+        const_iterator begin() const { return begin_; }
+        const_iterator end() const { return end_; }
+      private:
+        const_iterator begin_;
+        const_iterator end_;
+    };
+
+    // begin, end: The first item, and one past the last item, in key order.
+    const_iterator begin() const;
+    const_iterator end() const { return const_iterator(head_); }
+
+    // freeze: Copy the keys and data into an EytzingerIndex, a read-only
+    // array that can only be searched, but does that several times faster
+    // than the tree, in much less memory. This is for trees that are built
+    // once and then only used for lookups. The tree itself is unchanged, so
+    // you can destroy it afterwards if you don't need it any more. This takes
+    // O(n) time. Please see EytzingerIndex.h.
+    EytzingerIndex<K, D, Compare> freeze() const {
+      return EytzingerIndex<K, D, Compare>(begin(), end());
+    }
+
+    // bytesPerNode: The size of one tree node, for comparing memory use.
+    // (HeapNodeAllocator adds the memory allocator's own overhead on top of
+    // this for every node, typically 8 to 16 bytes.)
+    static constexpr std::size_t bytesPerNode() { return sizeof(TreeNode); }
+
+    // lower_bound: The first item whose key is not less than "key".
+    // upper_bound: The first item whose key is greater than "key".
+    // equal_range: Both of those; the items between them have this key.
+    // These return end() if there is no such item, and take O(log n) time.
+    const_iterator lower_bound(const K& key) const;
+    const_iterator upper_bound(const K& key) const;
+    std::pair<const_iterator, const_iterator> equal_range(const K& key) const;
+
+    // range: All of the items with keys from lo up to but not including hi,
+    // in order. For example:
+    //   for (const auto& item : tree.range(10, 20)) { use(item.key, item.data); }
+    const_range range(const K& lo, const K& hi) const;
+
+  private:
+    // _bound: The shared part of lower_bound and upper_bound. The result is
+    // the first item whose key is greater than "key", or, when "inclusive" is
+    // true, greater than or equal to it.
+    const_iterator _bound(const K& key, bool inclusive) const;
+
   public:
 
     // empty: Tells whether the tree is empty or not.
@@ -244,13 +580,16 @@ class AVL {
       return !head_;
     }
 
-    // clear_tree: Remove the head item until the tree is empty.
+    // clear_tree: Destroy every node and leave the tree empty.
+    // We could just call remove on the head item until the tree is empty,
+    // but every one of those removals would rebalance the tree, which is
+    // a waste of time since all of the nodes are going away anyway. So we
+    // destroy the nodes directly, children first, in O(n) time. After that,
+    // the allocator can release all of its memory at once.
     void clear_tree() {
-      while (head_) {
-        // As long as the head pointer isn't null, we can just look at
-        // what the key is and call remove based on that.
-        remove(head_->key);
-      }
+      _destroySubtree(head_);
+      head_ = nullptr;
+      nodes_.release();
     }
 
     // Destructor: We just clear the tree.
@@ -275,6 +614,123 @@ class AVL {
   private:
     void _printInOrder(TreeNode* node) const;
 
+  private:
+    // Helper functions for the bulk operations. Please see AVL-bulk.hpp.
+
+    // _buildFromSorted: Build a perfectly balanced subtree from the next
+    // "count" items of the iterators, advancing them, and return its root.
+    template <typename KeyIterator, typename DataIterator>
+    TreeNode* _buildFromSorted(KeyIterator& key_it, DataIterator& data_it, std::size_t count);
+    // _buildFromNodes: Link the existing nodes in nodes[first, last) into a
+    // perfectly balanced subtree and return its root.
+    TreeNode* _buildFromNodes(std::vector<TreeNode*>& nodes, std::size_t first, std::size_t last);
+    // _collectInOrder: Append pointers to the nodes of a subtree to the
+    // vector, in order.
+    void _collectInOrder(TreeNode* node, std::vector<TreeNode*>& nodes) const;
+    // _checkSortedBatch: Throw unless the keys are strictly increasing, and
+    // return how many there are.
+    template <typename KeyIterator>
+    static std::size_t _checkSortedBatch(KeyIterator keys_begin, KeyIterator keys_end);
+
+  private:
+    // Helpers for the set operations. Please see AVL-setops.hpp.
+
+    // NodePile: The nodes that a set operation has taken out of the trees,
+    // waiting to be destroyed. Whole subtrees can be added as well as single
+    // nodes. Nothing is allocated: the pile is a chain that runs through the
+    // nodes' own "right" pointers, where each node in the chain keeps its
+    // "left" subtree. So adding to the pile can't throw, which matters
+    // because we also use it to clean up after an exception.
+    class NodePile {
+      public:
+        NodePile() : first_(nullptr), last_(nullptr) { }
+        // addNode: Add one node, and forget its children.
+        void addNode(TreeNode* node) {
+          node->left = node->right = nullptr;
+          _append(node, node);
+        }
+        // addTree: Add a whole subtree (or nothing, for nullptr). Its right
+        // edge simply becomes part of the chain.
+        void addTree(TreeNode* root) {
+          if (!root) return;
+          TreeNode* last = root;
+          while (last->right) last = last->right;
+          _append(root, last);
+        }
+        // addPile: Move everything from another pile onto this one.
+        void addPile(NodePile& other) {
+          if (!other.first_) return;
+          _append(other.first_, other.last_);
+          other.first_ = other.last_ = nullptr;
+        }
+        TreeNode* first() const { return first_; }
+      private:
+        void _append(TreeNode* first, TreeNode* last) {
+          if (first_) last_->right = first;
+          else first_ = first;
+          last_ = last;
+        }
+        TreeNode* first_;
+        TreeNode* last_;
+    };
+
+    // _join: Join "left", the single node "middle", and "right" into one
+    // balanced subtree, and return its root. Every key in "left" must be
+    // less than middle's key, which must be less than every key in "right".
+    TreeNode* _join(TreeNode* left, TreeNode* middle, TreeNode* right);
+    // _join2: The same thing without a middle node.
+    TreeNode* _join2(TreeNode* left, TreeNode* right);
+    // _splitLast: Take the node with the largest key out of a non-empty
+    // subtree. Return the rest of the subtree, and point "last" at the node.
+    TreeNode* _splitLast(TreeNode* node, TreeNode*& last);
+    // _split: Divide a subtree into the keys less than "key", the node with
+    // "key" itself (or nullptr), and the keys greater than "key". If the
+    // comparator throws, every node of the subtree has been put on "garbage"
+    // instead.
+    void _split(TreeNode* node, const K& key, TreeNode*& less, TreeNode*& found, TreeNode*& greater,
+      NodePile& garbage);
+    // The recursive set operations. Each returns the root of the result.
+    // Nodes that aren't in the result are put on "garbage", to be destroyed
+    // afterwards on the calling thread, since the allocator can't be used
+    // from several threads at once. If one of these throws, every node that
+    // it was given has been put on "garbage".
+    TreeNode* _union(TreeNode* a, TreeNode* b, unsigned threads, NodePile& garbage);
+    TreeNode* _intersection(TreeNode* a, TreeNode* b, unsigned threads, NodePile& garbage);
+    TreeNode* _difference(TreeNode* a, TreeNode* b, unsigned threads, NodePile& garbage);
+    // _inParallel: Run the two halves of a set operation, on two threads if
+    // "threads" allows it and the subtrees (of about the given height) are
+    // big enough to be worth it.
+    template <typename LeftTask, typename RightTask>
+    void _inParallel(unsigned threads, int height, NodePile& garbage, LeftTask left, RightTask right);
+    // _takeNodesFrom: Make this tree's allocator responsible for every node
+    // of "other", and detach them from "other". Returns other's old root.
+    TreeNode* _takeNodesFrom(AVL& other);
+    // _destroyGarbage: Destroy the nodes in the list, such as new nodes that
+    // insertSorted has to give up on.
+    void _destroyGarbage(const std::vector<TreeNode*>& garbage);
+    // _destroyPile: Destroy every node on the pile, and leave it empty.
+    void _destroyPile(NodePile& garbage);
+
+    // Subtrees shorter than this are always handled on a single thread.
+    // A subtree of this height has at least a few hundred nodes.
+    static constexpr int PARALLEL_MIN_HEIGHT = 12;
+
+  private:
+    // Helpers for the order statistics. Please see AVL-order.hpp.
+
+    // _subtreeSize: The size of a subtree, or 0 for nullptr.
+    static std::size_t _subtreeSize(const TreeNode* node) { return node ? node->size : 0; }
+    // _countBelow: The number of keys smaller than "key", or, if "inclusive"
+    // is true, the number of keys smaller than or equal to "key".
+    std::size_t _countBelow(const K& key, bool inclusive) const;
+
+  private:
+    // _destroySubtree: Destroy all of the nodes beneath and including the
+    // specified node, with a post-order traversal. This doesn't fix any
+    // pointers that point to the node, so it's only meant for clear_tree,
+    // and for cleaning up a partly built subtree in _buildFromSorted.
+    void _destroySubtree(TreeNode* node);
+
   public:
     // More debugging functions to help check the AVL tree properties.
     // These are not meant to be fast and they are optional components.
@@ -285,6 +741,10 @@ class AVL {
     bool _debugHeightCheck(TreeNode* cur);
     bool _debugBalanceCheck(TreeNode* cur);
     bool _debugOrderCheck(TreeNode* cur);
+    // _debugSizeCheck: Check the subtree sizes, if the augmentation keeps
+    // them. The last argument says whether it does.
+    bool _debugSizeCheck(TreeNode* cur, std::true_type);
+    bool _debugSizeCheck(TreeNode*, std::false_type) { return true; }
 
     // This constant controls whether debugging checks will be run after
     // insertions and removals. Note that this makes the data structure run
@@ -298,7 +758,48 @@ class AVL {
     // flexible and consistent ways to define constants like this for the
     // whole class. This version of the example has been written with C++14
     // compatibility in mind.
-    static constexpr bool ENABLE_DEBUGGING_CHECKS = true;
+    //   The AVL_DEBUGGING_CHECKS macro at the top of this file gives the
+    // initial value.
+    static constexpr bool ENABLE_DEBUGGING_CHECKS = AVL_DEBUGGING_CHECKS;
+
+  public:
+    // setLocalCheckPeriod: When the local checks are compiled in (see
+    // AVL_LOCAL_CHECKS at the top of this file), run them after one in every
+    // "period" inserts and removes, or never if the period is 0. This lets
+    // you choose how much time to spend on checking while the program runs.
+    // It does nothing when the local checks aren't compiled in.
+    void setLocalCheckPeriod(unsigned period) {
+      local_check_period_ = period;
+      local_check_countdown_ = period;
+    }
+  private:
+    // The local checks: An insert or remove only changes the heights and
+    // the child pointers of the nodes on the path from the root down to
+    // where it happened, and the nodes that rotations move, which end up as
+    // children of the nodes on that path. So if the tree was correct before,
+    // checking those nodes against their children is enough to see that it
+    // still is, as far as the heights, balance factors, and subtree sizes
+    // go. For the key order, we only compare each node with its children,
+    // which would catch a rotation that linked the wrong nodes together, but
+    // not a key that ended up several levels away from where it belongs.
+    // The full _debugOrderCheck is still the one to use while testing.
+    //   _runLocalChecks gets the path that _find_and_insert or
+    // _find_and_remove recorded. After a remove, "removed_at" is the node
+    // that took the removed node's place. If that node had two children,
+    // _iopRemove rebalanced the path down to its in-order predecessor too,
+    // which is now the rightmost path of its left subtree, so we check that
+    // path as well.
+    static constexpr bool ENABLE_LOCAL_CHECKS = (AVL_LOCAL_CHECKS > 0);
+    unsigned local_check_period_ = AVL_LOCAL_CHECKS;
+    unsigned local_check_countdown_ = AVL_LOCAL_CHECKS;
+    void _runLocalChecks(TreeNode** const* path, int path_length, TreeNode* removed_at);
+    // _debugLocalCheck: Check one node against its children. A nullptr is
+    // fine.
+    bool _debugLocalCheck(TreeNode* cur) const;
+    bool _debugLocalSizeCheck(const TreeNode* cur, std::true_type) const {
+      return cur->size == 1 + _subtreeSize(cur->left) + _subtreeSize(cur->right);
+    }
+    bool _debugLocalSizeCheck(const TreeNode*, std::false_type) const { return true; }
 
 };
 
@@ -307,8 +808,18 @@ class AVL {
 // sometimes needed in C++14, but it is deprecated in C++17 and later.
 // In any case, the actual setting is initialized in the class definition
 // itself where this member is first mentioned.
-template <typename K, typename D>
-constexpr bool AVL<K, D>::ENABLE_DEBUGGING_CHECKS;
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+constexpr bool AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::ENABLE_DEBUGGING_CHECKS;
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+constexpr bool AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::ENABLE_LOCAL_CHECKS;
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+constexpr int AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::MAX_PATH_LENGTH;
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+constexpr int AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::PARALLEL_MIN_HEIGHT;
 
 // (Note 1) About how each TreeNode stores references:
 //   That this implementation of a tree is storing explicit aliases to memory
@@ -325,10 +836,18 @@ constexpr bool AVL<K, D>::ENABLE_DEBUGGING_CHECKS;
 // references it stores are then direct alias to other memory in a read-only
 // mode.
 //   Please see further comments in the file: AVL.hpp
+//   All of the above describes the default storage policy, StoreReferences.
+// The other policies in NodeStorage.h let the nodes own a copy of the key,
+// or of both the key and the data, so that the caller doesn't have to keep
+// them alive. That is also faster for lookups, because the key is right
+// there in the node instead of somewhere else in memory.
 
 // (Note 2) About referring to variable names in an initialization list:
-//   This TreeNode constructor initializes its own "data" member using
-// the argument also called "data". This is one of VERY FEW places in
+//   The original version of the TreeNode constructor was written like this:
+//     TreeNode(const K& key, const D& data)
+//       : key(key), data(data), left(nullptr), right(nullptr), height(0) { }
+// It initializes its own "data" member using the argument also called
+// "data". This is one of VERY FEW places in
 // C++ where you can reuse the same variable name to mean different
 // things at the same time.
 //   Within the initialization list only, when you write data(data) as
@@ -338,8 +857,9 @@ constexpr bool AVL<K, D>::ENABLE_DEBUGGING_CHECKS;
 // function argument, not to the member variable. It's best to avoid
 // styling your code like this to avoid making mistakes. Just give
 // the function parameter a different name, such as "dataArgument".
-// See the binary-tree-traversals example directory for a different
-// version, where we show this.
+// The storage policy classes in NodeStorage.h, which now initialize the
+// key and data, are written that way. See also the binary-tree-traversals
+// example directory for another version.
 
 // Sometimes, your header files might include another header file with
 // further templated definitions. The .h and .hpp are both just filename
@@ -29,8 +29,9 @@
 
 // ------
 
-template <typename K, typename D>
-const D& AVL<K, D>::find(const K& key) {
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+const D& AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::find(const K& key) {
   // Find the key in the tree starting at the head.
   // If found, we receive the tree's actual stored pointer to that node
   //   through return-by-reference.
@@ -41,8 +42,9 @@ const D& AVL<K, D>::find(const K& key) {
   return node->data;
 }
 
-template <typename K, typename D>
-bool AVL<K, D>::contains(const K& key) {
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+bool AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::contains(const K& key) {
   // This is just like "find" but when the item is not found, we just return
   // false instead of throwing an exception. When found, return true.
 
@@ -78,59 +80,70 @@ bool AVL<K, D>::contains(const K& key) {
 // then you probably need to put "typename" before the type.
 
 // The fully-qualified return type of the below function is:
-// AVL<K, D>::TreeNode*&
-// That is a pointer to a AVL<K, D>::TreeNode, returned by reference.
-
-template <typename K, typename D>
-typename AVL<K, D>::TreeNode*& AVL<K, D>::_find(
-  const K& key, TreeNode*& cur) const {
-
-  // (Please also see the implementation of _iop_of below, which discusses
-  //  some more nuances about returning references to pointers.)
-
-  // [Base case 1: When the key is not found]
-  // cur will be nullptr if the tree is empty, or if we descend below the
-  // lowest level without finding the key. Then we return nullptr and the
-  // outer "find" function (which calls "_find") will report that as an
-  // error.
-  //   (Note: The "cur" we return in this case is equal to nullptr, but
-  // it's important to write "return cur;" and not "return nullptr;" since
-  // this function returns by reference. We want to return the exact pointer
-  // that we found at this position (returning it by reference), even if it
-  // is a nullptr that will be trigger a "not found" error in the caller
-  // function that we return to. We should not return a reference to the
-  // "nullptr" literal; trying to use references to temporary values or
-  // literal constants can cause new issues depending on which version of
-  // the language (and compiler) you're using. We can avoid those problems
-  // by being sure to return references to actual pointers that are owned
-  // by our tree.)
-  if (cur == nullptr) { return cur; }
-  // [Base case 2: When the key is found]
-  // If we find a key that matches by value, then return the current TreeNode*
-  else if (key == cur->key) { return cur; }
-  // [When we need to search left]
-  // If the key we're looking for is smaller than the current node's key,
-  // then we should look to the left next.
-  else if (key < cur->key) { return _find(key, cur->left); }
-  // [When we need to search right]
-  // Otherwise, implicitly, the key we're looking for is larger than the
-  // current node's key. (We know this because it's not equal and not less.)
-  // So we should search to the right next.
-  else { return _find(key, cur->right); }
-
+// AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::TreeNode*&
+// That is a pointer to a AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::TreeNode, returned by reference.
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+template <typename Q>
+typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::TreeNode*& AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_find(
+  const Q& key, TreeNode*& cur) const {
+
+  // (Please also see the implementation of _iop_of in the bst example,
+  //  which discusses some more nuances about returning references to
+  //  pointers.)
+
+  // The lecture version of this function is recursive: it calls itself on
+  // cur->left or cur->right. Here we do the same thing with a loop. The
+  // variable "node" holds the address of the current pointer in the tree
+  // (a pointer to a pointer), so that at the end we can return that actual
+  // pointer by reference, just as the recursive version does.
+  TreeNode** node = &cur;
+
+  // [When the key is not found]
+  // *node will be nullptr if the tree is empty, or if we descend below the
+  // lowest level without finding the key. Then we stop and return that
+  // nullptr (by reference) and the outer "find" function (which calls
+  // "_find") will report that as an error.
+  //   (Note: It's important to return "*node", which is an actual pointer
+  // owned by our tree, and not the "nullptr" literal, since this function
+  // returns by reference. We should not return a reference to a temporary
+  // value or a literal constant.)
+  //   The lecture version checks "key == (*node)->key" and then
+  // "key < (*node)->key", which compares the keys twice at each level.
+  // Instead, we compare them once with the three-way comparator (see
+  // KeyCompare.h), and look at the sign of the result.
+  while (*node != nullptr) {
+    const int cmp = _compare(key, (*node)->key);
+    // [When the key is found]
+    // If we find a key that matches by value, then stop here.
+    if (cmp == 0) { break; }
+    // [When we need to search left]
+    // If the key we're looking for is smaller than the current node's key,
+    // then we should look to the left next.
+    else if (cmp < 0) { node = &((*node)->left); }
+    // [When we need to search right]
+    // Otherwise, implicitly, the key we're looking for is larger than the
+    // current node's key. So we should search to the right next.
+    else { node = &((*node)->right); }
+  }
+
+  return *node;
 }
 
 /**
 * insert()
 * Inserts `key` and associated `data` into the AVL tree.
 */
-template <typename K, typename D>
-void AVL<K, D>::insert(const K& key, const D& data) {
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::insert(const K& key, const D& data) {
 
-  // This function will begin a recursion process that will find the place
-  // to insert the new node, insert it, and then rebalance the tree as needed
-  // while returning up the recursive call stack to this point.
-  _find_and_insert(key, data, head_);
+  // This helper function will find the place to insert the new node,
+  // insert it, and then rebalance the tree as needed on the path back up
+  // to the root. The first "key" is used for the search, and then the key
+  // and data are passed along to create the node.
+  _find_and_insert(key, head_, key, data);
 
   // Run some optional brute-force debugging checks. This could be
   // deactivated for better efficiency. (The constant that toggles whether
@@ -140,45 +153,109 @@ void AVL<K, D>::insert(const K& key, const D& data) {
 
 }
 
-template <typename K, typename D>
-void AVL<K, D>::_find_and_insert(const K& key, const D& data, TreeNode*& cur) {
+// This version of insert moves the key and data into the new node.
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::insert(K&& key, D&& data) {
+
+  // If the nodes stored references, they would end up referring to
+  // temporary objects that are about to be destroyed. A static_assert
+  // turns that mistake into a compile-time error.
+  static_assert(NodeStorage<K, D>::OWNS_KEY && NodeStorage<K, D>::OWNS_DATA,
+    "insert(K&&, D&&) requires a storage policy that owns the key and data, such as StoreKeysAndData");
+
+  // The search only reads the key. The key and data are only moved from
+  // when the node is created, after the search is done.
+  _find_and_insert(key, head_, std::move(key), std::move(data));
+
+  runDebuggingChecks();
+}
+
+// emplace: Construct the data inside the new node from dataArgs.
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+template <typename KeyArg, typename... DataArgs>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::emplace(KeyArg&& key, DataArgs&&... dataArgs) {
+
+  static_assert(NodeStorage<K, D>::OWNS_KEY && NodeStorage<K, D>::OWNS_DATA,
+    "emplace requires a storage policy that owns the key and data, such as StoreKeysAndData");
+
+  // We need an actual K to search with, so we build it first, and then
+  // move it into the node.
+  K k(std::forward<KeyArg>(key));
+  _find_and_insert(k, head_, std::move(k), std::forward<DataArgs>(dataArgs)...);
+
+  runDebuggingChecks();
+}
+
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+template <typename... NodeArgs>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_find_and_insert(
+  const K& key, TreeNode*& cur, NodeArgs&&... nodeArgs) {
 
   // We let the "insert" function make the initial call to this one.
-  // The basic logic here is similar to _find, but now we want to take
-  // advantage of the call stack to ensure balance of everything from
-  // the insertion point up to the root, after we do the insertion.
-
-  if (cur == nullptr) {
-    // In this case we've found the empty child position where we should
-    // insert the item.
-    cur = new TreeNode(key, data);
-    // Note that we always insert the new node as a leaf, so it is already
-    // balanced. It has height 0 by default (because of the node class
-    // constructor), and it has no children, so there's no need to call
-    // the "ensure balance" function on it. We just return up the call
-    // stack now.
-    return;
-  }
-  else if (key == cur->key) {
-    // If we found a match for the key, then the key already exists,
-    // so report an error. (For the sake of this example, let's disallow
-    // duplicates. We could also do something nicer than this, like remove
-    // the old key and then insert the new item to replace it.)
-    throw std::runtime_error("error in insert(): key already exists");
-  }
-  else if (key < cur->key) {
-    // Search left and insert
-    _find_and_insert(key, data, cur->left);
-    // On the way back up, ensure the balance of this node
-    _ensureBalance(cur);
-    return;
+  // The basic logic here is similar to _find, but now we record the path
+  // we take on the way down, so that after the insertion we can ensure the
+  // balance of everything from the insertion point up to "cur".
+
+  // path[i] is the address of the tree pointer that points to the node at
+  // depth i (below cur) on the way down. When we rebalance a node, its
+  // parent's pointer may need to change to point at a different node, so
+  // we have to remember the pointers themselves, not just the nodes.
+  TreeNode** path[MAX_PATH_LENGTH];
+  int depth = 0;
+
+  TreeNode** node = &cur;
+  while (*node != nullptr) {
+    // As in _find, we compare the keys only once per level.
+    const int cmp = _compare(key, (*node)->key);
+    if (cmp == 0) {
+      // If we found a match for the key, then the key already exists,
+      // so report an error. (For the sake of this example, let's disallow
+      // duplicates. We could also do something nicer than this, like remove
+      // the old key and then insert the new item to replace it.)
+      // Nothing has been changed yet, so we can just throw.
+      throw std::runtime_error("error in insert(): key already exists");
+    }
+    path[depth++] = node;
+    if (cmp < 0) {
+      // Search left
+      node = &((*node)->left);
+    }
+    else {
+      // Search right
+      node = &((*node)->right);
+    }
   }
-  else {
-    // Search right and insert
-    _find_and_insert(key, data, cur->right);
-    // On the way back up, ensure the balance of this node
-    _ensureBalance(cur);
-    return;
+
+  // Now we've found the empty child position where we should insert the
+  // item. (The node allocator does the equivalent of "new TreeNode(key,
+  // data)", passing along nodeArgs.) Note that we always insert the new node as a leaf, so it is
+  // already balanced. It has height 0 by default (because of the node class
+  // constructor), and it has no children, so there's no need to call the
+  // "ensure balance" function on it.
+  *node = nodes_.create(std::forward<NodeArgs>(nodeArgs)...);
+  // The augmentation (if any) of the new leaf still has to be calculated
+  // from its own key and data, though. _updateHeight does that.
+  _updateHeight(*node);
+
+  // On the way back up, ensure the balance of each ancestor, from the
+  // deepest one up to the top. This is the order in which the recursive
+  // version would do it while returning.
+  //   Rebalancing a node only changes the pointers beneath it, and the
+  // pointer to it from its parent. The parent pointers for the nodes
+  // higher on the path are stored in nodes that are higher up, which
+  // haven't moved, so the addresses in "path" stay valid as we go.
+  const int path_length = depth;
+  while (depth > 0) {
+    _ensureBalance(*path[--depth]);
+  }
+
+  // Optionally check the nodes that we just changed. (See the note about
+  // the local checks in AVL.h.)
+  if (ENABLE_LOCAL_CHECKS) {
+    _runLocalChecks(path, path_length, nullptr);
   }
 
 }
@@ -187,13 +264,16 @@ void AVL<K, D>::_find_and_insert(const K& key, const D& data, TreeNode*& cur) {
 * remove()
 * Removes `key` from the AVL tree. Returns the associated data.
 */
-template <typename K, typename D>
-const D& AVL<K, D>::remove(const K& key) {
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::removed_data_type
+AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::remove(const K& key) {
 
-  // Begin the recursion process with this function that will find the
-  // node to remove, remove it, and then rebalance the tree as needed
-  // while it returns.
-  const D& d = _find_and_remove(key, head_);
+  // This helper function will find the node to remove, remove it, and
+  // then rebalance the tree as needed on the path back up to the root.
+  // (removed_data_type is "const D&" with the default storage policy.
+  //  Please see the note about it in AVL.h.)
+  removed_data_type d = _find_and_remove(key, head_);
 
   // Run some optional brute-force debugging checks. This could be
   // deactivated for better efficiency. (The constant that toggles whether
@@ -204,48 +284,65 @@ const D& AVL<K, D>::remove(const K& key) {
   return d;
 }
 
-template <typename K, typename D>
-const D& AVL<K, D>::_find_and_remove(const K& key, TreeNode*& cur) {
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::removed_data_type
+AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_find_and_remove(const K& key, TreeNode*& cur) {
 
   // We let the "remove" function make the initial call to this one.
-  // The basic logic here is similar to _find, but now we want to take
-  // advantage of the call stack to ensure balance of everything from
-  // the removal point up to the root, after we do the remove.
+  // The basic logic here is similar to _find_and_insert: we record the path
+  // on the way down, so that after the remove we can ensure the balance of
+  // everything from the removal point up to "cur".
+
+  TreeNode** path[MAX_PATH_LENGTH];
+  int depth = 0;
+
+  TreeNode** node = &cur;
+  while (*node != nullptr) {
+    const int cmp = _compare(key, (*node)->key);
+    if (cmp == 0) break;
+    path[depth++] = node;
+    if (cmp < 0) {
+      node = &((*node)->left);
+    }
+    else {
+      node = &((*node)->right);
+    }
+  }
 
-  if (cur == nullptr) {
+  if (*node == nullptr) {
     // Key not found
     throw std::runtime_error("error in remove(): key not found");
   }
-  else if (key == cur->key) {
-    // Found the node to remove; remove it recursively and return the data.
-    // (There's no need to "ensure balance" of the node being removed.)
-    return _remove(cur);
-  }
-  else if (key < cur->key) {
-    // Search left and remove
-    const D& d = _find_and_remove(key, cur->left);
-    // Ensure balance and update height of this ancestor
-    // on the way back up the call stack:
-    _ensureBalance(cur);
-    return d;
+
+  // Found the node to remove; remove it and keep a reference to the data.
+  // (There's no need to "ensure balance" of the node being removed.
+  //  _remove takes care of the nodes beneath this position, if needed.)
+  removed_data_type d = _remove(*node);
+
+  // Ensure balance and update height of each ancestor, going back up.
+  const int path_length = depth;
+  while (depth > 0) {
+    _ensureBalance(*path[--depth]);
   }
-  else {
-    // Search right and remove
-    const D& d = _find_and_remove(key, cur->right);
-    // Ensure balance and update height of this ancestor
-    // on the way back up the call stack:
-    _ensureBalance(cur);
-    return d;
+
+  // "node" still points at the tree pointer where the removed node was,
+  // which now points to whatever took its place.
+  if (ENABLE_LOCAL_CHECKS) {
+    _runLocalChecks(path, path_length, *node);
   }
 
+  return d;
 }
 
 // _remove will remove the node pointed to by the argument. Note that this
 // will alter the pointer you pass in-place, so you should not reuse the
 // pointer variable after calling this function on it. You can't be sure what
 // it points to anymore after the function call.
-template <typename K, typename D>
-const D& AVL<K, D>::_remove(TreeNode*& node) {
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::removed_data_type
+AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_remove(TreeNode*& node) {
 
   // If the node we are trying to remove is a nullptr, then it's an error,
   // as even if we'd like to "do nothing" here as a base case, we must return
@@ -263,12 +360,15 @@ const D& AVL<K, D>::_remove(TreeNode*& node) {
   if (node->left == nullptr && node->right == nullptr) {
     // Peek at the data referred to by the node so we can return a reference
     // to the data later, after the tree node itself is already gone.
-    const D& data = node->data;
+    // (If the node owns its data, then takeData moves the data out of the
+    //  node instead, since the node's copy is about to be destroyed.)
+    removed_data_type data = node->takeData();
     // The node is a leaf, so it has no descendants to worry about.
     // We can just delete it. (The slides originally showed "delete(node)".
-    // Note that the syntax for "delete" is like an operator, not a function,
-    // so it's not necessary to put the () when you use it.)
-    delete node;
+    // Here we ask the node allocator to destroy it instead, since that's
+    // where it came from. With the default HeapNodeAllocator, this does
+    // exactly "delete node;".)
+    nodes_.destroy(node);
     // It's very important to set "node" to nullptr here. The parent is still
     // holding this same pointer, so we must mark that the child is gone.
     node = nullptr;
@@ -280,10 +380,10 @@ const D& AVL<K, D>::_remove(TreeNode*& node) {
     // pointer to point to the node's child, so that the parent of the node
     // being deleted will retain its connection to the rest of the tree
     // below this point.
-    const D& data = node->data;
+    removed_data_type data = node->takeData();
     TreeNode* temp = node;
     node = node->left;
-    delete temp;
+    nodes_.destroy(temp);
     // "temp" is a temporary local variable here, but as a good habit, let's
     // set it to nullptr anyway rather than trying to over-optimize.
     temp = nullptr;
@@ -299,10 +399,10 @@ const D& AVL<K, D>::_remove(TreeNode*& node) {
   // One-child (right) remove
   else if (node->left == nullptr && node->right != nullptr) {
     // This case is symmetric to the previous case.
-    const D& data = node->data;
+    removed_data_type data = node->takeData();
     TreeNode* temp = node;
     node = node->right;
-    delete temp;
+    nodes_.destroy(temp);
     temp = nullptr;
 
     return data;
@@ -331,8 +431,9 @@ const D& AVL<K, D>::_remove(TreeNode*& node) {
 // represented by the first argument. If you need to keep track of the new
 // positions of BOTH nodes after the call, for some purpose, then you could
 // extend this to return two new references.
-template <typename K, typename D>
-typename AVL<K, D>::TreeNode*& AVL<K, D>::_swap_nodes(
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::TreeNode*& AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_swap_nodes(
   TreeNode*& node1, TreeNode*& node2) {
 
   // More information on the problem we need to solve here:
@@ -361,6 +462,10 @@ typename AVL<K, D>::TreeNode*& AVL<K, D>::_swap_nodes(
   // do this before changing the pointers. Since the heights are stored as
   // plain values in the nodes, it's easy to swap them.
   std::swap(node1->height, node2->height);
+  // The same goes for the augmentation, which also describes the subtree
+  // at each position. (_iopRemove recalculates it anyway on the way back
+  // up, but this keeps every node correct in between.)
+  std::swap(static_cast<Augmentation<K, D>&>(*node1), static_cast<Augmentation<K, D>&>(*node2));
 
   // The first case below has been fully commented, and the following cases
   // are similar and symmetric, so comments have been omitted there.
@@ -445,8 +550,9 @@ typename AVL<K, D>::TreeNode*& AVL<K, D>::_swap_nodes(
 
 }
 
-template <typename K, typename D>
-void AVL<K, D>::_updateHeight(TreeNode*& cur) {
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_updateHeight(TreeNode*& cur) {
   // If the node is nullptr, then do nothing and return.
   if (!cur) return;
   // Otherwise update the height to be one more than the greater of the
@@ -454,10 +560,18 @@ void AVL<K, D>::_updateHeight(TreeNode*& cur) {
   // case where a child is just nullptr (no node exists), in which case
   // its implicit height is -1.
   cur->height = 1 + std::max(_get_height(cur->left), _get_height(cur->right));
+  // The subtree augmentation (see NodeAugmentation.h), such as the subtree
+  // size, depends on the children in the same way that the height does.
+  // Every change to the shape of the tree (rotations, removals, and bulk
+  // builds) ends by calling _updateHeight on the changed nodes from the
+  // bottom up, so this is the one place where it needs to be recalculated.
+  // With the default NoAugmentation, this call does nothing at all.
+  cur->augment(cur->key, cur->data, cur->left, cur->right);
 }
 
-template <typename K, typename D>
-void AVL<K, D>::_ensureBalance(TreeNode*& cur) {
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_ensureBalance(TreeNode*& cur) {
 
   // Base case for safety: do nothing if cur is nullptr.
   if (!cur) return;
@@ -536,8 +650,9 @@ void AVL<K, D>::_ensureBalance(TreeNode*& cur) {
 
 }
 
-template <typename K, typename D>
-void AVL<K, D>::_rotateLeft(TreeNode*& cur) {
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_rotateLeft(TreeNode*& cur) {
 
   // Here, cur points to the original top-most node that roots the subtree
   // where we will do the left rotation. You might also want to refer
@@ -581,8 +696,9 @@ void AVL<K, D>::_rotateLeft(TreeNode*& cur) {
 
 }
 
-template <typename K, typename D>
-void AVL<K, D>::_rotateRight(TreeNode*& cur) {
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_rotateRight(TreeNode*& cur) {
 
   // This implementation is a mirror image of _rotateLeft.
 
@@ -606,8 +722,9 @@ void AVL<K, D>::_rotateRight(TreeNode*& cur) {
 
 }
 
-template <typename K, typename D>
-void AVL<K, D>::_rotateRightLeft(TreeNode*& cur) {
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_rotateRightLeft(TreeNode*& cur) {
 
   // Here, cur points to the original top-most node that roots the subtree
   // where we will do the rotation. You might also want to refer to the
@@ -634,8 +751,9 @@ void AVL<K, D>::_rotateRightLeft(TreeNode*& cur) {
 
 }
 
-template <typename K, typename D>
-void AVL<K, D>::_rotateLeftRight(TreeNode*& cur) {
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+void AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_rotateLeftRight(TreeNode*& cur) {
 
   // Similar to _rotateRightLeft
 
@@ -649,30 +767,76 @@ void AVL<K, D>::_rotateLeftRight(TreeNode*& cur) {
 
 }
 
-template <typename K, typename D>
-const D& AVL<K, D>::_iopRemove(TreeNode*& targetNode) {
+template <typename K, typename D, template <typename> class NodeAllocator,
+  template <typename, typename> class NodeStorage, template <typename, typename> class Augmentation, typename Compare>
+typename AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::removed_data_type
+AVL<K, D, NodeAllocator, NodeStorage, Augmentation, Compare>::_iopRemove(TreeNode*& targetNode) {
 
   // Here, the target node means the node we intend to remove.
 
   if (!targetNode) {
     throw std::runtime_error("ERROR: _iopRemove(TreeNode*& targetNode) called on nullptr");
   }
-
-  // Kick-start the IOP-finding process with the left child of the target,
-  // although we ultimately want to find the right-most child of that.
-  // The last argument "true" signals that it is the initial call we are
-  // making to that version of the recursive function on the way down.
-  const D& d = _iopRemove(targetNode, targetNode->left, true);
-
-  // A lot of things happened during the recursive call that we just made.
-  // There are two nodes that still need to get their balance checked here:
-  // First, we need to check the balance of the first node to the left, if
-  // any node still exists in that position. This is because the base case
-  // in the other version of _iopRemove doesn't check it there. After that,
-  // we also check the balance of "targetNode", which is now the node that
-  // ended up in targetNode's original upper position. The rest of the nodes
-  // above this, that are on the trail up to the root, must be re-checked by
-  // whichever function had called _iopRemove in the first place.
+  if (!targetNode->left) {
+    throw std::runtime_error("ERROR: _iopRemove: targetNode has no left child");
+  }
+
+  // To find the IOP, we start with the left child of the target and then
+  // keep going right as far as possible. We record the path of pointers
+  // along the way: path[0] is the target's left child pointer, path[1] is
+  // that child's right child pointer, and so on. The last entry in the
+  // path is the pointer to the IOP itself.
+  TreeNode** path[MAX_PATH_LENGTH];
+  int depth = 0;
+  path[depth++] = &(targetNode->left);
+  while ((*path[depth-1])->right != nullptr) {
+    path[depth] = &((*path[depth-1])->right);
+    depth++;
+  }
+
+  // We found the IoP. Swap the nodes by location, altering the pointers:
+  // After swapping positions, we get back a reference to the updated
+  // pointer to the targeted node. Meanwhile, "targetNode" will end up
+  // pointing to the hoisted node that replaced the target's position.
+  // We need to remember that, since targetNode was passed by reference.
+  TreeNode*& movedTarget = _swap_nodes(targetNode, *path[depth-1]);
+
+  // Let's think carefully about what just happened.
+  // The target node object is now in the lower position that was the IOP,
+  // and the IOP object is now in the target's upper position.
+  //   The path[0] entry was the address of the "left" pointer inside the
+  // original target node object. That object has moved down, so path[0] is
+  // no longer a pointer on the path, and we must not use it again. (That's
+  // also why we got back the "movedTarget" pointer from _swap_nodes: if the
+  // target was the direct parent of the IOP, then the last path entry is
+  // path[0] and it's no longer valid either.) The other entries, path[1]
+  // and beyond, are inside nodes that didn't move, so they're still valid.
+
+  // Since the moved target is now in the lower position that was the IOP,
+  // we know that removing it from that position will either be a
+  // zero-child remove or a one-child remove now. It can't be another
+  // two-child remove because then we must not have found the IOP yet.
+  // Since it's not going to be another two-child remove, we don't need
+  // to worry about _iopRemove being called yet again here.
+  removed_data_type d = _remove(movedTarget);
+
+  // Now rebalance the ancestors of the IOP's old position, from the bottom
+  // up. The deepest one is the node that held the pointer in path[depth-1],
+  // which is the node that path[depth-2] points to, and so on, up to the
+  // node that path[1] points to.
+  for (int i = depth - 2; i >= 1; i--) {
+    _ensureBalance(*path[i]);
+  }
+
+  // Two nodes still need to get their balance checked here: First, the
+  // first node to the left, if any node still exists in that position.
+  // (We had to skip path[0] above, but we can reach the same node through
+  // the hoisted node, since it's now the hoisted node's left child.) After
+  // that, we also check the balance of "targetNode", which is now the node
+  // that ended up in targetNode's original upper position. The rest of the
+  // nodes above this, that are on the trail up to the root, must be
+  // re-checked by whichever function had called _iopRemove in the first
+  // place.
   if (targetNode->left) {
     _ensureBalance(targetNode->left);
   }
@@ -681,121 +845,9 @@ const D& AVL<K, D>::_iopRemove(TreeNode*& targetNode) {
   return d;
 }
 
-template <typename K, typename D>
-const D& AVL<K, D>::_iopRemove(TreeNode*& targetNode, TreeNode*& iopAncestor, bool isInitialCall) {
-
-  // Here, iopAncestor is pointing to either the most recent ancestor node
-  // on the path as we head down to the actual IOP, or it is the IOP itself.
-  // (That is the base case that we will reach.)
-
-  // "isInitialCall" is set to true the first time we call this function on
-  // the way down, and otherwise, we set it to false (when we recurse here).
-
-  if (!targetNode) {
-    throw std::runtime_error("ERROR: _iopRemove(TreeNode*& targetNode, TreeNode*& iopAncestor): targetNode is null");
-  }
-
-  if (!iopAncestor) {
-    throw std::runtime_error("ERROR: _iopRemove(TreeNode*& targetNode, TreeNode*& iopAncestor): iopAncestor is null");
-  }
-
-  if (iopAncestor->right != nullptr) {
-    // General case: IoP not found yet.
-    // Keep doing deeper recursively, eventually removing the target after
-    // a swap, and getting the data back. We have to pass "false" for the
-    // next "isInitialCall" argument now.
-    const D& d = _iopRemove(targetNode, iopAncestor->right, false);
-
-    // After the recursive call has been made, the target node has been
-    // removed successfully from the ultimate IOP position.
-    // Also, d now has a reference to the removed data.
-
-    // In many cases, the "iopAncestor" pointer is now still pointing to
-    // one of the ancestors of the actual IOP node position. That is
-    // convenient to us here, because on the way back up from the recursion
-    // process, we'll call _ensureBalance on these to make sure that any
-    // necessary balancing changes or height updates are propagated upwards
-    // in the trail of ancestry to the root. However, if the current node
-    // was the first node to the left at the beginning of the process, then
-    // its immediate parent was just involved in a swap with the IOP! This
-    // is a problem for us here because we no longer have a safe way to
-    // directly change the pointer that points to this node. To get around
-    // this problem, we've passed an argument that tells whether it's the
-    // initial call to this version of _iopRemove or not, on the way down.
-    // If it is the initial call, then this was the first node to the left,
-    // so we can't call _ensureBalance on the "iopAncestor" pointer here:
-    // that pointer is no longer valid! Instead, we'll skip that here, and
-    // the outer _iopRemove wrapper function will do the job of ensuring the
-    // balance of its left child at the end.
-
-    if (!isInitialCall) {
-      // When it's not the initial call on the path traversing right, then
-      // this node's parent was not swapped, so the iopAncestor pointer is
-      // still valid here. We can ensure the balance of this node now, while
-      // we go back up the call stack.
-
-      // The version originally shown on the lecture slides had checked for
-      // nullptr here. In this version, we shouldn't really have to, since
-      // _ensureBalance now does this also, but also because if it had been
-      // a swap between the targetNode and the IOP here that caused the
-      // ancestor to no longer exist, then we would be in the base case branch
-      // of this function now, not here. In any case, it's okay to have a
-      // slightly redundant safety check, with almost no performance cost at
-      // all. We don't want to manually over-optimize this logic and possibly
-      // make a mistake.
-      if (iopAncestor) {
-        _ensureBalance(iopAncestor);
-      }
-    }
-
-    return d;
-  }
-  else {
-    // Base case: Here, iopAncestor points to the actual IOP.
-
-    // We found the IoP. Swap the nodes by location, altering the pointers:
-    // After swapping positions, we get back a reference to the updated
-    // pointer to the targeted node. Meanwhile, "targetNode" will end up
-    // pointing to the hoisted node that replaced the target's position.
-    // We need to remember that when we return up the call stack, since
-    // targetNode was passed by reference.
-    TreeNode*& movedTarget = _swap_nodes(targetNode, iopAncestor);
-
-    // Let's think carefully about what just happened.
-    // If the target node was not the direct parent of the IOP, then the
-    // swap was fairly simple, and now the pointer "targetNode" is actually
-    // pointing to the node that used to be the IOP, which is now raised
-    // to the higher position. So we'll want to make sure that the other
-    // _iopRemove wrapper function calls _ensureBalance on "targetNode"
-    // after we get out of the recursive call stack there. We can't do it
-    // right now, because first we want to make sure _ensureBalance gets
-    // called on the other nodes in the lineage on the way back up.
-    // The current function takes care of that as it returns through the
-    // other conditional branch (the general case).
-
-    // If the target node was the direct parent of the IOP, then this is
-    // still true. "targetNode" is now pointing to the raised node.
-    // The only complication is that the "iopAncestor" pointer is now
-    // pointing to something we aren't sure of, but we won't refer to it
-    // again here, so it doesn't matter. That's why we got back the
-    // "movedTarget" pointer from _swap_nodes instead, so we always know
-    // the correct pointer to remove from the lower position.
-
-    // Since the moved target is now in the lower position that was the
-    // IOP, we know that removing it from that position will either be a
-    // zero-child remove or a one-child remove now. It can't be another
-    // two-child remove because then we must not have found the IOP yet.
-    // Since it's not going to be another two-child remove, we don't need
-    // to worry about _iopRemove being called yet again here.
-
-    // Remove the swapped node (at IoP's position) and return up the call
-    // stack. What we return is actually a reference to the const data
-    // that was removed.
-    const D& d = _remove(movedTarget);
-    return d;
-  }
-
-}
-
 // Include the remaining headers in this series of related header files
 #include "AVL-extra.hpp"
+#include "AVL-bulk.hpp"
+#include "AVL-order.hpp"
+#include "AVL-iterator.hpp"
+#include "AVL-setops.hpp"
@@ -0,0 +1,102 @@
+/**
+ * Key comparison policies for the tree classes.
+ *
+ * The lecture version of _find compares the keys twice at each level:
+ *   if (key == node->key) ... else if (key < node->key) ... else ...
+ * For int keys, that costs almost nothing. But comparing two std::string
+ * keys means reading both strings until they differ, and when many keys
+ * share a long common prefix (like file paths or URLs), every comparison
+ * reads that whole prefix. Doing that twice per level nearly doubles the
+ * cost of a lookup.
+ *   A three-way comparison answers both questions at once. It returns a
+ * negative number if a < b, zero if they are equal, and a positive number if
+ * a > b, like std::string::compare or strcmp do. The trees call the
+ * comparator once per level and then branch on the sign of the result.
+ *
+ * A comparator is a class with an operator() that takes two keys (or a key
+ * and something that can be compared with a key) and returns an int. The
+ * tree creates a comparator object whenever it needs one, so the class must
+ * not have any state.
+ *
+ *   ThreeWayCompare : the default.
+ *     For std::string, this calls compare(), which makes one pass over the
+ *     characters. For any other type, it uses operator<. That can take two
+ *     comparisons, but for built-in types like int the compiler combines
+ *     them into one.
+ *       It is also "transparent": it can compare a key with an object of a
+ *     different type, so find() and contains() accept any such type
+ *     directly. For example, on a tree with std::string keys you can call
+ *     find("some literal") or find(some_char_pointer), and no temporary
+ *     std::string is built just for the lookup. When compiled as C++17 or
+ *     later, std::string_view works too. (This is the same idea as
+ *     std::less<> with std::map. A comparator says that it is transparent
+ *     with a member type named "is_transparent".)
+ */
+
+#pragma once
+
+// We include <string> for std::string::compare
+#include <string>
+// We include <cstring> for std::strncmp and std::strlen
+#include <cstring>
+
+#if __cplusplus >= 201703L
+// We include <string_view> for std::string_view (C++17 and later only)
+#include <string_view>
+#endif
+
+class ThreeWayCompare {
+  public:
+    using is_transparent = void;
+
+    // Any two types that can be compared with operator<.
+    template <typename A, typename B>
+    int operator()(const A& a, const B& b) const {
+      return (a < b) ? -1 : ((b < a) ? 1 : 0);
+    }
+
+    // Strings: compare() already gives a three-way result.
+    int operator()(const std::string& a, const std::string& b) const {
+      return a.compare(b);
+    }
+
+    // C strings: std::string also has a compare(const char*), but it calls
+    // strlen on the C string first, and a search would then measure the
+    // same C string again at every level. That made lookups with a C string
+    // about 60% slower than with a std::string in avl/bench.cpp. So instead, we
+    // use strncmp, which stops at the first difference. Only when the two
+    // agree up to the end of b (usually just at the node that we're looking
+    // for) do we need the length of the C string. (For a C string on the
+    // right, we flip the sign of the result. We don't just negate it, since
+    // it could be INT_MIN, which can't be negated.)
+    int operator()(const char* a, const std::string& b) const {
+      const int result = std::strncmp(a, b.c_str(), b.size());
+      if (result != 0) return result;
+      // The first b.size() characters match, or both have a '\0' at the same
+      // place, if b has one inside it.
+      const std::size_t a_length = std::strlen(a);
+      if (a_length < b.size()) return -1;
+      return (a_length == b.size()) ? 0 : 1;
+    }
+    int operator()(const std::string& a, const char* b) const {
+      const int result = (*this)(b, a);
+      return (result < 0) - (result > 0);
+    }
+    // (Without these two, a non-const char* would be a better match for the
+    // template version above, which compares twice.)
+    int operator()(const std::string& a, char* b) const {
+      return (*this)(a, static_cast<const char*>(b));
+    }
+    int operator()(char* a, const std::string& b) const {
+      return (*this)(static_cast<const char*>(a), b);
+    }
+
+#if __cplusplus >= 201703L
+    int operator()(const std::string& a, std::string_view b) const {
+      return a.compare(b);
+    }
+    int operator()(std::string_view a, const std::string& b) const {
+      return a.compare(b);
+    }
+#endif
+};
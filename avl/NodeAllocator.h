@@ -0,0 +1,212 @@
+/**
+ * Node allocation policies for the AVL tree.
+ *
+ * The AVL class takes one of these as a template parameter and uses it for
+ * every TreeNode it creates or destroys. Both policies provide the same
+ * small interface:
+ *   create(args...) : allocate and construct one object, return a pointer
+ *   destroy(ptr)    : destruct one object and give its memory back
+ *   release()       : give back all memory at once (after every object that
+ *                     was created has already been destroyed)
+ *   absorb(other)   : take over everything that another allocator of the
+ *                     same type created, so that those objects can now be
+ *                     destroyed through this one
+ *   share(other)    : keep the other allocator's memory alive as long as
+ *                     this one's, so that some of its objects can be moved
+ *                     over and destroyed through this one later
+ * The last two are used when the set operations in AVL-setops.hpp move
+ * nodes from one tree to another.
+ */
+
+#pragma once
+
+// We include <cstddef> for std::size_t
+#include <cstddef>
+// We include <memory> for std::shared_ptr, which lets arenas share slabs.
+#include <memory>
+// We include <new> for "placement new", which constructs an object in
+// memory that has already been allocated.
+#include <new>
+// We include <utility> for std::forward
+#include <utility>
+// We include <vector> to keep track of the slabs in the arena.
+#include <vector>
+
+// HeapNodeAllocator: Every node is a separate "new" and "delete". This is
+// what the AVL tree originally did, and it's still the default.
+template <typename T>
+class HeapNodeAllocator {
+  public:
+    template <typename... Args>
+    T* create(Args&&... args) {
+      return new T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T* ptr) {
+      delete ptr;
+    }
+
+    // Nothing is held back, so there is nothing to release.
+    void release() { }
+
+    // Every node came from the same general-purpose heap, so any node can
+    // already be deleted from anywhere. There's nothing to take over.
+    void absorb(HeapNodeAllocator&) { }
+    void share(const HeapNodeAllocator&) { }
+};
+
+// ArenaNodeAllocator: Nodes are carved out of large contiguous "slabs".
+// A node that is destroyed goes onto a free list so the next create() can
+// reuse its slot. The slabs themselves are only returned to the system by
+// release() (or the destructor), all at once.
+//   This helps in two ways: most create() calls are just a pointer bump or
+// a pop from the free list instead of a trip through the general-purpose
+// allocator, and nodes created around the same time end up next to each
+// other in memory.
+//   Since the arena owns its slabs, the arena can't be copied. Each tree
+// gets its own arena. (When a tree is split in two, the two arenas share
+// the slabs instead, and a slab is only freed once neither arena needs it.
+// std::shared_ptr keeps track of that for us.)
+template <typename T>
+class ArenaNodeAllocator {
+  public:
+    ArenaNodeAllocator()
+      : free_list_(nullptr), next_slot_(0), next_slab_size_(FIRST_SLAB_SIZE) { }
+
+    ArenaNodeAllocator(const ArenaNodeAllocator&) = delete;
+    ArenaNodeAllocator& operator=(const ArenaNodeAllocator&) = delete;
+
+    ~ArenaNodeAllocator() {
+      release();
+    }
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+      Slot* slot = _takeSlot();
+      try {
+        return new (slot->storage) T(std::forward<Args>(args)...);
+      }
+      catch (...) {
+        // If the constructor throws, the slot was never used, so put it
+        // back before passing the exception along.
+        _giveBackSlot(slot);
+        throw;
+      }
+    }
+
+    void destroy(T* ptr) {
+      ptr->~T();
+      _giveBackSlot(reinterpret_cast<Slot*>(ptr));
+    }
+
+    // Free every slab. The caller must have destroyed all of the objects
+    // first, because no destructors are run here.
+    void release() {
+      // Dropping our pointers to the slabs frees every slab that isn't
+      // shared with another arena.
+      slabs_.clear();
+      slab_sizes_.clear();
+      free_list_ = nullptr;
+      next_slot_ = 0;
+      next_slab_size_ = FIRST_SLAB_SIZE;
+    }
+
+    // Take over all of the other arena's slabs, leaving it empty. The
+    // objects in them stay where they are, and from now on this arena will
+    // free their memory. The other arena's unused slots become free slots
+    // here.
+    void absorb(ArenaNodeAllocator& other) {
+      if (&other == this) return;
+      if (!other.slabs_.empty()) {
+        Slot* newest = other.slabs_.back().get();
+        for (std::size_t i = other.next_slot_; i < other.slab_sizes_.back(); i++) {
+          _giveBackSlot(&newest[i]);
+        }
+      }
+      while (other.free_list_) {
+        Slot* slot = other.free_list_;
+        other.free_list_ = slot->next_free;
+        _giveBackSlot(slot);
+      }
+      // The other slabs go in front of ours, so that our newest slab, where
+      // _takeSlot continues, is still the last one. If we had no slabs, the
+      // last one is now the other arena's newest, whose unused slots are on
+      // our free list already, so we mark it as used up.
+      const bool had_no_slabs = slabs_.empty();
+      slabs_.insert(slabs_.begin(), other.slabs_.begin(), other.slabs_.end());
+      slab_sizes_.insert(slab_sizes_.begin(), other.slab_sizes_.begin(), other.slab_sizes_.end());
+      if (had_no_slabs && !slabs_.empty()) {
+        next_slot_ = slab_sizes_.back();
+      }
+      other.slabs_.clear();
+      other.slab_sizes_.clear();
+      other.release();
+    }
+
+    // Keep all of the other arena's current slabs alive for as long as we
+    // need them too. Unlike absorb, the other arena keeps working normally.
+    void share(const ArenaNodeAllocator& other) {
+      if (&other == this) return;
+      const bool had_no_slabs = slabs_.empty();
+      slabs_.insert(slabs_.begin(), other.slabs_.begin(), other.slabs_.end());
+      slab_sizes_.insert(slab_sizes_.begin(), other.slab_sizes_.begin(), other.slab_sizes_.end());
+      // The other arena still hands out the unused slots of its newest
+      // slab, so if that slab is now our last one, we must not.
+      if (had_no_slabs && !slabs_.empty()) {
+        next_slot_ = slab_sizes_.back();
+      }
+    }
+
+  private:
+    // Each slot can either hold an object or, while it's unused, a link to
+    // the next free slot. A union lets both share the same bytes.
+    union Slot {
+      Slot* next_free;
+      alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    // The first slab is small so a tiny tree doesn't waste memory. After
+    // that, each new slab doubles in size, up to a limit.
+    static constexpr std::size_t FIRST_SLAB_SIZE = 64;
+    static constexpr std::size_t MAX_SLAB_SIZE = 65536;
+
+    std::vector<std::shared_ptr<Slot>> slabs_;
+    std::vector<std::size_t> slab_sizes_;
+    Slot* free_list_;
+    // The index of the next never-used slot in the newest slab.
+    std::size_t next_slot_;
+    std::size_t next_slab_size_;
+
+    Slot* _takeSlot() {
+      // Reuse a freed slot if there is one.
+      if (free_list_) {
+        Slot* slot = free_list_;
+        free_list_ = slot->next_free;
+        return slot;
+      }
+      // Otherwise take the next slot from the newest slab, starting a new
+      // slab if that one is used up.
+      if (slabs_.empty() || next_slot_ == slab_sizes_.back()) {
+        // The shared_ptr needs to know to use delete[] for an array.
+        slabs_.push_back(std::shared_ptr<Slot>(new Slot[next_slab_size_], std::default_delete<Slot[]>()));
+        slab_sizes_.push_back(next_slab_size_);
+        next_slot_ = 0;
+        if (next_slab_size_ < MAX_SLAB_SIZE) {
+          next_slab_size_ *= 2;
+        }
+      }
+      return &slabs_.back().get()[next_slot_++];
+    }
+
+    void _giveBackSlot(Slot* slot) {
+      slot->next_free = free_list_;
+      free_list_ = slot;
+    }
+};
+
+// C++14 compatibility: out-of-class definitions of the static constexpr
+// members. (See the similar note at the bottom of AVL.h.)
+template <typename T>
+constexpr std::size_t ArenaNodeAllocator<T>::FIRST_SLAB_SIZE;
+template <typename T>
+constexpr std::size_t ArenaNodeAllocator<T>::MAX_SLAB_SIZE;
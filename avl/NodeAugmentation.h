@@ -0,0 +1,120 @@
+/**
+ * Node augmentation policies for the AVL tree.
+ *
+ * The tree's TreeNode class inherits from one of these, in addition to its
+ * storage policy (NodeStorage.h). An augmentation is extra information
+ * about the node's whole subtree, kept up to date as the tree changes:
+ *
+ *   NoAugmentation<K, D>           : Nothing. This is the default, and it
+ *     adds no members to the node at all.
+ *
+ *   SubtreeSize<K, D>              : std::size_t size;
+ *     The number of nodes in the subtree. With this, the tree can answer
+ *     rank (how many keys are smaller than this one?), select (what is the
+ *     i-th smallest key?) and countInRange in O(log n) time.
+ *
+ *   SubtreeAggregate<K, D, Monoid> : std::size_t size; aggregate_type aggregate;
+ *     The size, and also the Monoid's combination of all of the items in
+ *     the subtree, in order. With this, the tree can also answer
+ *     rangeAggregate (such as the sum of the data of all keys from lo to
+ *     hi) in O(log n) time.
+ *
+ * A Monoid class says how to combine items. It needs:
+ *   value_type            : The type of the combined value.
+ *   identity()            : The value for no items at all, such as 0 for a
+ *                           sum. combine(identity(), x) must be x.
+ *   of(key, data)         : The value for one item.
+ *   combine(left, right)  : The value for the items of "left" followed by
+ *                           the items of "right". This must be associative,
+ *                           but it doesn't have to be commutative.
+ * SumOfData below is an example.
+ *
+ * Since the AVL class expects a template with just <K, D> parameters, you
+ * choose a Monoid with an alias template, like this:
+ *   template <typename K, typename D>
+ *   using SumAugmentation = SubtreeAggregate<K, D, SumOfData<long long>>;
+ *   AVL<int, int, HeapNodeAllocator, StoreKeysAndData, SumAugmentation> tree;
+ */
+
+#pragma once
+
+// We include <cstddef> for std::size_t
+#include <cstddef>
+
+// The tree calls augment(key, data, left, right) on a node whenever the
+// node's children may have changed, after the children themselves are up
+// to date. That happens in exactly the same places where the node's height
+// is recalculated, so the tree does it in _updateHeight. "left" and "right"
+// are the node's children, or nullptr.
+
+template <typename K, typename D>
+class NoAugmentation {
+  public:
+    static constexpr bool KEEPS_SIZE = false;
+    static constexpr bool KEEPS_AGGREGATE = false;
+
+    template <typename Node>
+    void augment(const K&, const D&, const Node*, const Node*) { }
+};
+
+template <typename K, typename D>
+class SubtreeSize {
+  public:
+    static constexpr bool KEEPS_SIZE = true;
+    static constexpr bool KEEPS_AGGREGATE = false;
+
+    std::size_t size;
+
+    SubtreeSize() : size(1) { }
+
+    template <typename Node>
+    void augment(const K&, const D&, const Node* left, const Node* right) {
+      size = 1 + (left ? left->size : 0) + (right ? right->size : 0);
+    }
+};
+
+template <typename K, typename D, typename Monoid>
+class SubtreeAggregate : public SubtreeSize<K, D> {
+  public:
+    static constexpr bool KEEPS_AGGREGATE = true;
+    using aggregate_type = typename Monoid::value_type;
+    using monoid_type = Monoid;
+
+    aggregate_type aggregate;
+
+    SubtreeAggregate() : aggregate(Monoid::identity()) { }
+
+    template <typename Node>
+    void augment(const K& key, const D& data, const Node* left, const Node* right) {
+      SubtreeSize<K, D>::augment(key, data, left, right);
+      // Left subtree, then this node, then the right subtree: that's the
+      // order of the keys.
+      aggregate = Monoid::combine(
+        Monoid::combine(left ? left->aggregate : Monoid::identity(), Monoid::of(key, data)),
+        right ? right->aggregate : Monoid::identity());
+    }
+};
+
+// SumOfData: A Monoid for the sum of the data items, added up as type T.
+template <typename T>
+class SumOfData {
+  public:
+    using value_type = T;
+
+    static value_type identity() { return T(); }
+
+    template <typename K, typename D>
+    static value_type of(const K&, const D& data) { return T(data); }
+
+    static value_type combine(const value_type& left, const value_type& right) {
+      return left + right;
+    }
+};
+
+// C++14 compatibility: out-of-class definitions of the static constexpr
+// members. (See the similar note at the bottom of AVL.h.)
+template <typename K, typename D> constexpr bool NoAugmentation<K, D>::KEEPS_SIZE;
+template <typename K, typename D> constexpr bool NoAugmentation<K, D>::KEEPS_AGGREGATE;
+template <typename K, typename D> constexpr bool SubtreeSize<K, D>::KEEPS_SIZE;
+template <typename K, typename D> constexpr bool SubtreeSize<K, D>::KEEPS_AGGREGATE;
+template <typename K, typename D, typename Monoid> constexpr bool SubtreeAggregate<K, D, Monoid>::KEEPS_AGGREGATE;
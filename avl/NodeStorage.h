@@ -0,0 +1,96 @@
+/**
+ * Node storage policies for the tree classes.
+ *
+ * The tree's TreeNode class inherits from one of these, so the policy
+ * decides how the "key" and "data" members of each node are stored:
+ *
+ *   StoreReferences<K, D>  : const K& key; const D& data;
+ *     The original design. The tree stores references to items that live
+ *     somewhere else, and the caller must keep those items alive for as
+ *     long as the tree uses them.
+ *
+ *   StoreKeys<K, D>        : const K key; const D& data;
+ *     The key is copied (or moved) into the node itself. Every comparison
+ *     during a lookup reads the key, so keeping it inside the node means
+ *     one less pointer to follow, and one less likely cache miss, for every
+ *     level of the tree. The data is still referenced.
+ *
+ *   StoreKeysAndData<K, D> : const K key; D data;
+ *     The node owns a copy of both the key and the data, so the caller
+ *     doesn't need to keep anything alive. Items can be moved in with
+ *     insert(K&&, D&&) or constructed in place with emplace.
+ *
+ * Each policy also says what type "remove" should return. When the node
+ * owns the data, the data is destroyed along with the node, so remove has
+ * to hand it back by value instead of by reference.
+ */
+
+#pragma once
+
+// We include <utility> for std::forward and std::move
+#include <utility>
+
+template <typename K, typename D>
+class StoreReferences {
+  public:
+    static constexpr bool OWNS_KEY = false;
+    static constexpr bool OWNS_DATA = false;
+    using removed_data_type = const D&;
+
+    const K& key;
+    const D& data;
+
+    StoreReferences(const K& keyArgument, const D& dataArgument)
+      : key(keyArgument), data(dataArgument) { }
+
+    // Hand back the data of a node that is about to be destroyed.
+    removed_data_type takeData() { return data; }
+};
+
+template <typename K, typename D>
+class StoreKeys {
+  public:
+    static constexpr bool OWNS_KEY = true;
+    static constexpr bool OWNS_DATA = false;
+    using removed_data_type = const D&;
+
+    const K key;
+    const D& data;
+
+    template <typename KeyArg>
+    StoreKeys(KeyArg&& keyArgument, const D& dataArgument)
+      : key(std::forward<KeyArg>(keyArgument)), data(dataArgument) { }
+
+    removed_data_type takeData() { return data; }
+};
+
+template <typename K, typename D>
+class StoreKeysAndData {
+  public:
+    static constexpr bool OWNS_KEY = true;
+    static constexpr bool OWNS_DATA = true;
+    using removed_data_type = D;
+
+    const K key;
+    D data;
+
+    // The data can be built from any number of constructor arguments, which
+    // is what makes emplace possible.
+    template <typename KeyArg, typename... DataArgs>
+    StoreKeysAndData(KeyArg&& keyArgument, DataArgs&&... dataArguments)
+      : key(std::forward<KeyArg>(keyArgument)),
+        data(std::forward<DataArgs>(dataArguments)...) { }
+
+    // The node is about to be destroyed, so we can move the data out of it
+    // instead of copying it.
+    removed_data_type takeData() { return std::move(data); }
+};
+
+// C++14 compatibility: out-of-class definitions of the static constexpr
+// members. (See the similar note at the bottom of AVL.h.)
+template <typename K, typename D> constexpr bool StoreReferences<K, D>::OWNS_KEY;
+template <typename K, typename D> constexpr bool StoreReferences<K, D>::OWNS_DATA;
+template <typename K, typename D> constexpr bool StoreKeys<K, D>::OWNS_KEY;
+template <typename K, typename D> constexpr bool StoreKeys<K, D>::OWNS_DATA;
+template <typename K, typename D> constexpr bool StoreKeysAndData<K, D>::OWNS_KEY;
+template <typename K, typename D> constexpr bool StoreKeysAndData<K, D>::OWNS_DATA;
@@ -0,0 +1,448 @@
+/**
+ * AVL benchmarks:
+ * - per-node new/delete vs. arena node allocation
+ * - bulk building from sorted keys vs. repeated inserts
+ * - lookup latency of find()
+ * - lookup throughput with keys stored by reference vs. inside the nodes
+ * - range scans with iterators vs. one find() per key
+ * - union, intersection and difference of two trees vs. one insert or
+ *   remove per key
+ * - lookups of long string keys with one three-way comparison per level vs.
+ *   the two comparisons of the lecture version, and with a C string vs. a
+ *   temporary std::string as the search key
+ * - lookups in a tree vs. in the frozen EytzingerIndex from freeze() vs.
+ *   std::lower_bound on a sorted vector, and the memory each one takes
+ *
+ * Build and run with:
+ *   make bench
+ *   ./bench [number of keys]
+ */
+
+// Turn off the brute-force checks that AVL.h runs after every insert and
+// remove; otherwise we would mostly be timing those.
+#define AVL_DEBUGGING_CHECKS 0
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AVL.h"
+
+// Seconds elapsed since "start", as a double.
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// Insert every key, then clear the tree, and report how long each step took.
+template <template <typename> class NodeAllocator>
+void runAllocatorBenchmark(const char* label, const std::vector<int>& keys) {
+  AVL<int, int, NodeAllocator> t;
+
+  auto start = std::chrono::steady_clock::now();
+  for (const int& key : keys) {
+    t.insert(key, key);
+  }
+  const double insert_time = secondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  t.clear_tree();
+  const double clear_time = secondsSince(start);
+
+  std::cout << label
+    << "  insert: " << insert_time << " s"
+    << "  (" << (keys.size() / insert_time) << " inserts/s)"
+    << "  clear_tree: " << clear_time << " s" << std::endl;
+}
+
+// Build a tree from sorted keys with n inserts, and then with the bulk-build
+// constructor. Then merge in a second sorted batch of the same size with
+// insertSorted, and compare that with inserting the batch one at a time.
+void runBulkBenchmark(const std::vector<int>& sorted_keys) {
+  const std::size_t half = sorted_keys.size() / 2;
+  // Every other key goes in the first half, so the second batch has to be
+  // interleaved with the existing nodes.
+  std::vector<int> evens, odds;
+  for (std::size_t i=0; i<sorted_keys.size(); i++) {
+    (i % 2 == 0 ? evens : odds).push_back(sorted_keys[i]);
+  }
+
+  {
+    auto start = std::chrono::steady_clock::now();
+    AVL<int, int> t;
+    for (const int& key : evens) {
+      t.insert(key, key);
+    }
+    const double build_time = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (const int& key : odds) {
+      t.insert(key, key);
+    }
+    const double merge_time = secondsSince(start);
+
+    std::cout << "repeated insert     build " << half << ": " << build_time << " s"
+      << "  merge " << odds.size() << ": " << merge_time << " s" << std::endl;
+  }
+
+  {
+    auto start = std::chrono::steady_clock::now();
+    AVL<int, int> t(evens.begin(), evens.end(), evens.begin());
+    const double build_time = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    t.insertSorted(odds.begin(), odds.end(), odds.begin());
+    const double merge_time = secondsSince(start);
+
+    std::cout << "bulk / insertSorted build " << half << ": " << build_time << " s"
+      << "  merge " << odds.size() << ": " << merge_time << " s" << std::endl;
+  }
+}
+
+// Look up random keys that are in the tree and report the average time per
+// find() call. The sum of the results is printed so the compiler can't skip
+// the lookups.
+void runLookupBenchmark(const std::vector<int>& keys) {
+  AVL<int, int, ArenaNodeAllocator> t;
+  for (const int& key : keys) {
+    t.insert(key, key);
+  }
+
+  const std::size_t LOOKUPS = 4000000;
+  std::vector<int> queries(LOOKUPS);
+  std::mt19937 rng(777);
+  std::uniform_int_distribution<std::size_t> pick(0, keys.size() - 1);
+  for (int& q : queries) {
+    q = keys[pick(rng)];
+  }
+
+  long long sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (const int& q : queries) {
+    sum += t.find(q);
+  }
+  const double elapsed = secondsSince(start);
+
+  std::cout << "find: " << (elapsed * 1e9 / LOOKUPS) << " ns/lookup"
+    << "  (checksum " << sum << ")" << std::endl;
+}
+
+// Look up every key in random order, a few times over, and report lookups
+// per second. The keys vector is the external storage that the references
+// point to when NodeStorage is StoreReferences.
+template <template <typename, typename> class NodeStorage, typename K>
+void runStorageBenchmark(const char* label, const std::vector<K>& keys) {
+  AVL<K, int, ArenaNodeAllocator, NodeStorage> t;
+  std::vector<int> data(keys.size());
+  for (std::size_t i=0; i<keys.size(); i++) {
+    data[i] = (int)i;
+    t.insert(keys[i], data[i]);
+  }
+
+  // Query in a different random order than the insertions.
+  std::vector<std::size_t> order(keys.size());
+  for (std::size_t i=0; i<order.size(); i++) {
+    order[i] = i;
+  }
+  std::mt19937 rng(99);
+  std::shuffle(order.begin(), order.end(), rng);
+
+  const int ROUNDS = 3;
+  long long sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int r=0; r<ROUNDS; r++) {
+    for (const std::size_t& i : order) {
+      sum += t.find(keys[i]);
+    }
+  }
+  const double elapsed = secondsSince(start);
+
+  std::cout << label << ": " << (ROUNDS * keys.size() / elapsed) << " lookups/s"
+    << "  (checksum " << sum << ")" << std::endl;
+}
+
+// TwoComparisons: A comparator that does what the lecture version of _find
+// did at each level: first "==", and then "<" if the keys aren't equal. For
+// strings with a long common prefix, both of those read the whole prefix.
+class TwoComparisons {
+  public:
+    template <typename A, typename B>
+    int operator()(const A& a, const B& b) const {
+      if (a == b) return 0;
+      return (a < b) ? -1 : 1;
+    }
+};
+
+// Look up every key in random order with the given comparator, and report
+// the time per lookup. Each query is a separate char buffer, as if it had
+// just been read from a file or the network. With "temporary", each lookup
+// first builds a std::string from it, as a find(const K&) with std::string
+// keys requires; otherwise the C string is passed to find directly.
+template <typename Compare>
+void runStringKeyBenchmark(const char* label, const std::vector<std::string>& keys,
+  const std::vector<std::vector<char>>& queries, bool temporary) {
+
+  AVL<std::string, int, ArenaNodeAllocator, StoreKeys, NoAugmentation, Compare> t;
+  std::vector<int> data(keys.size(), 1);
+  for (std::size_t i=0; i<keys.size(); i++) {
+    t.insert(keys[i], data[i]);
+  }
+
+  // At least a million lookups in total, so small trees can be timed too.
+  const int ROUNDS = std::max(3, (int)(1000000 / queries.size()));
+  long long sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int r=0; r<ROUNDS; r++) {
+    for (const std::vector<char>& query : queries) {
+      if (temporary) {
+        sum += t.find(std::string(query.data()));
+      }
+      else {
+        sum += t.find(query.data());
+      }
+    }
+  }
+  const double elapsed = secondsSince(start);
+
+  std::cout << label << ": " << (elapsed * 1e9 / (ROUNDS * queries.size())) << " ns/lookup"
+    << "  (checksum " << sum << ")" << std::endl;
+}
+
+// Build "count" long keys that share a 200-character prefix and differ
+// only in the number at the end, like the paths of files in one deep
+// folder, and run runStringKeyBenchmark with each kind of search.
+void runStringKeyBenchmarks(int count) {
+  std::string prefix = "https://www.example.com/";
+  while (prefix.size() < 200) {
+    prefix += "archive/customers/";
+  }
+  prefix.resize(200);
+
+  std::vector<std::string> long_keys(count);
+  for (int i=0; i<count; i++) {
+    long_keys[i] = prefix + std::to_string(1000000000 + i);
+  }
+  std::shuffle(long_keys.begin(), long_keys.end(), std::mt19937(6));
+  std::vector<std::string> shuffled(long_keys);
+  std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(7));
+  std::vector<std::vector<char>> queries(count);
+  for (int i=0; i<count; i++) {
+    queries[i].assign(shuffled[i].c_str(), shuffled[i].c_str() + shuffled[i].size() + 1);
+  }
+
+  std::cout << count << " keys of " << long_keys[0].size() << " characters:" << std::endl;
+  runStringKeyBenchmark<TwoComparisons>("  == then <, temporary std::string", long_keys, queries, true);
+  runStringKeyBenchmark<ThreeWayCompare>("  three-way, temporary std::string", long_keys, queries, true);
+  runStringKeyBenchmark<ThreeWayCompare>("  three-way, C string             ", long_keys, queries, false);
+}
+
+// Scan ranges of 1000 consecutive keys, first with range(), which finds the
+// start in O(log n) and then steps through the nodes, and then the way we'd
+// have to do it without iterators: one find() for each key in the range.
+void runRangeScanBenchmark(const std::vector<int>& keys) {
+  AVL<int, int, ArenaNodeAllocator, StoreKeys> t;
+  for (const int& key : keys) {
+    t.insert(key, key);
+  }
+  const int SCANS = 20000, WIDTH = 1000;
+  std::mt19937 rng(7);
+  std::vector<int> starts(SCANS);
+  for (int& start : starts) {
+    start = (int)(rng() % (keys.size() - WIDTH));
+  }
+
+  long long sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (const int& lo : starts) {
+    for (const auto& item : t.range(lo, lo + WIDTH)) {
+      sum += item.data;
+    }
+  }
+  const double scan_time = secondsSince(start);
+
+  long long find_sum = 0;
+  start = std::chrono::steady_clock::now();
+  for (const int& lo : starts) {
+    for (int key = lo; key < lo + WIDTH; key++) {
+      find_sum += t.find(key);
+    }
+  }
+  const double find_time = secondsSince(start);
+
+  std::cout << "range():         " << ((double)SCANS * WIDTH / scan_time) << " items/s"
+    << "  (checksum " << sum << ")" << std::endl;
+  std::cout << "find() per key:  " << ((double)SCANS * WIDTH / find_time) << " items/s"
+    << "  (checksum " << find_sum << ")" << std::endl;
+}
+
+using SetTree = AVL<int, int, ArenaNodeAllocator, StoreKeys>;
+
+// Build the two trees for the set operations benchmark: "a" gets the first
+// three quarters of the keys in sorted order and "b" gets the last three
+// quarters, so half of the keys are in both.
+static void buildSetTrees(const std::vector<int>& sorted_keys, SetTree& a, SetTree& b) {
+  const std::size_t n = sorted_keys.size();
+  a.insertSorted(sorted_keys.begin(), sorted_keys.begin() + 3 * n / 4, sorted_keys.begin());
+  b.insertSorted(sorted_keys.begin() + n / 4, sorted_keys.end(), sorted_keys.begin() + n / 4);
+}
+
+// Time the set operations against the way we'd have to do them without
+// join and split: one insert (or remove) per key of the other tree.
+void runSetOperationsBenchmark(const std::vector<int>& sorted_keys) {
+  auto start = std::chrono::steady_clock::now();
+  {
+    SetTree a, b;
+    buildSetTrees(sorted_keys, a, b);
+    start = std::chrono::steady_clock::now();
+    for (const auto& item : b) {
+      if (!a.contains(item.key)) {
+        a.insert(item.key, item.data);
+      }
+    }
+    std::cout << "insert per key:               " << secondsSince(start) << " s" << std::endl;
+  }
+  {
+    SetTree a, b;
+    buildSetTrees(sorted_keys, a, b);
+    start = std::chrono::steady_clock::now();
+    for (const auto& item : b) {
+      if (a.contains(item.key)) {
+        a.remove(item.key);
+      }
+    }
+    std::cout << "remove per key:               " << secondsSince(start) << " s" << std::endl;
+  }
+
+  std::vector<unsigned> thread_counts = {1};
+  const unsigned cores = std::thread::hardware_concurrency();
+  for (unsigned t = 2; t <= cores; t *= 2) {
+    thread_counts.push_back(t);
+  }
+  for (unsigned threads : thread_counts) {
+    for (int op = 0; op < 3; op++) {
+      SetTree a, b;
+      buildSetTrees(sorted_keys, a, b);
+      start = std::chrono::steady_clock::now();
+      if (op == 0) a.unionWith(b, threads);
+      else if (op == 1) a.intersectionWith(b, threads);
+      else a.differenceWith(b, threads);
+      const double elapsed = secondsSince(start);
+      std::string label = (op == 0) ? "unionWith" : (op == 1) ? "intersectionWith" : "differenceWith";
+      label += ", " + std::to_string(threads) + ((threads == 1) ? " thread:" : " threads:");
+      label.resize(30, ' ');
+      std::cout << label << elapsed << " s" << std::endl;
+    }
+  }
+}
+
+// Look up random keys in a tree that stores its keys and data inside the
+// nodes, in the EytzingerIndex that freeze() makes from it, and with a
+// binary search (std::lower_bound) on a plain sorted vector, which has the
+// same keys and no pointers either, but searches in a cache-unfriendly
+// order. Also report how much memory each one takes.
+void runFrozenBenchmark(const std::vector<int>& keys) {
+  AVL<int, int, ArenaNodeAllocator, StoreKeysAndData> t;
+  for (const int& key : keys) {
+    t.insert(key, key);
+  }
+  const auto frozen = t.freeze();
+  std::vector<int> sorted_keys(keys);
+  std::sort(sorted_keys.begin(), sorted_keys.end());
+
+  const std::size_t LOOKUPS = 4000000;
+  std::vector<int> queries(LOOKUPS);
+  std::mt19937 rng(2020);
+  std::uniform_int_distribution<std::size_t> pick(0, keys.size() - 1);
+  for (int& q : queries) {
+    q = keys[pick(rng)];
+  }
+
+  long long sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (const int& q : queries) {
+    sum += t.find(q);
+  }
+  const double tree_time = secondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  for (const int& q : queries) {
+    sum += frozen.find(q);
+  }
+  const double frozen_time = secondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  for (const int& q : queries) {
+    sum += *std::lower_bound(sorted_keys.begin(), sorted_keys.end(), q);
+  }
+  const double vector_time = secondsSince(start);
+
+  // The tree's nodes come from the arena, so this is close to the real
+  // footprint. (With new/delete, each node would also have the malloc
+  // overhead.)
+  const std::size_t tree_bytes = keys.size() * t.bytesPerNode();
+  std::cout << "AVL tree find:           " << (tree_time * 1e9 / LOOKUPS) << " ns/lookup, "
+    << (tree_bytes / keys.size()) << " bytes/item" << std::endl;
+  std::cout << "EytzingerIndex find:     " << (frozen_time * 1e9 / LOOKUPS) << " ns/lookup, "
+    << ((double)frozen.memoryBytes() / keys.size()) << " bytes/item" << std::endl;
+  std::cout << "sorted vector, keys only: " << (vector_time * 1e9 / LOOKUPS) << " ns/lookup"
+    << "  (checksum " << sum << ")" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  const int N = (argc > 1) ? std::atoi(argv[1]) : 1000000;
+
+  // The tree stores references, so the keys have to live somewhere else
+  // for as long as the tree exists. We shuffle them so the inserts land
+  // all over the tree.
+  std::vector<int> keys(N);
+  for (int i=0; i<N; i++) {
+    keys[i] = i;
+  }
+  std::mt19937 rng(12345);
+  std::shuffle(keys.begin(), keys.end(), rng);
+
+  std::cout << "AVL node allocation benchmark, " << N << " random keys" << std::endl;
+  runAllocatorBenchmark<HeapNodeAllocator>("HeapNodeAllocator ", keys);
+  runAllocatorBenchmark<ArenaNodeAllocator>("ArenaNodeAllocator", keys);
+
+  std::vector<int> sorted_keys(keys);
+  std::sort(sorted_keys.begin(), sorted_keys.end());
+  std::cout << "\nAVL bulk build benchmark, " << N << " sorted keys" << std::endl;
+  runBulkBenchmark(sorted_keys);
+
+  std::cout << "\nAVL set operations benchmark, two trees of " << (3 * N / 4)
+    << " keys with " << (N / 2) << " in common" << std::endl;
+  runSetOperationsBenchmark(sorted_keys);
+
+  std::cout << "\nAVL lookup benchmark, " << N << " keys" << std::endl;
+  runLookupBenchmark(keys);
+
+  std::cout << "\nAVL range scan benchmark, " << N << " keys, scans of 1000 keys" << std::endl;
+  runRangeScanBenchmark(keys);
+
+  // Strings that share a common prefix, so that comparisons have to look
+  // past the first few characters.
+  std::vector<std::string> string_keys(N);
+  for (int i=0; i<N; i++) {
+    string_keys[i] = "customer-record-" + std::to_string(keys[i]);
+  }
+  std::cout << "\nAVL storage policy benchmark, " << N << " keys" << std::endl;
+  runStorageBenchmark<StoreReferences>("int keys,    StoreReferences", keys);
+  runStorageBenchmark<StoreKeys>("int keys,    StoreKeys      ", keys);
+  runStorageBenchmark<StoreReferences>("string keys, StoreReferences", string_keys);
+  runStorageBenchmark<StoreKeys>("string keys, StoreKeys      ", string_keys);
+
+  std::cout << "\nAVL string key benchmark, keys with a long common prefix" << std::endl;
+  runStringKeyBenchmarks(1000);
+  runStringKeyBenchmarks(std::min(N, 200000));
+
+  std::cout << "\nAVL frozen index benchmark, " << N << " keys" << std::endl;
+  runFrozenBenchmark(keys);
+
+  return 0;
+}
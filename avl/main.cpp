@@ -7,12 +7,82 @@
 
 #include <string>
 #include <iostream>
+#include <map>
+#include <random>
 #include <vector>
+#include <atomic>
 
+// Also run the local checks (see AVL.h) after every insert and remove, on
+// top of the full checks that are on by default in this debug build. This
+// way, every test below also tests that the local checks don't complain
+// about a correct tree.
+#define AVL_LOCAL_CHECKS 1
 #include "AVL.h"
 
 // Please see the introductory notes in AVL.h before you study this file.
 
+// The augmentations for the order statistics test below. (See
+// NodeAugmentation.h.) SumAugmentation keeps the sum of the data in each
+// subtree. ConcatAugmentation concatenates the data strings in key order,
+// which checks that rangeAggregate combines the items in the right order.
+template <typename K, typename D>
+using SumAugmentation = SubtreeAggregate<K, D, SumOfData<long long>>;
+
+class ConcatData {
+  public:
+    using value_type = std::string;
+    static value_type identity() { return ""; }
+    template <typename K>
+    static value_type of(const K&, const std::string& data) { return data; }
+    static value_type combine(const value_type& left, const value_type& right) { return left + right; }
+};
+template <typename K, typename D>
+using ConcatAugmentation = SubtreeAggregate<K, D, ConcatData>;
+
+// Comparators for the key comparison test below. (See KeyCompare.h.)
+// ReverseCompare sorts the keys from largest to smallest. CountingCompare
+// counts how many times it is called. A comparator object must not have
+// state, so the count is a static member instead.
+class ReverseCompare {
+  public:
+    int operator()(int a, int b) const { return (b < a) ? -1 : ((a < b) ? 1 : 0); }
+};
+class CountingCompare {
+  public:
+    static long long calls;
+    int operator()(int a, int b) const { calls++; return (a < b) ? -1 : ((b < a) ? 1 : 0); }
+};
+long long CountingCompare::calls = 0;
+// FailingCompare throws once calls_left runs out, for the set operation
+// cleanup test. The set operations can call it from several threads at
+// once, so the count is atomic.
+class FailingCompare {
+  public:
+    static std::atomic<long long> calls_left;
+    int operator()(int a, int b) const {
+      if (calls_left-- <= 0) { throw std::runtime_error("FailingCompare: no calls left"); }
+      return (a < b) ? -1 : ((b < a) ? 1 : 0);
+    }
+};
+std::atomic<long long> FailingCompare::calls_left(0);
+
+// Data for the bulk-build cleanup test below. Copying it throws once
+// copies_left runs out, like a copy that runs out of memory would.
+class CopyLimitedData {
+  public:
+    static int copies_left;
+    int value;
+    CopyLimitedData(int valueArgument) : value(valueArgument) { }
+    CopyLimitedData(const CopyLimitedData& other) : value(other.value) {
+      if (copies_left-- <= 0) { throw std::runtime_error("CopyLimitedData: no copies left"); }
+    }
+};
+int CopyLimitedData::copies_left = 0;
+// (The tree's debugging messages print the data.)
+std::ostream& operator<<(std::ostream& os, const CopyLimitedData& data) {
+  return os << data.value;
+}
+
 int main() {
 
   // We'll allocate this many items contiguously in memory externally to the
@@ -212,6 +282,548 @@ int main() {
       << "\n(All nodes will be removed...)\n";
   }
 
+  // The same kind of tree can take its nodes from an arena instead of
+  // calling "new" and "delete" for every node. The interface is identical;
+  // only the third template argument changes. (See NodeAllocator.h.)
+  if (V_SIZE >= 1000) {
+    std::cout << "\nTesting an AVL tree that uses ArenaNodeAllocator..." << std::endl;
+    AVL<int, std::string, ArenaNodeAllocator> arena_tree;
+
+    // Fill the tree, empty it with clear_tree (which releases the arena's
+    // slabs all at once), and fill it again, removing some items each time
+    // so that freed slots get reused.
+    for (int round = 0; round < 2; round++) {
+      for (int i=10; i<=900; i++) {
+        arena_tree.insert(int_storage[i], string_storage[i]);
+      }
+      for (int i=10; i<=900; i+=3) {
+        arena_tree.remove(i);
+      }
+      for (int i=10; i<=900; i+=3) {
+        arena_tree.insert(int_storage[i], string_storage[i]);
+      }
+      for (int i=10; i<=900; i++) {
+        if (arena_tree.find(i) != string_storage[i]) {
+          throw std::runtime_error("Error: arena tree returned the wrong data");
+        }
+      }
+      arena_tree.clear_tree();
+      if (!arena_tree.empty()) {
+        throw std::runtime_error("Error: arena tree should be empty after clear_tree");
+      }
+    }
+    std::cout << "Arena test OK" << std::endl;
+  }
+
+  // A tree can also be built all at once from keys that are already sorted,
+  // and more sorted batches can be merged in later. (See AVL-bulk.hpp.)
+  if (V_SIZE >= 1000) {
+    std::cout << "\nTesting the bulk-build constructor and insertSorted..." << std::endl;
+    // Build from keys [0, 400) with the matching strings.
+    AVL<int, std::string> bulk_tree(int_storage.begin(), int_storage.begin() + 400,
+      string_storage.begin());
+
+    // A big batch is merged into the tree and the tree is rebuilt.
+    bulk_tree.insertSorted(int_storage.begin() + 600, int_storage.end(),
+      string_storage.begin() + 600);
+    // A small batch is inserted one item at a time.
+    bulk_tree.insertSorted(int_storage.begin() + 400, int_storage.begin() + 410,
+      string_storage.begin() + 400);
+
+    // A batch containing a key that already exists is rejected as a whole.
+    try {
+      bulk_tree.insertSorted(int_storage.begin() + 405, int_storage.begin() + 415,
+        string_storage.begin() + 405);
+      throw std::logic_error("Error: insertSorted should have rejected a duplicate key");
+    }
+    catch (const std::runtime_error& e) {
+      if (bulk_tree.contains(410)) {
+        throw std::runtime_error("Error: a rejected batch should not change the tree");
+      }
+    }
+
+    for (int i=0; i<V_SIZE; i++) {
+      const bool expected = (i < 410 || i >= 600);
+      if (bulk_tree.contains(i) != expected) {
+        throw std::runtime_error("Error: bulk-built tree has the wrong contents");
+      }
+      if (expected && bulk_tree.find(i) != string_storage[i]) {
+        throw std::runtime_error("Error: bulk-built tree returned the wrong data");
+      }
+    }
+    std::cout << "Bulk build test OK" << std::endl;
+
+    // When the nodes own copies of the items, copying one can throw partway
+    // through. The bulk build must then destroy the nodes it already made
+    // (the sanitizer build reports them as leaks otherwise), and
+    // insertSorted must leave the tree unchanged, on both of its paths.
+    using CopyTree = AVL<int, CopyLimitedData, HeapNodeAllocator, StoreKeysAndData>;
+    std::vector<int> copy_keys;
+    std::vector<CopyLimitedData> copy_data;
+    copy_data.reserve(200);
+    for (int i=0; i<200; i++) {
+      copy_keys.push_back(i);
+      copy_data.emplace_back(i);
+    }
+    CopyLimitedData::copies_left = 50;
+    try {
+      CopyTree failed_tree(copy_keys.begin(), copy_keys.end(), copy_data.begin());
+      throw std::logic_error("Error: the bulk build should have run out of copies");
+    }
+    catch (const std::runtime_error& e) { }
+
+    CopyLimitedData::copies_left = 1000;
+    CopyTree copy_tree(copy_keys.begin(), copy_keys.begin() + 100, copy_data.begin());
+    // A big batch (merged), and then a small batch (inserted one at a time):
+    for (int batch_size : {100, 5}) {
+      CopyLimitedData::copies_left = (batch_size == 100) ? 50 : 3;
+      try {
+        copy_tree.insertSorted(copy_keys.begin() + 100, copy_keys.begin() + 100 + batch_size,
+          copy_data.begin() + 100);
+        throw std::logic_error("Error: insertSorted should have run out of copies");
+      }
+      catch (const std::runtime_error& e) { }
+      int count = 0;
+      for (auto it = copy_tree.begin(); it != copy_tree.end(); ++it) { count++; }
+      if (count != 100 || copy_tree.contains(100)) {
+        throw std::runtime_error("Error: a failed insertSorted should not change the tree");
+      }
+    }
+    std::cout << "Bulk build cleanup test OK" << std::endl;
+  }
+
+  // With the StoreKeysAndData storage policy, the nodes own copies of the
+  // keys and data, so we don't need any external storage, and we can pass
+  // temporary values. (See NodeStorage.h.)
+  {
+    std::cout << "\nTesting an AVL tree that stores keys and data in the nodes..." << std::endl;
+    AVL<std::string, std::string, ArenaNodeAllocator, StoreKeysAndData> owning_tree;
+
+    for (int i=0; i<200; i++) {
+      // The temporary strings are moved into the new node.
+      owning_tree.insert(std::to_string(i), std::string(3, 'a' + (i % 26)));
+    }
+    // emplace builds the data string in place from (count, character).
+    owning_tree.emplace("emplaced", 5, 'z');
+    if (owning_tree.find("emplaced") != "zzzzz") {
+      throw std::runtime_error("Error: emplace stored the wrong data");
+    }
+
+    for (int i=0; i<200; i+=2) {
+      // When the node owns the data, remove returns it by value.
+      const std::string removed = owning_tree.remove(std::to_string(i));
+      if (removed != std::string(3, 'a' + (i % 26))) {
+        throw std::runtime_error("Error: remove returned the wrong data");
+      }
+    }
+    for (int i=0; i<200; i++) {
+      if (owning_tree.contains(std::to_string(i)) != (i % 2 == 1)) {
+        throw std::runtime_error("Error: owning tree has the wrong contents");
+      }
+    }
+    std::cout << "Owning storage test OK" << std::endl;
+  }
+
+  // With an augmentation that keeps subtree sizes, the tree can answer
+  // rank, select and range queries in O(log n) time. We compare the answers
+  // to a std::map after a random mix of inserts and removes.
+  {
+    std::cout << "\nTesting order statistics and range aggregates..." << std::endl;
+    AVL<int, int, HeapNodeAllocator, StoreKeysAndData, SumAugmentation> sum_tree;
+    std::map<int, int> expected;
+    std::mt19937 rng(13);
+    for (int step=0; step<3000; step++) {
+      const int key = (int)(rng() % 2000);
+      if (expected.count(key)) {
+        sum_tree.remove(key);
+        expected.erase(key);
+      }
+      else {
+        sum_tree.insert(key, key * 3 + 1);
+        expected[key] = key * 3 + 1;
+      }
+    }
+
+    if (sum_tree.size() != expected.size()) {
+      throw std::runtime_error("Error: size() is wrong");
+    }
+    std::size_t i = 0;
+    for (const auto& item : expected) {
+      if (sum_tree.select(i) != item.first || sum_tree.rank(item.first) != i) {
+        throw std::runtime_error("Error: rank() or select() is wrong");
+      }
+      i++;
+    }
+    for (int q=0; q<500; q++) {
+      int lo = (int)(rng() % 2100) - 50;
+      int hi = lo + (int)(rng() % 400) - 20;
+      long long sum = 0;
+      std::size_t count = 0;
+      for (auto it = expected.lower_bound(lo); it != expected.end() && it->first <= hi; ++it) {
+        sum += it->second;
+        count++;
+      }
+      if (sum_tree.rangeAggregate(lo, hi) != sum || sum_tree.countInRange(lo, hi) != count) {
+        throw std::runtime_error("Error: rangeAggregate() or countInRange() is wrong");
+      }
+    }
+
+    std::vector<int> keys(100);
+    std::vector<std::string> letters(100);
+    for (int k=0; k<100; k++) {
+      keys[k] = k;
+      letters[k] = std::string(1, 'a' + (k % 26));
+    }
+    AVL<int, std::string, HeapNodeAllocator, StoreReferences, ConcatAugmentation>
+      concat_tree(keys.begin(), keys.end(), letters.begin());
+    concat_tree.remove(27);
+    if (concat_tree.rangeAggregate(24, 30) != "yzacde" || concat_tree.select(26) != 26) {
+      throw std::runtime_error("Error: rangeAggregate() combined the items in the wrong order");
+    }
+    std::cout << "Order statistics test OK" << std::endl;
+  }
+
+  // Iterators walk the items in key order, and lower_bound, upper_bound and
+  // range find where a scan should start and stop.
+  {
+    std::cout << "\nTesting iterators and range scans..." << std::endl;
+    AVL<int, int, ArenaNodeAllocator, StoreKeysAndData> scan_tree;
+    std::map<int, int> expected;
+    std::mt19937 rng(21);
+    for (int step=0; step<2000; step++) {
+      const int key = (int)(rng() % 1000) * 2;
+      if (expected.count(key)) {
+        scan_tree.remove(key);
+        expected.erase(key);
+      }
+      else {
+        scan_tree.insert(key, -key);
+        expected[key] = -key;
+      }
+    }
+
+    // Forwards over everything, then backwards from the end.
+    auto it = scan_tree.begin();
+    for (const auto& item : expected) {
+      if (it == scan_tree.end() || it->key != item.first || (*it).data != item.second) {
+        throw std::runtime_error("Error: forward iteration is wrong");
+      }
+      ++it;
+    }
+    if (it != scan_tree.end()) {
+      throw std::runtime_error("Error: forward iteration didn't stop at end()");
+    }
+    for (auto rit = expected.rbegin(); rit != expected.rend(); ++rit) {
+      if ((--it)->key != rit->first) {
+        throw std::runtime_error("Error: backward iteration is wrong");
+      }
+    }
+    if (it != scan_tree.begin()) {
+      throw std::runtime_error("Error: backward iteration didn't stop at begin()");
+    }
+
+    for (int key=-3; key<2004; key++) {
+      auto lower = scan_tree.lower_bound(key);
+      auto upper = scan_tree.upper_bound(key);
+      auto expected_lower = expected.lower_bound(key);
+      auto expected_upper = expected.upper_bound(key);
+      if ((lower == scan_tree.end()) != (expected_lower == expected.end()) ||
+          (lower != scan_tree.end() && lower->key != expected_lower->first) ||
+          (upper == scan_tree.end()) != (expected_upper == expected.end()) ||
+          (upper != scan_tree.end() && upper->key != expected_upper->first) ||
+          scan_tree.equal_range(key).first != lower) {
+        throw std::runtime_error("Error: lower_bound() or upper_bound() is wrong");
+      }
+    }
+
+    for (int q=0; q<200; q++) {
+      const int lo = (int)(rng() % 2100) - 50;
+      const int hi = lo + (int)(rng() % 300) - 10;
+      std::vector<int> scanned, wanted;
+      for (const auto& item : scan_tree.range(lo, hi)) {
+        scanned.push_back(item.key);
+      }
+      for (auto e = expected.lower_bound(lo); e != expected.end() && e->first < hi; ++e) {
+        wanted.push_back(e->first);
+      }
+      if (scanned != wanted) {
+        throw std::runtime_error("Error: range() scanned the wrong items");
+      }
+    }
+    AVL<int, int> empty_tree;
+    if (empty_tree.begin() != empty_tree.end() || empty_tree.lower_bound(5) != empty_tree.end()) {
+      throw std::runtime_error("Error: an empty tree should have begin() == end()");
+    }
+    std::cout << "Iterator test OK" << std::endl;
+  }
+
+  // The set operations, checked against std::map. The trees are big enough
+  // that the parallel code runs when we ask for 4 threads, and they use the
+  // arena allocator, since moving nodes between arenas is the tricky part.
+  {
+    std::cout << "\nTesting join, split and set operations..." << std::endl;
+    using SetTree = AVL<int, int, ArenaNodeAllocator, StoreKeysAndData, SubtreeSize>;
+    std::mt19937 rng(17);
+
+    // makeTree: Random keys from 0 to 39999, with data that says which tree
+    // the item came from. (insertSorted builds the tree with just one run of
+    // the debugging checks, instead of one per insert.)
+    auto makeTree = [&rng](SetTree& tree, std::map<int, int>& items, int percent, int tag) {
+      std::vector<int> keys, data;
+      for (int key=0; key<40000; key++) {
+        if ((int)(rng() % 100) < percent) {
+          keys.push_back(key);
+          data.push_back(tag);
+          items[key] = tag;
+        }
+      }
+      tree.insertSorted(keys.begin(), keys.end(), data.begin());
+    };
+    auto checkTree = [](const SetTree& tree, const std::map<int, int>& items, const char* what) {
+      auto it = tree.begin();
+      for (const auto& item : items) {
+        if (it == tree.end() || it->key != item.first || it->data != item.second) {
+          throw std::runtime_error(std::string("Error: ") + what + " gave the wrong items");
+        }
+        ++it;
+      }
+      if (it != tree.end() || tree.size() != items.size()) {
+        throw std::runtime_error(std::string("Error: ") + what + " gave too many items");
+      }
+    };
+
+    for (unsigned threads : {1u, 4u}) {
+      for (int op=0; op<3; op++) {
+        SetTree a, b;
+        std::map<int, int> a_items, b_items, expected;
+        makeTree(a, a_items, 30, 1);
+        // Sometimes one tree is much smaller than the other.
+        makeTree(b, b_items, (op == 1) ? 2 : 40, 2);
+        if (op == 0) {
+          expected = a_items;
+          expected.insert(b_items.begin(), b_items.end());
+          a.unionWith(b, threads);
+          checkTree(a, expected, "unionWith()");
+        }
+        else if (op == 1) {
+          for (const auto& item : a_items) {
+            if (b_items.count(item.first)) expected.insert(item);
+          }
+          a.intersectionWith(b, threads);
+          checkTree(a, expected, "intersectionWith()");
+        }
+        else {
+          for (const auto& item : a_items) {
+            if (!b_items.count(item.first)) expected.insert(item);
+          }
+          a.differenceWith(b, threads);
+          checkTree(a, expected, "differenceWith()");
+        }
+        if (!b.empty()) {
+          throw std::runtime_error("Error: a set operation didn't empty the other tree");
+        }
+        // The other tree is still usable afterwards.
+        b.insert(5, 5);
+      }
+    }
+
+    // Split a tree in three places, join the pieces back together, and then
+    // keep using all of the trees.
+    SetTree whole, middle, right;
+    std::map<int, int> items;
+    makeTree(whole, items, 50, 3);
+    whole.split(25000, right);
+    whole.split(12345, middle);
+    std::map<int, int> left_items(items.begin(), items.upper_bound(12345));
+    std::map<int, int> middle_items(items.upper_bound(12345), items.upper_bound(25000));
+    std::map<int, int> right_items(items.upper_bound(25000), items.end());
+    checkTree(whole, left_items, "split()");
+    checkTree(middle, middle_items, "split()");
+    checkTree(right, right_items, "split()");
+    bool threw = false;
+    try {
+      right.join(middle);
+    }
+    catch (const std::runtime_error&) {
+      threw = true;
+    }
+    if (!threw) {
+      throw std::runtime_error("Error: join() accepted keys in the wrong order");
+    }
+    middle.join(right);
+    whole.join(middle);
+    checkTree(whole, items, "join()");
+    right.insert(1, 1);
+    middle.insert(2, 2);
+    std::cout << "Set operations test OK" << std::endl;
+  }
+
+  // If the comparator throws in the middle of a set operation, both trees
+  // must be left empty, with every node destroyed exactly once. These trees
+  // use the heap allocator, so a build with -fsanitize=address would report
+  // any node that leaked or was destroyed twice.
+  {
+    std::cout << "\nTesting set operations with a throwing comparator..." << std::endl;
+    using FailTree = AVL<int, int, HeapNodeAllocator, StoreKeysAndData, NoAugmentation, FailingCompare>;
+    const long long plenty = 1LL << 40;
+    std::vector<int> a_keys, b_keys;
+    for (int key=0; key<40000; key += 2) a_keys.push_back(key);
+    for (int key=0; key<40000; key += 3) b_keys.push_back(key);
+
+    for (unsigned threads : {1u, 4u}) {
+      // op 3 is split.
+      for (int op=0; op<4; op++) {
+        // Fail early, near the top, and later, deep in the recursion. (A
+        // split only takes about 15 comparisons in all.)
+        for (long long limit : {10LL, (op == 3) ? 5LL : 3000LL}) {
+          FailingCompare::calls_left = plenty;
+          FailTree a, b;
+          a.insertSorted(a_keys.begin(), a_keys.end(), a_keys.begin());
+          if (op != 3) b.insertSorted(b_keys.begin(), b_keys.end(), b_keys.begin());
+
+          FailingCompare::calls_left = limit;
+          bool threw = false;
+          try {
+            if (op == 0) a.unionWith(b, threads);
+            else if (op == 1) a.intersectionWith(b, threads);
+            else if (op == 2) a.differenceWith(b, threads);
+            else a.split(20001, b);
+          }
+          catch (const std::runtime_error&) {
+            threw = true;
+          }
+          FailingCompare::calls_left = plenty;
+          if (!threw) {
+            throw std::runtime_error("Error: the comparator's exception didn't reach the caller");
+          }
+          if (!a.empty() || !b.empty()) {
+            throw std::runtime_error("Error: a failed set operation should leave both trees empty");
+          }
+          // Both trees are still usable afterwards.
+          a.insert(1, 1);
+          b.insert(2, 2);
+        }
+      }
+    }
+    std::cout << "Throwing comparator test OK" << std::endl;
+  }
+
+  // The keys are compared with a three-way comparator, once per level. With
+  // std::string keys, the default comparator also lets find and contains
+  // take a C string without building a temporary std::string. A different
+  // comparator changes the order of everything in the tree.
+  {
+    AVL<std::string, int, HeapNodeAllocator, StoreKeysAndData> names;
+    names.insert(std::string("banana"), 2);
+    names.insert(std::string("apple"), 1);
+    names.insert(std::string("cherry"), 3);
+    const char* wanted = "cherry";
+    if (names.find("apple") != 1 || names.find(wanted) != 3 || !names.contains("banana") ||
+        names.contains("durian") || names.contains("app") || names.contains("apples") ||
+        names.find(std::string("banana")) != 2) {
+      throw std::runtime_error("Error: heterogeneous lookup is wrong");
+    }
+
+    AVL<int, int, HeapNodeAllocator, StoreKeysAndData, SubtreeSize, ReverseCompare> reversed;
+    for (int key=0; key<100; key++) {
+      reversed.insert(key, key);
+    }
+    int expected_key = 99;
+    for (const auto& item : reversed) {
+      if (item.key != expected_key--) {
+        throw std::runtime_error("Error: ReverseCompare order is wrong");
+      }
+    }
+    // In this tree, 90 comes before 80, so range(90, 80) holds 90 to 81.
+    int in_range = 0;
+    for (const auto& item : reversed.range(90, 80)) {
+      if (item.key > 90 || item.key <= 80) {
+        throw std::runtime_error("Error: ReverseCompare range is wrong");
+      }
+      in_range++;
+    }
+    if (in_range != 10 || reversed.rank(90) != 9 || reversed.select(0) != 99) {
+      throw std::runtime_error("Error: ReverseCompare range or rank is wrong");
+    }
+
+    // An AVL tree with 1000 keys has a height of at most 14 (counting from
+    // 0), so a lookup visits at most 15 nodes, and makes one comparison at
+    // each of them.
+    AVL<int, int, HeapNodeAllocator, StoreKeysAndData, NoAugmentation, CountingCompare> counted;
+    for (int key=0; key<1000; key++) {
+      counted.insert(key, key);
+    }
+    for (int key=0; key<1000; key++) {
+      CountingCompare::calls = 0;
+      counted.find(key);
+      if (CountingCompare::calls > 15) {
+        throw std::runtime_error("Error: find compared the keys more than once per level");
+      }
+    }
+    std::cout << "Key comparison test OK" << std::endl;
+  }
+
+  // freeze() copies a tree into an EytzingerIndex, a read-only array that
+  // can only be searched. We try every size up to 70, so that the index
+  // goes through several complete and incomplete levels, and search for
+  // every key, and every gap between keys, before the first and after the
+  // last. (See EytzingerIndex.h.)
+  {
+    for (int n=0; n<=70; n++) {
+      AVL<int, int, HeapNodeAllocator, StoreKeysAndData> tree;
+      for (int i=0; i<n; i++) {
+        tree.insert(i * 2, i * 20);
+      }
+      const EytzingerIndex<int, int, ThreeWayCompare> frozen = tree.freeze();
+      if ((int)frozen.size() != n) {
+        throw std::runtime_error("Error: the frozen index has the wrong size");
+      }
+      for (int key=-1; key<=n*2; key++) {
+        const bool expected = (key >= 0 && key % 2 == 0 && key < n * 2);
+        if (frozen.contains(key) != expected || (expected && frozen.find(key) != key * 10)) {
+          throw std::runtime_error("Error: the frozen index gave the wrong answer");
+        }
+      }
+    }
+
+    AVL<std::string, int, HeapNodeAllocator, StoreKeysAndData> names;
+    names.insert(std::string("banana"), 2);
+    names.insert(std::string("apple"), 1);
+    names.insert(std::string("cherry"), 3);
+    auto frozen_names = names.freeze();
+    if (frozen_names.find("apple") != 1 || frozen_names.find(std::string("cherry")) != 3 ||
+        frozen_names.contains("apples")) {
+      throw std::runtime_error("Error: the frozen index with string keys is wrong");
+    }
+    try {
+      frozen_names.find("durian");
+      throw std::runtime_error("Error: the frozen index found a missing key");
+    }
+    catch (const std::runtime_error& e) {
+      if (std::string(e.what()).find("not found") == std::string::npos) throw;
+    }
+    std::cout << "Frozen index test OK" << std::endl;
+  }
+
+  // The local checks can run on a sample of the inserts and removes, or be
+  // turned off while the program runs.
+  {
+    AVL<int, int, HeapNodeAllocator, StoreKeysAndData, SubtreeSize> sampled;
+    sampled.setLocalCheckPeriod(7);
+    for (int key=0; key<2000; key++) {
+      sampled.insert(key, key);
+    }
+    for (int key=0; key<2000; key+=3) {
+      sampled.remove(key);
+    }
+    sampled.setLocalCheckPeriod(0);
+    sampled.insert(5000, 5000);
+    if (sampled.size() != 2000 - 667 + 1) {
+      throw std::runtime_error("Error: the sampled local check test has the wrong size");
+    }
+    std::cout << "Local check test OK" << std::endl;
+  }
+
   // Show that the program exited without crashing. If you try other
   // experiments in the code block above, you may find that they throw
   // uncaught exceptions from our class functions and crash to the terminal.
@@ -0,0 +1,66 @@
+/**
+ * Balancing policies for the Dictionary class.
+ *
+ * The Dictionary's TreeNode class also inherits from one of these, so the
+ * policy decides what extra bookkeeping each node carries, and whether
+ * insert and remove do any rebalancing work:
+ *
+ *   Unbalanced<K, D> : no extra members.
+ *     The original design from lecture. The shape of the tree depends
+ *     entirely on the order of the inserts. Random keys give a height of
+ *     about 2.99 log2(n) on average, but sorted keys give a tree that is
+ *     really a linked list, so every find, insert and remove takes O(n).
+ *
+ *   RedBlack<K, D>   : bool red;
+ *     A red-black tree. Every node is colored red or black, and insert and
+ *     remove keep these rules true:
+ *       (1) The root is black. (Null children count as black too.)
+ *       (2) A red node never has a red child.
+ *       (3) Every path from a node down to a null child passes through the
+ *           same number of black nodes.
+ *     The shortest possible path from the root is all black, and by rule
+ *     (2) the longest one alternates red and black, so no path is more than
+ *     twice as long as another. That makes the height at most 2 log2(n+1),
+ *     so find, insert and remove are all O(log n) in the worst case, no
+ *     matter what order the keys come in.
+ *
+ * Why red-black and not AVL? An AVL tree is balanced more strictly (its
+ * height is at most about 1.44 log2(n)), so lookups are a little shorter.
+ * But it pays for that on updates: it has to update heights all the way back
+ * up the path, and a remove can rotate at every level. A red-black tree
+ * usually only recolors a few nodes near the bottom. An insert does at most
+ * 2 rotations and a remove at most 3, so writes are cheaper. Many standard
+ * library implementations of std::map use red-black trees for this reason.
+ *
+ * (A treap, which keeps a random priority in each node, would also be cheap
+ * to update, but it is only balanced in expectation. A red-black tree gives
+ * the O(log n) bound for every input.)
+ */
+
+#pragma once
+
+// Like the storage policies in NodeStorage.h, these take the key and data
+// types as template parameters, even though the two policies here don't use
+// them, so that other policies (such as a treap, whose priorities might be
+// derived from the key) can be added with the same interface.
+
+template <typename K, typename D>
+class Unbalanced {
+  public:
+    static constexpr bool RED_BLACK = false;
+};
+
+template <typename K, typename D>
+class RedBlack {
+  public:
+    static constexpr bool RED_BLACK = true;
+
+    // New nodes start out red. Adding a red leaf never changes the number
+    // of black nodes on any path, so it can only break rule (2), which the
+    // insert fixup then repairs.
+    bool red;
+    RedBlack() : red(true) { }
+};
+
+template <typename K, typename D> constexpr bool Unbalanced<K, D>::RED_BLACK;
+template <typename K, typename D> constexpr bool RedBlack<K, D>::RED_BLACK;
@@ -0,0 +1,318 @@
+/**
+ * Dictionary BST - The red-black balancing policy, and debugging checks.
+ * Please see BalancePolicy.h for the rules that a red-black tree follows.
+ */
+
+#pragma once
+
+#include "Dictionary.hpp"
+
+// A note about how these functions are organized:
+// With the Unbalanced policy, insert and remove work exactly as they did in
+// lecture. With RedBlack, insert still uses _find to link in the new node
+// (which starts out red), and then calls _afterInsert, which walks down to
+// it again to record the path and fixes any broken rules on the way back
+// up. The second walk is cheap, because the first one just brought all of
+// those nodes into the cache. Remove is written separately, because it
+// needs the path before it unlinks anything.
+//   Both fixups only need the path above the node where the change
+// happened. The red-black rules are local: each fixup step either finishes,
+// or moves the problem two levels (insert) or one level (remove) up.
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+void Dictionary<K, D, NodeStorage, Balancing, Compare>::_afterInsert(const K& key, std::true_type) {
+  TreeNode** path[MAX_PATH_LENGTH];
+  int depth = 0;
+  path[0] = &head_;
+  while (true) {
+    TreeNode* node = *path[depth];
+    const int cmp = _compare(key, node->key);
+    if (cmp == 0) break;
+    path[depth + 1] = (cmp < 0) ? &(node->left) : &(node->right);
+    depth++;
+  }
+  _fixAfterInsert(path, depth);
+}
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+void Dictionary<K, D, NodeStorage, Balancing, Compare>::_fixAfterInsert(TreeNode** path[], int depth) {
+  // The node at path[depth] is red. The only rule that can be broken is
+  // rule (2), if its parent is red too.
+  while (depth > 0) {
+    TreeNode* parent = *path[depth - 1];
+    if (!parent->red) break;
+
+    // The parent is red, so it isn't the root (the root is always black),
+    // and the grandparent must be black.
+    TreeNode* grandparent = *path[depth - 2];
+    const bool parent_is_left = (grandparent->left == parent);
+    TreeNode* uncle = parent_is_left ? grandparent->right : grandparent->left;
+
+    if (_isRed(uncle)) {
+      // Case 1: The uncle is red too. Push the grandparent's black down onto
+      // both of its children. Every path through the grandparent still has
+      // the same number of black nodes, but now the grandparent is red, and
+      // its own parent might be red, so we continue from there.
+      parent->red = false;
+      uncle->red = false;
+      grandparent->red = true;
+      depth -= 2;
+      continue;
+    }
+
+    // Case 2: The uncle is black. One or two rotations bring the middle one
+    // of node, parent and grandparent up to the grandparent's place, with
+    // the other two as its red children. If the node is on the inside
+    // (the right child of a left child, or the reverse), the first rotation
+    // turns that into the outside case.
+    TreeNode* node = *path[depth];
+    if (parent_is_left) {
+      if (parent->right == node) _rotateLeft(*path[depth - 1]);
+      _rotateRight(*path[depth - 2]);
+    }
+    else {
+      if (parent->left == node) _rotateRight(*path[depth - 1]);
+      _rotateLeft(*path[depth - 2]);
+    }
+    (*path[depth - 2])->red = false;
+    grandparent->red = true;
+    // The top of this subtree is black again, just as the grandparent was,
+    // so nothing above it has changed.
+    break;
+  }
+
+  // Rule (1): Case 1 may have colored the root red.
+  head_->red = false;
+}
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+typename Dictionary<K, D, NodeStorage, Balancing, Compare>::removed_data_type
+Dictionary<K, D, NodeStorage, Balancing, Compare>::_removeKey(const K& key, std::true_type) {
+  // Record the path down to the node, as _afterInsert does.
+  TreeNode** path[MAX_PATH_LENGTH];
+  int depth = 0;
+  path[0] = &head_;
+  while (*path[depth]) {
+    TreeNode* node = *path[depth];
+    const int cmp = _compare(key, node->key);
+    if (cmp == 0) break;
+    path[depth + 1] = (cmp < 0) ? &(node->left) : &(node->right);
+    depth++;
+  }
+  if (!*path[depth]) { throw std::runtime_error("error: remove() used on non-existent key"); }
+
+  TreeNode* node = *path[depth];
+  if (node->left && node->right) {
+    // Two-child remove: As in _remove, we swap the node with its IOP, which
+    // has no right child. First we extend the path down to the IOP.
+    int iop_depth = depth + 1;
+    path[iop_depth] = &(node->left);
+    while ((*path[iop_depth])->right) {
+      path[iop_depth + 1] = &((*path[iop_depth])->right);
+      iop_depth++;
+    }
+    // The colors belong to the positions in the tree, not to the items, so
+    // the two nodes trade colors as well as places.
+    std::swap(node->red, (*path[iop_depth])->red);
+    path[iop_depth] = &_swap_nodes(*path[depth], *path[iop_depth]);
+    // _swap_nodes moved the nodes' own child pointers, so path[depth + 1],
+    // which was the address of our node's "left" member, is now out of
+    // date. It has to be the "left" member of the IOP, which has taken our
+    // node's place. The other entries are pointers in nodes that didn't
+    // move, except for path[iop_depth], which _swap_nodes told us.
+    path[depth + 1] = &((*path[depth])->left);
+    depth = iop_depth;
+    node = *path[depth];
+  }
+
+  // Now the node has at most one child, which takes its place.
+  TreeNode* child = node->left ? node->left : node->right;
+  const bool removed_black = !node->red;
+  removed_data_type data = node->takeData();
+  *path[depth] = child;
+  delete node;
+
+  // Removing a red node can't break any rule. Removing a black one leaves
+  // the paths through this position one black node short.
+  if (removed_black) _fixAfterRemove(path, depth);
+  return data;
+}
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+void Dictionary<K, D, NodeStorage, Balancing, Compare>::_fixAfterRemove(TreeNode** path[], int depth) {
+  // The paths through the position path[depth] have one black node fewer
+  // than the other paths. (We can think of that position as holding an
+  // "extra" black that still has to be placed somewhere.) If the node there
+  // is red, we just make it black. Otherwise, we look at its sibling, which
+  // can't be null, because the sibling's side has at least one black node
+  // more than this side does.
+  while (depth > 0 && !_isRed(*path[depth])) {
+    TreeNode* parent = *path[depth - 1];
+
+    // The left and right cases below are mirror images, so only the first
+    // one has comments.
+    if (path[depth] == &(parent->left)) {
+      TreeNode* sibling = parent->right;
+      if (sibling->red) {
+        // Case 1: The sibling is red, so the parent is black. Rotate the
+        // sibling up and swap their colors. This doesn't fix anything yet,
+        // but now our new sibling (one of the old sibling's children) is
+        // black, so one of the cases below applies. Our position is now one
+        // level deeper, under the parent, so the path gets one entry longer.
+        sibling->red = false;
+        parent->red = true;
+        _rotateLeft(*path[depth - 1]);
+        path[depth] = &(sibling->left);
+        path[depth + 1] = &(parent->left);
+        depth++;
+        sibling = parent->right;
+      }
+      if (!_isRed(sibling->left) && !_isRed(sibling->right)) {
+        // Case 2: The sibling and both of its children are black. Making the
+        // sibling red takes one black node away from its side too, so now
+        // the whole parent subtree is one short, and we continue from the
+        // parent. (If the parent is red, the loop stops and it turns black.)
+        sibling->red = true;
+        depth--;
+      }
+      else {
+        // Case 3: The sibling's far child is black, so its near child is
+        // red. Rotate the near child up into the sibling's place and swap
+        // their colors, which turns this into case 4.
+        if (!_isRed(sibling->right)) {
+          sibling->left->red = false;
+          sibling->red = true;
+          _rotateRight(parent->right);
+          sibling = parent->right;
+        }
+        // Case 4: The sibling's far child is red. Rotate the sibling up into
+        // the parent's place, with the parent's color. The parent becomes
+        // black and moves down to our side, which gives us the missing
+        // black node, and the far child turns black to make up for the
+        // sibling that moved up out of its side. That's it.
+        sibling->red = parent->red;
+        parent->red = false;
+        sibling->right->red = false;
+        _rotateLeft(*path[depth - 1]);
+        return;
+      }
+    }
+    else {
+      TreeNode* sibling = parent->left;
+      if (sibling->red) {
+        sibling->red = false;
+        parent->red = true;
+        _rotateRight(*path[depth - 1]);
+        path[depth] = &(sibling->right);
+        path[depth + 1] = &(parent->right);
+        depth++;
+        sibling = parent->left;
+      }
+      if (!_isRed(sibling->left) && !_isRed(sibling->right)) {
+        sibling->red = true;
+        depth--;
+      }
+      else {
+        if (!_isRed(sibling->left)) {
+          sibling->right->red = false;
+          sibling->red = true;
+          _rotateLeft(parent->left);
+          sibling = parent->left;
+        }
+        sibling->red = parent->red;
+        parent->red = false;
+        sibling->left->red = false;
+        _rotateRight(*path[depth - 1]);
+        return;
+      }
+    }
+  }
+
+  // Either the node here is red and can absorb the extra black, or we have
+  // reached the root, where the extra black can simply be dropped, because
+  // it would count on every path equally.
+  if (*path[depth]) (*path[depth])->red = false;
+}
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+void Dictionary<K, D, NodeStorage, Balancing, Compare>::_rotateLeft(TreeNode*& cur) {
+  // "cur" is the actual pointer in the tree, so changing it at the end
+  // links the new top of this subtree to its parent.
+  TreeNode* x = cur;
+  TreeNode* y = cur->right;
+  x->right = y->left;
+  y->left = x;
+  cur = y;
+}
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+void Dictionary<K, D, NodeStorage, Balancing, Compare>::_rotateRight(TreeNode*& cur) {
+  TreeNode* x = cur;
+  TreeNode* y = cur->left;
+  x->left = y->right;
+  y->right = x;
+  cur = y;
+}
+
+// -------
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+void Dictionary<K, D, NodeStorage, Balancing, Compare>::runDebuggingChecks() const {
+  if (!_debugOrderCheck()) {
+    throw std::runtime_error("ERROR: _debugOrderCheck failed");
+  }
+  if (!_debugBalanceCheck(is_red_black())) {
+    throw std::runtime_error("ERROR: _debugBalanceCheck failed");
+  }
+}
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+bool Dictionary<K, D, NodeStorage, Balancing, Compare>::_debugOrderCheck() const {
+  // An unbalanced tree may be too deep for a recursive check, so we use the
+  // iterator instead: every key must be less than the next one.
+  const_iterator it = begin();
+  if (it == end()) return true;
+  const_iterator prev = it++;
+  for (; it != end(); prev = it++) {
+    if (_compare(prev->key, it->key) >= 0) return false;
+  }
+  return true;
+}
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+bool Dictionary<K, D, NodeStorage, Balancing, Compare>::_debugBalanceCheck(std::true_type) const {
+  return !_isRed(head_) && _debugRedBlackCheck(head_) >= 0;
+}
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+int Dictionary<K, D, NodeStorage, Balancing, Compare>::_debugRedBlackCheck(const TreeNode* node) const {
+  // A null child counts as one black node.
+  if (!node) return 1;
+  if (node->red && (_isRed(node->left) || _isRed(node->right))) return -1;
+  const int left_blacks = _debugRedBlackCheck(node->left);
+  const int right_blacks = _debugRedBlackCheck(node->right);
+  if (left_blacks < 0 || left_blacks != right_blacks) return -1;
+  return left_blacks + (node->red ? 0 : 1);
+}
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+int Dictionary<K, D, NodeStorage, Balancing, Compare>::height() const {
+  // An iterator records the path from the root down to its node, so the
+  // longest path it records during a full scan is the height of the tree.
+  int result = 0;
+  for (const_iterator it = begin(); it != end(); ++it) {
+    if ((int)it.path_.size() > result) result = (int)it.path_.size();
+  }
+  return result;
+}
@@ -0,0 +1,150 @@
+/**
+ * Dictionary BST - Iterators, lower_bound/upper_bound/equal_range, and range
+ * scans.
+ */
+
+#pragma once
+
+#include "Dictionary.hpp"
+
+// A note about how the iterator moves:
+// To go from a node to the next one in key order, there are two cases.
+// If the node has a right subtree, the next node is the leftmost node of
+// that subtree, so we go right once and then left as far as possible.
+// Otherwise, the next node is the nearest ancestor that we reached by going
+// left, so we go back up the recorded path until we come up out of a left
+// child. Going backwards is the mirror image of this. Each edge of the tree
+// is walked down once and up once during a full scan, so a scan of n items
+// takes O(n) time, even though a single step can take as long as the height
+// of the tree.
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+void Dictionary<K, D, NodeStorage, Balancing, Compare>::const_iterator::_pushLeftmost(const TreeNode* node) {
+  while (node) {
+    path_.push_back(node);
+    node = node->left;
+  }
+}
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+void Dictionary<K, D, NodeStorage, Balancing, Compare>::const_iterator::_pushRightmost(const TreeNode* node) {
+  while (node) {
+    path_.push_back(node);
+    node = node->right;
+  }
+}
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+typename Dictionary<K, D, NodeStorage, Balancing, Compare>::const_iterator&
+Dictionary<K, D, NodeStorage, Balancing, Compare>::const_iterator::operator++() {
+  const TreeNode* node = path_.back();
+  if (node->right) {
+    _pushLeftmost(node->right);
+    return *this;
+  }
+  // Go up until we come up out of a left child. If we never do, we were at
+  // the last node, and the path ends up empty, which is the end iterator.
+  const TreeNode* child;
+  do {
+    child = path_.back();
+    path_.pop_back();
+  } while (!path_.empty() && path_.back()->left != child);
+  return *this;
+}
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+typename Dictionary<K, D, NodeStorage, Balancing, Compare>::const_iterator&
+Dictionary<K, D, NodeStorage, Balancing, Compare>::const_iterator::operator--() {
+  // Going back from end() gives the last node.
+  if (path_.empty()) {
+    _pushRightmost(head_);
+    return *this;
+  }
+  const TreeNode* node = path_.back();
+  if (node->left) {
+    _pushRightmost(node->left);
+    return *this;
+  }
+  const TreeNode* child;
+  do {
+    child = path_.back();
+    path_.pop_back();
+  } while (!path_.empty() && path_.back()->right != child);
+  return *this;
+}
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+typename Dictionary<K, D, NodeStorage, Balancing, Compare>::const_iterator
+Dictionary<K, D, NodeStorage, Balancing, Compare>::begin() const {
+  const_iterator it(head_);
+  it._pushLeftmost(head_);
+  return it;
+}
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+typename Dictionary<K, D, NodeStorage, Balancing, Compare>::const_iterator
+Dictionary<K, D, NodeStorage, Balancing, Compare>::_bound(const K& key, bool inclusive) const {
+  // Go down towards the key, recording the path. The answer is the last
+  // node on the path where we went left (or stopped, for an equal key when
+  // "inclusive" is true), since everything after it in key order is on the
+  // path below it. So at the end, we cut the path back to that node.
+  const_iterator it(head_);
+  std::size_t answer_depth = 0;
+  const TreeNode* node = head_;
+  while (node) {
+    it.path_.push_back(node);
+    const int cmp = _compare(key, node->key);
+    if (cmp < 0) {
+      answer_depth = it.path_.size();
+      node = node->left;
+    }
+    else if (inclusive && cmp == 0) {
+      answer_depth = it.path_.size();
+      break;
+    }
+    else {
+      node = node->right;
+    }
+  }
+  it.path_.resize(answer_depth);
+  return it;
+}
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+typename Dictionary<K, D, NodeStorage, Balancing, Compare>::const_iterator
+Dictionary<K, D, NodeStorage, Balancing, Compare>::lower_bound(const K& key) const {
+  return _bound(key, true);
+}
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+typename Dictionary<K, D, NodeStorage, Balancing, Compare>::const_iterator
+Dictionary<K, D, NodeStorage, Balancing, Compare>::upper_bound(const K& key) const {
+  return _bound(key, false);
+}
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+std::pair<typename Dictionary<K, D, NodeStorage, Balancing, Compare>::const_iterator,
+  typename Dictionary<K, D, NodeStorage, Balancing, Compare>::const_iterator>
+Dictionary<K, D, NodeStorage, Balancing, Compare>::equal_range(const K& key) const {
+  return std::make_pair(lower_bound(key), upper_bound(key));
+}
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+typename Dictionary<K, D, NodeStorage, Balancing, Compare>::const_range
+Dictionary<K, D, NodeStorage, Balancing, Compare>::range(const K& lo, const K& hi) const {
+  // An empty range if hi isn't after lo, instead of an end before the start.
+  if (_compare(lo, hi) >= 0) {
+    return const_range(end(), end());
+  }
+  return const_range(lower_bound(lo), lower_bound(hi));
+}
@@ -24,25 +24,96 @@
 // We'll add a "printInOrder" function to help us inspect the results.
 // This will require std::cout from <iostream>.
 #include <iostream>
+// We include <stack> for the explicit stacks in _printInOrder and clear_tree.
+#include <stack>
+// We include <vector> for the path that each iterator records.
+#include <vector>
+// We include <iterator> for std::bidirectional_iterator_tag
+#include <iterator>
+// We include <cstddef> for std::ptrdiff_t
+#include <cstddef>
+// We include <type_traits> for std::true_type and std::false_type
+#include <type_traits>
 
-template <typename K, typename D>
+// The node storage policies (bst::StoreReferences, bst::StoreKeys,
+// bst::StoreKeysAndData)
+#include "NodeStorage.h"
+// The balancing policies (Unbalanced, RedBlack)
+#include "BalancePolicy.h"
+// The key comparison policy (bst::ThreeWayCompare)
+#include "KeyCompare.h"
+// The flat, read-only search array that freeze() builds (bst::EytzingerIndex)
+#include "EytzingerIndex.h"
+
+// The NodeStorage template parameter chooses how each node holds its key
+// and data. The default, StoreReferences, stores references to items that
+// the caller keeps somewhere else, as described in note 1 below. StoreKeys
+// and StoreKeysAndData copy the key, or both the key and the data, into the
+// node itself. They are in the "bst" namespace, so that they don't clash
+// with the avl example's copy. Please see NodeStorage.h for details.
+
+// The Balancing template parameter chooses whether the tree keeps itself
+// balanced. The default, Unbalanced, is the plain BST from lecture, whose
+// height depends on the order of the inserts. RedBlack makes it a red-black
+// tree, so that find, insert and remove are O(log n) even for sorted input.
+// The public interface is the same either way. Please see BalancePolicy.h
+// and Dictionary-balance.hpp for details. For example:
+//   Dictionary<int, std::string, bst::StoreKeysAndData, RedBlack> dict;
+
+// The Compare template parameter is a three-way comparator for the keys,
+// so that each level of a search compares the keys only once. The default,
+// bst::ThreeWayCompare, also lets find take other types than K, such as a C
+// string for a dictionary with std::string keys. Please see KeyCompare.h.
+
+template <typename K, typename D,
+  template <typename, typename> class NodeStorage = bst::StoreReferences,
+  template <typename, typename> class Balancing = Unbalanced,
+  typename Compare = bst::ThreeWayCompare>
 class Dictionary {
   public:
+    // The type that "remove" returns. When the nodes only store references,
+    // this is "const D&", a reference to the caller's data. When the nodes
+    // own their data, the data is destroyed along with the node, so remove
+    // returns a plain "D" value instead.
+    using removed_data_type = typename NodeStorage<K, D>::removed_data_type;
+
     // Let the constructor just initialize the head pointer to null.
     // We'll skip implementing other constructors for this example.
     Dictionary() : head_(nullptr) { }
 
     // find, insert, remove: Please see Dictionary.hpp for comments on these.
     const D& find(const K& key);
+    // This version of find takes any type that the comparator can compare
+    // with a key, when the comparator is transparent. (For details, see
+    // the same function in the AVL example.)
+    template <typename Q, typename C = Compare, typename = typename C::is_transparent>
+    const D& find(const Q& key) {
+      TreeNode*& node = _find(key, head_);
+      if (node == nullptr) { throw std::runtime_error("error: key not found"); }
+      return node->data;
+    }
     void insert(const K& key, const D& data);
-    const D& remove(const K& key);
+    removed_data_type remove(const K& key);
+
+    // These versions of insert are only available when the nodes own their
+    // key and data (StoreKeysAndData). With the rvalue-reference version,
+    // the key and data are moved into the new node instead of copied.
+    // emplace constructs the data directly inside the node from whatever
+    // constructor arguments you pass after the key.
+    void insert(K&& key, D&& data);
+    template <typename KeyArg, typename... DataArgs>
+    void emplace(KeyArg&& key, DataArgs&&... dataArgs);
 
   private:
-    class TreeNode {
+    // TreeNode inherits its "key" and "data" members from the storage
+    // policy class. With the default policy, these are the references:
+    //   const K& key;
+    //   const D& data;
+    // It also inherits whatever the balancing policy needs in each node,
+    // which is nothing for Unbalanced and a color for RedBlack.
+    class TreeNode : public NodeStorage<K, D>, public Balancing<K, D> {
       public:
         // *See note 1 below about how references are being used here.
-        const K& key;
-        const D& data;
         // Note that you can declare multiple pointers on the same line as
         // shorthand, like this:
         //   TreeNode *left, *right;
@@ -51,9 +122,16 @@ class Dictionary {
         // Instead, you can declare the pointers on separate lines like this:
         TreeNode* left;
         TreeNode* right;
-        // **See note 2 below about how this initialization list is styled.
-        TreeNode(const K& key, const D& data)
-          : key(key), data(data), left(nullptr), right(nullptr) { }
+        // Whatever arguments we get are passed along to the storage
+        // policy's constructor, which initializes the key and data.
+        // ("Args&&..." together with std::forward is called "perfect
+        // forwarding". It passes each argument along exactly as it was
+        // given.) **See note 2 below about how the storage policy's
+        // initialization list is styled.
+        template <typename... Args>
+        TreeNode(Args&&... args)
+          : NodeStorage<K, D>(std::forward<Args>(args)...),
+            left(nullptr), right(nullptr) { }
     };
 
     TreeNode *head_;
@@ -61,13 +139,56 @@ class Dictionary {
     // These internal helper functions are private because they are only
     // meant to be used by other member functions of our class. Please see
     // the comments in Dictionary.hpp for details about them.
-    TreeNode*& _find(const K& key, TreeNode*& cur) const;
-    const D& _remove(TreeNode*& node);
+    template <typename Q>
+    TreeNode*& _find(const Q& key, TreeNode*& cur) const;
+    // _compare: Compare two keys with the Compare policy. The result is
+    // negative, zero or positive when a is less than, equal to or greater
+    // than b.
+    template <typename A, typename B>
+    static int _compare(const A& a, const B& b) { return Compare()(a, b); }
+    removed_data_type _remove(TreeNode*& node);
     // _remove relies on the following three functions.
     TreeNode*& _iop_of(TreeNode*& cur) const;
     TreeNode*& _rightmost_of(TreeNode*& cur) const;
     TreeNode*& _swap_nodes(TreeNode*& node1, TreeNode*& node2);
 
+    // These are true_type for RedBlack and false_type for Unbalanced, so
+    // that the overloads below can pick the right code at compile time.
+    // (The red-black functions use the "red" member, which an Unbalanced
+    // node doesn't have, so they must not even be compiled for it.)
+    using is_red_black = std::integral_constant<bool, Balancing<K, D>::RED_BLACK>;
+
+    // The red-black tree code is in Dictionary-balance.hpp. _afterInsert is
+    // called right after a new node has been linked into the tree, and
+    // restores the red-black rules. The Unbalanced version does nothing.
+    void _afterInsert(const K& key, std::true_type);
+    void _afterInsert(const K&, std::false_type) { }
+    // _removeKey does the work of remove. The false_type version is the
+    // original one from lecture, and the true_type one is for red-black.
+    removed_data_type _removeKey(const K& key, std::false_type);
+    removed_data_type _removeKey(const K& key, std::true_type);
+    // Red-black insert and remove walk down from the root and record the
+    // path as the addresses of the actual pointers in the tree: path[0] is
+    // &head_, and path[i+1] is &(*path[i])->left or &(*path[i])->right. As
+    // with _find, this lets us change a parent's pointer to its child
+    // without parent pointers. The height of a red-black tree is at most
+    // 2 log2(n+1), which is less than 128 for any n that fits in memory, and
+    // a remove can make the path one longer during its fixup.
+    static constexpr int MAX_PATH_LENGTH = 130;
+    void _fixAfterInsert(TreeNode** path[], int depth);
+    void _fixAfterRemove(TreeNode** path[], int depth);
+    // Rotations: the node that "cur" points to moves down, and its right
+    // (for _rotateLeft) or left (for _rotateRight) child takes its place.
+    void _rotateLeft(TreeNode*& cur);
+    void _rotateRight(TreeNode*& cur);
+    static bool _isRed(const TreeNode* node) { return node && node->red; }
+    // Checks for runDebuggingChecks. _debugRedBlackCheck returns the number
+    // of black nodes on each path below "node", or -1 if a rule is broken.
+    bool _debugOrderCheck() const;
+    int _debugRedBlackCheck(const TreeNode* node) const;
+    bool _debugBalanceCheck(std::true_type) const;
+    bool _debugBalanceCheck(std::false_type) const { return true; }
+
     // Below are some extra example functions not shown in lecture.
     // The main.cpp file has examples.
   
@@ -86,35 +207,174 @@ class Dictionary {
     // printInOrder: Print the tree contents to std::cout using an in-order
     // traversal. The "_printInOrder" version is for internal use by the
     // public wrapper function "printInOrder".
+    //   This prints exactly what the simple recursive version would print:
+    //     if (!node) { print " "; return; }
+    //     _printInOrder(node->left); print node; _printInOrder(node->right);
+    // but since this tree may be very deep (it isn't balanced), we use an
+    // explicit stack instead of the call stack. The stack holds the nodes
+    // whose left subtree we're still printing.
     void _printInOrder(TreeNode* node) {
-      // Base case: if node is nullptr, then print a space and return.
-      if (!node) {
-        std::cout << " ";
-        return;
-      }
-      else {
-        // Recurse left:
-        _printInOrder(node->left);
-        // Print this node:
-        std::cout << "[" << node->key << " : " << node->data << "]";
-        // Recurse right:
-        _printInOrder(node->right);
+      std::stack<TreeNode*> node_stack;
+      while (true) {
+        if (node) {
+          // Go left first, and remember to come back to this node.
+          node_stack.push(node);
+          node = node->left;
+        }
+        else {
+          // Base case: a nullptr prints as a space.
+          std::cout << " ";
+          if (node_stack.empty()) break;
+          // The left subtree of the top node is done. Print that node and
+          // then continue with its right subtree.
+          node = node_stack.top();
+          node_stack.pop();
+          std::cout << "[" << node->key << " : " << node->data << "]";
+          node = node->right;
+        }
       }
     }
 
+  public:
+    // const_iterator: A bidirectional iterator over the items in key order,
+    // like the iterators of std::map. Dereferencing it gives the node's
+    // storage policy object, so "it->key" and "it->data" read the key and
+    // data directly from the node, without copying anything.
+    //   The nodes don't have parent pointers, so the iterator records the
+    // path from the root down to its current node. Since this tree isn't
+    // balanced, that path can be as long as the number of items, so it is
+    // kept in a std::vector. The vector only allocates when the path gets
+    // deeper than it has been before for this iterator, not on every step,
+    // and a full scan of n items takes O(n) steps in total.
+    //   Any insert or remove invalidates all iterators. Please see
+    // Dictionary-iterator.hpp.
+    class const_iterator {
+      public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = NodeStorage<K, D>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        const_iterator() : head_(nullptr) { }
+
+        reference operator*() const { return *path_.back(); }
+        pointer operator->() const { return path_.back(); }
+
+        const_iterator& operator++();
+        const_iterator& operator--();
+        const_iterator operator++(int) { const_iterator old(*this); ++(*this); return old; }
+        const_iterator operator--(int) { const_iterator old(*this); --(*this); return old; }
+
+        // Two iterators are equal if they are at the same node. The end
+        // iterator is at no node at all.
+        bool operator==(const const_iterator& other) const { return _node() == other._node(); }
+        bool operator!=(const const_iterator& other) const { return _node() != other._node(); }
+
+      private:
+        friend class Dictionary;
+
+        // The root of the tree, so that decrementing end() can find the
+        // last node.
+        const TreeNode* head_;
+        // path_[0] is the root, and path_.back() is the current node. An
+        // empty path means this is the end iterator.
+        std::vector<const TreeNode*> path_;
+
+        explicit const_iterator(const TreeNode* head) : head_(head) { }
+        const TreeNode* _node() const { return path_.empty() ? nullptr : path_.back(); }
+        // Push this node, and then its left children all the way down.
+        void _pushLeftmost(const TreeNode* node);
+        // Push this node, and then its right children all the way down.
+        void _pushRightmost(const TreeNode* node);
+    };
+    // The items can't be changed through an iterator, so both are the same.
+    using iterator = const_iterator;
+
+    // const_range: The pair of iterators returned by range(), which can be
+    // used in a range-based for loop.
+    class const_range {
+      public:
+        const_range(const_iterator first, const_iterator last) : begin_(first), end_(last) { }
+        const_iterator begin() const { return begin_; }
+        const_iterator end() const { return end_; }
+      private:
+        const_iterator begin_;
+        const_iterator end_;
+    };
+
+    // begin, end: The first item, and one past the last item, in key order.
+    const_iterator begin() const;
+    const_iterator end() const { return const_iterator(head_); }
+
+    // freeze: Copy the keys and data into an EytzingerIndex, a read-only
+    // array that can only be searched. It has the shape of a perfectly
+    // balanced tree no matter how unbalanced this tree is, so lookups are
+    // always O(log n), and much faster in practice. This takes O(n) time.
+    // Please see EytzingerIndex.h.
+    bst::EytzingerIndex<K, D, Compare> freeze() const {
+      return bst::EytzingerIndex<K, D, Compare>(begin(), end());
+    }
+
+    // lower_bound: The first item whose key is not less than "key".
+    // upper_bound: The first item whose key is greater than "key".
+    // equal_range: Both of those; the items between them have this key.
+    // These return end() if there is no such item.
+    const_iterator lower_bound(const K& key) const;
+    const_iterator upper_bound(const K& key) const;
+    std::pair<const_iterator, const_iterator> equal_range(const K& key) const;
+
+    // range: All of the items with keys from lo up to but not including hi,
+    // in order. For example:
+    //   for (const auto& item : dict.range(10, 20)) { use(item.key, item.data); }
+    const_range range(const K& lo, const K& hi) const;
+
+  private:
+    // _bound: The shared part of lower_bound and upper_bound. The result is
+    // the first item whose key is greater than "key", or, when "inclusive" is
+    // true, greater than or equal to it.
+    const_iterator _bound(const K& key, bool inclusive) const;
+
   public:
 
     void printInOrder() {
       _printInOrder(head_);
     }
 
-    // clear_tree: Remove the head item until the tree is empty.
+    // runDebuggingChecks: Make sure the keys are in order, and, with the
+    // RedBlack policy, that the red-black rules hold. Throws a
+    // std::runtime_error if anything is wrong. This takes O(n) time, so it's
+    // meant for testing.
+    void runDebuggingChecks() const;
+
+    // height: The number of nodes on the longest path from the root down
+    // (0 for an empty tree). This takes O(n) time; it's here so you can see
+    // the effect of the balancing policy.
+    int height() const;
+
+    // clear_tree: Destroy every node and leave the tree empty.
+    //   We could just call remove on the head item until the tree is empty,
+    // but with the RedBlack policy, every one of those removals would fix
+    // up the tree's colors and rotations on the way back up, which is a
+    // waste of time since all of the nodes are going away anyway. So we
+    // delete the nodes directly instead, in O(n) time.
+    //   Each node's children have to be remembered before the node itself
+    // is deleted. The recursive way to do that would be a post-order
+    // traversal (children first), but as with _printInOrder, this tree may
+    // be very deep, so we keep the nodes still to be deleted on an explicit
+    // stack instead of the call stack. We read a node's child pointers
+    // before we delete it, so the order doesn't matter otherwise.
     void clear_tree() {
-      while (head_) {
-        // As long as the head pointer isn't null, we can just look at
-        // what the key is and call remove based on that.
-        remove(head_->key);
+      std::stack<TreeNode*> node_stack;
+      if (head_) node_stack.push(head_);
+      while (!node_stack.empty()) {
+        TreeNode* node = node_stack.top();
+        node_stack.pop();
+        if (node->left) node_stack.push(node->left);
+        if (node->right) node_stack.push(node->right);
+        delete node;
       }
+      head_ = nullptr;
     }
 
     // Destructor: We just clear the tree.
@@ -143,10 +403,18 @@ class Dictionary {
 // references it stores are then direct alias to other memory in a read-only
 // mode.
 //   Please see further comments in the file: Dictionary.hpp
+//   All of the above describes the default storage policy, StoreReferences.
+// The other policies in NodeStorage.h let the nodes own a copy of the key,
+// or of both the key and the data, so that the caller doesn't have to keep
+// them alive. That is also faster for lookups, because the key is right
+// there in the node instead of somewhere else in memory.
 
 // Note 2:
-// This TreeNode constructor initializes its own "data" member using
-// the argument also called "data". This is one of VERY FEW places in
+// The original version of the TreeNode constructor was written like this:
+//   TreeNode(const K& key, const D& data)
+//     : key(key), data(data), left(nullptr), right(nullptr) { }
+// It initializes its own "data" member using the argument also called
+// "data". This is one of VERY FEW places in
 // C++ where you can reuse the same variable name to mean different
 // things at the same time.
 //   Within the initialization list only, when you write data(data) as
@@ -156,8 +424,13 @@ class Dictionary {
 // function argument, not to the member variable. It's best to avoid
 // styling your code like this to avoid making mistakes. Just give
 // the function parameter a different name, such as "dataArgument".
-// See the binary-tree-traversals example directory for a different
-// version, where we show this.
+// The storage policy classes in NodeStorage.h, which now initialize the
+// key and data, are written that way. See also the binary-tree-traversals
+// example directory for another version.
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+constexpr int Dictionary<K, D, NodeStorage, Balancing, Compare>::MAX_PATH_LENGTH;
 
 // Sometimes, your header files might include another header file with
 // further templated definitions. The .h and .hpp are both just filename
@@ -73,8 +73,9 @@
 
 // ------
 
-template <typename K, typename D>
-const D& Dictionary<K, D>::find(const K& key) {
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+const D& Dictionary<K, D, NodeStorage, Balancing, Compare>::find(const K& key) {
   // Find the key in the tree starting at the head.
   // If found, we receive the tree's actual stored pointer to that node
   //   through return-by-reference.
@@ -104,52 +105,72 @@ const D& Dictionary<K, D>::find(const K& key) {
 // then you probably need to put "typename" before the type.
 
 // The fully-qualified return type of the below function is:
-// Dictionary<K, D>::TreeNode*&
-// That is a pointer to a Dictionary<K, D>::TreeNode, returned by reference.
+// Dictionary<K, D, NodeStorage, Balancing, Compare>::TreeNode*&
+// That is a pointer to a Dictionary<K, D, NodeStorage, Balancing, Compare>::TreeNode, returned by reference.
 
-template <typename K, typename D>
-typename Dictionary<K, D>::TreeNode*& Dictionary<K, D>::_find(
-  const K& key, TreeNode*& cur) const {
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+template <typename Q>
+typename Dictionary<K, D, NodeStorage, Balancing, Compare>::TreeNode*& Dictionary<K, D, NodeStorage, Balancing, Compare>::_find(
+  const Q& key, TreeNode*& cur) const {
 
   // (Please also see the implementation of _iop_of below, which discusses
   //  some more nuances about returning references to pointers.)
 
-  // [Base case 1: When the key is not found]
-  // cur will be nullptr if the tree is empty, or if we descend below the
-  // lowest level without finding the key. Then we return nullptr and the
-  // outer "find" function (which calls "_find") will report that as an
-  // error. Or, if we were calling insert, then the pointer returned is the
-  // position where the item should be placed.
-  //   Note: The "cur" we return in this case is equal to nullptr, but
-  // it's important to write "return cur;" and not "return nullptr;" since
-  // this function returns by reference. We specifically want to return the
+  // The lecture version of this function is recursive: it calls itself on
+  // cur->left or cur->right. Since this tree isn't balanced, inserting keys
+  // in sorted order makes it as deep as it has items, and one recursive call
+  // per level could then overflow the call stack. So here we do the same
+  // thing with a loop. The variable "node" holds the address of the current
+  // pointer in the tree (a pointer to a pointer), so that at the end we can
+  // return that actual pointer by reference, just as the recursive version
+  // does.
+  TreeNode** node = &cur;
+
+  // [When the key is not found]
+  // *node will be nullptr if the tree is empty, or if we descend below the
+  // lowest level without finding the key. Then we stop and return that
+  // nullptr (by reference), and the outer "find" function (which calls
+  // "_find") will report that as an error. Or, if we were calling insert,
+  // then the pointer returned is the position where the item should be
+  // placed.
+  //   Note: It's important to return "*node" and not "nullptr" since this
+  // function returns by reference. We specifically want to return the
   // pointer at this position we found. This is true whether we want to
   // replace it, as when we're doing an insertion, or if this is a failed
   // "find" operation that should report an error. We should not return a
   // reference to the "nullptr" literal, and we should avoid making
   // references to temporary constants like numerical literals in any case.
-  if (cur == nullptr) { return cur; }
-  // [Base case 2: When the key is found]
-  // If we find a key that matches by value, then return the current TreeNode*
-  else if (key == cur->key) { return cur; }
-  // [When we need to search left]
-  // If the key we're looking for is smaller than the current node's key,
-  // then we should look to the left next.
-  else if (key < cur->key) { return _find(key, cur->left); }
-  // [When we need to search right]
-  // Otherwise, implicitly, the key we're looking for is larger than the
-  // current node's key. (We know this because it's not equal and not less.)
-  // So we should search to the right next.
-  else { return _find(key, cur->right); }
+  //   The lecture version checks "key == (*node)->key" and then
+  // "key < (*node)->key", which compares the keys twice at each level.
+  // Instead, we compare them once with the three-way comparator (see
+  // KeyCompare.h), and look at the sign of the result.
+  while (*node != nullptr) {
+    const int cmp = _compare(key, (*node)->key);
+    // [When the key is found]
+    // If we find a key that matches by value, then stop here.
+    if (cmp == 0) { break; }
+    // [When we need to search left]
+    // If the key we're looking for is smaller than the current node's key,
+    // then we should look to the left next.
+    else if (cmp < 0) { node = &((*node)->left); }
+    // [When we need to search right]
+    // Otherwise, implicitly, the key we're looking for is larger than the
+    // current node's key. (We know this because it's not equal and not less.)
+    // So we should search to the right next.
+    else { node = &((*node)->right); }
+  }
 
+  return *node;
 }
 
 /**
 * insert()
 * Inserts `key` and associated `data` into the Dictionary.
 */
-template <typename K, typename D>
-void Dictionary<K, D>::insert(const K& key, const D& data) {
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+void Dictionary<K, D, NodeStorage, Balancing, Compare>::insert(const K& key, const D& data) {
   // Find the place where the item should go.
   TreeNode *& node = _find(key, head_);
   // For the sake of this example, let's disallow duplicates. If the node
@@ -158,14 +179,63 @@ void Dictionary<K, D>::insert(const K& key, const D& data) {
   // then insert the new item to replace it.)
   if (node) { throw std::runtime_error("error: insert() used on an existing key"); }
   node = new TreeNode(key, data);
+  // With the RedBlack policy, this rebalances the tree. With Unbalanced, it
+  // does nothing, and the compiler removes the call entirely.
+  _afterInsert(node->key, is_red_black());
+}
+
+// This version of insert moves the key and data into the new node.
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+void Dictionary<K, D, NodeStorage, Balancing, Compare>::insert(K&& key, D&& data) {
+  // If the nodes stored references, they would end up referring to
+  // temporary objects that are about to be destroyed. A static_assert
+  // turns that mistake into a compile-time error.
+  static_assert(NodeStorage<K, D>::OWNS_KEY && NodeStorage<K, D>::OWNS_DATA,
+    "insert(K&&, D&&) requires a storage policy that owns the key and data, such as StoreKeysAndData");
+
+  TreeNode *& node = _find(key, head_);
+  if (node) { throw std::runtime_error("error: insert() used on an existing key"); }
+  // The search is done, so now we can move from the arguments.
+  node = new TreeNode(std::move(key), std::move(data));
+  // (The key was moved into the node, so we pass the node's copy.)
+  _afterInsert(node->key, is_red_black());
+}
+
+// emplace: Construct the data inside the new node from dataArgs.
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+template <typename KeyArg, typename... DataArgs>
+void Dictionary<K, D, NodeStorage, Balancing, Compare>::emplace(KeyArg&& key, DataArgs&&... dataArgs) {
+  static_assert(NodeStorage<K, D>::OWNS_KEY && NodeStorage<K, D>::OWNS_DATA,
+    "emplace requires a storage policy that owns the key and data, such as StoreKeysAndData");
+
+  // We need an actual K to search with, so we build it first, and then
+  // move it into the node.
+  K k(std::forward<KeyArg>(key));
+  TreeNode *& node = _find(k, head_);
+  if (node) { throw std::runtime_error("error: emplace() used on an existing key"); }
+  node = new TreeNode(std::move(k), std::forward<DataArgs>(dataArgs)...);
+  _afterInsert(node->key, is_red_black());
 }
 
 /**
 * remove()
 * Removes `key` from the Dictionary. Returns the associated data.
 */
-template <typename K, typename D>
-const D& Dictionary<K, D>::remove(const K& key) {
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+typename Dictionary<K, D, NodeStorage, Balancing, Compare>::removed_data_type
+Dictionary<K, D, NodeStorage, Balancing, Compare>::remove(const K& key) {
+  // The red-black version of remove is in Dictionary-balance.hpp. This
+  // picks the right version at compile time.
+  return _removeKey(key, is_red_black());
+}
+
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+typename Dictionary<K, D, NodeStorage, Balancing, Compare>::removed_data_type
+Dictionary<K, D, NodeStorage, Balancing, Compare>::_removeKey(const K& key, std::false_type) {
   // First, find the actual pointer to the node containing this key.
   // If not found, then the pointer returned will be equal to nullptr.
   TreeNode*& node = _find(key, head_);
@@ -177,8 +247,10 @@ const D& Dictionary<K, D>::remove(const K& key) {
 // will alter the pointer you pass in-place, so you should not reuse the
 // pointer variable after calling this function on it. You can't be sure what
 // it points to anymore after the function call.
-template <typename K, typename D>
-const D& Dictionary<K, D>::_remove(TreeNode*& node) {
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+typename Dictionary<K, D, NodeStorage, Balancing, Compare>::removed_data_type
+Dictionary<K, D, NodeStorage, Balancing, Compare>::_remove(TreeNode*& node) {
 
   // If the node we are trying to remove is a nullptr, then it's an error,
   // as even if we'd like to "do nothing" here as a base case, we must return
@@ -196,7 +268,9 @@ const D& Dictionary<K, D>::_remove(TreeNode*& node) {
   if (node->left == nullptr && node->right == nullptr) {
     // Peek at the data referred to by the node so we can return a reference
     // to the data later, after the tree node itself is already gone.
-    const D& data = node->data;
+    // (If the node owns its data, then takeData moves the data out of the
+    //  node instead, since the node's copy is about to be destroyed.)
+    removed_data_type data = node->takeData();
     // The node is a leaf, so it has no descendants to worry about.
     // We can just delete it. (The slides originally showed "delete(node)".
     // Note that the syntax for "delete" is like an operator, not a function,
@@ -213,7 +287,7 @@ const D& Dictionary<K, D>::_remove(TreeNode*& node) {
     // pointer to point to the node's child, so that the parent of the node
     // being deleted will retain its connection to the rest of the tree
     // below this point.
-    const D& data = node->data;
+    removed_data_type data = node->takeData();
     TreeNode* temp = node;
     node = node->left;
     delete temp;
@@ -222,7 +296,7 @@ const D& Dictionary<K, D>::_remove(TreeNode*& node) {
   // One-child (right) remove
   else if (node->left == nullptr && node->right != nullptr) {
     // This case is symmetric to the previous case.
-    const D& data = node->data;
+    removed_data_type data = node->takeData();
     TreeNode* temp = node;
     node = node->right;
     delete temp;
@@ -281,8 +355,9 @@ const D& Dictionary<K, D>::_remove(TreeNode*& node) {
 // _iop_of: You pass in a pointer to a node, and it returns the pointer to
 // the in-order predecessor node, by reference. If the IOP does not exist,
 // it returns a reference to a node pointer that has value nullptr.
-template <typename K, typename D>
-typename Dictionary<K, D>::TreeNode*& Dictionary<K, D>::_iop_of(
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+typename Dictionary<K, D, NodeStorage, Balancing, Compare>::TreeNode*& Dictionary<K, D, NodeStorage, Balancing, Compare>::_iop_of(
   TreeNode*& cur) const {
 
   // We want to find the in-order predecessor of "cur",
@@ -332,12 +407,15 @@ typename Dictionary<K, D>::TreeNode*& Dictionary<K, D>::_iop_of(
   //    this solution, it would make sense to rewrite this entire class to
   //    store reference_wrapper instead of plain references.)
   // 3. Use recursion with a function that takes a reference as an argument
-  //    and returns a reference. This is how _find works. Since passing
-  //    arguments counts as initializing the argument variable, you can
-  //    simulate updating a reference with each recursive call.
-
-  // We'll go with option #3 again, recursion, so you can get more practice
-  // with that. See the binary-tree-traversals folder to learn about the
+  //    and returns a reference. This is how _find worked in lecture. Since
+  //    passing arguments counts as initializing the argument variable, you
+  //    can simulate updating a reference with each recursive call.
+
+  // We use option #1 in _find and _rightmost_of: the loop updates a pointer
+  // to a pointer, and the function returns the final pointer by reference.
+  // Recursion would also work, but this tree isn't balanced, so it could be
+  // as deep as the number of items, and deep recursion can overflow the call
+  // stack. See the binary-tree-traversals folder to learn more about the
   // pointers-to-pointers concept.
 
   // ---------------------------------------------------------------
@@ -348,25 +426,27 @@ typename Dictionary<K, D>::TreeNode*& Dictionary<K, D>::_iop_of(
 }
 
 // _rightmost_of:
-// Find the right-most child of cur using recursion, and return that
+// Find the right-most child of cur using a loop, and return that
 // node pointer, by reference.
 // If you call this function on a nullptr to begin with, it returns the same
 // pointer by reference.
-template <typename K, typename D>
-typename Dictionary<K, D>::TreeNode*& Dictionary<K, D>::_rightmost_of(
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+typename Dictionary<K, D, NodeStorage, Balancing, Compare>::TreeNode*& Dictionary<K, D, NodeStorage, Balancing, Compare>::_rightmost_of(
   TreeNode*& cur) const {
 
-  // Base case 1: If cur is null, then just return it by reference.
+  // If cur is null, then just return it by reference.
   // (Since cur has the value of nullptr, we can check for that result.)
   if (!cur) return cur;
 
-  // Base case 2: So far, we know cur is not null. Now, if cur does not have
-  // a right child, then cur is the rightmost, so return cur by reference.
-  if (!(cur->right)) return cur;
-
-  // General case: The cur pointer is not null, and it does have a right
-  // child, so we should recurse to the right and return whatever we get.
-  return _rightmost_of(cur->right);
+  // Otherwise, keep moving to the right child as long as there is one.
+  // As in _find, "node" holds the address of the actual pointer in the
+  // tree, so we can return it by reference.
+  TreeNode** node = &cur;
+  while ((*node)->right) {
+    node = &((*node)->right);
+  }
+  return *node;
 }
 
 // _swap_nodes:
@@ -378,8 +458,9 @@ typename Dictionary<K, D>::TreeNode*& Dictionary<K, D>::_rightmost_of(
 // represented by the first argument. If you need to keep track of the new
 // positions of BOTH nodes after the call, for some purpose, then you could
 // extend this to return two new references.
-template <typename K, typename D>
-typename Dictionary<K, D>::TreeNode*& Dictionary<K, D>::_swap_nodes(
+template <typename K, typename D, template <typename, typename> class NodeStorage,
+  template <typename, typename> class Balancing, typename Compare>
+typename Dictionary<K, D, NodeStorage, Balancing, Compare>::TreeNode*& Dictionary<K, D, NodeStorage, Balancing, Compare>::_swap_nodes(
   TreeNode*& node1, TreeNode*& node2) {
 
   // More information on the problem we need to solve here:
@@ -488,3 +569,9 @@ typename Dictionary<K, D>::TreeNode*& Dictionary<K, D>::_swap_nodes(
 }
 
 
+
+// The red-black balancing code is in a separate file.
+#include "Dictionary-balance.hpp"
+
+// The iterators are in a separate file.
+#include "Dictionary-iterator.hpp"
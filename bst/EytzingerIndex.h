@@ -0,0 +1,223 @@
+/**
+ * EytzingerIndex: An immutable, pointer-free search array for lookups.
+ *
+ * Many trees are built once and then only searched. For those, all of the
+ * machinery that makes a tree easy to change is just overhead: every node
+ * has two child pointers and a height, the nodes are scattered around
+ * memory, and each step of a search has to load a node before it even
+ * knows where the next one is. The AVL and Dictionary classes have a
+ * freeze() function that copies their items into one of these instead.
+ *
+ * The layout:
+ *   The keys are stored in one array, in "Eytzinger" order (named after
+ * Michael Eytzinger, who used it for family trees in 1590). It's the same
+ * layout as a binary heap: the root is at index 1, and the children of
+ * index i are at 2i and 2i+1. So it's a perfectly balanced binary search
+ * tree where the child "pointers" are just arithmetic. For example, the
+ * sorted keys 10 20 30 40 50 60 70 are stored as:
+ *   index: 1  2  3  4  5  6  7
+ *   key:   40 20 60 10 30 50 70
+ * The data items are in a second array, in the same order. (Keeping them
+ * apart means that a search only reads keys, so more of them fit in each
+ * cache line.)
+ *
+ * The search, and why it's fast:
+ * - It's branchless: at each level, i = 2i + (keys[i] < key). The compiler
+ *   turns the comparison into an instruction that makes a 0 or 1, instead
+ *   of a branch. A branch here would be mispredicted about half the time,
+ *   since the direction is random, and each misprediction costs about as
+ *   much as 15-20 simple instructions.
+ * - It prefetches: the 16 possible descendants of i that are four levels
+ *   further down are at 16i to 16i+15, right next to each other. For 4-byte
+ *   keys, that is 64 bytes, a single cache line. So at each level, we ask
+ *   the CPU to start loading that line, and it arrives while we do the next
+ *   few levels. In a node-based tree, we can't know where those nodes are
+ *   without loading the ones in between first.
+ * - It's compact: no pointers or heights, and no per-node memory
+ *   allocation overhead. For int keys and int data, each item takes 8
+ *   bytes. In the AVL tree, each node with those (stored in the node) also
+ *   needs two 8-byte pointers and a height.
+ *
+ * The search goes all the way down, always log2(n) levels, without
+ * stopping early when it sees the key. That sounds wasteful, but the early
+ * stop would need a second, unpredictable branch at every level, and it
+ * would only save a level or two on average anyway. At the end, we undo the
+ * last few right turns to get the lower bound (the first key that is not
+ * less than the one we want), and check whether that's the key.
+ *
+ * The Compare parameter is a three-way comparator, as in KeyCompare.h. The
+ * freeze() functions pass along the comparator of the tree, so the index
+ * uses the same key order, and find() and contains() accept the same key
+ * types as the tree's own heterogeneous lookup.
+ *
+ * This is the bst example's own copy of the class from the avl example.
+ * Like the other policy classes that bst shares with avl (see NodeStorage.h),
+ * it is in the "bst" namespace, so that both trees can be used in the same
+ * program.
+ */
+
+#pragma once
+
+// We include <vector> for the key and data arrays
+#include <vector>
+// We include <stdexcept> for std::runtime_error
+#include <stdexcept>
+// We include <utility> for std::move
+#include <utility>
+// We include <cstddef> for std::size_t
+#include <cstddef>
+
+namespace bst {
+
+template <typename K, typename D, typename Compare>
+class EytzingerIndex {
+  public:
+    // An empty index.
+    EytzingerIndex() : size_(0) { }
+
+    // Build the index from a range of items in strictly increasing key
+    // order, where each item has "key" and "data" members, such as the
+    // items you get from iterating over an AVL or a Dictionary. The keys
+    // and data are copied. This takes O(n) time. Throws a
+    // std::runtime_error if the keys are not in order.
+    template <typename ItemIterator>
+    EytzingerIndex(ItemIterator first, ItemIterator last);
+
+    // find: Return the data for this key. Throws a std::runtime_error if
+    // the key isn't there. The key can be anything that Compare can compare
+    // with a K.
+    template <typename Q>
+    const D& find(const Q& key) const {
+      const std::size_t i = _lowerBound(key);
+      if (i == 0 || Compare()(key, keys_[i]) != 0) {
+        throw std::runtime_error("error in EytzingerIndex::find(): key not found");
+      }
+      return data_[i];
+    }
+
+    // contains: Tell whether this key is there.
+    template <typename Q>
+    bool contains(const Q& key) const {
+      const std::size_t i = _lowerBound(key);
+      return i != 0 && Compare()(key, keys_[i]) == 0;
+    }
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // memoryBytes: The size of the two arrays, in bytes. (If K or D own
+    // memory elsewhere, such as the characters of a long std::string, that
+    // isn't counted.)
+    std::size_t memoryBytes() const {
+      return keys_.capacity() * sizeof(K) + data_.capacity() * sizeof(D);
+    }
+
+  private:
+    // keys_[1] to keys_[size_] are the keys in Eytzinger order, and data_
+    // holds the matching data. Index 0 isn't used, so that the children of
+    // i are exactly 2i and 2i+1.
+    std::vector<K> keys_;
+    std::vector<D> data_;
+    std::size_t size_;
+
+    // PREFETCH_LEVELS: How many levels ahead to prefetch. The descendants
+    // of i that are L levels down are the 2^L items starting at index
+    // i * 2^L. We pick the largest L for which those items fit in a
+    // 64-byte cache line (but at least 1), so that a single prefetch brings
+    // all of them in: 4 levels for 4-byte keys, 3 for 8-byte keys, and so on.
+    static constexpr std::size_t KEYS_PER_LINE = 64 / sizeof(K);
+    static constexpr int PREFETCH_LEVELS =
+      (KEYS_PER_LINE >= 16) ? 4 : (KEYS_PER_LINE >= 8) ? 3 : (KEYS_PER_LINE >= 4) ? 2 : 1;
+
+    // _fill: Put the sorted items into Eytzinger order, with an in-order
+    // traversal of the implicit tree: the left subtree of index i gets the
+    // smallest items, then i itself, then the right subtree. The recursion
+    // only goes log2(n) levels deep.
+    void _fill(std::vector<K>& sorted_keys, std::vector<D>& sorted_data,
+      std::size_t& next, std::size_t i);
+
+    // _lowerBound: The index of the first key that is not less than "key",
+    // or 0 if there is none.
+    template <typename Q>
+    std::size_t _lowerBound(const Q& key) const;
+};
+
+template <typename K, typename D, typename Compare>
+template <typename ItemIterator>
+EytzingerIndex<K, D, Compare>::EytzingerIndex(ItemIterator first, ItemIterator last) : size_(0) {
+  // Copy the items out in sorted order first.
+  std::vector<K> sorted_keys;
+  std::vector<D> sorted_data;
+  for (ItemIterator it = first; it != last; ++it) {
+    if (!sorted_keys.empty() && Compare()(sorted_keys.back(), it->key) >= 0) {
+      throw std::runtime_error("error in EytzingerIndex: keys are not in strictly increasing order");
+    }
+    sorted_keys.push_back(it->key);
+    sorted_data.push_back(it->data);
+  }
+  size_ = sorted_keys.size();
+  if (size_ == 0) return;
+
+  // The arrays need a placeholder in every slot before _fill moves the
+  // items into place. We use copies of the first item for that, so that
+  // K and D don't need default constructors.
+  keys_.assign(size_ + 1, sorted_keys[0]);
+  data_.assign(size_ + 1, sorted_data[0]);
+  std::size_t next = 0;
+  _fill(sorted_keys, sorted_data, next, 1);
+}
+
+template <typename K, typename D, typename Compare>
+void EytzingerIndex<K, D, Compare>::_fill(std::vector<K>& sorted_keys, std::vector<D>& sorted_data,
+  std::size_t& next, std::size_t i) {
+
+  if (i > size_) return;
+  _fill(sorted_keys, sorted_data, next, 2 * i);
+  keys_[i] = std::move(sorted_keys[next]);
+  data_[i] = std::move(sorted_data[next]);
+  next++;
+  _fill(sorted_keys, sorted_data, next, 2 * i + 1);
+}
+
+template <typename K, typename D, typename Compare>
+template <typename Q>
+std::size_t EytzingerIndex<K, D, Compare>::_lowerBound(const Q& key) const {
+  const K* keys = keys_.data();
+  std::size_t i = 1;
+  while (i <= size_) {
+#if defined(__GNUC__)
+    // __builtin_prefetch is a GCC and Clang extension. It's only a hint,
+    // and it never faults, but we still keep the address inside the array,
+    // since even computing a pointer past the end is undefined behavior in
+    // C++. (The compiler does this with a conditional move, not a branch.)
+    const std::size_t ahead = i << PREFETCH_LEVELS;
+    __builtin_prefetch(keys + (ahead <= size_ ? ahead : 0));
+#endif
+    // Go right (2i+1) if this key is less than the one we want, and left
+    // (2i) otherwise. Note there's no "if" here.
+    i = 2 * i + (Compare()(keys[i], key) < 0);
+  }
+
+  // Now i is past the bottom of the tree. The lower bound is the last node
+  // on the path where we went left. Every right turn after that added a 1
+  // bit at the end of i, and the left turn itself added a 0 bit, so we
+  // remove the trailing 1 bits and then one more bit. (If we never went
+  // left, this gives 0, meaning "no such key".)
+#if defined(__GNUC__)
+  // __builtin_ctzll counts the trailing 0 bits, so on ~i it counts the
+  // trailing 1 bits of i, in one instruction.
+  return i >> (__builtin_ctzll(~(unsigned long long)i) + 1);
+#else
+  while (i & 1) {
+    i >>= 1;
+  }
+  return i >> 1;
+#endif
+}
+
+template <typename K, typename D, typename Compare>
+constexpr std::size_t EytzingerIndex<K, D, Compare>::KEYS_PER_LINE;
+template <typename K, typename D, typename Compare>
+constexpr int EytzingerIndex<K, D, Compare>::PREFETCH_LEVELS;
+
+}  // namespace bst
@@ -0,0 +1,101 @@
+/**
+ * Dictionary benchmark: the Unbalanced and RedBlack balancing policies, with
+ * keys that are inserted in sorted, reverse-sorted and random order.
+ *
+ * Build and run with:
+ *   make bench
+ *   ./bench [number of keys]
+ *
+ * The default is 200,000 keys. For each order, we insert all of the keys,
+ * find each of them once (in random order), and then remove them all (in
+ * random order), and report the average time per operation.
+ *
+ * With sorted or reverse-sorted input, the unbalanced tree is a chain, so
+ * every operation is O(n) and the whole run is O(n^2). Those two runs use at
+ * most 20,000 keys, or they would take many minutes; keep that in mind when
+ * comparing the numbers.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Dictionary.h"
+
+using bst::StoreKeysAndData;
+
+// Seconds elapsed since "start", as a double.
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+template <typename Dict>
+static void runBenchmark(const std::string& label, const std::vector<int>& insert_order) {
+  std::vector<int> lookup_order = insert_order;
+  std::shuffle(lookup_order.begin(), lookup_order.end(), std::mt19937(2));
+  const double n = (double)insert_order.size();
+
+  Dict dict;
+  auto start = std::chrono::steady_clock::now();
+  for (const int& key : insert_order) {
+    dict.insert(key, key);
+  }
+  const double insert_seconds = secondsSince(start);
+  const int height = dict.height();
+
+  long long sum = 0;
+  start = std::chrono::steady_clock::now();
+  for (const int& key : lookup_order) {
+    sum += dict.find(key);
+  }
+  const double find_seconds = secondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  for (const int& key : lookup_order) {
+    sum -= dict.remove(key);
+  }
+  const double remove_seconds = secondsSince(start);
+
+  std::string padded = label;
+  padded.resize(30, ' ');
+  std::cout << padded << insert_order.size() << " keys, height " << height
+    << ": insert " << (insert_seconds / n * 1e9) << " ns, find "
+    << (find_seconds / n * 1e9) << " ns, remove " << (remove_seconds / n * 1e9)
+    << " ns" << (sum == 0 ? "" : " (wrong sum!)") << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  const int N = (argc > 1) ? std::atoi(argv[1]) : 200000;
+  const int CHAIN_N = std::min(N, 20000);
+
+  using UnbalancedDict = Dictionary<int, int, StoreKeysAndData, Unbalanced>;
+  using RedBlackDict = Dictionary<int, int, StoreKeysAndData, RedBlack>;
+
+  std::vector<int> sorted(N), random(N);
+  for (int i = 0; i < N; i++) {
+    sorted[i] = i;
+    random[i] = i;
+  }
+  std::shuffle(random.begin(), random.end(), std::mt19937(1));
+  std::vector<int> reversed(sorted.rbegin(), sorted.rend());
+  std::vector<int> short_sorted(sorted.begin(), sorted.begin() + CHAIN_N);
+  std::vector<int> short_reversed(short_sorted.rbegin(), short_sorted.rend());
+
+  runBenchmark<UnbalancedDict>("Unbalanced, sorted:", short_sorted);
+  runBenchmark<RedBlackDict>("RedBlack, sorted:", short_sorted);
+  runBenchmark<RedBlackDict>("RedBlack, sorted:", sorted);
+  std::cout << std::endl;
+  runBenchmark<UnbalancedDict>("Unbalanced, reverse-sorted:", short_reversed);
+  runBenchmark<RedBlackDict>("RedBlack, reverse-sorted:", short_reversed);
+  runBenchmark<RedBlackDict>("RedBlack, reverse-sorted:", reversed);
+  std::cout << std::endl;
+  runBenchmark<UnbalancedDict>("Unbalanced, random:", random);
+  runBenchmark<RedBlackDict>("RedBlack, random:", random);
+
+  return 0;
+}
@@ -7,10 +7,15 @@
 
 #include <string>
 #include <iostream>
+#include <map>
+#include <random>
 #include <vector>
 
 #include "Dictionary.h"
 
+// The storage policies are in the "bst" namespace (see NodeStorage.h).
+using bst::StoreKeysAndData;
+
 int main() {
 
   // First, we'll fill a vector with some values matching each index, which
@@ -144,6 +149,151 @@ int main() {
     }
   }
 
+  // With the StoreKeysAndData storage policy, the nodes own copies of the
+  // keys and data, so we can insert temporary values directly, and remove
+  // returns the data by value. (See NodeStorage.h.)
+  {
+    Dictionary<int, std::string, StoreKeysAndData> owning;
+    owning.insert(37, "thirty seven");
+    owning.insert(19, "nineteen");
+    owning.emplace(51, "fifty one");
+    std::cout << "Owning dictionary: ";
+    owning.printInOrder();
+    std::cout << std::endl;
+    std::cout << "owning.remove(19): " << owning.remove(19) << std::endl;
+  }
+
+  // Iterators walk the items in key order, and range() scans the keys from
+  // lo up to (but not including) hi. We compare them to a std::map.
+  {
+    Dictionary<int, int, StoreKeysAndData> scan_dict;
+    std::map<int, int> expected;
+    std::mt19937 rng(4);
+    for (int i=0; i<500; i++) {
+      const int key = (int)(rng() % 1000);
+      if (!expected.count(key)) {
+        scan_dict.insert(key, key * 10);
+        expected[key] = key * 10;
+      }
+    }
+
+    auto it = scan_dict.begin();
+    for (const auto& item : expected) {
+      if (it == scan_dict.end() || it->key != item.first || it->data != item.second) {
+        throw std::runtime_error("Error: forward iteration is wrong");
+      }
+      ++it;
+    }
+    for (auto rit = expected.rbegin(); rit != expected.rend(); ++rit) {
+      if ((--it)->key != rit->first) {
+        throw std::runtime_error("Error: backward iteration is wrong");
+      }
+    }
+
+    for (int lo=-5; lo<1005; lo+=7) {
+      const int hi = lo + 40;
+      std::vector<int> scanned, wanted;
+      for (const auto& item : scan_dict.range(lo, hi)) {
+        scanned.push_back(item.key);
+      }
+      for (auto e = expected.lower_bound(lo); e != expected.end() && e->first < hi; ++e) {
+        wanted.push_back(e->first);
+      }
+      auto upper = scan_dict.upper_bound(lo);
+      auto expected_upper = expected.upper_bound(lo);
+      if (scanned != wanted || (upper == scan_dict.end()) != (expected_upper == expected.end()) ||
+          (upper != scan_dict.end() && upper->key != expected_upper->first)) {
+        throw std::runtime_error("Error: range() or upper_bound() is wrong");
+      }
+    }
+    std::cout << "Iterator test OK" << std::endl;
+  }
+
+  // With the RedBlack balancing policy, inserting sorted keys still gives a
+  // tree of height O(log n), where the unbalanced tree would be a chain as
+  // long as the number of keys. We also make random inserts and removes
+  // (with all three kinds of remove) and compare against a std::map, and
+  // check the red-black rules after every change.
+  {
+    Dictionary<int, int, StoreKeysAndData, RedBlack> sorted_dict;
+    Dictionary<int, int, StoreKeysAndData> unbalanced_dict;
+    for (int key=0; key<1000; key++) {
+      sorted_dict.insert(key, key);
+      unbalanced_dict.insert(key, key);
+    }
+    sorted_dict.runDebuggingChecks();
+    std::cout << "Height after 1000 sorted inserts: " << unbalanced_dict.height()
+      << " unbalanced, " << sorted_dict.height() << " red-black" << std::endl;
+    // 2 log2(1001) is just under 20.
+    if (sorted_dict.height() > 19) {
+      throw std::runtime_error("Error: the red-black tree is too tall");
+    }
+    for (int key=999; key>=0; key-=2) {
+      if (sorted_dict.remove(key) != key) {
+        throw std::runtime_error("Error: red-black remove returned the wrong data");
+      }
+    }
+    sorted_dict.runDebuggingChecks();
+
+    Dictionary<int, int, StoreKeysAndData, RedBlack> rb_dict;
+    std::map<int, int> expected;
+    std::mt19937 rng(18);
+    for (int i=0; i<4000; i++) {
+      const int key = (int)(rng() % 300);
+      if (expected.count(key)) {
+        if (rb_dict.remove(key) != expected[key]) {
+          throw std::runtime_error("Error: red-black remove returned the wrong data");
+        }
+        expected.erase(key);
+      }
+      else {
+        rb_dict.insert(key, i);
+        expected[key] = i;
+      }
+      rb_dict.runDebuggingChecks();
+    }
+    for (const auto& item : expected) {
+      if (rb_dict.find(item.first) != item.second) {
+        throw std::runtime_error("Error: red-black find returned the wrong data");
+      }
+    }
+    if (expected.size() != (std::size_t)std::distance(rb_dict.begin(), rb_dict.end())) {
+      throw std::runtime_error("Error: the red-black tree has the wrong number of items");
+    }
+    std::cout << "Red-black test OK" << std::endl;
+  }
+
+  // With std::string keys, find can take a C string directly, and no
+  // temporary std::string is built for the search. (See KeyCompare.h.)
+  {
+    Dictionary<std::string, int, StoreKeysAndData, RedBlack> names;
+    names.insert(std::string("banana"), 2);
+    names.insert(std::string("apple"), 1);
+    names.insert(std::string("cherry"), 3);
+    const char* wanted = "cherry";
+    if (names.find("apple") != 1 || names.find(wanted) != 3 || names.find(std::string("banana")) != 2) {
+      throw std::runtime_error("Error: heterogeneous lookup is wrong");
+    }
+    std::cout << "names.find(\"cherry\"): " << names.find("cherry") << std::endl;
+  }
+
+  // freeze() copies the items into a read-only EytzingerIndex, which is
+  // perfectly balanced even when the tree isn't, as after sorted inserts.
+  {
+    Dictionary<int, int, StoreKeysAndData> chain;
+    for (int key=0; key<500; key++) {
+      chain.insert(key, key + 1);
+    }
+    auto frozen = chain.freeze();
+    for (int key=-1; key<=500; key++) {
+      const bool expected = (key >= 0 && key < 500);
+      if (frozen.contains(key) != expected || (expected && frozen.find(key) != key + 1)) {
+        throw std::runtime_error("Error: the frozen index gave the wrong answer");
+      }
+    }
+    std::cout << "Frozen index test OK" << std::endl;
+  }
+
   // Show that the program exited without crashing. If you try other
   // experiments in the code block above, you may find that they throw
   // uncaught exceptions from our class functions and crash to the terminal.
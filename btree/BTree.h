@@ -1,33 +1,124 @@
 /**
  * BTree class outline.
- * 
+ *
  * @author
  *   Wade Fagen-Ulmschneider <waf@illinois.edu>
  */
 
+// This is an in-memory B-tree that stores a set of keys. A B-tree of order
+// m stores up to m-1 keys in each node, in sorted order, and each internal
+// node with k keys has k+1 children. Because each node holds many keys next
+// to each other in one array, a lookup only has to jump to a new place in
+// memory once per level, and there are very few levels. (An AVL tree jumps
+// to a new node, which is usually a cache miss, once per key comparison.)
+//   The ORDER template parameter controls the node size. A good choice is
+// one where the keys_ array fills a few cache lines (64 bytes each), for
+// example ORDER = 16 to 64 for int keys. For a B-tree on disk, you would
+// instead pick an order that fills a whole disk page.
+//   This version uses the "proactive" insert and remove algorithms: on the
+// way down the tree, insert splits any full node before stepping into it,
+// and remove makes sure any node it steps into has more than the minimum
+// number of keys, by borrowing a key from a sibling or merging with one.
+// That way, neither operation ever has to go back up the tree. To make the
+// splits come out even, ORDER must be an even number.
+
 #pragma once
 
+// We include <stdexcept> so we can throw std::runtime_error in some cases.
+#include <stdexcept>
+
+// btreeKeyIndex: Return the index of the first of the node's keys that is
+// not less than "key". That is where the key would be if it's in the node,
+// and otherwise, the index of the child to search next. (This is shared
+// with DiskBTree, which stores its nodes differently.)
 template <typename K>
+unsigned btreeKeyIndex(const K* keys, unsigned keys_ct, const K& key);
+
+template <typename K, unsigned ORDER = 64>
 class BTree {
+  static_assert(ORDER >= 4 && ORDER % 2 == 0, "BTree ORDER must be an even number, at least 4");
+
   public:
-    // ...
+    BTree() : root_(nullptr), size_(0) { }
+
+    // The tree owns its nodes, so we don't allow shallow copies.
+    BTree(const BTree&) = delete;
+    BTree& operator=(const BTree&) = delete;
+
+    ~BTree() {
+      clear();
+    }
+
+    // exists: Tells whether the key is in the tree.
+    bool exists(const K& key) const;
+
+    // insert: Add the key to the tree. Throws if the key already exists.
+    void insert(const K& key);
+
+    // remove: Remove the key from the tree. Throws if the key doesn't exist.
+    // (The tree may have been reorganized on the way down before we find
+    //  that out, but it still holds exactly the same keys.)
+    void remove(const K& key);
+
+    // clear: Remove everything.
+    void clear();
+
+    unsigned long size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // height: The number of levels of nodes, which is 0 for an empty tree.
+    unsigned height() const;
+
+    // runDebuggingChecks: Check every B-tree property (sorted keys, key
+    // counts, all leaves at the same depth) and throw if something is wrong.
+    // This visits every node, so it's only meant for testing.
+    bool runDebuggingChecks() const;
 
   private:
+    // MAX_KEYS and MIN_KEYS: Every node except the root must always have
+    // between MIN_KEYS and MAX_KEYS keys.
+    static constexpr unsigned MAX_KEYS = ORDER - 1;
+    static constexpr unsigned MIN_KEYS = ORDER / 2 - 1;
+
     class BTreeNode {
       public:
-        K* keys_;
+        // The keys are stored right inside the node, so the whole array
+        // sits together in memory.
+        K keys_[MAX_KEYS];
+        // children_[i] holds the keys that are less than keys_[i], and
+        // children_[keys_ct_] holds the keys greater than all of them.
+        // A leaf has no children.
+        BTreeNode* children_[ORDER];
         unsigned keys_ct_;
         bool _isLeaf;
 
-        BTreeNode() : keys_(nullptr), keys_ct_(0), _isLeaf(true) { }
+        BTreeNode(bool isLeaf) : keys_ct_(0), _isLeaf(isLeaf) { }
         bool isLeaf() const;
+        BTreeNode & _fetchChild(unsigned index) const;
     };
     BTreeNode *root_;
+    unsigned long size_;
+
+    bool _exists(const BTreeNode & node, const K & key) const;
+
+    static unsigned _keyIndex(const BTreeNode & node, const K & key) {
+      return btreeKeyIndex(node.keys_, node.keys_ct_, key);
+    }
 
-    BTreeNode & _fetchChild(unsigned index);
-    bool _exists(BTreeNode & node, const K & key);
-    // ...
+    // _splitChild: The child at this index must be full. Move its upper
+    // half into a new node, and move its middle key up into this node.
+    void _splitChild(BTreeNode & node, unsigned index);
+    // _mergeChildren: Merge the child at this index, the key at this index,
+    // and the next child into one node.
+    void _mergeChildren(BTreeNode & node, unsigned index);
+    // _borrowFromLeft, _borrowFromRight: Rotate one key from a sibling,
+    // through this node, into the child at this index.
+    void _borrowFromLeft(BTreeNode & node, unsigned index);
+    void _borrowFromRight(BTreeNode & node, unsigned index);
 
+    void _clear(BTreeNode * node);
+    void _debugCheck(const BTreeNode & node, const K * lower, const K * upper,
+      unsigned depth, unsigned & leaf_depth, unsigned long & count) const;
 };
 
-#include "BTree.hpp"
\ No newline at end of file
+#include "BTree.hpp"
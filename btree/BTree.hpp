@@ -1,36 +1,382 @@
 /**
- * An empty BTree.
- * 
+ * BTree implementation.
+ *
  * @author
  *   Wade Fagen-Ulmschneider <waf@illinois.edu>
  */
+
+#pragma once
+
 #include "BTree.h"
 
-template <typename K>
-bool BTree<K>::_exists(BTree<K>::BTreeNode & node, const K & key) {
-  unsigned i;
-  for ( i = 0; i < node.keys_ct_ && key < node.keys_[i]; i++) { }
+#include <algorithm>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+template <typename K, unsigned ORDER>
+bool BTree<K, ORDER>::exists(const K & key) const {
+  if (!root_) { return false; }
+  return _exists(*root_, key);
+}
 
-  if ( i < node.keys_ct_ && key == node.keys_[i] ) {
+template <typename K, unsigned ORDER>
+bool BTree<K, ORDER>::_exists(const BTree<K, ORDER>::BTreeNode & node, const K & key) const {
+  // Find the first key in this node that is not less than the key we want.
+  unsigned i = _keyIndex(node, key);
+
+  // If it's equal, we found it.
+  if ( i < node.keys_ct_ && !(key < node.keys_[i]) ) {
     return true;
   }
 
+  // Otherwise, the key can only be in the child between keys_[i-1] and
+  // keys_[i], which is child i. (The node is passed by reference, so we
+  // never copy a whole node on the way down.)
   if ( node.isLeaf() ) {
     return false;
   } else {
-    BTreeNode nextChild = node._fetchChild(i);
+    const BTreeNode & nextChild = node._fetchChild(i);
     return _exists(nextChild, key);
-  } 
+  }
 }
 
 template <typename K>
-bool BTree<K>::BTreeNode::isLeaf() const {
-  // Stub implementation 
+unsigned btreeKeyIndex(const K* keys, unsigned keys_ct, const K& key) {
+  // For small arithmetic keys (int, double, ...), the fastest search is
+  // usually to compare the key against every key in the node and count how
+  // many are smaller. There are no branches that depend on the data, so the
+  // CPU never guesses wrong, and the compiler can turn the loop into SIMD
+  // instructions that do several comparisons at once.
+  //   For other key types, like std::string, or for very full nodes, a
+  // binary search (std::lower_bound) does fewer comparisons, and that wins.
+  if (std::is_arithmetic<K>::value && keys_ct <= 128) {
+    unsigned count = 0;
+    for (unsigned i = 0; i < keys_ct; i++) {
+      count += (keys[i] < key);
+    }
+    return count;
+  } else {
+    return std::lower_bound(keys, keys + keys_ct, key) - keys;
+  }
+}
+
+template <typename K, unsigned ORDER>
+void BTree<K, ORDER>::insert(const K & key) {
+  if (!root_) {
+    root_ = new BTreeNode(true);
+  }
+
+  // If the root is full, split it first. The tree grows taller by one level
+  // here, at the top, which is the only way a B-tree ever gets taller.
+  if (root_->keys_ct_ == MAX_KEYS) {
+    BTreeNode * newRoot = new BTreeNode(false);
+    newRoot->children_[0] = root_;
+    root_ = newRoot;
+    _splitChild(*root_, 0);
+  }
+
+  BTreeNode * node = root_;
+  while (true) {
+    unsigned i = _keyIndex(*node, key);
+    if ( i < node->keys_ct_ && !(key < node->keys_[i]) ) {
+      throw std::runtime_error("error in insert(): key already exists");
+    }
+
+    if ( node->isLeaf() ) {
+      // Shift the larger keys over by one and put the key in its place.
+      // We know there's room, because we never step into a full node.
+      std::move_backward(node->keys_ + i, node->keys_ + node->keys_ct_,
+        node->keys_ + node->keys_ct_ + 1);
+      node->keys_[i] = key;
+      node->keys_ct_++;
+      size_++;
+      return;
+    }
+
+    // Before we step into the child, split it if it's full.
+    if (node->children_[i]->keys_ct_ == MAX_KEYS) {
+      _splitChild(*node, i);
+      // The child's middle key just moved up into keys_[i], so we need to
+      // decide again which of the two halves to step into.
+      if (node->keys_[i] < key) {
+        i++;
+      } else if (!(key < node->keys_[i])) {
+        throw std::runtime_error("error in insert(): key already exists");
+      }
+    }
+    node = node->children_[i];
+  }
+}
+
+template <typename K, unsigned ORDER>
+void BTree<K, ORDER>::_splitChild(BTreeNode & node, unsigned index) {
+  // With t = ORDER / 2, a full child has 2t - 1 keys. The first t - 1 keys
+  // stay in the child, the middle key moves up into this node, and the last
+  // t - 1 keys (with their children) move to a new right sibling.
+  const unsigned t = ORDER / 2;
+  BTreeNode & left = *node.children_[index];
+  BTreeNode * right = new BTreeNode(left.isLeaf());
+
+  std::move(left.keys_ + t, left.keys_ + MAX_KEYS, right->keys_);
+  if ( !left.isLeaf() ) {
+    std::copy(left.children_ + t, left.children_ + ORDER, right->children_);
+  }
+  right->keys_ct_ = t - 1;
+  left.keys_ct_ = t - 1;
+
+  // Make room in this node for the middle key and the new child.
+  std::move_backward(node.keys_ + index, node.keys_ + node.keys_ct_,
+    node.keys_ + node.keys_ct_ + 1);
+  std::copy_backward(node.children_ + index + 1, node.children_ + node.keys_ct_ + 1,
+    node.children_ + node.keys_ct_ + 2);
+  node.keys_[index] = std::move(left.keys_[t - 1]);
+  node.children_[index + 1] = right;
+  node.keys_ct_++;
+}
+
+template <typename K, unsigned ORDER>
+void BTree<K, ORDER>::remove(const K & key) {
+  if (!root_) {
+    throw std::runtime_error("error in remove(): key not found");
+  }
+
+  // "target" is the key we're currently trying to delete. It starts as the
+  // key we were given, but if that key is in an internal node, we replace
+  // it with its predecessor or successor and then go on to delete that one
+  // from a leaf instead.
+  K target = key;
+  BTreeNode * node = root_;
+  bool removed = false;
+
+  while (true) {
+    unsigned i = _keyIndex(*node, target);
+    const bool found = ( i < node->keys_ct_ && !(target < node->keys_[i]) );
+
+    if ( found && node->isLeaf() ) {
+      // The easy case: remove the key from the leaf.
+      std::move(node->keys_ + i + 1, node->keys_ + node->keys_ct_, node->keys_ + i);
+      node->keys_ct_--;
+      size_--;
+      removed = true;
+      break;
+    }
+
+    if ( found ) {
+      BTreeNode & leftChild = *node->children_[i];
+      BTreeNode & rightChild = *node->children_[i + 1];
+      if (leftChild.keys_ct_ > MIN_KEYS) {
+        // Replace the key with its in-order predecessor (the largest key in
+        // the left subtree), and then delete the predecessor from there.
+        const BTreeNode * cur = &leftChild;
+        while ( !cur->isLeaf() ) { cur = cur->children_[cur->keys_ct_]; }
+        node->keys_[i] = cur->keys_[cur->keys_ct_ - 1];
+        target = node->keys_[i];
+        node = &leftChild;
+      } else if (rightChild.keys_ct_ > MIN_KEYS) {
+        // Same idea with the in-order successor.
+        const BTreeNode * cur = &rightChild;
+        while ( !cur->isLeaf() ) { cur = cur->children_[0]; }
+        node->keys_[i] = cur->keys_[0];
+        target = node->keys_[i];
+        node = &rightChild;
+      } else {
+        // Both children have the minimum number of keys, so merge them
+        // around the key, and then delete the key from the merged node.
+        _mergeChildren(*node, i);
+        node = &leftChild;
+      }
+      continue;
+    }
+
+    if ( node->isLeaf() ) {
+      break;
+    }
+
+    // The key is somewhere under child i. Make sure that child has more
+    // than the minimum number of keys before we step into it, so that
+    // removing a key from it later can't make it too small.
+    if (node->children_[i]->keys_ct_ == MIN_KEYS) {
+      if (i > 0 && node->children_[i - 1]->keys_ct_ > MIN_KEYS) {
+        _borrowFromLeft(*node, i);
+      } else if (i < node->keys_ct_ && node->children_[i + 1]->keys_ct_ > MIN_KEYS) {
+        _borrowFromRight(*node, i);
+      } else if (i < node->keys_ct_) {
+        _mergeChildren(*node, i);
+      } else {
+        _mergeChildren(*node, i - 1);
+        i--;
+      }
+    }
+    node = node->children_[i];
+  }
+
+  // A merge can leave the root with no keys and a single child. Then that
+  // child becomes the new root, and the tree gets shorter by one level.
+  if (root_->keys_ct_ == 0) {
+    BTreeNode * oldRoot = root_;
+    root_ = root_->isLeaf() ? nullptr : root_->children_[0];
+    delete oldRoot;
+  }
+
+  // We only throw now, after the tree is back in a valid shape.
+  if (!removed) {
+    throw std::runtime_error("error in remove(): key not found");
+  }
+}
+
+template <typename K, unsigned ORDER>
+void BTree<K, ORDER>::_mergeChildren(BTreeNode & node, unsigned index) {
+  BTreeNode & left = *node.children_[index];
+  BTreeNode * right = node.children_[index + 1];
+
+  // The left child gets the separating key from this node, followed by all
+  // of the right child's keys and children.
+  left.keys_[left.keys_ct_] = std::move(node.keys_[index]);
+  std::move(right->keys_, right->keys_ + right->keys_ct_, left.keys_ + left.keys_ct_ + 1);
+  if ( !left.isLeaf() ) {
+    std::copy(right->children_, right->children_ + right->keys_ct_ + 1,
+      left.children_ + left.keys_ct_ + 1);
+  }
+  left.keys_ct_ += 1 + right->keys_ct_;
+
+  // Close the gap in this node.
+  std::move(node.keys_ + index + 1, node.keys_ + node.keys_ct_, node.keys_ + index);
+  std::copy(node.children_ + index + 2, node.children_ + node.keys_ct_ + 1,
+    node.children_ + index + 1);
+  node.keys_ct_--;
+  delete right;
+}
+
+template <typename K, unsigned ORDER>
+void BTree<K, ORDER>::_borrowFromLeft(BTreeNode & node, unsigned index) {
+  BTreeNode & child = *node.children_[index];
+  BTreeNode & sibling = *node.children_[index - 1];
+
+  // Make room at the front of the child.
+  std::move_backward(child.keys_, child.keys_ + child.keys_ct_, child.keys_ + child.keys_ct_ + 1);
+  if ( !child.isLeaf() ) {
+    std::copy_backward(child.children_, child.children_ + child.keys_ct_ + 1,
+      child.children_ + child.keys_ct_ + 2);
+    child.children_[0] = sibling.children_[sibling.keys_ct_];
+  }
+
+  // The separating key comes down into the child, and the sibling's last
+  // key goes up to replace it.
+  child.keys_[0] = std::move(node.keys_[index - 1]);
+  node.keys_[index - 1] = std::move(sibling.keys_[sibling.keys_ct_ - 1]);
+  child.keys_ct_++;
+  sibling.keys_ct_--;
+}
+
+template <typename K, unsigned ORDER>
+void BTree<K, ORDER>::_borrowFromRight(BTreeNode & node, unsigned index) {
+  BTreeNode & child = *node.children_[index];
+  BTreeNode & sibling = *node.children_[index + 1];
+
+  // The separating key comes down to the end of the child, and the
+  // sibling's first key goes up to replace it.
+  child.keys_[child.keys_ct_] = std::move(node.keys_[index]);
+  node.keys_[index] = std::move(sibling.keys_[0]);
+  if ( !child.isLeaf() ) {
+    child.children_[child.keys_ct_ + 1] = sibling.children_[0];
+    std::copy(sibling.children_ + 1, sibling.children_ + sibling.keys_ct_ + 1, sibling.children_);
+  }
+  std::move(sibling.keys_ + 1, sibling.keys_ + sibling.keys_ct_, sibling.keys_);
+  child.keys_ct_++;
+  sibling.keys_ct_--;
+}
+
+template <typename K, unsigned ORDER>
+void BTree<K, ORDER>::clear() {
+  _clear(root_);
+  root_ = nullptr;
+  size_ = 0;
+}
+
+template <typename K, unsigned ORDER>
+void BTree<K, ORDER>::_clear(BTreeNode * node) {
+  if (!node) { return; }
+  if ( !node->isLeaf() ) {
+    for (unsigned i = 0; i <= node->keys_ct_; i++) {
+      _clear(node->children_[i]);
+    }
+  }
+  delete node;
+}
+
+template <typename K, unsigned ORDER>
+unsigned BTree<K, ORDER>::height() const {
+  unsigned h = 0;
+  for (const BTreeNode * node = root_; node; node = node->isLeaf() ? nullptr : node->children_[0]) {
+    h++;
+  }
+  return h;
+}
+
+template <typename K, unsigned ORDER>
+bool BTree<K, ORDER>::BTreeNode::isLeaf() const {
+  return _isLeaf;
+}
+
+template <typename K, unsigned ORDER>
+typename BTree<K, ORDER>::BTreeNode & BTree<K, ORDER>::BTreeNode::_fetchChild(unsigned index) const {
+  // In memory, a child is just a pointer away. (A B-tree stored on disk
+  // would read the child's page here instead.)
+  return *children_[index];
+}
+
+template <typename K, unsigned ORDER>
+bool BTree<K, ORDER>::runDebuggingChecks() const {
+  if (!root_) {
+    if (size_ != 0) throw std::runtime_error("ERROR: BTree is empty but size_ is not 0");
+    return true;
+  }
+  unsigned leaf_depth = 0;
+  unsigned long count = 0;
+  _debugCheck(*root_, nullptr, nullptr, 1, leaf_depth, count);
+  if (count != size_) {
+    throw std::runtime_error("ERROR: BTree size_ does not match the number of keys");
+  }
   return true;
 }
 
-template <typename K>
-typename BTree<K>::BTreeNode & BTree<K>::_fetchChild(unsigned index) {
-  // Stub implementation 
-  return *root_;
+template <typename K, unsigned ORDER>
+void BTree<K, ORDER>::_debugCheck(const BTreeNode & node, const K * lower, const K * upper,
+  unsigned depth, unsigned & leaf_depth, unsigned long & count) const {
+
+  if (node.keys_ct_ > MAX_KEYS || (&node != root_ && node.keys_ct_ < MIN_KEYS)) {
+    throw std::runtime_error("ERROR: BTree node has the wrong number of keys: " + std::to_string(node.keys_ct_));
+  }
+  for (unsigned i = 0; i < node.keys_ct_; i++) {
+    const bool ordered = (i == 0 || node.keys_[i - 1] < node.keys_[i]);
+    const bool above_lower = (!lower || *lower < node.keys_[i]);
+    const bool below_upper = (!upper || node.keys_[i] < *upper);
+    if (!ordered || !above_lower || !below_upper) {
+      throw std::runtime_error("ERROR: BTree keys are out of order");
+    }
+  }
+  count += node.keys_ct_;
+
+  if ( node.isLeaf() ) {
+    // Every leaf must be at the same depth.
+    if (leaf_depth == 0) { leaf_depth = depth; }
+    if (depth != leaf_depth) {
+      throw std::runtime_error("ERROR: BTree leaves are at different depths");
+    }
+    return;
+  }
+
+  for (unsigned i = 0; i <= node.keys_ct_; i++) {
+    const K * child_lower = (i == 0) ? lower : &node.keys_[i - 1];
+    const K * child_upper = (i == node.keys_ct_) ? upper : &node.keys_[i];
+    _debugCheck(node._fetchChild(i), child_lower, child_upper, depth + 1, leaf_depth, count);
+  }
 }
+
+// C++14 compatibility: out-of-class definitions of the static constexpr
+// members. (This is sometimes needed in C++14, but it is deprecated in C++17.)
+template <typename K, unsigned ORDER>
+constexpr unsigned BTree<K, ORDER>::MAX_KEYS;
+template <typename K, unsigned ORDER>
+constexpr unsigned BTree<K, ORDER>::MIN_KEYS;
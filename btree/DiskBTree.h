@@ -0,0 +1,143 @@
+/**
+ * DiskBTree class outline: a B-tree whose nodes live in the pages of a
+ * memory-mapped file.
+ */
+
+// This is the same B-tree as in BTree.h, with the same proactive insert and
+// remove algorithms, but each node is one page of a file (see Pager.h), and
+// a child "pointer" is a page number. Following a child pointer means
+// fetching that page, which is what BTreeNode::_fetchChild hints at in the
+// in-memory version. Only a small number of pages are mapped at a time, so
+// the tree can be much larger than the available memory.
+//   Because a page holds a few thousand bytes, the order is large (338 for
+// int keys), and the tree is very shallow: 3 or 4 levels can hold billions
+// of keys. That's what keeps the number of page fetches per lookup small.
+//
+// Keys are copied into the pages byte for byte, so K must be a trivially
+// copyable type, like int or a plain struct. (A std::string holds a pointer
+// to memory that won't be there the next time the file is opened.)
+//
+// Changes are only saved by commit(). If the DiskBTree is destroyed, or the
+// program crashes, before commit() is called, the file still holds the tree
+// as of the last commit. Opening a file doesn't read the tree, so it takes
+// the same (short) time no matter how big the tree is.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "BTree.h"
+#include "Pager.h"
+
+template <typename K,
+  unsigned ORDER = (unsigned)((Pager::PAGE_SIZE - 32) / (sizeof(K) + 8)) & ~1u>
+class DiskBTree {
+  static_assert(ORDER >= 4 && ORDER % 2 == 0, "DiskBTree ORDER must be an even number, at least 4");
+  static_assert(std::is_trivially_copyable<K>::value, "DiskBTree keys must be trivially copyable");
+
+  public:
+    // Open the tree stored at this path, or create an empty one. At most
+    // cache_pages pages of the file are mapped into memory at once.
+    DiskBTree(const std::string& path, std::size_t cache_pages = 64);
+
+    DiskBTree(const DiskBTree&) = delete;
+    DiskBTree& operator=(const DiskBTree&) = delete;
+
+    // The same operations as BTree:
+    bool exists(const K& key) const;
+    void insert(const K& key);
+    void remove(const K& key);
+
+    // forEachInRange: Call visit(key) for every key with lower <= key <= upper,
+    // in sorted order, and return how many keys there were.
+    template <typename Visit>
+    unsigned long forEachInRange(const K& lower, const K& upper, Visit visit) const;
+
+    // commit: Save every change since the last commit to the file.
+    void commit();
+
+    unsigned long size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    unsigned height() const;
+
+    // The pager, for its cache statistics.
+    const Pager& pager() const { return pager_; }
+
+    bool runDebuggingChecks() const;
+
+  private:
+    static constexpr unsigned MAX_KEYS = ORDER - 1;
+    static constexpr unsigned MIN_KEYS = ORDER / 2 - 1;
+
+    // The indexes of the header fields where we save the tree's information.
+    enum { FIELD_ROOT = 0, FIELD_SIZE = 1, FIELD_ORDER = 2, FIELD_KEY_SIZE = 3 };
+
+    // DiskNode: The layout of a node in its page. There are no pointers in
+    // here, only page numbers, so the page means the same thing wherever the
+    // file happens to be mapped in memory.
+    class DiskNode {
+      public:
+        // The first 8 bytes of the page belong to the Pager.
+        std::uint64_t pager_reserved_;
+        // The commit sequence number when this page was written. If it's the
+        // current one, the page is new since the last commit, and we can
+        // change it in place; otherwise, we have to copy it first.
+        std::uint64_t transaction_;
+        std::uint32_t keys_ct_;
+        std::uint32_t is_leaf_;
+        K keys_[MAX_KEYS];
+        std::uint64_t children_[ORDER];
+
+        bool isLeaf() const { return is_leaf_ != 0; }
+    };
+    static_assert(sizeof(DiskNode) <= Pager::PAGE_SIZE, "DiskBTree ORDER is too big to fit a node in one page");
+
+    // NodeRef: A pinned page, seen as a DiskNode.
+    class NodeRef {
+      public:
+        NodeRef() { }
+        explicit NodeRef(Pager::PageRef&& page) : page_(std::move(page)) { }
+        DiskNode* operator->() const { return reinterpret_cast<DiskNode*>(page_.data()); }
+        DiskNode& operator*() const { return *operator->(); }
+        std::uint64_t pageNumber() const { return page_.pageNumber(); }
+      private:
+        Pager::PageRef page_;
+    };
+
+    // Fetching a page changes the cache, even when we only read the page,
+    // so the pager is mutable.
+    mutable Pager pager_;
+    // The page number of the root node, or 0 for an empty tree.
+    std::uint64_t root_;
+    unsigned long size_;
+
+    // _fetchChild: Fetch the page of the child at this index, for reading.
+    NodeRef _fetchChild(const DiskNode& node, unsigned index) const;
+    // _writable: Fetch the page with this number so that we can change it.
+    // If the page is part of the last commit, it's copied to a new page
+    // first, and page_number is updated to point to the copy.
+    NodeRef _writable(std::uint64_t& page_number);
+    NodeRef _newNode(bool isLeaf);
+
+    static unsigned _keyIndex(const DiskNode& node, const K& key) {
+      return btreeKeyIndex(node.keys_, node.keys_ct_, key);
+    }
+
+    void _splitChild(DiskNode& node, DiskNode& left, unsigned index);
+    void _mergeChildren(DiskNode& node, DiskNode& left, unsigned index);
+    void _borrowFromLeft(DiskNode& node, DiskNode& child, unsigned index);
+    void _borrowFromRight(DiskNode& node, DiskNode& child, unsigned index);
+
+    template <typename Visit>
+    void _forEachInRange(const DiskNode& node, const K& lower, const K& upper,
+      Visit& visit, unsigned long& count) const;
+    void _debugCheck(const DiskNode& node, const K* lower, const K* upper,
+      unsigned depth, unsigned& leaf_depth, unsigned long& count) const;
+};
+
+#include "DiskBTree.hpp"
@@ -0,0 +1,397 @@
+/**
+ * DiskBTree implementation.
+ */
+
+#pragma once
+
+#include "DiskBTree.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+// Most of this code mirrors BTree.hpp. The comments here focus on what is
+// different when the nodes live in pages: every node has to be fetched, and
+// a node that is part of the last commit must be copied before it changes.
+
+template <typename K, unsigned ORDER>
+DiskBTree<K, ORDER>::DiskBTree(const std::string& path, std::size_t cache_pages)
+  : pager_(path, std::max<std::size_t>(cache_pages, 8)), root_(0), size_(0) {
+
+  // An insert or remove pins up to about 5 pages at once, so the cache has
+  // room for at least 8.
+  if (pager_.isNewFile()) {
+    pager_.setUserField(FIELD_ORDER, ORDER);
+    pager_.setUserField(FIELD_KEY_SIZE, sizeof(K));
+    pager_.commit();
+  } else if (pager_.getUserField(FIELD_ORDER) != ORDER
+    || pager_.getUserField(FIELD_KEY_SIZE) != sizeof(K)) {
+    throw std::runtime_error("DiskBTree: " + path + " holds a tree with a different ORDER or key type");
+  }
+
+  // This is all we need to read to open the tree.
+  root_ = pager_.getUserField(FIELD_ROOT);
+  size_ = pager_.getUserField(FIELD_SIZE);
+}
+
+template <typename K, unsigned ORDER>
+void DiskBTree<K, ORDER>::commit() {
+  pager_.setUserField(FIELD_ROOT, root_);
+  pager_.setUserField(FIELD_SIZE, size_);
+  pager_.commit();
+}
+
+template <typename K, unsigned ORDER>
+typename DiskBTree<K, ORDER>::NodeRef DiskBTree<K, ORDER>::_fetchChild(
+  const DiskNode& node, unsigned index) const {
+  return NodeRef(pager_.fetch(node.children_[index]));
+}
+
+template <typename K, unsigned ORDER>
+typename DiskBTree<K, ORDER>::NodeRef DiskBTree<K, ORDER>::_writable(std::uint64_t& page_number) {
+  NodeRef node(pager_.fetch(page_number));
+  if (node->transaction_ == pager_.currentTransaction()) {
+    return node;
+  }
+
+  // This page belongs to the last commit, which must stay intact until the
+  // next commit, so we make a copy and change the copy instead ("copy on
+  // write"). The caller then stores the new page number in the parent,
+  // which is why the parent must already be writable.
+  NodeRef copy(pager_.allocate());
+  std::memcpy(&copy->transaction_, &node->transaction_,
+    sizeof(DiskNode) - offsetof(DiskNode, transaction_));
+  copy->transaction_ = pager_.currentTransaction();
+  pager_.release(page_number);
+  page_number = copy.pageNumber();
+  return copy;
+}
+
+template <typename K, unsigned ORDER>
+typename DiskBTree<K, ORDER>::NodeRef DiskBTree<K, ORDER>::_newNode(bool isLeaf) {
+  NodeRef node(pager_.allocate());
+  node->transaction_ = pager_.currentTransaction();
+  node->keys_ct_ = 0;
+  node->is_leaf_ = isLeaf;
+  return node;
+}
+
+template <typename K, unsigned ORDER>
+bool DiskBTree<K, ORDER>::exists(const K& key) const {
+  if (root_ == 0) { return false; }
+
+  NodeRef node(pager_.fetch(root_));
+  while (true) {
+    unsigned i = _keyIndex(*node, key);
+    if ( i < node->keys_ct_ && !(key < node->keys_[i]) ) {
+      return true;
+    }
+    if ( node->isLeaf() ) {
+      return false;
+    }
+    // Moving the new page into "node" unpins the parent's page.
+    node = _fetchChild(*node, i);
+  }
+}
+
+template <typename K, unsigned ORDER>
+void DiskBTree<K, ORDER>::insert(const K& key) {
+  if (root_ == 0) {
+    root_ = _newNode(true).pageNumber();
+  }
+
+  NodeRef node = _writable(root_);
+  if (node->keys_ct_ == MAX_KEYS) {
+    NodeRef newRoot = _newNode(false);
+    newRoot->children_[0] = root_;
+    root_ = newRoot.pageNumber();
+    _splitChild(*newRoot, *node, 0);
+    node = std::move(newRoot);
+  }
+
+  while (true) {
+    unsigned i = _keyIndex(*node, key);
+    if ( i < node->keys_ct_ && !(key < node->keys_[i]) ) {
+      throw std::runtime_error("error in insert(): key already exists");
+    }
+
+    if ( node->isLeaf() ) {
+      std::memmove(node->keys_ + i + 1, node->keys_ + i, (node->keys_ct_ - i) * sizeof(K));
+      node->keys_[i] = key;
+      node->keys_ct_++;
+      size_++;
+      return;
+    }
+
+    // The child is about to change (we'll at least step into it), so we
+    // make it writable now.
+    NodeRef child = _writable(node->children_[i]);
+    if (child->keys_ct_ == MAX_KEYS) {
+      _splitChild(*node, *child, i);
+      if (node->keys_[i] < key) {
+        // The new right half was just created, so it's already writable.
+        child = _fetchChild(*node, i + 1);
+      } else if (!(key < node->keys_[i])) {
+        throw std::runtime_error("error in insert(): key already exists");
+      }
+    }
+    node = std::move(child);
+  }
+}
+
+template <typename K, unsigned ORDER>
+void DiskBTree<K, ORDER>::_splitChild(DiskNode& node, DiskNode& left, unsigned index) {
+  const unsigned t = ORDER / 2;
+  NodeRef right = _newNode(left.isLeaf());
+
+  std::memcpy(right->keys_, left.keys_ + t, (t - 1) * sizeof(K));
+  if ( !left.isLeaf() ) {
+    std::memcpy(right->children_, left.children_ + t, t * sizeof(std::uint64_t));
+  }
+  right->keys_ct_ = t - 1;
+  left.keys_ct_ = t - 1;
+
+  std::memmove(node.keys_ + index + 1, node.keys_ + index, (node.keys_ct_ - index) * sizeof(K));
+  std::memmove(node.children_ + index + 2, node.children_ + index + 1,
+    (node.keys_ct_ - index) * sizeof(std::uint64_t));
+  node.keys_[index] = left.keys_[t - 1];
+  node.children_[index + 1] = right.pageNumber();
+  node.keys_ct_++;
+}
+
+template <typename K, unsigned ORDER>
+void DiskBTree<K, ORDER>::remove(const K& key) {
+  if (root_ == 0) {
+    throw std::runtime_error("error in remove(): key not found");
+  }
+
+  K target = key;
+  NodeRef node = _writable(root_);
+  bool removed = false;
+
+  while (true) {
+    unsigned i = _keyIndex(*node, target);
+    const bool found = ( i < node->keys_ct_ && !(target < node->keys_[i]) );
+
+    if ( found && node->isLeaf() ) {
+      std::memmove(node->keys_ + i, node->keys_ + i + 1, (node->keys_ct_ - i - 1) * sizeof(K));
+      node->keys_ct_--;
+      size_--;
+      removed = true;
+      break;
+    }
+
+    if ( node->isLeaf() ) {
+      break;
+    }
+
+    if ( found ) {
+      // Only read the children's key counts here. We make writable only the
+      // child that we actually step into.
+      const unsigned leftCount = _fetchChild(*node, i)->keys_ct_;
+      const unsigned rightCount = _fetchChild(*node, i + 1)->keys_ct_;
+      if (leftCount > MIN_KEYS) {
+        NodeRef cur = _fetchChild(*node, i);
+        while ( !cur->isLeaf() ) { cur = _fetchChild(*cur, cur->keys_ct_); }
+        node->keys_[i] = cur->keys_[cur->keys_ct_ - 1];
+        target = node->keys_[i];
+        node = _writable(node->children_[i]);
+      } else if (rightCount > MIN_KEYS) {
+        NodeRef cur = _fetchChild(*node, i + 1);
+        while ( !cur->isLeaf() ) { cur = _fetchChild(*cur, 0); }
+        node->keys_[i] = cur->keys_[0];
+        target = node->keys_[i];
+        node = _writable(node->children_[i + 1]);
+      } else {
+        NodeRef left = _writable(node->children_[i]);
+        _mergeChildren(*node, *left, i);
+        node = std::move(left);
+      }
+      continue;
+    }
+
+    NodeRef child = _writable(node->children_[i]);
+    if (child->keys_ct_ == MIN_KEYS) {
+      if (i > 0 && _fetchChild(*node, i - 1)->keys_ct_ > MIN_KEYS) {
+        _borrowFromLeft(*node, *child, i);
+      } else if (i < node->keys_ct_ && _fetchChild(*node, i + 1)->keys_ct_ > MIN_KEYS) {
+        _borrowFromRight(*node, *child, i);
+      } else if (i < node->keys_ct_) {
+        _mergeChildren(*node, *child, i);
+      } else {
+        // Merge into the left sibling instead, and step into that.
+        NodeRef left = _writable(node->children_[i - 1]);
+        _mergeChildren(*node, *left, i - 1);
+        child = std::move(left);
+      }
+    }
+    node = std::move(child);
+  }
+  node = NodeRef();
+
+  // Shrink the tree from the top if the root ran out of keys.
+  NodeRef root(pager_.fetch(root_));
+  if (root->keys_ct_ == 0) {
+    const std::uint64_t oldRoot = root_;
+    root_ = root->isLeaf() ? 0 : root->children_[0];
+    pager_.release(oldRoot);
+  }
+
+  if (!removed) {
+    throw std::runtime_error("error in remove(): key not found");
+  }
+}
+
+template <typename K, unsigned ORDER>
+void DiskBTree<K, ORDER>::_mergeChildren(DiskNode& node, DiskNode& left, unsigned index) {
+  // The right child disappears, so it never needs to be writable; we only
+  // read it, and then release its page.
+  NodeRef right = _fetchChild(node, index + 1);
+
+  left.keys_[left.keys_ct_] = node.keys_[index];
+  std::memcpy(left.keys_ + left.keys_ct_ + 1, right->keys_, right->keys_ct_ * sizeof(K));
+  if ( !left.isLeaf() ) {
+    std::memcpy(left.children_ + left.keys_ct_ + 1, right->children_,
+      (right->keys_ct_ + 1) * sizeof(std::uint64_t));
+  }
+  left.keys_ct_ += 1 + right->keys_ct_;
+
+  pager_.release(node.children_[index + 1]);
+  std::memmove(node.keys_ + index, node.keys_ + index + 1, (node.keys_ct_ - index - 1) * sizeof(K));
+  std::memmove(node.children_ + index + 1, node.children_ + index + 2,
+    (node.keys_ct_ - index - 1) * sizeof(std::uint64_t));
+  node.keys_ct_--;
+}
+
+template <typename K, unsigned ORDER>
+void DiskBTree<K, ORDER>::_borrowFromLeft(DiskNode& node, DiskNode& child, unsigned index) {
+  NodeRef sibling = _writable(node.children_[index - 1]);
+
+  std::memmove(child.keys_ + 1, child.keys_, child.keys_ct_ * sizeof(K));
+  if ( !child.isLeaf() ) {
+    std::memmove(child.children_ + 1, child.children_, (child.keys_ct_ + 1) * sizeof(std::uint64_t));
+    child.children_[0] = sibling->children_[sibling->keys_ct_];
+  }
+  child.keys_[0] = node.keys_[index - 1];
+  node.keys_[index - 1] = sibling->keys_[sibling->keys_ct_ - 1];
+  child.keys_ct_++;
+  sibling->keys_ct_--;
+}
+
+template <typename K, unsigned ORDER>
+void DiskBTree<K, ORDER>::_borrowFromRight(DiskNode& node, DiskNode& child, unsigned index) {
+  NodeRef sibling = _writable(node.children_[index + 1]);
+
+  child.keys_[child.keys_ct_] = node.keys_[index];
+  node.keys_[index] = sibling->keys_[0];
+  if ( !child.isLeaf() ) {
+    child.children_[child.keys_ct_ + 1] = sibling->children_[0];
+    std::memmove(sibling->children_, sibling->children_ + 1, sibling->keys_ct_ * sizeof(std::uint64_t));
+  }
+  std::memmove(sibling->keys_, sibling->keys_ + 1, (sibling->keys_ct_ - 1) * sizeof(K));
+  child.keys_ct_++;
+  sibling->keys_ct_--;
+}
+
+template <typename K, unsigned ORDER>
+template <typename Visit>
+unsigned long DiskBTree<K, ORDER>::forEachInRange(const K& lower, const K& upper, Visit visit) const {
+  unsigned long count = 0;
+  if (root_ != 0) {
+    NodeRef root(pager_.fetch(root_));
+    _forEachInRange(*root, lower, upper, visit, count);
+  }
+  return count;
+}
+
+template <typename K, unsigned ORDER>
+template <typename Visit>
+void DiskBTree<K, ORDER>::_forEachInRange(const DiskNode& node, const K& lower, const K& upper,
+  Visit& visit, unsigned long& count) const {
+
+  // Skip straight to the first key that could be in the range. After that,
+  // this is an in-order traversal that stops at the first key past "upper".
+  // The leaves of a range that spans many keys are mostly visited one after
+  // the other, so each page is fetched only once.
+  for (unsigned i = _keyIndex(node, lower); i <= node.keys_ct_; i++) {
+    if ( !node.isLeaf() ) {
+      NodeRef child = _fetchChild(node, i);
+      _forEachInRange(*child, lower, upper, visit, count);
+    }
+    if (i == node.keys_ct_ || upper < node.keys_[i]) {
+      return;
+    }
+    visit(node.keys_[i]);
+    count++;
+  }
+}
+
+template <typename K, unsigned ORDER>
+unsigned DiskBTree<K, ORDER>::height() const {
+  unsigned h = 0;
+  if (root_ == 0) { return h; }
+  NodeRef node(pager_.fetch(root_));
+  for (h = 1; !node->isLeaf(); h++) {
+    node = _fetchChild(*node, 0);
+  }
+  return h;
+}
+
+template <typename K, unsigned ORDER>
+bool DiskBTree<K, ORDER>::runDebuggingChecks() const {
+  if (root_ == 0) {
+    if (size_ != 0) throw std::runtime_error("ERROR: DiskBTree is empty but size_ is not 0");
+    return true;
+  }
+  unsigned leaf_depth = 0;
+  unsigned long count = 0;
+  NodeRef root(pager_.fetch(root_));
+  if (root->keys_ct_ == 0) {
+    throw std::runtime_error("ERROR: DiskBTree root has no keys");
+  }
+  _debugCheck(*root, nullptr, nullptr, 1, leaf_depth, count);
+  if (count != size_) {
+    throw std::runtime_error("ERROR: DiskBTree size_ does not match the number of keys");
+  }
+  return true;
+}
+
+template <typename K, unsigned ORDER>
+void DiskBTree<K, ORDER>::_debugCheck(const DiskNode& node, const K* lower, const K* upper,
+  unsigned depth, unsigned& leaf_depth, unsigned long& count) const {
+
+  if (node.keys_ct_ > MAX_KEYS || (depth > 1 && node.keys_ct_ < MIN_KEYS)) {
+    throw std::runtime_error("ERROR: DiskBTree node has the wrong number of keys: " + std::to_string(node.keys_ct_));
+  }
+  for (unsigned i = 0; i < node.keys_ct_; i++) {
+    const bool ordered = (i == 0 || node.keys_[i - 1] < node.keys_[i]);
+    const bool above_lower = (!lower || *lower < node.keys_[i]);
+    const bool below_upper = (!upper || node.keys_[i] < *upper);
+    if (!ordered || !above_lower || !below_upper) {
+      throw std::runtime_error("ERROR: DiskBTree keys are out of order");
+    }
+  }
+  count += node.keys_ct_;
+
+  if ( node.isLeaf() ) {
+    if (leaf_depth == 0) { leaf_depth = depth; }
+    if (depth != leaf_depth) {
+      throw std::runtime_error("ERROR: DiskBTree leaves are at different depths");
+    }
+    return;
+  }
+
+  for (unsigned i = 0; i <= node.keys_ct_; i++) {
+    const K* child_lower = (i == 0) ? lower : &node.keys_[i - 1];
+    const K* child_upper = (i == node.keys_ct_) ? upper : &node.keys_[i];
+    NodeRef child = _fetchChild(node, i);
+    _debugCheck(*child, child_lower, child_upper, depth + 1, leaf_depth, count);
+  }
+}
+
+// C++14 compatibility: out-of-class definitions of the static constexpr
+// members.
+template <typename K, unsigned ORDER>
+constexpr unsigned DiskBTree<K, ORDER>::MAX_KEYS;
+template <typename K, unsigned ORDER>
+constexpr unsigned DiskBTree<K, ORDER>::MIN_KEYS;
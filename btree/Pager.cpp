@@ -0,0 +1,296 @@
+/**
+ * Pager: fixed-size pages of a memory-mapped file, with a small page cache
+ * and crash-consistent commits.
+ */
+
+#include "Pager.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+// POSIX headers for open, mmap, ftruncate, fdatasync, ...
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// "BTREEPG1" as an integer, so we can tell whether a file is ours.
+static const std::uint64_t PAGER_MAGIC = 0x3147504545525442ULL;
+// The two header slots are in different 512-byte disk sectors, so a torn
+// write of one slot can't damage the other.
+static const std::size_t HEADER_SLOT_OFFSET[2] = { 0, 2048 };
+
+Pager::PageRef::PageRef(Frame* frame) : frame_(frame) {
+  frame_->pins++;
+}
+
+Pager::PageRef& Pager::PageRef::operator=(PageRef&& other) {
+  if (this != &other) {
+    reset();
+    frame_ = other.frame_;
+    other.frame_ = nullptr;
+  }
+  return *this;
+}
+
+char* Pager::PageRef::data() const {
+  return frame_->data;
+}
+
+std::uint64_t Pager::PageRef::pageNumber() const {
+  return frame_->page;
+}
+
+void Pager::PageRef::reset() {
+  if (frame_) {
+    frame_->pager->_unpin(frame_);
+    frame_ = nullptr;
+  }
+}
+
+Pager::Pager(const std::string& path, std::size_t cache_pages)
+  : fd_(-1), new_file_(false), file_pages_(0), cache_pages_(cache_pages),
+    fetches_(0), misses_(0) {
+
+  if (sysconf(_SC_PAGESIZE) > (long)PAGE_SIZE || PAGE_SIZE % sysconf(_SC_PAGESIZE) != 0) {
+    throw std::runtime_error("Pager: PAGE_SIZE must be a multiple of the system page size");
+  }
+
+  fd_ = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd_ < 0) {
+    throw std::runtime_error("Pager: could not open " + path);
+  }
+  // If the constructor throws, the destructor doesn't run, so from here on
+  // we have to close the file ourselves before anything leaves.
+  try {
+    _open(path);
+  }
+  catch (...) {
+    close(fd_);
+    throw;
+  }
+}
+
+void Pager::_open(const std::string& path) {
+  struct stat st;
+  if (fstat(fd_, &st) != 0) {
+    throw std::runtime_error("Pager: could not stat " + path);
+  }
+  file_pages_ = st.st_size / PAGE_SIZE;
+
+  if (st.st_size == 0) {
+    // A brand new file: page 0 is the header, and there are no other pages
+    // yet. We write the same header into both slots.
+    new_file_ = true;
+    std::memset(&header_, 0, sizeof(header_));
+    header_.magic = PAGER_MAGIC;
+    header_.page_size = PAGE_SIZE;
+    header_.page_count = 1;
+    _growFile(1);
+    _writeHeader(header_, 0);
+    _writeHeader(header_, 1);
+    _sync();
+    return;
+  }
+
+  // Use whichever header slot is valid and has the higher sequence number.
+  Header slots[2];
+  const bool valid0 = _readHeader(0, slots[0]);
+  const bool valid1 = _readHeader(1, slots[1]);
+  if (!valid0 && !valid1) {
+    throw std::runtime_error("Pager: " + path + " is not a valid page file");
+  }
+  if (valid0 && (!valid1 || slots[0].sequence > slots[1].sequence)) {
+    header_ = slots[0];
+  } else {
+    header_ = slots[1];
+  }
+}
+
+Pager::~Pager() {
+  // Anything that wasn't committed is simply dropped: the file still has
+  // the header from the last commit.
+  for (auto& entry : frames_) {
+    _unmap(entry.second);
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+Pager::PageRef Pager::fetch(std::uint64_t page) {
+  fetches_++;
+  auto found = frames_.find(page);
+  if (found != frames_.end()) {
+    Frame* frame = found->second;
+    if (frame->pins == 0) {
+      lru_.erase(frame->lru_position);
+    }
+    return PageRef(frame);
+  }
+
+  // Not in the cache. Make room, then map the page.
+  misses_++;
+  _evictIfNeeded();
+  void* data = mmap(nullptr, PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd_,
+    (off_t)(page * PAGE_SIZE));
+  if (data == MAP_FAILED) {
+    throw std::runtime_error("Pager: mmap failed for page " + std::to_string(page));
+  }
+  Frame* frame = new Frame;
+  frame->pager = this;
+  frame->page = page;
+  frame->data = static_cast<char*>(data);
+  frame->pins = 0;
+  frames_[page] = frame;
+  return PageRef(frame);
+}
+
+Pager::PageRef Pager::allocate() {
+  if (header_.free_head != 0) {
+    // Take the first page off the free list. Note that we don't touch the
+    // page's first 8 bytes: the last committed header's free list still
+    // goes through this page, and that list must stay intact until the
+    // next commit replaces it.
+    PageRef ref = fetch(header_.free_head);
+    header_.free_head = _nextFree(ref.data());
+    return ref;
+  }
+
+  // Otherwise, add a page at the end of the file.
+  const std::uint64_t page = header_.page_count++;
+  if (page >= file_pages_) {
+    _growFile(page + 1);
+  }
+  return fetch(page);
+}
+
+void Pager::release(std::uint64_t page) {
+  pending_free_.push_back(page);
+}
+
+void Pager::commit() {
+  // 1. Make sure every page we changed is on the disk. (On Linux, this also
+  //    writes back pages that we changed through a shared mapping, including
+  //    ones that have already been unmapped.)
+  _sync();
+
+  // 2. Write the new header into the slot that doesn't hold the current
+  //    one, and wait for it. Once this is on disk, the commit has happened.
+  _commitHeader();
+
+  // 3. The pages released before this commit aren't used by the committed
+  //    tree anymore, so now they can go on the free list. That changes the
+  //    free list, so we commit one more time to save it. (If we crash in
+  //    between, those pages are leaked, but nothing is corrupted. If
+  //    something throws in between, the pages that are already on the free
+  //    list are saved by the next commit, and the rest are still pending.)
+  if (pending_free_.empty()) {
+    return;
+  }
+  while (!pending_free_.empty()) {
+    PageRef ref = fetch(pending_free_.back());
+    _nextFree(ref.data()) = header_.free_head;
+    header_.free_head = pending_free_.back();
+    pending_free_.pop_back();
+  }
+  _sync();
+  _commitHeader();
+}
+
+void Pager::_unpin(Frame* frame) {
+  frame->pins--;
+  if (frame->pins == 0) {
+    lru_.push_back(frame);
+    frame->lru_position = std::prev(lru_.end());
+    _evictIfNeeded();
+  }
+}
+
+void Pager::_evictIfNeeded() {
+  // Unmap the least recently used unpinned pages until we're back under the
+  // limit. Pinned pages can't be unmapped, so if there are too many of
+  // those, the cache grows past the limit for a while.
+  while (frames_.size() >= cache_pages_ && !lru_.empty()) {
+    Frame* victim = lru_.front();
+    lru_.pop_front();
+    frames_.erase(victim->page);
+    _unmap(victim);
+  }
+}
+
+void Pager::_unmap(Frame* frame) {
+  // The page's contents are in the file, so unmapping loses nothing.
+  munmap(frame->data, PAGE_SIZE);
+  delete frame;
+}
+
+void Pager::_growFile(std::uint64_t min_pages) {
+  // Grow by doubling, so that a file built one page at a time only has to
+  // be resized O(log n) times.
+  std::uint64_t new_pages = std::max<std::uint64_t>(file_pages_ * 2, 16);
+  if (new_pages < min_pages) {
+    new_pages = min_pages;
+  }
+  if (ftruncate(fd_, (off_t)(new_pages * PAGE_SIZE)) != 0) {
+    throw std::runtime_error("Pager: could not grow the file");
+  }
+  file_pages_ = new_pages;
+}
+
+void Pager::_sync() {
+  if (fdatasync(fd_) != 0) {
+    throw std::runtime_error("Pager: fdatasync failed");
+  }
+}
+
+void Pager::_commitHeader() {
+  // The new header goes into the slot that doesn't hold the current one.
+  // header_ only takes the new sequence number once the header is on disk.
+  // Until then, if the write or the sync fails, header_ still describes the
+  // last commit (and currentTransaction() hasn't moved on), so the next try
+  // writes the same slot again and the current header stays intact.
+  Header next = header_;
+  next.sequence++;
+  _writeHeader(next, next.sequence % 2);
+  _sync();
+  header_.sequence = next.sequence;
+}
+
+void Pager::_writeHeader(Header header, unsigned slot) {
+  // "header" is a copy, since we fill in its checksum here.
+  header.checksum = _checksum(header);
+  if (pwrite(fd_, &header, sizeof(header), HEADER_SLOT_OFFSET[slot]) != (ssize_t)sizeof(header)) {
+    throw std::runtime_error("Pager: could not write the header");
+  }
+}
+
+bool Pager::_readHeader(unsigned slot, Header& header) const {
+  if (pread(fd_, &header, sizeof(header), HEADER_SLOT_OFFSET[slot]) != (ssize_t)sizeof(header)) {
+    return false;
+  }
+  return header.magic == PAGER_MAGIC && header.page_size == PAGE_SIZE
+    && header.checksum == _checksum(header);
+}
+
+std::uint64_t Pager::_checksum(const Header& header) {
+  // FNV-1a over every byte of the header before the checksum itself.
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&header);
+  std::uint64_t hash = 14695981039346656037ULL;
+  for (std::size_t i = 0; i < offsetof(Header, checksum); i++) {
+    hash = (hash ^ bytes[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+std::uint64_t& Pager::_nextFree(char* page_data) {
+  return *reinterpret_cast<std::uint64_t*>(page_data);
+}
+
+// C++14 compatibility: out-of-class definitions of the static constexpr
+// members.
+constexpr std::size_t Pager::PAGE_SIZE;
+constexpr unsigned Pager::USER_FIELDS;
@@ -0,0 +1,169 @@
+/**
+ * Pager: fixed-size pages of a memory-mapped file, with a small page cache
+ * and crash-consistent commits. DiskBTree stores its nodes in these pages.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// How the file is laid out:
+//   Page 0 is the file header. It has two copies ("slots") of the header
+// record, in different disk sectors. Every other page is either in use by
+// the caller (for example, a B-tree node), or on the free list.
+//   The first 8 bytes of every page other than page 0 belong to the pager:
+// that's where a free page stores the number of the next free page. The
+// caller must never write to those bytes.
+//
+// How commits stay crash-consistent ("shadow paging"):
+//   A page that was part of the last commit is never written to again until
+// a later commit has stopped using it. To change such a page, the caller
+// copies it to a newly allocated page first, and frees the old one. (See
+// DiskBTree::_writable.) Freed pages don't go back on the free list until
+// after the next commit, because the last committed tree still uses them.
+//   commit() then writes in this order:
+//     1. Flush every changed page to disk, and wait.
+//     2. Write the new header (root page, free list, ...) into the slot that
+//        does NOT hold the current header, with a higher sequence number and
+//        a checksum, and flush that.
+//   If the program crashes at any point, opening the file picks the header
+// slot with a valid checksum and the highest sequence number. Either that's
+// the old header, which only refers to pages we never touched, or it's the
+// new one, which was only written after all of its pages were on disk.
+//   A crash can leak the pages that were waiting to go on the free list,
+// but it can never corrupt the tree.
+//
+// Opening a file only reads page 0, so it takes the same time no matter how
+// big the file is. All other pages are mapped into memory when they are
+// first used.
+
+class Pager {
+  private:
+    struct Frame;
+
+  public:
+    static constexpr std::size_t PAGE_SIZE = 4096;
+    // The number of 64-bit values in the header that the caller can use to
+    // store its own information, like the page number of the tree's root.
+    static constexpr unsigned USER_FIELDS = 8;
+
+    // PageRef: A page that is "pinned" in the cache. While a PageRef for a
+    // page exists, the page stays mapped, so data() stays valid. When the
+    // PageRef is destroyed, the page may be evicted again.
+    class PageRef {
+      public:
+        PageRef() : frame_(nullptr) { }
+        PageRef(PageRef&& other) : frame_(other.frame_) { other.frame_ = nullptr; }
+        PageRef& operator=(PageRef&& other);
+        PageRef(const PageRef&) = delete;
+        PageRef& operator=(const PageRef&) = delete;
+        ~PageRef() { reset(); }
+
+        char* data() const;
+        std::uint64_t pageNumber() const;
+        void reset();
+
+      private:
+        friend class Pager;
+        explicit PageRef(Frame* frame);
+        Frame* frame_;
+    };
+
+    // Open the file at this path, or create it if it doesn't exist. At most
+    // cache_pages pages are kept mapped at once (unless more than that are
+    // pinned at the same time).
+    Pager(const std::string& path, std::size_t cache_pages = 64);
+    ~Pager();
+
+    Pager(const Pager&) = delete;
+    Pager& operator=(const Pager&) = delete;
+
+    // fetch: Pin an existing page.
+    PageRef fetch(std::uint64_t page);
+
+    // allocate: Get an unused page, from the free list if possible, and
+    // otherwise from the end of the file. The page's contents are undefined.
+    PageRef allocate();
+
+    // release: The caller doesn't need this page anymore. It becomes free
+    // after the next commit.
+    void release(std::uint64_t page);
+
+    // commit: Make every change since the last commit durable, as one step.
+    // If a write or sync fails, this throws, and the changes are still
+    // waiting to be committed: the pager still describes the last commit
+    // that made it to disk, so commit can simply be tried again.
+    void commit();
+
+    // Every commit has a sequence number. Pages that were allocated since
+    // the last commit can safely be changed in place; the caller can tell
+    // which ones those are by storing this number in each page it writes.
+    std::uint64_t currentTransaction() const { return header_.sequence + 1; }
+
+    // True if the file was just created, so the caller should set it up.
+    bool isNewFile() const { return new_file_; }
+
+    // The caller's own header fields. Changes are saved by the next commit.
+    std::uint64_t getUserField(unsigned index) const { return header_.user[index]; }
+    void setUserField(unsigned index, std::uint64_t value) { header_.user[index] = value; }
+
+    // Statistics for benchmarks: how many fetches there were, and how many
+    // of those had to map the page because it wasn't in the cache.
+    std::uint64_t fetchCount() const { return fetches_; }
+    std::uint64_t missCount() const { return misses_; }
+    std::uint64_t pageCount() const { return header_.page_count; }
+
+  private:
+    struct Header {
+      std::uint64_t magic;
+      std::uint64_t page_size;
+      std::uint64_t sequence;
+      std::uint64_t page_count;
+      std::uint64_t free_head;
+      std::uint64_t user[USER_FIELDS];
+      std::uint64_t checksum;
+    };
+
+    struct Frame {
+      Pager* pager;
+      std::uint64_t page;
+      char* data;
+      unsigned pins;
+      // This frame's place in lru_, which is only valid when pins == 0.
+      std::list<Frame*>::iterator lru_position;
+    };
+
+    int fd_;
+    bool new_file_;
+    Header header_;
+    std::uint64_t file_pages_;
+    std::size_t cache_pages_;
+
+    // All mapped frames, and the unpinned ones in least-recently-used order.
+    std::unordered_map<std::uint64_t, Frame*> frames_;
+    std::list<Frame*> lru_;
+
+    // Pages released since the last commit.
+    std::vector<std::uint64_t> pending_free_;
+
+    std::uint64_t fetches_;
+    std::uint64_t misses_;
+
+    // _open: The rest of the constructor, once the file is open.
+    void _open(const std::string& path);
+    void _unpin(Frame* frame);
+    void _evictIfNeeded();
+    void _unmap(Frame* frame);
+    void _growFile(std::uint64_t min_pages);
+    void _sync();
+    void _commitHeader();
+    void _writeHeader(Header header, unsigned slot);
+    bool _readHeader(unsigned slot, Header& header) const;
+    static std::uint64_t _checksum(const Header& header);
+    static std::uint64_t& _nextFree(char* page_data);
+};
@@ -0,0 +1,109 @@
+/**
+ * DiskBTree benchmark: build a tree in a file that is much larger than the
+ * page cache, then time reopening it, point lookups, and range scans.
+ *
+ * Build and run with:
+ *   make bench-disk
+ *   ./bench-disk [number of keys] [cache pages] [file]
+ *
+ * The defaults are 2,000,000 keys (a file of about 60 MB) and a cache of
+ * 64 pages (256 KB). Note that the operating system keeps recently used
+ * parts of the file in memory too, so unless the file is also bigger than
+ * the machine's RAM, a "miss" here costs a mmap call and a minor page
+ * fault, not an actual disk read.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "DiskBTree.h"
+
+// Seconds elapsed since "start", as a double.
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+int main(int argc, char* argv[]) {
+  const long N = (argc > 1) ? std::atol(argv[1]) : 2000000;
+  const std::size_t CACHE_PAGES = (argc > 2) ? std::atol(argv[2]) : 64;
+  const std::string path = (argc > 3) ? argv[3] : "bench-disk.db";
+  std::remove(path.c_str());
+
+  // The keys are the even numbers, inserted in random order, so that a range
+  // scan finds a key for every other value in the range.
+  std::vector<int> keys(N);
+  for (long i=0; i<N; i++) {
+    keys[i] = (int)(2 * i);
+  }
+  std::mt19937 rng(12345);
+  std::shuffle(keys.begin(), keys.end(), rng);
+
+  std::cout << "DiskBTree benchmark, " << N << " random keys, cache of "
+    << CACHE_PAGES << " pages (" << (CACHE_PAGES * Pager::PAGE_SIZE / 1024) << " KB)" << std::endl;
+
+  {
+    DiskBTree<int> t(path, CACHE_PAGES);
+    auto start = std::chrono::steady_clock::now();
+    for (long i=0; i<N; i++) {
+      t.insert(keys[i]);
+      // Committing once per batch lets each batch change pages in place
+      // after their first copy.
+      if (i % 100000 == 99999) {
+        t.commit();
+      }
+    }
+    t.commit();
+    const double elapsed = secondsSince(start);
+    std::cout << "build:        " << (N / elapsed) << " inserts/s, height " << t.height()
+      << ", file " << (t.pager().pageCount() * Pager::PAGE_SIZE / (1024 * 1024)) << " MB" << std::endl;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  DiskBTree<int> t(path, CACHE_PAGES);
+  std::cout << "reopen:       " << (secondsSince(start) * 1e6) << " us" << std::endl;
+
+  // Point lookups of random keys that are in the tree.
+  const long LOOKUPS = 500000;
+  std::uniform_int_distribution<long> pick(0, N - 1);
+  std::vector<int> queries(LOOKUPS);
+  for (int& q : queries) {
+    q = keys[pick(rng)];
+  }
+  long found = 0;
+  std::uint64_t fetches = t.pager().fetchCount(), misses = t.pager().missCount();
+  start = std::chrono::steady_clock::now();
+  for (const int& q : queries) {
+    found += t.exists(q);
+  }
+  double elapsed = secondsSince(start);
+  std::cout << "point lookup: " << (elapsed * 1e9 / LOOKUPS) << " ns/lookup, "
+    << double(t.pager().fetchCount() - fetches) / LOOKUPS << " pages/lookup, "
+    << 100.0 * (t.pager().missCount() - misses) / (t.pager().fetchCount() - fetches) << "% cache misses"
+    << "  (found " << found << ")" << std::endl;
+
+  // Range scans of 2000 consecutive values (1000 keys) each.
+  const long SCANS = 5000;
+  long scanned = 0;
+  long long sum = 0;
+  fetches = t.pager().fetchCount();
+  start = std::chrono::steady_clock::now();
+  for (long s=0; s<SCANS; s++) {
+    const int lower = 2 * (int)pick(rng);
+    scanned += t.forEachInRange(lower, lower + 1999, [&](int key) { sum += key; });
+  }
+  elapsed = secondsSince(start);
+  std::cout << "range scan:   " << (elapsed * 1e6 / SCANS) << " us/scan, "
+    << (scanned / elapsed) << " keys/s, "
+    << double(t.pager().fetchCount() - fetches) / SCANS << " pages/scan"
+    << "  (checksum " << sum << ")" << std::endl;
+
+  std::remove(path.c_str());
+  return 0;
+}
@@ -0,0 +1,148 @@
+/**
+ * B-tree benchmark: insert and lookup throughput of the in-memory BTree at a
+ * few node sizes, compared with the AVL tree and the plain BST.
+ *
+ * Build and run with:
+ *   make bench
+ *   ./bench [number of keys]
+ *
+ * The default is 1,000,000 keys. Larger runs, up to 100,000,000 keys, show
+ * the difference best, because then the trees are far bigger than the CPU
+ * caches; but at that size the AVL tree alone needs several GB of memory.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Turn off the brute-force checks that AVL.h runs after every insert and
+// remove; otherwise we would mostly be timing those.
+#define AVL_DEBUGGING_CHECKS 0
+
+#include "BTree.h"
+#include "../avl/AVL.h"
+#include "../bst/Dictionary.h"
+
+struct BenchResult {
+  double insert_seconds;
+  double lookup_seconds;
+  long long checksum;
+};
+
+// Seconds elapsed since "start", as a double.
+double secondsSince(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// Each of these inserts all of the keys, then looks up all of the queries.
+// The keys vector must stay alive during the call, because the trees store
+// references to the data items in it.
+template <unsigned ORDER>
+BenchResult benchBTree(const std::vector<int>& keys, const std::vector<int>& queries) {
+  BTree<int, ORDER> t;
+  BenchResult result;
+
+  auto start = std::chrono::steady_clock::now();
+  for (const int& key : keys) {
+    t.insert(key);
+  }
+  result.insert_seconds = secondsSince(start);
+
+  long long sum = 0;
+  start = std::chrono::steady_clock::now();
+  for (const int& q : queries) {
+    sum += t.exists(q);
+  }
+  result.lookup_seconds = secondsSince(start);
+  result.checksum = sum;
+  return result;
+}
+
+// The AVL tree from ../avl, for comparison.
+BenchResult benchAVL(const std::vector<int>& keys, const std::vector<int>& queries) {
+  // This is the fastest AVL setup: nodes from an arena, and the keys stored
+  // inside the nodes so a comparison doesn't have to follow a reference.
+  AVL<int, int, ArenaNodeAllocator, StoreKeys> t;
+  BenchResult result;
+
+  auto start = std::chrono::steady_clock::now();
+  for (const int& key : keys) {
+    t.insert(key, key);
+  }
+  result.insert_seconds = secondsSince(start);
+
+  long long sum = 0;
+  start = std::chrono::steady_clock::now();
+  for (const int& q : queries) {
+    sum += t.contains(q);
+  }
+  result.lookup_seconds = secondsSince(start);
+  result.checksum = sum;
+  return result;
+}
+
+// The unbalanced BST Dictionary from ../bst, for comparison.
+BenchResult benchDictionary(const std::vector<int>& keys, const std::vector<int>& queries) {
+  // The keys are inserted in random order, so this tree stays reasonably
+  // shallow (about 2 ln n levels on average) even though it never rebalances.
+  Dictionary<int, int, bst::StoreKeys> t;
+  BenchResult result;
+
+  auto start = std::chrono::steady_clock::now();
+  for (const int& key : keys) {
+    t.insert(key, key);
+  }
+  result.insert_seconds = secondsSince(start);
+
+  // Dictionary has no "contains", and find() throws for a missing key, so
+  // the caller only asks for keys that are in the tree.
+  long long sum = 0;
+  start = std::chrono::steady_clock::now();
+  for (const int& q : queries) {
+    sum += t.find(q);
+  }
+  result.lookup_seconds = secondsSince(start);
+  result.checksum = sum;
+  return result;
+}
+
+void report(const char* label, std::size_t n, std::size_t lookups, const BenchResult& r) {
+  std::cout << label
+    << "  insert: " << (n / r.insert_seconds) << " /s"
+    << "  lookup: " << (r.lookup_seconds * 1e9 / lookups) << " ns"
+    << "  (checksum " << r.checksum << ")" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  const long N = (argc > 1) ? std::atol(argv[1]) : 1000000;
+
+  // Distinct keys in random order.
+  std::vector<int> keys(N);
+  for (long i=0; i<N; i++) {
+    keys[i] = (int)i;
+  }
+  std::mt19937 rng(12345);
+  std::shuffle(keys.begin(), keys.end(), rng);
+
+  // Random lookups of keys that are in the tree.
+  const std::size_t LOOKUPS = 4000000;
+  std::vector<int> queries(LOOKUPS);
+  std::uniform_int_distribution<long> pick(0, N - 1);
+  for (int& q : queries) {
+    q = keys[pick(rng)];
+  }
+
+  std::cout << "Tree benchmark, " << N << " random keys, "
+    << LOOKUPS << " random lookups" << std::endl;
+  report("BTree<int, 16>          ", N, LOOKUPS, benchBTree<16>(keys, queries));
+  report("BTree<int, 64>          ", N, LOOKUPS, benchBTree<64>(keys, queries));
+  report("BTree<int, 256>         ", N, LOOKUPS, benchBTree<256>(keys, queries));
+  report("AVL (arena, StoreKeys)  ", N, LOOKUPS, benchAVL(keys, queries));
+  report("Dictionary (StoreKeys)  ", N, LOOKUPS, benchDictionary(keys, queries));
+
+  return 0;
+}
@@ -1,15 +1,169 @@
 /**
- * An empty BinaryTree.
- * 
+ * BTree example usage, with a self-check against std::set.
+ *
  * @author
  *   Wade Fagen-Ulmschneider <waf@illinois.edu>
  */
 
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
 #include "BTree.h"
+#include "DiskBTree.h"
+
+// checkAgainstSet: Do a long run of random inserts and removes on both a
+// BTree and a std::set, and make sure the two always agree. A small ORDER
+// makes the tree tall, so this tests many splits, merges and borrows.
+template <unsigned ORDER>
+void checkAgainstSet(unsigned seed) {
+  BTree<int, ORDER> t;
+  std::set<int> expected;
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> keyDist(0, 2000);
+
+  for (int step = 0; step < 20000; step++) {
+    const int key = keyDist(rng);
+    const bool inSet = expected.count(key) > 0;
+    if (t.exists(key) != inSet) {
+      throw std::runtime_error("BTree test failed: exists() disagrees with std::set");
+    }
+
+    // Insert until the tree is big, then mostly remove, then mix.
+    const bool doInsert = (step < 6000) || (step >= 12000 && rng() % 2 == 0);
+    bool threw = false;
+    try {
+      if (doInsert) {
+        t.insert(key);
+        expected.insert(key);
+      } else {
+        t.remove(key);
+        expected.erase(key);
+      }
+    }
+    catch (const std::runtime_error&) {
+      threw = true;
+    }
+    // Inserting a key that exists, or removing one that doesn't, must throw.
+    if (threw != (doInsert == inSet)) {
+      throw std::runtime_error("BTree test failed: wrong exception behavior");
+    }
+
+    if (t.size() != expected.size()) {
+      throw std::runtime_error("BTree test failed: size() disagrees with std::set");
+    }
+    if (step % 500 == 0) {
+      t.runDebuggingChecks();
+    }
+  }
+  t.runDebuggingChecks();
+
+  // Remove everything that's left, in random order.
+  std::vector<int> remaining(expected.begin(), expected.end());
+  std::shuffle(remaining.begin(), remaining.end(), rng);
+  for (int key : remaining) {
+    t.remove(key);
+  }
+  t.runDebuggingChecks();
+  if (!t.empty() || t.height() != 0) {
+    throw std::runtime_error("BTree test failed: tree should be empty");
+  }
+}
+
+// checkDiskTree: The same kind of test for DiskBTree, with a small ORDER so
+// the tree gets tall, and a tiny page cache so pages are evicted all the
+// time. We also close and reopen the file, and check that changes made
+// after the last commit are thrown away.
+void checkDiskTree(unsigned seed) {
+  const std::string path = "btree-test.db";
+  std::remove(path.c_str());
+
+  std::set<int> expected;
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> keyDist(0, 3000);
+  {
+    DiskBTree<int, 8> t(path, 8);
+    for (int step = 0; step < 20000; step++) {
+      const int key = keyDist(rng);
+      const bool inSet = expected.count(key) > 0;
+      if (t.exists(key) != inSet) {
+        throw std::runtime_error("DiskBTree test failed: exists() disagrees with std::set");
+      }
+      if (step < 8000 || rng() % 2 == 0) {
+        if (!inSet) { t.insert(key); expected.insert(key); }
+      } else {
+        if (inSet) { t.remove(key); expected.erase(key); }
+      }
+      if (step % 1000 == 999) {
+        t.runDebuggingChecks();
+        t.commit();
+      }
+    }
+    t.commit();
+
+    // A range scan must see exactly the keys that std::set has in the range.
+    std::vector<int> scanned;
+    t.forEachInRange(1000, 2000, [&](int key) { scanned.push_back(key); });
+    std::vector<int> inRange(expected.lower_bound(1000), expected.upper_bound(2000));
+    if (scanned != inRange) {
+      throw std::runtime_error("DiskBTree test failed: forEachInRange() is wrong");
+    }
+
+    // Change a lot without committing, then drop the tree.
+    for (int key = 0; key <= 3000; key++) {
+      if (expected.count(key)) { t.remove(key); } else { t.insert(key); }
+    }
+  }
+
+  // Reopen: we should see the tree as of the last commit.
+  {
+    DiskBTree<int, 8> t(path, 8);
+    t.runDebuggingChecks();
+    if (t.size() != expected.size()) {
+      throw std::runtime_error("DiskBTree test failed: wrong size after reopening");
+    }
+    for (int key = 0; key <= 3000; key++) {
+      if (t.exists(key) != (expected.count(key) > 0)) {
+        throw std::runtime_error("DiskBTree test failed: wrong keys after reopening");
+      }
+    }
+    // Empty the tree, so the free list gets a workout on the way down.
+    for (int key : expected) {
+      t.remove(key);
+    }
+    t.commit();
+    t.runDebuggingChecks();
+    if (!t.empty() || t.height() != 0) {
+      throw std::runtime_error("DiskBTree test failed: tree should be empty");
+    }
+  }
+  std::remove(path.c_str());
+}
 
 int main() {
   BTree<int> t;
-  // ...
+  for (int i = 0; i < 1000; i++) {
+    t.insert(i * 2);
+  }
+
+  std::cout << "size: " << t.size() << ", height: " << t.height() << std::endl;
+  std::cout << "exists(500): " << t.exists(500) << std::endl;
+  std::cout << "exists(501): " << t.exists(501) << std::endl;
+
+  t.remove(500);
+  std::cout << "after remove(500), exists(500): " << t.exists(500) << std::endl;
+
+  checkAgainstSet<4>(1);
+  checkAgainstSet<6>(2);
+  checkAgainstSet<64>(3);
+  std::cout << "BTree tests passed." << std::endl;
+
+  checkDiskTree(4);
+  std::cout << "DiskBTree tests passed." << std::endl;
 
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,84 @@
+/**
+ * A game of the Tower of Hanoi puzzle, using CompactStacks.
+ */
+
+#include "CompactGame.h"
+#include "CompactStack.h"
+
+#include <stdexcept>
+#include <iostream>
+using std::cout;
+using std::endl;
+
+CompactGame::CompactGame() : CompactGame(4) { }
+
+CompactGame::CompactGame(unsigned cubes, unsigned pegs) : stacks_(pegs) {
+  if (cubes > 64) {
+    throw std::runtime_error("A CompactGame can have at most 64 cubes.");
+  }
+  if (pegs < 3) {
+    throw std::runtime_error("A CompactGame needs at least 3 pegs.");
+  }
+  for (unsigned length = cubes; length >= 1; length--) {
+    stacks_[0].push_back(length);
+  }
+}
+
+void CompactGame::moveCube(unsigned from, unsigned to) {
+  _moveCube(stacks_.at(from), stacks_.at(to));
+}
+
+const CompactStack & CompactGame::getStack(unsigned index) const {
+  return stacks_.at(index);
+}
+
+// Move the top cube from Stack `s1` to Stack `s2`:
+void CompactGame::_moveCube(CompactStack & s1, CompactStack & s2) {
+  if (!s1.moveTopTo(s2)) {
+    throw std::runtime_error("Illegal move in CompactGame.");
+  }
+}
+
+// Move the cubes in the range [start...end] from `source` to `target`, using spare as a spare spot:
+void CompactGame::_move(
+  unsigned start, unsigned end,
+  CompactStack & source, CompactStack & target, CompactStack & spare,
+  unsigned depth, bool verbose
+) {
+  if (verbose) {
+    cout << "Planning (depth=" << depth << "): Move [" << start << ".." << end << "] from Stack@" << &source << " -> Stack@" << &target << ", Spare@" << &spare << "]" << endl;
+  }
+  depth++;
+
+  if (start == end) {
+    _moveCube( source, target );
+    if (verbose) {
+      cout << *this << endl;
+    }
+  } else {
+    _move(start + 1, end  , source, spare , target, depth, verbose);
+    _move(start    , start, source, target, spare , depth, verbose);
+    _move(start + 1, end  , spare , target, source, depth, verbose);
+  }
+}
+
+void CompactGame::solve(bool verbose) {
+  if (stacks_[0].size() == 0) {
+    return;
+  }
+  _move(
+    0, stacks_[0].size() - 1,  //< Move the entire set of cubes, [0 .. size-1]
+    stacks_[0], //< Source stack is [0]
+    stacks_[2], //< Target stack is [2]
+    stacks_[1], //< Spare stack is [1]
+    0,  //< Initial depth (for printouts only) is 0
+    verbose
+  );
+}
+
+std::ostream& operator<<(std::ostream & os, const CompactGame & game) {
+  for (unsigned i = 0; i < game.stacks_.size(); i++) {
+    os << "Stack[" << i << ", " << &game.stacks_[i] << "]: " << game.stacks_[i] << endl;
+  }
+  return os;
+}
@@ -0,0 +1,45 @@
+/**
+ * A game of the Tower of Hanoi puzzle, using CompactStacks.
+ *
+ * This plays the same game, with the same plan and the same printouts, as
+ * the Game class, but each stack is a CompactStack (a bitmask of cube
+ * lengths) instead of a Stack (a vector of Cubes). Please see
+ * CompactStack.h for how that works.
+ */
+
+#pragma once
+
+#include "CompactStack.h"
+#include <vector>
+
+class CompactGame {
+  public:
+    // The same four cubes on the [0]th stack as in Game:
+    CompactGame();
+    // Cubes of lengths `cubes` down to 1 on the [0]th stack (up to 64),
+    // with `pegs` stacks in all (at least 3):
+    CompactGame(unsigned cubes, unsigned pegs = 3);
+
+    // Solve the game with the recursive plan from Game. If `verbose` is
+    // true, print the plan and the game after each move, as Game::solve
+    // does; otherwise, just make the moves.
+    void solve(bool verbose = true);
+
+    // Move the top cube from stack `from` to stack `to`, without printing.
+    // Throws a std::runtime_error if the move breaks the rules.
+    void moveCube(unsigned from, unsigned to);
+
+    const CompactStack & getStack(unsigned index) const;
+    unsigned pegs() const { return stacks_.size(); }
+
+    // An overloaded operator<<, printing the game the same way as for a Game:
+    friend std::ostream& operator<<(std::ostream & os, const CompactGame & game);
+
+  private:
+    std::vector<CompactStack> stacks_;
+
+  private:
+    void _moveCube(CompactStack & s1, CompactStack & s2);
+    void _move(unsigned start, unsigned end, CompactStack & source, CompactStack & target, CompactStack & spare,
+      unsigned depth, bool verbose);
+};
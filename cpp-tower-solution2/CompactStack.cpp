@@ -0,0 +1,74 @@
+/**
+ * A compact "stack" of cubes in a Tower of Hanoi puzzle, stored as a
+ * bitmask of cube lengths.
+ */
+
+#include "CompactStack.h"
+
+#include <stdexcept>
+#include <iostream>
+
+void CompactStack::push_back(unsigned length) {
+  if (length < 1 || length > 64) {
+    throw std::runtime_error("A CompactStack can only hold cubes of length 1 to 64.");
+  }
+
+  // Ensure that we do not push a cube on top of a smaller cube (or on top
+  // of another cube of the same length):
+  const uint64_t bit = uint64_t(1) << (length - 1);
+  if ( (disks_ & ((bit << 1) - 1)) != 0 ) {
+    std::cerr << "A smaller cube cannot be placed on top of a larger cube." << std::endl;
+    std::cerr << "  Tried to add Cube(length=" << length << ")" << std::endl;
+    std::cerr << "  Current stack: " << *this << std::endl;
+
+    throw std::runtime_error("A smaller cube cannot be placed on top of a larger cube.");
+  }
+
+  disks_ |= bit;
+}
+
+unsigned CompactStack::removeTop() {
+  const unsigned length = peekTop();
+  if (length == 0) {
+    throw std::runtime_error("Cannot remove a cube from an empty stack.");
+  }
+  disks_ &= disks_ - 1;  //< Clears the lowest 1 bit
+  return length;
+}
+
+unsigned CompactStack::peekTop() const {
+  if (disks_ == 0) {
+    return 0;
+  }
+  unsigned length = 1;
+  uint64_t disks = disks_;
+  while ((disks & 1) == 0) {
+    disks >>= 1;
+    length++;
+  }
+  return length;
+}
+
+unsigned CompactStack::size() const {
+  unsigned count = 0;
+  for (uint64_t disks = disks_; disks != 0; disks &= disks - 1) {
+    count++;
+  }
+  return count;
+}
+
+std::ostream& operator<<(std::ostream & os, const CompactStack & stack) {
+  // From the largest length (the bottom) down to the smallest (the top):
+  bool first = true;
+  for (int bit = 63; bit >= 0; bit--) {
+    if ((stack.disks_ >> bit) & 1) {
+      if (!first) {
+        os << " ";
+      }
+      os << (bit + 1);
+      first = false;
+    }
+  }
+
+  return os;
+}
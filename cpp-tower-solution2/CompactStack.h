@@ -0,0 +1,61 @@
+/**
+ * A compact "stack" of cubes in a Tower of Hanoi puzzle, stored as a
+ * bitmask of cube lengths.
+ *
+ * A Stack keeps a std::vector of uiuc::Cube objects, and each Cube holds
+ * its length and its color as five doubles, so every move copies a 40-byte
+ * Cube out of one vector and into another. But in a game of Tower of Hanoi,
+ * each length appears only once, and a stack is always in order from the
+ * largest cube at the bottom to the smallest on top. So all we really need
+ * to know about a stack is which lengths are in it: bit (length - 1) of a
+ * 64-bit integer is 1 if the stack has the cube of that length. Then:
+ *
+ * - The top cube is the lowest 1 bit, which is `disks_ & -disks_`.
+ * - A cube can go on the stack if no 1 bit is at or below its bit. That's a
+ *   single AND, instead of finding the top Cube and comparing lengths.
+ * - Moving a cube is one XOR and one OR.
+ *
+ * The lengths must be whole numbers from 1 to 64.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+
+class CompactStack {
+  public:
+    CompactStack() : disks_(0) { }
+
+    // Add the cube of length `length` on top, checking the rules the same
+    // way as Stack::push_back does:
+    void push_back(unsigned length);
+    // Remove the top cube, and return its length:
+    unsigned removeTop();
+    // The length of the top cube (0 for an empty stack):
+    unsigned peekTop() const;
+    unsigned size() const;
+
+    // Move the top cube of this stack onto `target`, if the rules allow it,
+    // and return whether it moved. This is O(1), and it doesn't print.
+    bool moveTopTo(CompactStack & target) {
+      // (The lowest 1 bit of x is x & -x, in two's complement arithmetic.)
+      const uint64_t top = disks_ & (~disks_ + 1);
+      if (top == 0 || (target.disks_ & ((top << 1) - 1)) != 0) {
+        return false;
+      }
+      disks_ ^= top;
+      target.disks_ |= top;
+      return true;
+    }
+
+    // The lengths as a bitmask, as described above:
+    uint64_t bits() const { return disks_; }
+
+    // An overloaded operator<<, printing the lengths from the bottom up,
+    // just as for a Stack:
+    friend std::ostream& operator<<(std::ostream & os, const CompactStack & stack);
+
+  private:
+    uint64_t disks_;
+};
@@ -0,0 +1,172 @@
+/**
+ * Planning a Tower of Hanoi game with more than three pegs.
+ */
+
+#include "FrameStewart.h"
+#include "CompactGame.h"
+#include "MoveStream.h"
+
+#include <limits>
+#include <stdexcept>
+
+const uint64_t FrameStewart::MAX_PLAN_MOVES;
+
+// Stands for "not possible", such as moving two cubes with only two pegs:
+static const uint64_t IMPOSSIBLE = std::numeric_limits<uint64_t>::max();
+
+// a + b, or IMPOSSIBLE if either one is, or if the sum doesn't fit:
+static uint64_t addMoves(uint64_t a, uint64_t b) {
+  if (a == IMPOSSIBLE || b == IMPOSSIBLE || a > IMPOSSIBLE - b) {
+    return IMPOSSIBLE;
+  }
+  return a + b;
+}
+
+// The number of 1 bits:
+static unsigned countPegs(uint32_t pegs) {
+  unsigned count = 0;
+  for (; pegs != 0; pegs &= pegs - 1) {
+    count++;
+  }
+  return count;
+}
+
+FrameStewart::FrameStewart(unsigned maxCubes, unsigned maxPegs)
+  : maxCubes_(maxCubes), maxPegs_(maxPegs),
+    moves_(maxPegs + 1, std::vector<uint64_t>(maxCubes + 1, IMPOSSIBLE)),
+    split_(maxPegs + 1, std::vector<unsigned>(maxCubes + 1, 0)) {
+
+  if (maxCubes > 64 || maxPegs < 3 || maxPegs > 32) {
+    throw std::runtime_error("FrameStewart: up to 64 cubes, and from 3 to 32 pegs.");
+  }
+
+  // With two pegs, we can only move a single cube.
+  moves_[2][0] = 0;
+  moves_[2][1] = 1;
+
+  for (unsigned p = 3; p <= maxPegs; p++) {
+    moves_[p][0] = 0;
+    if (maxCubes >= 1) {
+      moves_[p][1] = 1;
+    }
+    for (unsigned n = 2; n <= maxCubes; n++) {
+      // Try every k. (k = 0 would mean doing everything with one peg less,
+      // which is never better.)
+      for (unsigned k = 1; k < n; k++) {
+        const uint64_t total = addMoves(addMoves(moves_[p][k], moves_[p][k]), moves_[p - 1][n - k]);
+        if (total < moves_[p][n]) {
+          moves_[p][n] = total;
+          split_[p][n] = k;
+        }
+      }
+    }
+  }
+}
+
+void FrameStewart::_checkSize(unsigned cubes, unsigned pegs) const {
+  if (cubes > maxCubes_ || pegs < 3 || pegs > maxPegs_) {
+    throw std::runtime_error("FrameStewart: the game is larger than the table.");
+  }
+}
+
+uint64_t FrameStewart::moveCount(unsigned cubes, unsigned pegs) const {
+  _checkSize(cubes, pegs);
+  return moves_[pegs][cubes];
+}
+
+unsigned FrameStewart::split(unsigned cubes, unsigned pegs) const {
+  _checkSize(cubes, pegs);
+  return split_[pegs][cubes];
+}
+
+std::vector<FrameStewart::Move> FrameStewart::plan(unsigned cubes, unsigned pegs, unsigned threads) const {
+  const uint64_t count = moveCount(cubes, pegs);
+  if (count > MAX_PLAN_MOVES) {
+    throw std::runtime_error("FrameStewart: the plan would be too large to keep in memory.");
+  }
+
+  std::vector<Move> moves(count);
+  const uint32_t allPegs = (pegs == 32) ? ~uint32_t(0) : ((uint32_t(1) << pegs) - 1);
+  _plan(0, cubes, 0, pegs - 1, allPegs, moves.data(), (threads < 1) ? 1 : threads);
+  return moves;
+}
+
+void FrameStewart::_plan(unsigned base, unsigned count, unsigned from, unsigned to, uint32_t allowed,
+  Move * out, unsigned threads) const {
+
+  if (count == 0) {
+    return;
+  }
+
+  const unsigned p = countPegs(allowed);
+  if (count == 1) {
+    out->cube = base + 1;
+    out->from = from;
+    out->to = to;
+    return;
+  }
+
+  // Find the lowest-numbered allowed stack that is neither `from` nor `to`:
+  const uint32_t others = allowed & ~(uint32_t(1) << from) & ~(uint32_t(1) << to);
+  unsigned park = 0;
+  while (((others >> park) & 1) == 0) {
+    park++;
+  }
+
+  // With only three pegs left, the plan is always the usual one, so instead
+  // of recursing all the way down, we compute its moves directly with a
+  // MoveStream (see MoveStream.h), which goes from stack 0 to stack 2 using
+  // stack 1, and rename the stacks. Each move only depends on its number,
+  // so MoveStream::forEachRange can split a large plan into one piece per
+  // thread.
+  if (p == 3) {
+    const MoveStream stream(count, threads);
+    stream.forEachRange(1, stream.size(), [&](uint64_t first, uint64_t n) {
+      _planThreePegs(base, from, park, to, stream, first, first + n - 1, out);
+    });
+    return;
+  }
+
+  // Otherwise, the top k cubes are parked on that stack in step 1, and we
+  // plan the three steps. The table tells us how many moves each step takes,
+  // so we know where each one starts.
+  const unsigned k = split_[p][count];
+  Move * step1 = out;
+  Move * step2 = step1 + moves_[p][k];
+  Move * step3 = step2 + moves_[p - 1][count - k];
+  const uint32_t withoutPark = allowed & ~(uint32_t(1) << park);
+
+  _plan(base, k, from, park, allowed, step1, threads);
+  _plan(base + k, count - k, from, to, withoutPark, step2, threads);
+  _plan(base, k, park, to, allowed, step3, threads);
+}
+
+void FrameStewart::_planThreePegs(unsigned base, unsigned from, unsigned spare, unsigned to,
+  const MoveStream & stream, uint64_t first, uint64_t last, Move * out) {
+
+  const unsigned stacks[3] = { from, spare, to };
+  for (uint64_t m = first; m <= last; m++) {
+    const MoveStream::Move move = stream.moveAt(m);
+    out[m - 1].cube = base + 1 + MoveStream::disk(move);
+    out[m - 1].from = stacks[MoveStream::from(move)];
+    out[m - 1].to = stacks[MoveStream::to(move)];
+  }
+}
+
+void FrameStewart::solve(CompactGame & game, unsigned threads) const {
+  for (unsigned i = 1; i < game.pegs(); i++) {
+    if (game.getStack(i).size() != 0) {
+      throw std::runtime_error("FrameStewart::solve: the cubes must all start on stack 0.");
+    }
+  }
+  // plan() assumes that the lengths are 1, 2, 3, ... with no gaps.
+  const unsigned cubes = game.getStack(0).size();
+  if (cubes < 64 && game.getStack(0).bits() != (uint64_t(1) << cubes) - 1) {
+    throw std::runtime_error("FrameStewart::solve: the cubes must have lengths 1, 2, 3, ... with no gaps.");
+  }
+
+  const std::vector<Move> moves = plan(cubes, game.pegs(), threads);
+  for (const Move & move : moves) {
+    game.moveCube(move.from, move.to);
+  }
+}
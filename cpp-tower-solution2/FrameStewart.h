@@ -0,0 +1,100 @@
+/**
+ * Planning a Tower of Hanoi game with more than three pegs.
+ *
+ * With three pegs, there's only one way to move a tower of n cubes: move
+ * the top n-1 out of the way, move the largest cube, and move the n-1 back
+ * on top of it. With more pegs, there are more choices. The Frame-Stewart
+ * algorithm picks a number k, and then:
+ *
+ *   1. moves the top k cubes to some other peg, using all p pegs,
+ *   2. moves the other n-k cubes to the target peg, using the p-1 pegs that
+ *      don't hold the k cubes, and
+ *   3. moves the k cubes onto the target peg, using all p pegs again.
+ *
+ * The best k depends on n and p, so we work out the move counts ahead of
+ * time, from small games to large ones:
+ *
+ *   moves(n, p) = the smallest 2 * moves(k, p) + moves(n-k, p-1) for any k
+ *
+ * and we remember the best k for each (n, p) in a table. (This is a
+ * "dynamic programming" table: each entry only depends on entries that
+ * have already been filled in.) For 4 pegs, this is proven to be the fewest
+ * possible moves; for more pegs, it's believed to be, but nobody has proven
+ * it yet.
+ *
+ * Since the table also tells us exactly how many moves each of the three
+ * steps takes, we know where each step's moves go in the final list before
+ * we make any of them, so the list is filled in place, without copying.
+ * When a step is down to three pegs, we don't recurse any further: its
+ * moves are the usual three-peg plan, which MoveStream computes directly
+ * from the move numbers. That is also where the threads come in: each
+ * thread computes its own range of move numbers. (With more pegs, the
+ * plans are short -- 18,433 moves for 64 cubes on 4 pegs -- so only the
+ * three-peg parts of a plan are ever big enough to be worth a thread.)
+ *   The moves can't be *played* at the same time, since each one starts
+ * from where the one before it left off. The plan is played afterward, one
+ * move at a time, which takes O(1) time per move on a CompactGame.
+ */
+
+#pragma once
+
+#include "CompactGame.h"
+#include "MoveStream.h"
+
+#include <cstdint>
+#include <vector>
+
+class FrameStewart {
+  public:
+    // One move: the length of the cube, and the stacks it moves between.
+    struct Move {
+      uint8_t cube;
+      uint8_t from;
+      uint8_t to;
+    };
+
+    // The largest plan that plan() will make, in moves. (At 3 bytes per
+    // move, that's 768 MB.)
+    static const uint64_t MAX_PLAN_MOVES = uint64_t(1) << 28;
+
+    // Fill in the table for games of up to `maxCubes` cubes (at most 64)
+    // and up to `maxPegs` pegs (from 3 to 32).
+    FrameStewart(unsigned maxCubes, unsigned maxPegs);
+
+    // The fewest moves for `cubes` cubes on `pegs` pegs (the largest
+    // possible uint64_t if that doesn't fit), and the k that gets it:
+    uint64_t moveCount(unsigned cubes, unsigned pegs) const;
+    unsigned split(unsigned cubes, unsigned pegs) const;
+
+    // The moves that take `cubes` cubes from stack 0 to the last stack,
+    // planned with up to `threads` threads.
+    std::vector<Move> plan(unsigned cubes, unsigned pegs, unsigned threads = 1) const;
+
+    // Plan, and then play the moves on `game`, without printing. All of the
+    // cubes have to be on the game's stack 0.
+    void solve(CompactGame & game, unsigned threads = 1) const;
+
+  private:
+    unsigned maxCubes_;
+    unsigned maxPegs_;
+    // moves_[p][n] and split_[p][n], for p from 0 to maxPegs_ and n from 0
+    // to maxCubes_ (the rows for fewer than 2 pegs aren't used):
+    std::vector< std::vector<uint64_t> > moves_;
+    std::vector< std::vector<unsigned> > split_;
+
+    // Plan the moves of cubes base+1 to base+count (which are on top of
+    // each other, at the top of the `from` stack) to the `to` stack, using
+    // only the stacks whose bits are set in `allowed`. The moves are
+    // written to out[0 .. moveCount(count, p)-1], where p is the number of
+    // allowed stacks.
+    void _plan(unsigned base, unsigned count, unsigned from, unsigned to, uint32_t allowed,
+      Move * out, unsigned threads) const;
+
+    // Write moves first to last of the three-peg plan in `stream` to
+    // out[first-1 .. last-1], with its stacks 0, 1 and 2 renamed to
+    // `from`, `spare` and `to`, and its cubes numbered from base+1:
+    static void _planThreePegs(unsigned base, unsigned from, unsigned spare, unsigned to,
+      const MoveStream & stream, uint64_t first, uint64_t last, Move * out);
+
+    void _checkSize(unsigned cubes, unsigned pegs) const;
+};
@@ -1,5 +1,6 @@
 #include "Game.h"
 #include "Stack.h"
+#include "MoveStream.h"
 #include "uiuc/Cube.h"
 #include "uiuc/HSLAPixel.h"
 
@@ -72,6 +73,17 @@ void Game::solve() {
   );
 }
 
+void Game::solveWithMoveStream(unsigned threads) {
+  MoveStream moves(stacks_[0].size(), threads);
+
+  // Apply each chunk of moves as soon as it has been computed:
+  moves.stream([this](const MoveStream::Move * chunk, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+      _moveCube( stacks_[MoveStream::from(chunk[i])], stacks_[MoveStream::to(chunk[i])] );
+    }
+  });
+}
+
 std::ostream& operator<<(std::ostream & os, const Game & game) {
   for (unsigned i = 0; i < game.stacks_.size(); i++) {
     os << "Stack[" << i << ", " << &game.stacks_[i] << "]: " << game.stacks_[i] << endl;
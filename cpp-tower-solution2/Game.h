@@ -15,6 +15,10 @@ class Game {
     Game();
     void solve();
 
+    // Solve the game with the moves from a MoveStream (see MoveStream.h),
+    // without recursion or printing. Only the final state is changed.
+    void solveWithMoveStream(unsigned threads = 1);
+
     // An overloaded operator<<, allowing us to print the stack via `cout<<`:
     friend std::ostream& operator<<(std::ostream & os, const Game & game);
 
@@ -0,0 +1,167 @@
+/**
+ * Solving the Tower of Hanoi by arithmetic, without recursion.
+ *
+ * The recursive Game::_move has to work through the whole plan to get to
+ * any one move, and it copies cubes and prints the game after each move.
+ * But the optimal solution has a simple pattern: when the moves are
+ * numbered m = 1, 2, ..., 2^n - 1, move m is the same as the bit that
+ * changes between m-1 and m in a binary (Gray code) counter:
+ *
+ *   disk = the number of trailing 0 bits of m   (0 is the smallest disk)
+ *   from = (m & (m - 1)) % 3
+ *   to   = ((m | (m - 1)) + 1) % 3
+ *
+ * This moves the tower from peg 0 to peg 2 when n is odd, and to peg 1 when
+ * n is even, so for even n we swap the names of pegs 1 and 2. Each move only
+ * needs m, so the moves can be computed in any order, and different threads
+ * can compute different parts of the solution at the same time.
+ *
+ * Each move is packed into 16 bits: the disk in bits 0-5 (so up to 64
+ * disks), "from" in bits 6-7, and "to" in bits 8-9.
+ *
+ * For 64 disks, there are 2^64 - 1 moves, which is the largest number that
+ * fits in a uint64_t, so the move numbers still fit. (Computing all of them
+ * would take centuries, though.)
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+class MoveStream {
+  public:
+    typedef uint16_t Move;
+
+    static unsigned disk(Move move) { return move & 63; }
+    static unsigned from(Move move) { return (move >> 6) & 3; }
+    static unsigned to(Move move) { return (move >> 8) & 3; }
+
+    // A solution for `disks` disks (1 to 64), moving them from peg 0 to
+    // peg 2, that uses up to `threads` threads to compute the moves.
+    MoveStream(unsigned disks, unsigned threads = 1) : disks_(disks), threads_(threads) {
+      if (disks < 1 || disks > 64) {
+        throw std::runtime_error("MoveStream: the number of disks must be from 1 to 64.");
+      }
+      if (threads_ < 1) { threads_ = 1; }
+      peg_[0] = 0;
+      peg_[1] = (disks % 2 == 0) ? 2 : 1;
+      peg_[2] = (disks % 2 == 0) ? 1 : 2;
+    }
+
+    unsigned disks() const { return disks_; }
+
+    // The number of moves, 2^n - 1:
+    uint64_t size() const { return ~uint64_t(0) >> (64 - disks_); }
+
+    // Move number m, from 1 to size():
+    Move moveAt(uint64_t m) const {
+      const unsigned disk = _trailingZeros(m);
+      const unsigned from = (m & (m - 1)) % 3;
+      // We don't need a second remainder for "to": the two numbers in the
+      // formula differ by 2^(disk+1), so "to" is 2 pegs further along when
+      // the disk is even, and 1 peg when it's odd. (This also avoids
+      // computing (m | (m - 1)) + 1, which would overflow for 64 disks.)
+      unsigned to = from + 2 - (disk & 1);
+      if (to >= 3) { to -= 3; }
+      return Move(disk | (peg_[from] << 6) | (peg_[to] << 8));
+    }
+
+    // Write moves first, first + 1, ..., first + count - 1 to out[0 .. count-1].
+    // The range is split into one piece per thread.
+    void generate(uint64_t first, std::size_t count, Move * out) const {
+      forEachRange(first, count, [this, first, out](uint64_t begin, uint64_t n) {
+        _generate(begin, std::size_t(n), out + (begin - first));
+      });
+    }
+
+    // Split moves first, first + 1, ..., first + count - 1 into one piece per
+    // thread, and call fn(first move of the piece, number of moves) once for
+    // each piece, each on its own thread. The calling thread does the first
+    // piece itself. Returns when all of the pieces are done.
+    //   Since each move only depends on its number, this is all that any
+    // code that computes a lot of moves needs to do to use several threads.
+    template <typename Fn>
+    void forEachRange(uint64_t first, uint64_t count, Fn fn) const {
+      // Starting a thread takes tens of microseconds, so each thread should
+      // get at least this many moves:
+      const uint64_t MIN_MOVES_PER_THREAD = 1 << 16;
+      uint64_t threads = threads_;
+      if (count / threads < MIN_MOVES_PER_THREAD) {
+        threads = count / MIN_MOVES_PER_THREAD;
+        if (threads < 1) { threads = 1; }
+      }
+
+      std::vector<std::thread> workers;
+      const uint64_t piece = count / threads;
+      try {
+        for (uint64_t t = 1; t < threads; t++) {
+          const uint64_t begin = t * piece;
+          const uint64_t end = (t + 1 == threads) ? count : begin + piece;
+          workers.push_back(std::thread([&fn, first, begin, end]() { fn(first + begin, end - begin); }));
+        }
+        // The calling thread does the first piece itself.
+        fn(first, (threads == 1) ? count : piece);
+      }
+      catch (...) {
+        // Destroying a std::thread that hasn't been joined calls
+        // std::terminate, so we wait for the others before passing this on.
+        for (std::thread & worker : workers) {
+          worker.join();
+        }
+        throw;
+      }
+      for (std::thread & worker : workers) {
+        worker.join();
+      }
+    }
+
+    // Compute `count` moves starting at move `first`, in order, a chunk at a
+    // time, and call sink(moves, number of moves) with each chunk. The
+    // buffer is reused for the next chunk, so the sink has to copy anything
+    // that it wants to keep.
+    template <typename Sink>
+    void stream(uint64_t first, uint64_t count, Sink && sink, std::size_t chunkSize = 1 << 20) const {
+      std::vector<Move> buffer(chunkSize);
+      while (count > 0) {
+        const std::size_t n = (count < chunkSize) ? std::size_t(count) : chunkSize;
+        generate(first, n, buffer.data());
+        sink(buffer.data(), n);
+        first += n;
+        count -= n;
+      }
+    }
+
+    // The whole solution:
+    template <typename Sink>
+    void stream(Sink && sink, std::size_t chunkSize = 1 << 20) const {
+      stream(1, size(), sink, chunkSize);
+    }
+
+  private:
+    unsigned disks_;
+    unsigned threads_;
+    unsigned peg_[3];
+
+    void _generate(uint64_t first, std::size_t count, Move * out) const {
+      for (std::size_t i = 0; i < count; i++) {
+        out[i] = moveAt(first + i);
+      }
+    }
+
+    static unsigned _trailingZeros(uint64_t m) {
+#if defined(__GNUC__)
+      return __builtin_ctzll(m);
+#else
+      unsigned zeros = 0;
+      while ((m & 1) == 0) {
+        m >>= 1;
+        zeros++;
+      }
+      return zeros;
+#endif
+    }
+};
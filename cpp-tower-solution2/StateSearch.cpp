@@ -0,0 +1,230 @@
+/**
+ * Breadth-first search over every state of a three-peg Tower of Hanoi game.
+ */
+
+#include "StateSearch.h"
+#include "CompactGame.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+const unsigned StateSearch::MAX_CUBES;
+
+// How many frontier states a thread takes at a time:
+static const std::size_t BATCH_SIZE = 1024;
+// Levels smaller than this are expanded on one thread:
+static const std::size_t MIN_PARALLEL_FRONTIER = 2 * BATCH_SIZE;
+
+StateSearch::StateSearch(unsigned cubes, unsigned threads) : cubes_(cubes), threads_(threads) {
+  if (cubes < 1 || cubes > MAX_CUBES) {
+    throw std::runtime_error("StateSearch: the number of cubes must be from 1 to 20.");
+  }
+  if (threads_ < 1) { threads_ = 1; }
+
+  pow3_.push_back(1);
+  for (unsigned i = 1; i <= cubes; i++) {
+    pow3_.push_back(pow3_.back() * 3);
+  }
+}
+
+StateSearch::State StateSearch::encode(const std::vector<unsigned> & pegs) const {
+  if (pegs.size() != cubes_) {
+    throw std::runtime_error("StateSearch::encode: there must be one stack number per cube.");
+  }
+  State state = 0;
+  for (unsigned i = 0; i < cubes_; i++) {
+    if (pegs[i] > 2) {
+      throw std::runtime_error("StateSearch::encode: the stack numbers must be 0, 1 or 2.");
+    }
+    state += pegs[i] * pow3_[i];
+  }
+  return state;
+}
+
+std::vector<unsigned> StateSearch::decode(State state) const {
+  std::vector<unsigned> pegs(cubes_);
+  for (unsigned i = 0; i < cubes_; i++) {
+    pegs[i] = state % 3;
+    state /= 3;
+  }
+  return pegs;
+}
+
+StateSearch::State StateSearch::encode(const CompactGame & game) const {
+  if (game.pegs() != 3) {
+    throw std::runtime_error("StateSearch::encode: the game must have three stacks.");
+  }
+  std::vector<unsigned> pegs(cubes_, 3);
+  for (unsigned stack = 0; stack < 3; stack++) {
+    const uint64_t bits = game.getStack(stack).bits();
+    if ((bits >> cubes_) != 0) {
+      throw std::runtime_error("StateSearch::encode: the game has a cube that is too large.");
+    }
+    for (unsigned i = 0; i < cubes_; i++) {
+      if ((bits >> i) & 1) {
+        pegs[i] = stack;
+      }
+    }
+  }
+  // (encode() throws if any cube is missing, since its stack is still 3.)
+  return encode(pegs);
+}
+
+void StateSearch::_expand(const std::vector<uint32_t> & frontier, std::atomic<std::size_t> & nextBatch,
+  std::vector<uint32_t> & next, uint32_t goal, std::atomic<bool> & found) {
+
+  const uint64_t * pow3 = pow3_.data();
+  for (;;) {
+    const std::size_t begin = nextBatch.fetch_add(BATCH_SIZE);
+    if (begin >= frontier.size()) {
+      return;
+    }
+    const std::size_t end = std::min(begin + BATCH_SIZE, frontier.size());
+
+    for (std::size_t f = begin; f < end; f++) {
+      const uint32_t state = frontier[f];
+
+      // Find the top (smallest) cube on each stack, by looking at the
+      // cubes from the smallest up until we've seen all three stacks.
+      // `cubes_` stands for "empty".
+      unsigned top[3] = { cubes_, cubes_, cubes_ };
+      unsigned seen = 0;
+      uint32_t digits = state;
+      for (unsigned i = 0; i < cubes_ && seen < 3; i++) {
+        const unsigned stack = digits % 3;
+        digits /= 3;
+        if (top[stack] == cubes_) {
+          top[stack] = i;
+          seen++;
+        }
+      }
+
+      // A cube can move from stack a to stack b if it's smaller than the
+      // top of b. Moving cube i from a to b changes digit i from a to b.
+      for (unsigned a = 0; a < 3; a++) {
+        if (top[a] == cubes_) continue;
+        for (unsigned b = 0; b < 3; b++) {
+          if (b == a || top[b] < top[a]) continue;
+          const uint32_t neighbor = uint32_t(state + (int64_t(b) - int64_t(a)) * int64_t(pow3[top[a]]));
+          if (_visit(neighbor)) {
+            next.push_back(neighbor);
+            if (neighbor == goal) {
+              found = true;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+StateSearch::Result StateSearch::search(State start, State goal) {
+  if (start >= stateCount() || goal >= stateCount()) {
+    throw std::runtime_error("StateSearch::search: not a state of this game.");
+  }
+
+  const auto startTime = std::chrono::steady_clock::now();
+  Result result = { false, 0, 0, 0, 0, 0.0 };
+
+  // A fresh bit array, with every bit 0 (not visited):
+  const std::size_t words = std::size_t((stateCount() + 63) / 64);
+  visited_ = std::vector< std::atomic<uint64_t> >(words);
+  const std::size_t visitedBytes = words * sizeof(uint64_t);
+
+  std::vector<uint32_t> frontier(1, uint32_t(start));
+  std::vector< std::vector<uint32_t> > next(threads_);
+  _visit(uint32_t(start));
+  std::atomic<bool> found(start == goal);
+  std::atomic<std::size_t> nextBatch(0);
+
+  // There are about 2^n levels, so instead of starting new threads for
+  // each one, the extra threads wait until the next large level is ready,
+  // work on it, and then report that they're done. `level` counts the
+  // levels that have been handed out, and `working` counts the threads
+  // that haven't finished the current one yet.
+  std::mutex mutex;
+  std::condition_variable ready, finished;
+  uint64_t level = 0;
+  unsigned working = 0;
+  bool stop = false;
+
+  std::vector<std::thread> workers;
+  for (unsigned t = 1; t < threads_; t++) {
+    workers.push_back(std::thread([&, t]() {
+      uint64_t done = 0;
+      for (;;) {
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          ready.wait(lock, [&]() { return stop || level != done; });
+          if (stop) return;
+          done = level;
+        }
+        _expand(frontier, nextBatch, next[t], uint32_t(goal), found);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--working == 0) {
+          finished.notify_one();
+        }
+      }
+    }));
+  }
+
+  while (!found && !frontier.empty()) {
+    nextBatch = 0;
+    if (workers.empty() || frontier.size() < MIN_PARALLEL_FRONTIER) {
+      _expand(frontier, nextBatch, next[0], uint32_t(goal), found);
+    }
+    else {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        working = workers.size();
+        level++;
+      }
+      ready.notify_all();
+      _expand(frontier, nextBatch, next[0], uint32_t(goal), found);
+      std::unique_lock<std::mutex> lock(mutex);
+      finished.wait(lock, [&]() { return working == 0; });
+    }
+
+    result.statesExpanded += frontier.size();
+    result.levels++;
+
+    // Memory for the bit array, this level, and the next one:
+    std::size_t bytes = visitedBytes + frontier.capacity() * sizeof(uint32_t);
+    for (const std::vector<uint32_t> & part : next) {
+      bytes += part.capacity() * sizeof(uint32_t);
+    }
+    result.peakBytes = std::max(result.peakBytes, bytes);
+
+    // The next level becomes the frontier. The first thread's part is
+    // swapped in, so that it doesn't have to be copied, and the other
+    // parts (if any) are added to the end.
+    frontier.swap(next[0]);
+    next[0].clear();
+    for (std::size_t t = 1; t < next.size(); t++) {
+      frontier.insert(frontier.end(), next[t].begin(), next[t].end());
+      next[t].clear();
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+  }
+  ready.notify_all();
+  for (std::thread & worker : workers) {
+    worker.join();
+  }
+
+  result.found = found;
+  result.distance = result.levels;
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+  result.seconds = elapsed.count();
+
+  // Give back the memory of the bit array.
+  std::vector< std::atomic<uint64_t> >().swap(visited_);
+  return result;
+}
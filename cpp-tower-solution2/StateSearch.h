@@ -0,0 +1,110 @@
+/**
+ * Breadth-first search over every state of a three-peg Tower of Hanoi game.
+ *
+ * The recursive Game::_move only knows one job: moving a whole tower from
+ * one stack to another. This class can find the fewest moves between *any*
+ * two states of the game, such as from a half-finished game to some other
+ * arrangement, by searching through the states themselves.
+ *
+ * Encoding the states:
+ *   In any state, each cube is on one of the three stacks, and the order of
+ * the cubes on a stack is always the same (larger below smaller), so a state
+ * is just a list of which stack each cube is on. We write that as a number
+ * in base 3, where digit i is the stack of the cube of length i+1:
+ *
+ *   state = stack(cube 1) + 3 * stack(cube 2) + 9 * stack(cube 3) + ...
+ *
+ * So the states of an n-cube game are exactly the numbers from 0 to 3^n - 1,
+ * and we can keep track of which ones we've seen with an array of 3^n bits.
+ * (For 20 cubes that's 3,486,784,401 bits, or 436 MB, which is the most we
+ * allow. It also means that a state fits in a uint32_t.)
+ *
+ * The search:
+ *   We search one "level" at a time: first the states one move from the
+ * start, then the states two moves from it, and so on, until we find the
+ * goal. The states in the current level are called the frontier. To make
+ * the next level, we look at the (two or three) moves from each frontier
+ * state, and keep the states that we haven't seen before.
+ *   When the frontier is large, several threads work on it at once. They
+ * take "batches" of frontier states, a thousand at a time, from a shared
+ * counter, so a thread that finishes early just takes another batch. Each
+ * thread collects the next level in its own vector, and marks the states
+ * that it has seen in the shared bit array with an atomic "or", so that two
+ * threads that reach the same state at once can't both keep it. All of the
+ * threads finish a level before any of them starts the next one.
+ *   The levels of a Tower of Hanoi game are small and there are many of
+ * them: the 3^n states are spread out over about 2^n levels, so for 20
+ * cubes, a level has about 3,300 states on average. That's why the threads
+ * are started once per search and wait for each level, instead of being
+ * started for each level, and why a level of just one or two batches is
+ * done by one thread alone.
+ */
+
+#pragma once
+
+#include "CompactGame.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class StateSearch {
+  public:
+    typedef uint64_t State;
+
+    static const unsigned MAX_CUBES = 20;
+
+    // The results of a search:
+    struct Result {
+      bool found;                //< Whether the goal was reached (it always is)
+      uint64_t distance;         //< The fewest moves from the start to the goal
+      uint64_t statesExpanded;   //< How many states we looked at the moves from
+      uint64_t levels;           //< How many levels we searched
+      std::size_t peakBytes;     //< The most memory in use at once
+      double seconds;            //< How long it took
+    };
+
+    // A search engine for games of `cubes` cubes (1 to 20), which uses up
+    // to `threads` threads.
+    StateSearch(unsigned cubes, unsigned threads = 1);
+
+    // Convert between states and lists of stack numbers, where pegs[i] is
+    // the stack (0, 1 or 2) of the cube of length i+1:
+    State encode(const std::vector<unsigned> & pegs) const;
+    std::vector<unsigned> decode(State state) const;
+    // The state of a three-stack CompactGame that has cubes 1 to n:
+    State encode(const CompactGame & game) const;
+
+    // The number of states, 3^n:
+    uint64_t stateCount() const { return pow3_[cubes_]; }
+
+    // Find the fewest moves from `start` to `goal`.
+    Result search(State start, State goal);
+
+  private:
+    unsigned cubes_;
+    unsigned threads_;
+    // pow3_[i] is 3^i:
+    std::vector<uint64_t> pow3_;
+    // One bit per state, set once the search has reached it:
+    std::vector< std::atomic<uint64_t> > visited_;
+
+    // Mark the state as visited, and return true if it wasn't already.
+    bool _visit(uint32_t state) {
+      std::atomic<uint64_t> & word = visited_[state >> 6];
+      const uint64_t bit = uint64_t(1) << (state & 63);
+      // Most states that we reach have been seen before, so we check with
+      // a plain read first, which is cheaper than the atomic "or".
+      if (word.load(std::memory_order_relaxed) & bit) {
+        return false;
+      }
+      return (word.fetch_or(bit, std::memory_order_relaxed) & bit) == 0;
+    }
+
+    // Expand batches of frontier states, taking each batch from
+    // `nextBatch`, and add the new states to `next`. Sets `found` if it
+    // reaches the goal.
+    void _expand(const std::vector<uint32_t> & frontier, std::atomic<std::size_t> & nextBatch,
+      std::vector<uint32_t> & next, uint32_t goal, std::atomic<bool> & found);
+};
@@ -0,0 +1,243 @@
+/**
+ * Tower of Hanoi benchmarks:
+ * - move generation with the recursive plan (like Game::_move, but writing
+ *   the moves to a buffer instead of moving cubes and printing) vs. the
+ *   arithmetic MoveStream, with 1, 2, 4, ... threads
+ * - Game (a vector of Cubes per stack) vs. CompactGame (a bitmask per
+ *   stack), for the printed 4-cube game and for making moves only
+ * - Frame-Stewart planning with 1, 2, 4, ... threads and then playing the
+ *   plan, vs. CompactGame's recursive solve, and games with more pegs
+ * - StateSearch, a breadth-first search from one whole tower to another,
+ *   for 16 cubes up to the most cubes given (18 by default, at most 20)
+ *
+ * Build and run with:
+ *   make bench
+ *   ./bench [number of disks] [most threads to try] [most cubes to search]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "CompactGame.h"
+#include "CompactStack.h"
+#include "FrameStewart.h"
+#include "Game.h"
+#include "MoveStream.h"
+#include "Stack.h"
+#include "StateSearch.h"
+#include "uiuc/Cube.h"
+#include "uiuc/HSLAPixel.h"
+
+// Seconds elapsed since "start", as a double.
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// Adds up every move it's given, so the compiler can't skip computing them.
+class ChecksumSink {
+  public:
+    ChecksumSink() : sum(0) { }
+    void operator()(const MoveStream::Move * moves, std::size_t count) {
+      for (std::size_t i = 0; i < count; i++) {
+        sum += moves[i];
+      }
+    }
+    uint64_t sum;
+};
+
+// The recursive plan, writing moves in the same format as MoveStream, and
+// handing them to the sink a chunk at a time.
+class RecursivePlanner {
+  public:
+    RecursivePlanner(ChecksumSink & sink) : sink_(sink), buffer_(1 << 20), used_(0) { }
+
+    void solve(unsigned disks) {
+      _move(disks - 1, 0, 2, 1);
+      sink_(buffer_.data(), used_);
+      used_ = 0;
+    }
+
+  private:
+    ChecksumSink & sink_;
+    std::vector<MoveStream::Move> buffer_;
+    std::size_t used_;
+
+    // Move disks 0 to `largest` from `source` to `target`:
+    void _move(unsigned largest, unsigned source, unsigned target, unsigned spare) {
+      if (largest > 0) { _move(largest - 1, source, spare, target); }
+      buffer_[used_++] = MoveStream::Move(largest | (source << 6) | (target << 8));
+      if (used_ == buffer_.size()) {
+        sink_(buffer_.data(), used_);
+        used_ = 0;
+      }
+      if (largest > 0) { _move(largest - 1, spare, target, source); }
+    }
+};
+
+// Solve the printed 4-cube game many times, with std::cout sent to a
+// string that we throw away, and report the time per game.
+template <typename GameType>
+void runPrintedGameBenchmark(const char* label) {
+  const int GAMES = 20000;
+  std::ostringstream discard;
+  std::streambuf * original = std::cout.rdbuf(discard.rdbuf());
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < GAMES; i++) {
+    GameType game;
+    game.solve();
+    discard.str("");
+  }
+  const double elapsed = secondsSince(start);
+  std::cout.rdbuf(original);
+  std::cout << label << (elapsed * 1e6 / GAMES) << " us/game" << std::endl;
+}
+
+// Make every move of the solution for `cubes` cubes on three Stacks, and
+// then on three CompactStacks, and report the time per move. The moves come
+// from a MoveStream, so that both only pay for the moves themselves.
+void runMoveBenchmark(unsigned cubes) {
+  MoveStream moves(cubes);
+  std::vector<MoveStream::Move> plan(moves.size());
+  moves.generate(1, plan.size(), plan.data());
+
+  std::vector<Stack> stacks(3);
+  for (unsigned length = cubes; length >= 1; length--) {
+    stacks[0].push_back(Cube(length, uiuc::HSLAPixel::BLUE));
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (const MoveStream::Move & move : plan) {
+    Stack & target = stacks[MoveStream::to(move)];
+    target.push_back(stacks[MoveStream::from(move)].removeTop());
+  }
+  const double stack_time = secondsSince(start);
+
+  std::vector<CompactStack> compact(3);
+  for (unsigned length = cubes; length >= 1; length--) {
+    compact[0].push_back(length);
+  }
+  unsigned illegal = 0;
+  start = std::chrono::steady_clock::now();
+  for (const MoveStream::Move & move : plan) {
+    illegal += !compact[MoveStream::from(move)].moveTopTo(compact[MoveStream::to(move)]);
+  }
+  const double compact_time = secondsSince(start);
+
+  std::cout << "Stack (" << sizeof(Cube) << "-byte Cubes): " << (stack_time * 1e9 / plan.size()) << " ns/move" << std::endl;
+  std::cout << "CompactStack         : " << (compact_time * 1e9 / plan.size()) << " ns/move"
+    << "  (" << stacks[2].size() << " and " << compact[2].size() << " cubes moved, "
+    << illegal << " illegal)" << std::endl;
+}
+
+// Solve a 3-peg game of `cubes` cubes by planning it with Frame-Stewart
+// and then playing the plan, with more and more threads for the planning,
+// and compare with CompactGame's recursive solve. Then show the move counts
+// and times for 64 cubes with more pegs.
+void runFrameStewartBenchmark(unsigned cubes, unsigned maxThreads) {
+  auto start = std::chrono::steady_clock::now();
+  FrameStewart planner(64, 32);
+  std::cout << "table for up to 64 cubes and 32 pegs: " << (secondsSince(start) * 1e3) << " ms" << std::endl;
+
+  const double moves = double(planner.moveCount(cubes, 3));
+  {
+    CompactGame game(cubes);
+    start = std::chrono::steady_clock::now();
+    game.solve(false);
+    const double elapsed = secondsSince(start);
+    std::cout << "CompactGame::solve, " << cubes << " cubes         : "
+      << (moves / elapsed / 1e6) << " million moves/sec" << std::endl;
+  }
+
+  for (unsigned threads = 1; ; threads *= 2) {
+    threads = std::min(threads, maxThreads);
+    start = std::chrono::steady_clock::now();
+    const std::vector<FrameStewart::Move> plan = planner.plan(cubes, 3, threads);
+    const double plan_time = secondsSince(start);
+
+    CompactGame game(cubes);
+    start = std::chrono::steady_clock::now();
+    for (const FrameStewart::Move & move : plan) {
+      game.moveCube(move.from, move.to);
+    }
+    const double play_time = secondsSince(start);
+    std::cout << "plan with " << threads << " thread" << (threads == 1 ? ", " : "s,") << " then play   : "
+      << (moves / (plan_time + play_time) / 1e6) << " million moves/sec"
+      << "  (planning " << (plan_time * 1e3) << " ms, playing " << (play_time * 1e3) << " ms)" << std::endl;
+    if (threads == maxThreads) break;
+  }
+
+  for (unsigned pegs = 4; pegs <= 8; pegs++) {
+    CompactGame game(64, pegs);
+    start = std::chrono::steady_clock::now();
+    planner.solve(game);
+    std::cout << "64 cubes, " << pegs << " pegs: " << planner.moveCount(64, pegs) << " moves in "
+      << (secondsSince(start) * 1e6) << " us" << std::endl;
+  }
+}
+
+void runStateSearchBenchmark(unsigned maxCubes, unsigned maxThreads) {
+  for (unsigned cubes = 16; cubes <= maxCubes; cubes++) {
+    for (unsigned threads = 1; ; threads *= 2) {
+      threads = std::min(threads, maxThreads);
+      StateSearch search(cubes, threads);
+      const StateSearch::Result result = search.search(0, search.stateCount() - 1);
+      std::cout << cubes << " cubes, " << threads << " thread" << (threads == 1 ? ", " : "s,") << " "
+        << result.levels << " levels, distance " << result.distance << ": "
+        << (result.statesExpanded / result.seconds / 1e6) << " million states/sec, "
+        << (result.peakBytes / 1e6) << " MB peak, " << result.seconds << " s" << std::endl;
+      if (threads == maxThreads) break;
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+  const unsigned disks = (argc > 1) ? std::atoi(argv[1]) : 28;
+
+  const double moves = double(MoveStream(disks).size());
+  std::cout << "Tower of Hanoi move generation, " << disks << " disks, " << moves << " moves, "
+    << sizeof(MoveStream::Move) << " bytes per move" << std::endl;
+
+  {
+    ChecksumSink sink;
+    RecursivePlanner planner(sink);
+    auto start = std::chrono::steady_clock::now();
+    planner.solve(disks);
+    const double elapsed = secondsSince(start);
+    std::cout << "recursive            : " << (moves / elapsed / 1e6) << " million moves/sec"
+      << "  (checksum " << sink.sum << ")" << std::endl;
+  }
+
+  const unsigned hardware = (argc > 2) ? std::atoi(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned threads = 1; ; threads *= 2) {
+    threads = std::min(threads, hardware);
+    ChecksumSink sink;
+    MoveStream stream(disks, threads);
+    auto start = std::chrono::steady_clock::now();
+    stream.stream(sink);
+    const double elapsed = secondsSince(start);
+    std::cout << "MoveStream, " << threads << " thread" << (threads == 1 ? " " : "s") << "   : "
+      << (moves / elapsed / 1e6) << " million moves/sec"
+      << "  (checksum " << sink.sum << ")" << std::endl;
+    if (threads == hardware) break;
+  }
+
+  std::cout << "\nThe printed 4-cube game" << std::endl;
+  runPrintedGameBenchmark<Game>("Game       : ");
+  runPrintedGameBenchmark<CompactGame>("CompactGame: ");
+
+  std::cout << "\nMaking the moves for 20 cubes, without printing" << std::endl;
+  runMoveBenchmark(20);
+
+  std::cout << "\nFrame-Stewart planning" << std::endl;
+  runFrameStewartBenchmark(24, hardware);
+
+  std::cout << "\nBreadth-first search over the states of the game" << std::endl;
+  runStateSearchBenchmark((argc > 3) ? std::atoi(argv[3]) : 18, hardware);
+
+  return 0;
+}
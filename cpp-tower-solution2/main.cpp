@@ -1,12 +1,97 @@
 /**
  * Simple main to create and solve a game of the Tower of Hanoi puzzle.
- * 
+ *
  * @author
  *   Wade Fagen-Ulmschneider <waf@illinois.edu>
  */
 
 #include "Game.h"
+#include "CompactGame.h"
+#include "FrameStewart.h"
+#include "MoveStream.h"
+#include "StateSearch.h"
 #include <iostream>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+// Play every move of a MoveStream on three pegs of disk numbers, checking
+// that each one is legal, and that all of the disks end up on peg 2.
+void checkMoveStream(unsigned disks, unsigned threads, std::size_t chunkSize) {
+  std::vector<unsigned> pegs[3];
+  for (unsigned d = disks; d > 0; d--) {
+    pegs[0].push_back(d - 1);
+  }
+
+  uint64_t moveCount = 0;
+  MoveStream moves(disks, threads);
+  moves.stream([&](const MoveStream::Move * chunk, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+      std::vector<unsigned> & from = pegs[MoveStream::from(chunk[i])];
+      std::vector<unsigned> & to = pegs[MoveStream::to(chunk[i])];
+      if (from.empty() || from.back() != MoveStream::disk(chunk[i])) {
+        throw std::runtime_error("MoveStream moved a disk that isn't on top of its peg.");
+      }
+      if (!to.empty() && to.back() < from.back()) {
+        throw std::runtime_error("MoveStream put a larger disk on a smaller one.");
+      }
+      to.push_back(from.back());
+      from.pop_back();
+    }
+    moveCount += count;
+  }, chunkSize);
+
+  if (moveCount != moves.size() || pegs[2].size() != disks) {
+    throw std::runtime_error("MoveStream didn't move the whole tower to peg 2.");
+  }
+}
+
+// Run game.solve() and return everything that it printed, with the memory
+// addresses of the stacks replaced by "@", since those are different for
+// every game.
+template <typename GameType>
+std::string solveAndCapture(GameType & game) {
+  std::ostringstream captured;
+  std::streambuf * original = std::cout.rdbuf(captured.rdbuf());
+  game.solve();
+  std::cout.rdbuf(original);
+  return std::regex_replace(captured.str(), std::regex("0x[0-9a-f]+"), "@");
+}
+
+// The fewest moves to gather the smallest `count` cubes of a three-stack
+// state onto stack `target`, where pegs[i] is the stack of cube i+1. The
+// largest cube that isn't on `target` has to move there, so the smaller ones
+// have to go to the third stack first, and then come back on top of it.
+uint64_t movesToTower(const std::vector<unsigned> & pegs, unsigned count, unsigned target) {
+  uint64_t moves = 0;
+  for (unsigned i = count; i-- > 0; ) {
+    if (pegs[i] != target) {
+      moves += uint64_t(1) << i;
+      target = 3 - pegs[i] - target;
+    }
+  }
+  return moves;
+}
+
+// The fewest moves between two states, worked out without searching: the
+// largest cube that differs either moves once, through the third stack, or
+// twice, by way of the third stack, and the smaller cubes make way for it.
+uint64_t movesBetween(const std::vector<unsigned> & start, const std::vector<unsigned> & goal) {
+  unsigned d = start.size();
+  while (d > 0 && start[d - 1] == goal[d - 1]) {
+    d--;
+  }
+  if (d == 0) {
+    return 0;
+  }
+  d--;
+  const unsigned a = start[d], b = goal[d], c = 3 - a - b;
+  const uint64_t once = movesToTower(start, d, c) + 1 + movesToTower(goal, d, c);
+  const uint64_t twice = movesToTower(start, d, b) + 1 + ((uint64_t(1) << d) - 1) + 1 + movesToTower(goal, d, a);
+  return (once < twice) ? once : twice;
+}
 
 int main() {
   Game g;
@@ -19,5 +104,134 @@ int main() {
   std::cout << "Final game state: " << std::endl;
   std::cout << g << std::endl;
 
+  // The same game, solved with the arithmetic MoveStream:
+  Game g2;
+  g2.solveWithMoveStream();
+  std::cout << "Final game state (MoveStream): " << std::endl;
+  std::cout << g2 << std::endl;
+
+  for (unsigned disks = 1; disks <= 18; disks++) {
+    checkMoveStream(disks, 1, 1000);
+  }
+  // (The chunks have to be large for the threads to be used.)
+  checkMoveStream(20, 4, 1 << 20);
+
+  // For 64 disks, the middle move is the only move of the largest disk,
+  // and the last move is the smallest disk arriving on peg 2:
+  MoveStream big(64);
+  MoveStream::Move middle = big.moveAt(uint64_t(1) << 63);
+  MoveStream::Move last = big.moveAt(big.size());
+  if (big.size() != ~uint64_t(0) ||
+      MoveStream::disk(middle) != 63 || MoveStream::from(middle) != 0 || MoveStream::to(middle) != 2 ||
+      MoveStream::disk(last) != 0 || MoveStream::to(last) != 2) {
+    throw std::runtime_error("MoveStream is wrong for 64 disks.");
+  }
+  std::cout << "MoveStream checks OK" << std::endl;
+
+  // A CompactGame prints exactly the same plan and game states as a Game:
+  Game g3;
+  CompactGame compact;
+  if (solveAndCapture(g3) != solveAndCapture(compact)) {
+    throw std::runtime_error("CompactGame printed something different from Game.");
+  }
+  CompactGame compact20(20);
+  compact20.solve(false);
+  if (compact20.getStack(2).size() != 20 || compact20.getStack(2).peekTop() != 1 ||
+      compact20.getStack(0).size() + compact20.getStack(1).size() != 0) {
+    throw std::runtime_error("CompactGame didn't solve the 20 cube game.");
+  }
+  CompactStack small;
+  small.push_back(2);
+  try {
+    small.push_back(3);
+    throw std::logic_error("CompactStack allowed a larger cube on a smaller one.");
+  } catch (const std::runtime_error &) {
+    // (The message from CompactStack::push_back has been printed to std::cerr.)
+  }
+  std::cout << "CompactGame checks OK" << std::endl;
+
+  // Frame-Stewart: with 3 pegs, the plan is the usual 2^n - 1 moves, and
+  // with 4 pegs, the move counts are a known sequence. We play the plans on
+  // CompactGames, which check that every move is legal.
+  FrameStewart planner(64, 8);
+  const uint64_t fourPegMoves[] = { 0, 1, 3, 5, 9, 13, 17, 25, 33, 41, 49, 65, 81, 97, 113, 129 };
+  for (unsigned cubes = 0; cubes <= 15; cubes++) {
+    if (planner.moveCount(cubes, 3) != (uint64_t(1) << cubes) - 1 ||
+        planner.moveCount(cubes, 4) != fourPegMoves[cubes]) {
+      throw std::runtime_error("FrameStewart has the wrong move count.");
+    }
+  }
+  for (unsigned pegs = 3; pegs <= 8; pegs++) {
+    for (unsigned cubes = 0; cubes <= ((pegs == 3) ? 12 : 24); cubes++) {
+      CompactGame game(cubes, pegs);
+      planner.solve(game);
+      if (game.getStack(pegs - 1).size() != cubes) {
+        throw std::runtime_error("FrameStewart didn't move the whole tower.");
+      }
+    }
+  }
+  // A plan made with several threads is the same as with one:
+  const std::vector<FrameStewart::Move> serial = planner.plan(20, 3, 1);
+  const std::vector<FrameStewart::Move> parallel = planner.plan(20, 3, 4);
+  for (std::size_t i = 0; i < serial.size(); i++) {
+    if (serial[i].cube != parallel[i].cube || serial[i].from != parallel[i].from || serial[i].to != parallel[i].to) {
+      throw std::runtime_error("FrameStewart made a different plan with threads.");
+    }
+  }
+  CompactGame fourPegs(64, 4);
+  planner.solve(fourPegs, 4);
+  std::cout << "64 cubes on 4 pegs: " << planner.moveCount(64, 4) << " moves" << std::endl;
+  std::cout << fourPegs;
+  std::cout << "FrameStewart checks OK" << std::endl;
+
+  // StateSearch: from a whole tower on stack 0 to a whole tower on stack 2
+  // takes the usual 2^n - 1 moves.
+  for (unsigned cubes = 1; cubes <= 10; cubes++) {
+    StateSearch search(cubes);
+    const StateSearch::Result result = search.search(0, search.stateCount() - 1);
+    if (!result.found || result.distance != (uint64_t(1) << cubes) - 1) {
+      throw std::runtime_error("StateSearch found the wrong distance between two towers.");
+    }
+  }
+  // Between any two states, it finds the same distance as movesBetween:
+  std::mt19937 random(2024);
+  for (unsigned cubes = 1; cubes <= 7; cubes++) {
+    StateSearch search(cubes);
+    for (unsigned trial = 0; trial < 50; trial++) {
+      const StateSearch::State start = random() % search.stateCount();
+      const StateSearch::State goal = random() % search.stateCount();
+      const std::vector<unsigned> startPegs = search.decode(start);
+      if (search.encode(startPegs) != start) {
+        throw std::runtime_error("StateSearch::decode and encode don't match.");
+      }
+      if (search.search(start, goal).distance != movesBetween(startPegs, search.decode(goal))) {
+        throw std::runtime_error("StateSearch found the wrong distance between two states.");
+      }
+    }
+  }
+  // A CompactGame halfway through: cubes 1 and 2 on stack 1, cube 3 on
+  // stack 2, and cube 4 still on stack 0.
+  CompactGame halfway;
+  halfway.moveCube(0, 2);
+  halfway.moveCube(0, 1);
+  halfway.moveCube(2, 1);
+  halfway.moveCube(0, 2);
+  StateSearch four(4);
+  if (four.encode(halfway) != four.encode({ 1, 1, 2, 0 }) ||
+      four.search(0, four.encode(halfway)).distance != 4) {
+    throw std::runtime_error("StateSearch got the wrong state for a CompactGame.");
+  }
+  // With several threads (12 cubes is the smallest game whose largest
+  // levels are big enough to be split up), the answer is the same:
+  StateSearch serialSearch(12, 1), parallelSearch(12, 4);
+  const StateSearch::State start = serialSearch.encode(std::vector<unsigned>(12, 1));
+  const StateSearch::Result serialResult = serialSearch.search(start, serialSearch.stateCount() - 1);
+  const StateSearch::Result parallelResult = parallelSearch.search(start, parallelSearch.stateCount() - 1);
+  if (serialResult.distance != 4095 || parallelResult.distance != 4095 ||
+      serialResult.statesExpanded != parallelResult.statesExpanded) {
+    throw std::runtime_error("StateSearch found a different answer with threads.");
+  }
+  std::cout << "StateSearch checks OK" << std::endl;
+
   return 0;
-}
\ No newline at end of file
+}
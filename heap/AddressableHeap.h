@@ -0,0 +1,99 @@
+/**
+ * An addressable heap: a Heap where each item has a handle, so that an item
+ * anywhere in the heap can have its key decreased, or be removed.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "Heap.h"
+
+// Algorithms like Dijkstra's shortest paths need to lower the priority of
+// an item that is already in the heap. A plain Heap can't do that, because
+// it has no way to find the item. The usual workaround is to insert a second
+// copy with the new priority, and skip the old copy when it comes out, but
+// then the heap fills up with stale copies.
+//   AddressableHeap fixes that. insert() returns a handle for the item, and
+// the heap keeps a table from each handle to the item's current index in the
+// array. Every time the Heap code moves an item, it tells its trace policy
+// where the item was placed (see HeapTrace.h), and that's where we update
+// the table. So decreaseKey can jump straight to the item, lower its key, and
+// heapify it up, in O(log n) time.
+//
+// A handle stays valid until its item is removed (by removeMin or erase).
+// After that, the same handle number may be given to a new item.
+
+// HandleTrace: The trace policy that keeps the handle table up to date. It
+// inherits from the caller's own trace policy, so that one still sees all of
+// the other steps.
+template <typename Trace>
+class HandleTrace : public Trace {
+  public:
+    // positions[handle] is the index of that handle's item in the array, or
+    // 0 if the handle isn't in use.
+    std::vector<unsigned> positions;
+
+    template <typename Entry>
+    void placed(const Entry & entry, unsigned index) {
+      positions[entry.handle] = index;
+    }
+};
+
+// AddressableHeapEntry: What the underlying Heap actually stores: the key,
+// and the handle that it belongs to. Entries are ordered by key only.
+template <typename T>
+class AddressableHeapEntry {
+  public:
+    T key;
+    unsigned handle;
+
+    bool operator<(const AddressableHeapEntry & other) const {
+      return key < other.key;
+    }
+};
+
+template <typename T, typename Trace = NoHeapTrace, unsigned ARITY = 2>
+class AddressableHeap : private Heap<AddressableHeapEntry<T>, HandleTrace<Trace>, ARITY> {
+  private:
+    typedef Heap<AddressableHeapEntry<T>, HandleTrace<Trace>, ARITY> Base;
+    typedef AddressableHeapEntry<T> Entry;
+
+  public:
+    typedef unsigned Handle;
+
+    // insert: Add the key, and return a handle for it.
+    Handle insert(const T & key);
+
+    // top: The smallest key, without removing it.
+    const T & top() const;
+    // topHandle: The handle of the smallest key.
+    Handle topHandle() const;
+    // removeMin: Remove the smallest key and return it. Its handle is no
+    // longer valid after this.
+    T removeMin();
+
+    // decreaseKey: Lower the key of this handle's item to newKey. Throws if
+    // newKey is larger than the current key.
+    void decreaseKey(Handle handle, const T & newKey);
+    // erase: Remove this handle's item, wherever it is in the heap.
+    void erase(Handle handle);
+
+    // contains: Whether this handle belongs to an item in the heap.
+    bool contains(Handle handle) const;
+    // get: The current key of this handle's item.
+    const T & get(Handle handle) const;
+
+    using Base::size;
+    using Base::empty;
+    using Base::reserve;
+    using Base::trace;
+
+  private:
+    // Handles that were used before and are free now.
+    std::vector<Handle> free_handles_;
+
+    unsigned _indexOf(Handle handle) const;
+};
+
+#include "AddressableHeap.hpp"
@@ -0,0 +1,117 @@
+/**
+ * An addressable heap: a Heap where each item has a handle, so that an item
+ * anywhere in the heap can have its key decreased, or be removed.
+ */
+
+#pragma once
+
+#include "AddressableHeap.h"
+
+#include <stdexcept>
+
+// Note: Inside these functions, the members of the Heap base class (like
+// item_ and size_) have to be written as this->item_, because the base class
+// depends on the template parameters.
+
+template <typename T, typename Trace, unsigned ARITY>
+typename AddressableHeap<T, Trace, ARITY>::Handle AddressableHeap<T, Trace, ARITY>::insert(const T & key) {
+  std::vector<unsigned> & positions = this->trace_.positions;
+
+  // Reuse a free handle if there is one.
+  Handle handle;
+  if ( !free_handles_.empty() ) {
+    handle = free_handles_.back();
+    free_handles_.pop_back();
+  } else {
+    handle = positions.size();
+    positions.push_back(0);
+  }
+
+  Entry entry;
+  entry.key = key;
+  entry.handle = handle;
+  // The Heap's insert tells our trace policy where the entry ends up.
+  Base::insert(entry);
+  return handle;
+}
+
+template <typename T, typename Trace, unsigned ARITY>
+const T & AddressableHeap<T, Trace, ARITY>::top() const {
+  if ( this->empty() ) {
+    throw std::runtime_error("error in top(): the heap is empty");
+  }
+  return this->item_[1].key;
+}
+
+template <typename T, typename Trace, unsigned ARITY>
+typename AddressableHeap<T, Trace, ARITY>::Handle AddressableHeap<T, Trace, ARITY>::topHandle() const {
+  if ( this->empty() ) {
+    throw std::runtime_error("error in topHandle(): the heap is empty");
+  }
+  return this->item_[1].handle;
+}
+
+template <typename T, typename Trace, unsigned ARITY>
+T AddressableHeap<T, Trace, ARITY>::removeMin() {
+  if ( this->empty() ) {
+    throw std::runtime_error("error in removeMin(): the heap is empty");
+  }
+  Entry entry = Base::removeMin();
+  this->trace_.positions[entry.handle] = 0;
+  free_handles_.push_back(entry.handle);
+  return entry.key;
+}
+
+template <typename T, typename Trace, unsigned ARITY>
+void AddressableHeap<T, Trace, ARITY>::decreaseKey(Handle handle, const T & newKey) {
+  const unsigned index = _indexOf(handle);
+  if ( this->item_[index].key < newKey ) {
+    throw std::runtime_error("error in decreaseKey(): the new key is larger than the current key");
+  }
+
+  // A smaller key can only need to move up toward the root.
+  this->item_[index].key = newKey;
+  this->_heapifyUp(index);
+}
+
+template <typename T, typename Trace, unsigned ARITY>
+void AddressableHeap<T, Trace, ARITY>::erase(Handle handle) {
+  const unsigned index = _indexOf(handle);
+
+  // Like removeMin, but at any index: move the last item into the hole.
+  // That item might be smaller than the one it replaces, or larger, so it
+  // may have to move either up or down. (At most one of the two calls does
+  // anything.)
+  const unsigned last = this->size_;
+  if (index != last) {
+    this->_swap(index, last);
+  }
+  this->size_--;
+  if (index != last) {
+    const Handle moved = this->item_[index].handle;
+    this->_heapifyUp(index);
+    this->_heapifyDown(this->trace_.positions[moved]);
+  }
+
+  this->trace_.positions[handle] = 0;
+  free_handles_.push_back(handle);
+}
+
+template <typename T, typename Trace, unsigned ARITY>
+bool AddressableHeap<T, Trace, ARITY>::contains(Handle handle) const {
+  const std::vector<unsigned> & positions = this->trace_.positions;
+  return handle < positions.size() && positions[handle] != 0;
+}
+
+template <typename T, typename Trace, unsigned ARITY>
+const T & AddressableHeap<T, Trace, ARITY>::get(Handle handle) const {
+  return this->item_[_indexOf(handle)].key;
+}
+
+template <typename T, typename Trace, unsigned ARITY>
+unsigned AddressableHeap<T, Trace, ARITY>::_indexOf(Handle handle) const {
+  if ( !contains(handle) ) {
+    throw std::runtime_error("error: this handle does not belong to an item in the heap");
+  }
+  return this->trace_.positions[handle];
+}
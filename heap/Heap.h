@@ -7,25 +7,121 @@
 
 #pragma once
 
-template <typename T>
+#include <iterator>
+#include <type_traits>
+
+#include "HeapTrace.h"
+
+// The Trace policy (see HeapTrace.h) decides what happens at each step of
+// the heap's work. The default, NoHeapTrace, does nothing at all, so the
+// heap does no I/O and has no extra cost.
+//
+// ARITY is the number of children of each node. The default, 2, is the
+// binary heap from the lecture. With more children per node, the heap has
+// fewer levels, so inserts (which compare once per level) get faster, but
+// removeMin has to look at more children on each level. Those children are
+// next to each other in the array, though, and the array is placed so that
+// they share one cache line when they fit (for example, 4 children of 16
+// bytes, 8 doubles, or 16 ints). Then each level costs at most one cache
+// miss. Whether that beats the extra comparisons depends on the machine,
+// the item size, and whether the heap fits in the CPU caches, so it's
+// worth measuring with "make bench" before picking an ARITY.
+template <typename T, typename Trace = NoHeapTrace, unsigned ARITY = 2>
 class Heap {
+  static_assert(ARITY >= 2, "Heap ARITY must be at least 2");
+
   public:
     Heap();
+
+    // Build a heap from all of the items in the range [first, last).
+    // This takes O(n) time, compared to O(n log n) for n calls to insert.
+    template <typename Iterator>
+    Heap(Iterator first, Iterator last);
+
+    // The heap owns its array, so we don't allow shallow copies.
+    Heap(const Heap&) = delete;
+    Heap& operator=(const Heap&) = delete;
+
+    ~Heap() {
+      delete[] storage_;
+    }
+
     void insert(const T key);
     T removeMin();
 
-  private:
+    // peekMin: The smallest item, without removing it. The heap must not
+    // be empty.
+    const T & peekMin() const { return item_[1]; }
+
+    // replaceMin: Remove the smallest item and insert key, in one step, and
+    // return the item that was removed. The heap must not be empty. This
+    // heapifies down only once, where removeMin followed by insert would
+    // heapify down and then up again.
+    T replaceMin(const T key);
+
+    // insertBatch: Insert all of the items in the range [first, last).
+    // A batch that is large compared to the heap is added by rebuilding the
+    // whole heap in O(n) time; a small batch is added one item at a time.
+    template <typename Iterator>
+    void insertBatch(Iterator first, Iterator last);
+
+    // reserve: Make room for at least this many items, so that inserting up
+    // to that many won't have to grow the array again.
+    void reserve(unsigned capacity);
+
+    unsigned size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // The trace policy object, for example to read a CountingHeapTrace's
+    // counters or reset them.
+    Trace & trace() { return trace_; }
+    const Trace & trace() const { return trace_; }
+
+  // The rest is protected instead of private, so that AddressableHeap
+  // (in AddressableHeap.h) can build on it.
+  protected:
+    static constexpr unsigned CACHE_LINE_SIZE = 64;
+
     unsigned size_;
     unsigned capacity_;
+    // storage_ is the array we allocated, and item_ points somewhere near
+    // its start, chosen to line the children up with cache lines. The items
+    // are in item_[1] through item_[size_].
+    T *storage_;
     T *item_;
+    // The trace is mutable so that const helpers like _minChild can still
+    // report their comparisons.
+    mutable Trace trace_;
 
-    int _parent(unsigned index) const;
-    int _minChild(unsigned index) const;
+    unsigned _parent(unsigned index) const;
+    unsigned _firstChild(unsigned index) const;
+    unsigned _minChild(unsigned index) const;
+    // _minOfChildren: Find the smallest child in item_[first..last]. The
+    // last argument says whether T is a number type (std::true_type) or not.
+    unsigned _minOfChildren(unsigned first, unsigned last, std::true_type) const;
+    unsigned _minOfChildren(unsigned first, unsigned last, std::false_type) const;
+    unsigned _minOfFullGroup(unsigned first) const;
 
     void _heapifyUp(unsigned index);
     void _heapifyDown();
     void _heapifyDown(unsigned index);
     void _growArray();
+    void _resizeArray(unsigned capacity);
+    void _buildHeap();
+
+    // Call reserve() for the size of the range, if we can find out the size
+    // without using up the range. (We can for forward iterators, like the
+    // ones from std::vector, but not for input iterators, like the ones that
+    // read from a stream.)
+    template <typename Iterator>
+    void _reserveFor(Iterator first, Iterator last, std::forward_iterator_tag);
+    template <typename Iterator>
+    void _reserveFor(Iterator, Iterator, std::input_iterator_tag) { }
+
+    // Every comparison and swap goes through these, so the trace policy
+    // sees all of them.
+    bool _less(const T & a, const T & b) const;
+    void _swap(unsigned index1, unsigned index2);
 
     bool _isRoot(unsigned index) const;
     bool _isLeaf(unsigned index) const;
@@ -6,18 +6,109 @@
  */
 #include "Heap.h"
 #include <algorithm>
-#include <iostream>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
 
-template <typename T>
-Heap<T>::Heap() {
+template <typename T, typename Trace, unsigned ARITY>
+Heap<T, Trace, ARITY>::Heap() {
   size_ = 0;
-  capacity_ = 2;
-  item_ = new T[capacity_ + 1];
+  capacity_ = 0;
+  storage_ = nullptr;
+  item_ = nullptr;
+  _resizeArray(2);
 }
 
 
-template <typename T>
-void Heap<T>::insert(const T key) {
+template <typename T, typename Trace, unsigned ARITY>
+template <typename Iterator>
+Heap<T, Trace, ARITY>::Heap(Iterator first, Iterator last) : Heap() {
+  _reserveFor(first, last, typename std::iterator_traits<Iterator>::iterator_category());
+
+  // Copy every item into the array, in whatever order it comes...
+  for ( ; first != last; ++first) {
+    if ( size_ == capacity_ ) { _growArray(); }
+    size_++;
+    item_[size_] = *first;
+    trace_.placed(item_[size_], size_);
+  }
+
+  // ...and then restore the heap property for the whole array at once.
+  _buildHeap();
+
+  trace_.built(item_, size_, ARITY);
+}
+
+
+template <typename T, typename Trace, unsigned ARITY>
+void Heap<T, Trace, ARITY>::_buildHeap() {
+  // Every leaf is already a heap of one item. Going backwards from the last
+  // node that has a child, up to the root, we heapify each node down, which
+  // joins its children (already heaps) into a heap.
+  //   In a binary heap, half of the nodes are leaves and are skipped. A
+  // quarter of them are one level up and can move down at most 1 level, an
+  // eighth of them at most 2 levels, and so on. That sum adds up to less
+  // than n swaps in total, so this takes O(n) time. (With more children per
+  // node, even more of the nodes are leaves.)
+  if (size_ < 2) return;
+  for (unsigned index = _parent(size_); index >= 1; index--) {
+    _heapifyDown(index);
+  }
+}
+
+
+template <typename T, typename Trace, unsigned ARITY>
+template <typename Iterator>
+void Heap<T, Trace, ARITY>::insertBatch(Iterator first, Iterator last) {
+  _reserveFor(first, last, typename std::iterator_traits<Iterator>::iterator_category());
+
+  // Append the whole batch to the end of the array first.
+  const unsigned oldSize = size_;
+  for ( ; first != last; ++first) {
+    if ( size_ == capacity_ ) { _growArray(); }
+    size_++;
+    item_[size_] = *first;
+    trace_.placed(item_[size_], size_);
+  }
+  const unsigned m = size_ - oldSize;
+  if (m == 0) return;
+
+  // Heapifying each new item up costs up to one swap per level, so about
+  // m * (number of levels) in total, while rebuilding the whole heap always
+  // costs about n. For a batch that's large compared to the heap, rebuilding
+  // is cheaper.
+  unsigned levels = 1;
+  for (unsigned long long width = ARITY; width < size_; width *= ARITY) levels++;
+
+  if ((unsigned long long)m * levels > size_) {
+    _buildHeap();
+  } else {
+    for (unsigned index = oldSize + 1; index <= size_; index++) {
+      _heapifyUp(index);
+    }
+  }
+
+  trace_.built(item_, size_, ARITY);
+}
+
+
+template <typename T, typename Trace, unsigned ARITY>
+void Heap<T, Trace, ARITY>::reserve(unsigned capacity) {
+  if (capacity > capacity_) {
+    _resizeArray(capacity);
+  }
+}
+
+
+template <typename T, typename Trace, unsigned ARITY>
+template <typename Iterator>
+void Heap<T, Trace, ARITY>::_reserveFor(Iterator first, Iterator last, std::forward_iterator_tag) {
+  reserve(size_ + std::distance(first, last));
+}
+
+
+template <typename T, typename Trace, unsigned ARITY>
+void Heap<T, Trace, ARITY>::insert(const T key) {
   // Check to ensure there’s space to insert an element
   // ...if not, grow the array
   if ( size_ == capacity_ ) { _growArray(); }
@@ -25,23 +116,20 @@ void Heap<T>::insert(const T key) {
   // Insert the new element at the end of the array
   size_++;
   item_[size_] = key;
+  trace_.placed(item_[size_], size_);
   
   // Restore the heap property
   _heapifyUp(size_);
 
-  std::cout << "After Heap<T>::insert(key = " << key << "): ";
-  for (unsigned i = 1; i <= size_; i++) {
-    std::cout << item_[i] << " ";
-  }
-  std::cout << std::endl;
+  trace_.inserted(key, item_, size_, ARITY);
 }
 
 
-template <class T>
-T Heap<T>::removeMin() {
+template <typename T, typename Trace, unsigned ARITY>
+T Heap<T, Trace, ARITY>::removeMin() {
   // Swap with the last value
   T minValue = item_[1];
-  std::swap( item_[1], item_[size_--] );
+  _swap( 1, size_-- );
 
   // Restore the heap property
   _heapifyDown();
@@ -51,78 +139,189 @@ T Heap<T>::removeMin() {
 }
 
 
-template <class T>
-void Heap<T>::_heapifyUp( unsigned index ) {
+template <typename T, typename Trace, unsigned ARITY>
+T Heap<T, Trace, ARITY>::replaceMin(const T key) {
+  // Put the new key where the minimum was...
+  T minValue = item_[1];
+  item_[1] = key;
+  trace_.placed(item_[1], 1);
+
+  // ...and let it sink to where it belongs.
+  _heapifyDown();
+
+  return minValue;
+}
+
+
+template <typename T, typename Trace, unsigned ARITY>
+void Heap<T, Trace, ARITY>::_heapifyUp( unsigned index ) {
   if ( !_isRoot(index) ) {
-    if ( item_[index] < item_[ _parent(index) ] ) {
-      std::swap( item_[index], item_[ _parent(index) ] );
+    if ( _less( item_[index], item_[ _parent(index) ] ) ) {
+      _swap( index, _parent(index) );
       _heapifyUp( _parent(index) );
     }
   }
 }
 
 
-template <class T>
-void Heap<T>::_heapifyDown() {
+template <typename T, typename Trace, unsigned ARITY>
+void Heap<T, Trace, ARITY>::_heapifyDown() {
   _heapifyDown(1);
 }
 
 
-template <class T>
-void Heap<T>::_heapifyDown( unsigned index ) {
+template <typename T, typename Trace, unsigned ARITY>
+void Heap<T, Trace, ARITY>::_heapifyDown( unsigned index ) {
   if ( !_isLeaf(index) ) {
-    T minChildIndex = _minChild(index);
-    if ( item_[index] > item_[minChildIndex] ) {
-       std::swap( item_[index], item_[minChildIndex] );
+    unsigned minChildIndex = _minChild(index);
+    if ( _less( item_[minChildIndex], item_[index] ) ) {
+       _swap( index, minChildIndex );
        _heapifyDown( minChildIndex );
     }
   }
 }
 
 
-template <class T>
-void Heap<T>::_growArray() {
-  T* newItem = new T[(2 * capacity_) + 1];
-  for (unsigned i  = 1; i <= capacity_; i++) { newItem[i] = item_[i]; }
-  
-  capacity_ = 2 * capacity_;
-  delete[] item_;
+template <typename T, typename Trace, unsigned ARITY>
+void Heap<T, Trace, ARITY>::_growArray() {
+  _resizeArray(2 * capacity_);
+}
+
+
+template <typename T, typename Trace, unsigned ARITY>
+void Heap<T, Trace, ARITY>::_resizeArray(unsigned capacity) {
+  // Index 0 is unused, so the array needs one extra slot. We also allocate
+  // one cache line's worth of extra slots, so that we can shift where item_
+  // starts: the children of every node start at an index that is 2 more
+  // than a multiple of ARITY, so if item_[2] is at the start of a cache line,
+  // and ARITY items fit in a line, each node's children share one line.
+  const unsigned padding = CACHE_LINE_SIZE / sizeof(T) + 1;
+  T* newStorage = new T[capacity + 1 + padding];
+  unsigned offset = 0;
+  for (unsigned k = 0; k < padding; k++) {
+    if (reinterpret_cast<std::uintptr_t>(newStorage + k + 2) % CACHE_LINE_SIZE == 0) {
+      offset = k;
+      break;
+    }
+  }
+  T* newItem = newStorage + offset;
+  for (unsigned i  = 1; i <= size_; i++) { newItem[i] = std::move(item_[i]); }
+
+  // (The first array, made by the constructor, isn't a grow event.)
+  const bool grew = (storage_ != nullptr);
+  capacity_ = capacity;
+  delete[] storage_;
+  storage_ = newStorage;
   item_ = newItem;
-  std::cerr << "Heap<T>::_growArray() increased array to capacity_ == " << capacity_ << std::endl;
+  if (grew) { trace_.grew(capacity_); }
 }
 
 
-template <class T>
-bool Heap<T>::_isRoot( unsigned index ) const {
+template <typename T, typename Trace, unsigned ARITY>
+bool Heap<T, Trace, ARITY>::_isRoot( unsigned index ) const {
   return (index == 1);
 }
 
 
-template <class T>
-bool Heap<T>::_isLeaf( unsigned index ) const {
-  // A leaf node has no children, so it is a leaf if the left child (index * 2) is
-  // larger than the size of our heap.
-  return (index * 2 > size_);
+template <typename T, typename Trace, unsigned ARITY>
+bool Heap<T, Trace, ARITY>::_isLeaf( unsigned index ) const {
+  // A leaf node has no children, so it is a leaf if its first child is
+  // past the end of our heap.
+  return (_firstChild(index) > size_);
 }
 
 
-template <class T>
-int Heap<T>::_parent( unsigned index ) const {
-  return index / 2;
+template <typename T, typename Trace, unsigned ARITY>
+unsigned Heap<T, Trace, ARITY>::_firstChild( unsigned index ) const {
+  // With ARITY == 2, this is the familiar index * 2, and the other child is
+  // at index * 2 + 1.
+  return ARITY * (index - 1) + 2;
 }
 
 
-template <class T>
-int Heap<T>::_minChild( unsigned index ) const {
-  unsigned left = index * 2;
-  unsigned right = (index * 2) + 1;
+template <typename T, typename Trace, unsigned ARITY>
+unsigned Heap<T, Trace, ARITY>::_parent( unsigned index ) const {
+  // With ARITY == 2, this is index / 2.
+  return (index - 2) / ARITY + 1;
+}
 
-  if (right > size_) {
-    // No right child exists
-    return left;
-  } else if ( item_[left] <= item_[right] ) {
-    return left;
-  } else {
-    return right;
+
+template <typename T, typename Trace, unsigned ARITY>
+unsigned Heap<T, Trace, ARITY>::_minChild( unsigned index ) const {
+  const unsigned first = _firstChild(index);
+  const unsigned last = std::min(first + ARITY - 1, size_);
+  return _minOfChildren(first, last, std::is_arithmetic<T>());
+}
+
+
+template <typename T, typename Trace, unsigned ARITY>
+unsigned Heap<T, Trace, ARITY>::_minOfChildren( unsigned first, unsigned last, std::true_type ) const {
+  // For numbers, when the node has all of its children, use the branchless
+  // version below.
+  if (ARITY > 2 && last - first + 1 == ARITY) {
+    return _minOfFullGroup(first);
+  }
+  return _minOfChildren(first, last, std::false_type());
+}
+
+
+template <typename T, typename Trace, unsigned ARITY>
+unsigned Heap<T, Trace, ARITY>::_minOfChildren( unsigned first, unsigned last, std::false_type ) const {
+  // Check each child in turn. On a tie, we keep the leftmost one.
+  unsigned minIndex = first;
+  for (unsigned child = first + 1; child <= last; child++) {
+    if ( _less( item_[child], item_[minIndex] ) ) {
+      minIndex = child;
+    }
+  }
+  return minIndex;
+}
+
+
+template <typename T, typename Trace, unsigned ARITY>
+unsigned Heap<T, Trace, ARITY>::_minOfFullGroup( unsigned first ) const {
+  // When the children are numbers, we find the smallest one in two passes
+  // that have no branches at all: first the smallest value, and then the
+  // position of the first child with that value. Both loops always run
+  // exactly ARITY times, and each step is a simple "pick one of two", so the
+  // compiler can unroll them and use SIMD instructions, which compare a
+  // whole group of children in a few steps. A loop with an "if" in it would
+  // make the CPU guess the outcome of every comparison instead, and with
+  // random keys it guesses wrong about half of the time.
+  const T* group = item_ + first;
+  T minValue = group[0];
+  for (unsigned j = 1; j < ARITY; j++) {
+    minValue = (group[j] < minValue) ? group[j] : minValue;
+  }
+  unsigned offset = 0;
+  for (unsigned j = ARITY; j-- > 0; ) {
+    offset = (group[j] == minValue) ? j : offset;
+  }
+
+  for (unsigned j = 1; j < ARITY; j++) {
+    trace_.compared();
   }
-}
\ No newline at end of file
+  return first + offset;
+}
+
+
+template <typename T, typename Trace, unsigned ARITY>
+bool Heap<T, Trace, ARITY>::_less( const T & a, const T & b ) const {
+  trace_.compared();
+  return a < b;
+}
+
+
+template <typename T, typename Trace, unsigned ARITY>
+void Heap<T, Trace, ARITY>::_swap( unsigned index1, unsigned index2 ) {
+  trace_.swapped();
+  std::swap( item_[index1], item_[index2] );
+  trace_.placed( item_[index1], index1 );
+  trace_.placed( item_[index2], index2 );
+}
+
+
+// C++14 compatibility: out-of-class definition of the static constexpr
+// member. (This is sometimes needed in C++14, but it is deprecated in C++17.)
+template <typename T, typename Trace, unsigned ARITY>
+constexpr unsigned Heap<T, Trace, ARITY>::CACHE_LINE_SIZE;
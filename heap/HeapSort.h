@@ -0,0 +1,150 @@
+/**
+ * Sorting with a Heap: heapSort, partialSort, and a parallel heapSort that
+ * sorts pieces of the range on separate threads and then merges them.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#include "Heap.h"
+
+// Building a heap takes O(n) time, and each removeMin takes O(log n), so
+// building a heap and then removing everything is a complete O(n log n)
+// sort. That's all heapSort does. The textbook version of heap sort works
+// inside the array that is being sorted; this one copies the items into a
+// Heap, so it needs O(n) extra memory, but it reuses the Heap class as it
+// is, including its ARITY and cache-line placement.
+//
+// All of these take the range as a pair of random access iterators, like
+// std::sort, and sort it from smallest to largest using operator<.
+
+// heapSort: Sort the range [first, last).
+template <unsigned ARITY = 2, typename RandomIt>
+void heapSort(RandomIt first, RandomIt last) {
+  typedef typename std::iterator_traits<RandomIt>::value_type T;
+  Heap<T, NoHeapTrace, ARITY> heap(first, last);
+  for ( ; first != last; ++first) {
+    *first = heap.removeMin();
+  }
+}
+
+// HeapReversed: Holds one item, and orders the items backwards, so that a
+// Heap of HeapReversed<T> (still a min-heap, as far as it knows) keeps the
+// largest item on top.
+template <typename T>
+class HeapReversed {
+  public:
+    T value;
+
+    bool operator<(const HeapReversed & other) const {
+      return other.value < value;
+    }
+};
+
+// partialSort: Put the k smallest items of [first, last) at the front of the
+// range, in sorted order, like std::partial_sort. The other items end up in
+// the rest of the range, in no particular order.
+//   Only a heap of k items is kept, with the largest of them on top, so
+// this takes O(n log k) time and O(k) extra memory. Each item after the
+// first k is compared to the top of the heap: if it's smaller, it belongs
+// with the k smallest, so it replaces the top, and the old top moves to
+// where that item was.
+template <unsigned ARITY = 2, typename RandomIt>
+void partialSort(RandomIt first, RandomIt last, std::size_t k) {
+  typedef typename std::iterator_traits<RandomIt>::value_type T;
+  const std::size_t n = std::distance(first, last);
+  if (k > n) { k = n; }
+  if (k == 0) return;
+
+  std::vector<HeapReversed<T>> front;
+  front.reserve(k);
+  for (RandomIt it = first; it != first + k; ++it) {
+    front.push_back(HeapReversed<T>{ *it });
+  }
+  Heap<HeapReversed<T>, NoHeapTrace, ARITY> largest(front.begin(), front.end());
+
+  for (RandomIt it = first + k; it != last; ++it) {
+    if (*it < largest.peekMin().value) {
+      *it = largest.replaceMin(HeapReversed<T>{ *it }).value;
+    }
+  }
+
+  // The heap gives the k smallest back largest first, so fill the front of
+  // the range from the back.
+  for (std::size_t i = k; i-- > 0; ) {
+    first[i] = largest.removeMin().value;
+  }
+}
+
+// HeapSortRun: One sorted piece of the range, while the pieces are merged:
+// the item at the front of the piece, and which piece it is. Runs are
+// ordered by their front item, so a Heap of runs always has the run with
+// the smallest front item on top.
+template <typename T>
+class HeapSortRun {
+  public:
+    T front;
+    unsigned run;
+
+    bool operator<(const HeapSortRun & other) const {
+      return front < other.front;
+    }
+};
+
+// parallelHeapSort: Sort the range [first, last) using up to "threads"
+// threads. The range is cut into one piece per thread, and each thread
+// heapSorts its own piece. Then a Heap of the pieces' front items merges
+// them: the smallest front item is the next item of the output, and it is
+// replaced by the next item of the same piece. That merge is done on one
+// thread, and takes O(n log threads) time.
+template <unsigned ARITY = 2, typename RandomIt>
+void parallelHeapSort(RandomIt first, RandomIt last, unsigned threads) {
+  typedef typename std::iterator_traits<RandomIt>::value_type T;
+  const std::size_t n = std::distance(first, last);
+  if (threads < 1) { threads = 1; }
+  if (threads > n) { threads = (n > 0) ? n : 1; }
+  if (threads == 1) {
+    heapSort<ARITY>(first, last);
+    return;
+  }
+
+  // Piece i is [bounds[i], bounds[i + 1]).
+  std::vector<std::size_t> bounds(threads + 1);
+  for (unsigned i = 0; i <= threads; i++) {
+    bounds[i] = n * i / threads;
+  }
+
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < threads; i++) {
+    workers.push_back(std::thread([first, &bounds, i]() {
+      heapSort<ARITY>(first + bounds[i], first + bounds[i + 1]);
+    }));
+  }
+  for (std::thread & worker : workers) {
+    worker.join();
+  }
+
+  // Merge the sorted pieces into a new array, then copy it back.
+  std::vector<std::size_t> next(bounds.begin(), bounds.end() - 1);
+  Heap<HeapSortRun<T>, NoHeapTrace, ARITY> runs;
+  runs.reserve(threads);
+  for (unsigned i = 0; i < threads; i++) {
+    runs.insert(HeapSortRun<T>{ first[next[i]++], i });
+  }
+
+  std::vector<T> merged;
+  merged.reserve(n);
+  while (!runs.empty()) {
+    const unsigned run = runs.peekMin().run;
+    if (next[run] < bounds[run + 1]) {
+      merged.push_back(runs.replaceMin(HeapSortRun<T>{ first[next[run]++], run }).front);
+    } else {
+      merged.push_back(runs.removeMin().front);
+    }
+  }
+  std::copy(merged.begin(), merged.end(), first);
+}
@@ -0,0 +1,129 @@
+/**
+ * Tracing policies for the Heap class.
+ *
+ * Heap<T, Trace> calls a member function of its Trace object at each
+ * interesting step: every comparison, every swap, every time the array
+ * grows (including reserve()), after every insert, after a whole range of
+ * items has been added at once by the range constructor or insertBatch
+ * ("built"), and every time an item is stored at a new index in the array
+ * ("placed"). The policy decides what happens then:
+ *
+ *   NoHeapTrace       : Nothing. Every call is empty, so the compiler
+ *                       removes them completely. This is the default.
+ *   CountingHeapTrace : Count the comparisons, swaps and grow events, and
+ *                       remember the deepest level the heap has reached,
+ *                       for profiling. There is no I/O at all.
+ *   PrintingHeapTrace : Print the whole array after every insert, and a
+ *                       message whenever the array grows, like the version
+ *                       of the heap in the lecture videos. This is useful to
+ *                       watch a small heap work, but the printing makes
+ *                       every insert take O(n) time.
+ *
+ * Any class with the same member functions can be used as a policy. For
+ * example, AddressableHeap uses "placed" to keep track of where each item
+ * is in the array.
+ */
+
+#pragma once
+
+#include <iostream>
+
+class NoHeapTrace {
+  public:
+    void compared() { }
+    void swapped() { }
+    void grew(unsigned) { }
+    template <typename T>
+    void inserted(const T&, const T*, unsigned, unsigned) { }
+    template <typename T>
+    void built(const T*, unsigned, unsigned) { }
+    template <typename T>
+    void placed(const T&, unsigned) { }
+};
+
+class CountingHeapTrace {
+  public:
+    CountingHeapTrace() { reset(); }
+
+    void compared() { comparisons_++; }
+    void swapped() { swaps_++; }
+    void grew(unsigned) { grows_++; }
+
+    template <typename T>
+    void inserted(const T&, const T*, unsigned size, unsigned arity) {
+      _reached(size, arity);
+    }
+    template <typename T>
+    void built(const T*, unsigned size, unsigned arity) {
+      _reached(size, arity);
+    }
+
+    template <typename T>
+    void placed(const T&, unsigned) { }
+
+    unsigned long long comparisons() const { return comparisons_; }
+    unsigned long long swaps() const { return swaps_; }
+    unsigned long long grows() const { return grows_; }
+    unsigned maxDepth() const { return max_depth_; }
+
+    void reset() {
+      comparisons_ = 0;
+      swaps_ = 0;
+      grows_ = 0;
+      max_depth_ = 0;
+    }
+
+  private:
+    unsigned long long comparisons_;
+    unsigned long long swaps_;
+    unsigned long long grows_;
+    unsigned max_depth_;
+
+    // The items are in item_[1] through item_[size], and the last one is
+    // on the deepest level. Level 0 has 1 node, level 1 has "arity" nodes,
+    // level 2 has arity * arity nodes, and so on.
+    void _reached(unsigned size, unsigned arity) {
+      unsigned depth = 0;
+      unsigned long long levelEnd = 1, width = 1;
+      while (levelEnd < size) {
+        width *= arity;
+        levelEnd += width;
+        depth++;
+      }
+      if (depth > max_depth_) { max_depth_ = depth; }
+    }
+};
+
+class PrintingHeapTrace {
+  public:
+    void compared() { }
+    void swapped() { }
+
+    void grew(unsigned capacity) {
+      std::cerr << "Heap<T>::_growArray() increased array to capacity_ == " << capacity << std::endl;
+    }
+
+    template <typename T>
+    void inserted(const T& key, const T* items, unsigned size, unsigned) {
+      std::cout << "After Heap<T>::insert(key = " << key << "): ";
+      _print(items, size);
+    }
+
+    template <typename T>
+    void built(const T* items, unsigned size, unsigned) {
+      std::cout << "After adding a batch of items: ";
+      _print(items, size);
+    }
+
+    template <typename T>
+    void placed(const T&, unsigned) { }
+
+  private:
+    template <typename T>
+    void _print(const T* items, unsigned size) {
+      for (unsigned i = 1; i <= size; i++) {
+        std::cout << items[i] << " ";
+      }
+      std::cout << std::endl;
+    }
+};
@@ -0,0 +1,77 @@
+/**
+ * MultiQueue: a concurrent priority queue made of several Heaps, each with
+ * its own lock, with "relaxed" removeMin.
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Heap.h"
+
+// Putting one Heap behind one mutex makes every thread wait for every other
+// thread, so adding threads doesn't make it any faster. A MultiQueue uses
+// many Heaps instead, typically 2 for each thread, each behind its own mutex.
+//
+//   insert:    Pick a random heap and insert into it. If another thread is
+//              using that heap right now, pick a different one instead of
+//              waiting.
+//   tryRemoveMin: Pick two random heaps, and remove the smaller of their
+//              two minimums.
+//
+// With many heaps, two threads rarely pick the same one, so they rarely
+// wait for each other. The price is that tryRemoveMin doesn't always return
+// the overall smallest item, only one that is likely to be among the
+// smallest few. (Looking at two heaps instead of one makes a big difference
+// here: it keeps the heaps' minimums close to each other.) For schedulers
+// and many graph algorithms, that's a good trade.
+//
+// Each heap is the ordinary Heap class, so each insert and removeMin still
+// runs Heap's own _heapifyUp and _heapifyDown; the MultiQueue only decides
+// which heap to use and holds its lock.
+//
+// Every item that is inserted is removed exactly once. When no thread is
+// inserting or removing, tryRemoveMin only returns false if the queue is
+// completely empty.
+
+template <typename T, unsigned ARITY = 2>
+class MultiQueue {
+  public:
+    // The number of heaps is threads * queuesPerThread.
+    MultiQueue(unsigned threads, unsigned queuesPerThread = 2);
+
+    MultiQueue(const MultiQueue&) = delete;
+    MultiQueue& operator=(const MultiQueue&) = delete;
+
+    void insert(const T & item);
+
+    // tryRemoveMin: Remove a small item and store it in "item". Returns
+    // false if there was nothing to remove.
+    bool tryRemoveMin(T & item);
+
+    // size: The total number of items. This locks every heap, so it's meant
+    // for testing, not for use while other threads are busy.
+    unsigned size() const;
+
+  private:
+    // SubQueue: One heap and its lock. The padding keeps two SubQueues'
+    // locks out of the same 64-byte cache line, so that threads using
+    // different heaps don't slow each other down by writing to the same line
+    // ("false sharing").
+    class SubQueue {
+      public:
+        mutable std::mutex lock;
+        Heap<T, NoHeapTrace, ARITY> heap;
+        char padding[64];
+    };
+
+    std::vector<std::unique_ptr<SubQueue>> queues_;
+
+    // A random heap index, using a random number generator that belongs to
+    // the calling thread.
+    unsigned _randomQueue() const;
+};
+
+#include "MultiQueue.hpp"
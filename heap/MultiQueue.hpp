@@ -0,0 +1,104 @@
+/**
+ * MultiQueue: a concurrent priority queue made of several Heaps, each with
+ * its own lock, with "relaxed" removeMin.
+ */
+
+#pragma once
+
+#include "MultiQueue.h"
+
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <thread>
+
+template <typename T, unsigned ARITY>
+MultiQueue<T, ARITY>::MultiQueue(unsigned threads, unsigned queuesPerThread) {
+  const unsigned count = std::max(2u, threads * queuesPerThread);
+  for (unsigned i = 0; i < count; i++) {
+    queues_.push_back(std::unique_ptr<SubQueue>(new SubQueue));
+  }
+}
+
+template <typename T, unsigned ARITY>
+unsigned MultiQueue<T, ARITY>::_randomQueue() const {
+  // Each thread gets its own generator ("thread_local"), seeded from its
+  // thread id, so threads never share or wait for a generator.
+  thread_local std::minstd_rand rng(
+    (unsigned)std::hash<std::thread::id>()(std::this_thread::get_id()));
+  return rng() % queues_.size();
+}
+
+template <typename T, unsigned ARITY>
+void MultiQueue<T, ARITY>::insert(const T & item) {
+  // Keep picking random heaps until we find one that no other thread is
+  // using. try_to_lock never waits: the unique_lock just doesn't own the
+  // lock if another thread has it. Either way, the unique_lock releases
+  // whatever it holds when it goes out of scope, even if heap.insert throws
+  // (for example, bad_alloc when the heap's array grows), so a heap can
+  // never be left locked forever.
+  while (true) {
+    SubQueue & q = *queues_[_randomQueue()];
+    std::unique_lock<std::mutex> lock(q.lock, std::try_to_lock);
+    if (lock.owns_lock()) {
+      q.heap.insert(item);
+      return;
+    }
+  }
+}
+
+template <typename T, unsigned ARITY>
+bool MultiQueue<T, ARITY>::tryRemoveMin(T & item) {
+  // A few attempts with two random heaps...
+  for (int attempt = 0; attempt < 4; attempt++) {
+    unsigned a = _randomQueue();
+    unsigned b = _randomQueue();
+    if (a == b) { b = (b + 1) % queues_.size(); }
+    SubQueue & qa = *queues_[a];
+    SubQueue & qb = *queues_[b];
+
+    // (As in insert, the unique_locks unlock on every way out, including
+    // an exception from removeMin or from copying the item.)
+    std::unique_lock<std::mutex> la(qa.lock, std::try_to_lock);
+    if ( !la.owns_lock() ) continue;
+    // We hold one lock and only *try* the second one, so two threads can
+    // never end up waiting for each other's locks (a "deadlock").
+    std::unique_lock<std::mutex> lb(qb.lock, std::try_to_lock);
+    if ( !lb.owns_lock() ) {
+      if ( !qa.heap.empty() ) {
+        item = qa.heap.removeMin();
+        return true;
+      }
+      continue;
+    }
+
+    SubQueue * best = nullptr;
+    if ( !qa.heap.empty() ) { best = &qa; }
+    if ( !qb.heap.empty() && (!best || qb.heap.peekMin() < best->heap.peekMin()) ) { best = &qb; }
+    if (best) {
+      item = best->heap.removeMin();
+      return true;
+    }
+  }
+
+  // ...and if those all came up empty, check every heap in turn, so that we
+  // don't report an empty queue just because we were unlucky.
+  for (auto & q : queues_) {
+    std::lock_guard<std::mutex> guard(q->lock);
+    if ( !q->heap.empty() ) {
+      item = q->heap.removeMin();
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename T, unsigned ARITY>
+unsigned MultiQueue<T, ARITY>::size() const {
+  unsigned total = 0;
+  for (const auto & q : queues_) {
+    std::lock_guard<std::mutex> guard(q->lock);
+    total += q->heap.size();
+  }
+  return total;
+}
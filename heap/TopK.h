@@ -0,0 +1,69 @@
+/**
+ * TopK: keep the k largest items of a stream that may be far too long to
+ * store, using a Heap of at most k items.
+ */
+
+#pragma once
+
+#include <iterator>
+#include <vector>
+
+#include "Heap.h"
+
+// The items are pushed one at a time, and TopK never holds more than k of
+// them, so the memory it uses is O(k) no matter how long the stream is.
+//   The trick is that the heap is a min-heap of the k largest items seen so
+// far, so the smallest of them is on top. A new item only matters if it's
+// larger than that one; then it takes its place in the heap (replaceMin),
+// and the item that was on top is dropped for good. Most items in a long
+// stream are smaller than the top, and for those, push is just one
+// comparison. The others cost O(log k).
+//
+// To use several threads, give each thread its own TopK and its own part of
+// the stream, and merge the TopKs at the end. parallelTopK (below) does that.
+template <typename T, unsigned ARITY = 2>
+class TopK {
+  public:
+    // A TopK that keeps the k largest items.
+    explicit TopK(unsigned k);
+
+    // The heap owns its array, so TopK can't be copied either.
+    TopK(const TopK&) = delete;
+    TopK& operator=(const TopK&) = delete;
+
+    // push: Offer one item from the stream.
+    void push(const T & item);
+
+    // push: Offer every item in the range [first, last).
+    template <typename Iterator>
+    void push(Iterator first, Iterator last);
+
+    // merge: Offer every item that "other" kept. This empties "other".
+    void merge(TopK & other);
+
+    // take: The items kept so far, largest first. This empties the TopK.
+    std::vector<T> take();
+
+    // The number of items kept so far: k, or fewer if fewer were pushed.
+    unsigned size() const { return heap_.size(); }
+    unsigned k() const { return k_; }
+
+  private:
+    unsigned k_;
+    Heap<T, NoHeapTrace, ARITY> heap_;
+};
+
+// parallelTopK: The k largest items, largest first, using "threads" threads.
+// Thread i (from 0 to threads - 1) calls produce(i, topK) with its own TopK,
+// and produce pushes that thread's share of the stream into it (for example,
+// by reading its own part of a file). Then the threads' TopKs are merged.
+template <typename T, unsigned ARITY = 2, typename Producer>
+std::vector<T> parallelTopK(unsigned k, unsigned threads, Producer produce);
+
+// parallelTopK: The k largest items in the range [first, last), largest
+// first. The range is split evenly between the threads.
+template <unsigned ARITY = 2, typename RandomIt>
+std::vector<typename std::iterator_traits<RandomIt>::value_type>
+parallelTopK(RandomIt first, RandomIt last, unsigned k, unsigned threads);
+
+#include "TopK.hpp"
@@ -0,0 +1,96 @@
+/**
+ * TopK: keep the k largest items of a stream that may be far too long to
+ * store, using a Heap of at most k items.
+ */
+
+#include "TopK.h"
+#include <iterator>
+#include <memory>
+#include <thread>
+
+template <typename T, unsigned ARITY>
+TopK<T, ARITY>::TopK(unsigned k) : k_(k) {
+  heap_.reserve(k);
+}
+
+
+template <typename T, unsigned ARITY>
+void TopK<T, ARITY>::push(const T & item) {
+  if (heap_.size() < k_) {
+    // Still filling up: keep everything.
+    heap_.insert(item);
+  } else if (k_ > 0 && heap_.peekMin() < item) {
+    // Larger than the smallest item we kept, so it replaces that one.
+    heap_.replaceMin(item);
+  }
+}
+
+
+template <typename T, unsigned ARITY>
+template <typename Iterator>
+void TopK<T, ARITY>::push(Iterator first, Iterator last) {
+  for ( ; first != last; ++first) {
+    push(*first);
+  }
+}
+
+
+template <typename T, unsigned ARITY>
+void TopK<T, ARITY>::merge(TopK & other) {
+  while (!other.heap_.empty()) {
+    push(other.heap_.removeMin());
+  }
+}
+
+
+template <typename T, unsigned ARITY>
+std::vector<T> TopK<T, ARITY>::take() {
+  // The heap gives the smallest first, so fill the result from the back.
+  std::vector<T> result(heap_.size());
+  for (unsigned i = result.size(); i-- > 0; ) {
+    result[i] = heap_.removeMin();
+  }
+  return result;
+}
+
+
+template <typename T, unsigned ARITY, typename Producer>
+std::vector<T> parallelTopK(unsigned k, unsigned threads, Producer produce) {
+  if (threads < 1) { threads = 1; }
+
+  // TopK can't be copied, so the vector holds pointers to them.
+  std::vector<std::unique_ptr<TopK<T, ARITY>>> partial;
+  for (unsigned i = 0; i < threads; i++) {
+    partial.push_back(std::unique_ptr<TopK<T, ARITY>>(new TopK<T, ARITY>(k)));
+  }
+
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < threads; i++) {
+    TopK<T, ARITY> * topK = partial[i].get();
+    workers.push_back(std::thread([&produce, topK, i]() {
+      produce(i, *topK);
+    }));
+  }
+  for (std::thread & worker : workers) {
+    worker.join();
+  }
+
+  // Each thread kept at most k items, so this merge only looks at
+  // threads * k items in total, however long the stream was.
+  for (unsigned i = 1; i < threads; i++) {
+    partial[0]->merge(*partial[i]);
+  }
+  return partial[0]->take();
+}
+
+
+template <unsigned ARITY, typename RandomIt>
+std::vector<typename std::iterator_traits<RandomIt>::value_type>
+parallelTopK(RandomIt first, RandomIt last, unsigned k, unsigned threads) {
+  typedef typename std::iterator_traits<RandomIt>::value_type T;
+  if (threads < 1) { threads = 1; }
+  const std::size_t n = std::distance(first, last);
+  return parallelTopK<T, ARITY>(k, threads, [first, n, threads](unsigned i, TopK<T, ARITY> & topK) {
+    topK.push(first + n * i / threads, first + n * (i + 1) / threads);
+  });
+}
@@ -0,0 +1,101 @@
+/**
+ * Heap benchmark: throughput of a MultiQueue, compared with a single Heap
+ * behind one mutex, from 1 to 64 threads.
+ *
+ * Build and run with:
+ *   make bench-concurrent
+ *   ./bench-concurrent [total operations]
+ *
+ * Each thread does an equal share of the operations, alternating insert
+ * and removeMin, on a queue that starts with 1,000,000 items. Note that the
+ * results can only improve with more threads up to the number of CPU cores
+ * on the machine.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Heap.h"
+#include "MultiQueue.h"
+
+// Seconds elapsed since "start", as a double.
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+static const long PREFILL = 1000000;
+
+// The baseline: one Heap, one lock.
+class LockedHeap {
+  public:
+    void insert(long long item) {
+      std::lock_guard<std::mutex> guard(lock_);
+      heap_.insert(item);
+    }
+    bool tryRemoveMin(long long & item) {
+      std::lock_guard<std::mutex> guard(lock_);
+      if (heap_.empty()) return false;
+      item = heap_.removeMin();
+      return true;
+    }
+  private:
+    std::mutex lock_;
+    Heap<long long> heap_;
+};
+
+// Run "threads" threads that each do their share of "ops" operations on the
+// queue, and return the total operations per second.
+template <typename Queue>
+double runThreads(Queue & queue, unsigned threads, long ops) {
+  const long perThread = ops / threads;
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned t = 0; t < threads; t++) {
+    workers.push_back(std::thread([&queue, perThread, t]() {
+      std::mt19937_64 rng(t + 1);
+      long long item;
+      for (long i = 0; i < perThread; i += 2) {
+        queue.insert((long long)(rng() >> 1));
+        queue.tryRemoveMin(item);
+      }
+    }));
+  }
+  for (std::thread & w : workers) {
+    w.join();
+  }
+  return (perThread * threads) / secondsSince(start);
+}
+
+template <typename Queue>
+void prefill(Queue & queue) {
+  std::mt19937_64 rng(99);
+  for (long i = 0; i < PREFILL; i++) {
+    queue.insert((long long)(rng() >> 1));
+  }
+}
+
+int main(int argc, char* argv[]) {
+  const long OPS = (argc > 1) ? std::atol(argv[1]) : 4000000;
+
+  std::cout << "Concurrent priority queue benchmark, " << OPS << " operations, "
+    << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+  std::cout << "threads   Heap + mutex (ops/s)   MultiQueue (ops/s)" << std::endl;
+  for (unsigned threads = 1; threads <= 64; threads *= 2) {
+    LockedHeap locked;
+    prefill(locked);
+    const double lockedRate = runThreads(locked, threads, OPS);
+
+    MultiQueue<long long> multi(threads);
+    prefill(multi);
+    const double multiRate = runThreads(multi, threads, OPS);
+
+    std::cout << threads << "\t  " << lockedRate << "\t\t " << multiRate << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,135 @@
+/**
+ * Heap benchmark: Dijkstra's shortest paths on a random graph, with a plain
+ * Heap that gets duplicate entries ("lazy deletion"), compared with an
+ * AddressableHeap that uses decreaseKey.
+ *
+ * Build and run with:
+ *   make bench-dijkstra
+ *   ./bench-dijkstra [number of nodes] [edges per node]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "AddressableHeap.h"
+#include "Heap.h"
+
+// Seconds elapsed since "start", as a double.
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// A directed graph, stored so that the edges leaving node v are
+// edges[first_edge[v]] through edges[first_edge[v + 1] - 1].
+struct Graph {
+  std::vector<unsigned> first_edge;
+  std::vector<unsigned> target;
+  std::vector<long long> weight;
+};
+
+static const long long INFINITE = std::numeric_limits<long long>::max();
+
+// With a plain Heap, we can't lower the priority of a node that's already
+// in the heap, so we insert it again, and skip the stale entries when they
+// come out later.
+std::vector<long long> dijkstraLazy(const Graph& g, unsigned source, unsigned& max_heap_size) {
+  const unsigned n = g.first_edge.size() - 1;
+  std::vector<long long> dist(n, INFINITE);
+  Heap<std::pair<long long, unsigned>> heap;
+  dist[source] = 0;
+  heap.insert(std::make_pair(0LL, source));
+  max_heap_size = 1;
+
+  while ( !heap.empty() ) {
+    std::pair<long long, unsigned> top = heap.removeMin();
+    const unsigned v = top.second;
+    if (top.first > dist[v]) continue;  // a stale entry
+    for (unsigned e = g.first_edge[v]; e < g.first_edge[v + 1]; e++) {
+      const long long d = top.first + g.weight[e];
+      if (d < dist[g.target[e]]) {
+        dist[g.target[e]] = d;
+        heap.insert(std::make_pair(d, g.target[e]));
+        if (heap.size() > max_heap_size) max_heap_size = heap.size();
+      }
+    }
+  }
+  return dist;
+}
+
+// With an AddressableHeap, each node is in the heap at most once, and we
+// lower its key in place.
+std::vector<long long> dijkstraDecreaseKey(const Graph& g, unsigned source, unsigned& max_heap_size) {
+  const unsigned n = g.first_edge.size() - 1;
+  std::vector<long long> dist(n, INFINITE);
+  AddressableHeap<std::pair<long long, unsigned>> heap;
+  const unsigned NO_HANDLE = std::numeric_limits<unsigned>::max();
+  std::vector<unsigned> handle(n, NO_HANDLE);
+  dist[source] = 0;
+  handle[source] = heap.insert(std::make_pair(0LL, source));
+  max_heap_size = 1;
+
+  while ( !heap.empty() ) {
+    std::pair<long long, unsigned> top = heap.removeMin();
+    const unsigned v = top.second;
+    handle[v] = NO_HANDLE;
+    for (unsigned e = g.first_edge[v]; e < g.first_edge[v + 1]; e++) {
+      const unsigned w = g.target[e];
+      const long long d = top.first + g.weight[e];
+      if (d < dist[w]) {
+        dist[w] = d;
+        if (handle[w] == NO_HANDLE) {
+          handle[w] = heap.insert(std::make_pair(d, w));
+        } else {
+          heap.decreaseKey(handle[w], std::make_pair(d, w));
+        }
+        if (heap.size() > max_heap_size) max_heap_size = heap.size();
+      }
+    }
+  }
+  return dist;
+}
+
+int main(int argc, char* argv[]) {
+  const unsigned N = (argc > 1) ? std::atol(argv[1]) : 1000000;
+  const unsigned DEGREE = (argc > 2) ? std::atol(argv[2]) : 8;
+
+  // A random graph with DEGREE edges leaving each node.
+  Graph g;
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<unsigned> pickNode(0, N - 1);
+  std::uniform_int_distribution<long long> pickWeight(1, 1000);
+  for (unsigned v = 0; v < N; v++) {
+    g.first_edge.push_back(g.target.size());
+    for (unsigned k = 0; k < DEGREE; k++) {
+      g.target.push_back(pickNode(rng));
+      g.weight.push_back(pickWeight(rng));
+    }
+  }
+  g.first_edge.push_back(g.target.size());
+
+  std::cout << "Dijkstra benchmark, " << N << " nodes, " << g.target.size() << " edges" << std::endl;
+
+  unsigned lazy_max = 0, addressable_max = 0;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<long long> lazy = dijkstraLazy(g, 0, lazy_max);
+  const double lazy_time = secondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  std::vector<long long> addressable = dijkstraDecreaseKey(g, 0, addressable_max);
+  const double addressable_time = secondsSince(start);
+
+  if (lazy != addressable) {
+    throw std::runtime_error("the two versions found different distances");
+  }
+
+  std::cout << "Heap with duplicates:      " << lazy_time << " s, max heap size " << lazy_max << std::endl;
+  std::cout << "AddressableHeap:           " << addressable_time << " s, max heap size " << addressable_max << std::endl;
+  return 0;
+}
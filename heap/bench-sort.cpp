@@ -0,0 +1,110 @@
+/**
+ * Benchmark for HeapSort.h and TopK.h: heapSort and parallelHeapSort against
+ * std::sort, partialSort against std::partial_sort, and the top k of a long
+ * stream of generated numbers, which is never stored.
+ *
+ * Build and run with:
+ *   make bench-sort
+ *   ./bench-sort [items to sort] [stream length] [k] [threads]
+ *
+ * The defaults are 10,000,000 items, a stream of 200,000,000 numbers, k of
+ * 1000, and one thread per core.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "HeapSort.h"
+#include "TopK.h"
+
+// Seconds elapsed since "start", as a double.
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// A quick pseudo-random number for each position of the stream, so that
+// every thread can make its own part of the stream without storing it.
+static std::uint64_t streamItem(std::uint64_t i) {
+  std::uint64_t x = i + 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+// Time one way of sorting a copy of "items", and check that it sorted.
+template <typename Sort>
+static void timeSort(const char* name, const std::vector<int> & items, Sort sort) {
+  std::vector<int> copy(items);
+  auto start = std::chrono::steady_clock::now();
+  sort(copy);
+  const double elapsed = secondsSince(start);
+  std::cout << name << (elapsed * 1e9 / items.size()) << " ns/item"
+    << (std::is_sorted(copy.begin(), copy.end()) ? "" : "  (NOT SORTED)") << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  const long N = (argc > 1) ? std::atol(argv[1]) : 10000000;
+  const long long STREAM = (argc > 2) ? std::atoll(argv[2]) : 200000000;
+  const unsigned K = (argc > 3) ? std::atoi(argv[3]) : 1000;
+  unsigned threads = (argc > 4) ? std::atoi(argv[4]) : std::thread::hardware_concurrency();
+  if (threads == 0) { threads = 1; }
+
+  std::vector<int> items(N);
+  std::mt19937 rng(2024);
+  for (int& item : items) { item = (int)rng(); }
+
+  std::cout << "Sorting " << N << " random ints, " << threads << " thread(s)" << std::endl;
+  timeSort("std::sort:                   ", items, [](std::vector<int> & v) {
+    std::sort(v.begin(), v.end());
+  });
+  timeSort("heapSort (ARITY 2):          ", items, [](std::vector<int> & v) {
+    heapSort<2>(v.begin(), v.end());
+  });
+  timeSort("heapSort (ARITY 4):          ", items, [](std::vector<int> & v) {
+    heapSort<4>(v.begin(), v.end());
+  });
+  timeSort("parallelHeapSort (ARITY 4): ", items, [threads](std::vector<int> & v) {
+    parallelHeapSort<4>(v.begin(), v.end(), threads);
+  });
+
+  std::cout << std::endl << "Smallest " << K << " of " << N << " ints" << std::endl;
+  {
+    std::vector<int> copy(items);
+    auto start = std::chrono::steady_clock::now();
+    std::partial_sort(copy.begin(), copy.begin() + K, copy.end());
+    std::cout << "std::partial_sort:   " << (secondsSince(start) * 1e3) << " ms" << std::endl;
+    std::vector<int> copy2(items);
+    start = std::chrono::steady_clock::now();
+    partialSort(copy2.begin(), copy2.end(), K);
+    std::cout << "partialSort:         " << (secondsSince(start) * 1e3) << " ms"
+      << (std::equal(copy.begin(), copy.begin() + K, copy2.begin()) ? "" : "  (WRONG)") << std::endl;
+  }
+
+  // Top k of a stream. Nothing but the TopKs is ever stored, so the memory
+  // used is threads * k items, whatever the length of the stream.
+  std::cout << std::endl << "Largest " << K << " of a stream of " << STREAM << " numbers" << std::endl;
+  std::uint64_t firstResult = 0;
+  for (unsigned t = 1; t <= threads; t *= 2) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::uint64_t> top = parallelTopK<std::uint64_t, 4>(K, t,
+      [STREAM, t](unsigned i, TopK<std::uint64_t, 4> & topK) {
+        const long long begin = STREAM * i / t, end = STREAM * (i + 1) / t;
+        for (long long j = begin; j < end; j++) {
+          topK.push(streamItem(j));
+        }
+      });
+    const double elapsed = secondsSince(start);
+    if (t == 1) { firstResult = top.back(); }
+    std::cout << t << " thread(s): " << (STREAM / elapsed / 1e6) << " million items/s"
+      << (top.back() == firstResult ? "" : "  (WRONG)") << std::endl;
+  }
+
+  return 0;
+}
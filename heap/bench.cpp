@@ -0,0 +1,146 @@
+/**
+ * Heap benchmarks:
+ * - filling a heap one item at a time (with and without counting the work),
+ *   compared with the O(n) range constructor and insertBatch
+ * - a sweep over ARITY and item size, with a mix of inserts and removeMins
+ *
+ * Build and run with:
+ *   make bench
+ *   ./bench [number of items]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "Heap.h"
+
+// Seconds elapsed since "start", as a double.
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+void runFillBenchmark(const std::vector<long long>& items) {
+  const long N = items.size();
+  std::cout << "Heap fill benchmark, " << N << " random items" << std::endl;
+
+  {
+    Heap<long long> heap;
+    heap.reserve(N);
+    auto start = std::chrono::steady_clock::now();
+    for (const long long& item : items) {
+      heap.insert(item);
+    }
+    std::cout << "one at a time:              " << secondsSince(start) << " s"
+      << "  (min " << heap.removeMin() << ")" << std::endl;
+  }
+
+  {
+    // The same, but counting the work. This shows what the counters cost.
+    Heap<long long, CountingHeapTrace> heap;
+    heap.reserve(N);
+    auto start = std::chrono::steady_clock::now();
+    for (const long long& item : items) {
+      heap.insert(item);
+    }
+    std::cout << "one at a time, counting:    " << secondsSince(start) << " s"
+      << "  (" << heap.trace().comparisons() << " comparisons, "
+      << heap.trace().swaps() << " swaps)" << std::endl;
+  }
+
+  {
+    auto start = std::chrono::steady_clock::now();
+    Heap<long long> heap(items.begin(), items.end());
+    std::cout << "range constructor:          " << secondsSince(start) << " s"
+      << "  (min " << heap.removeMin() << ")" << std::endl;
+  }
+
+  {
+    // A heap that's already half full, and then one big batch.
+    const long half = N / 2;
+    Heap<long long> heap(items.begin(), items.begin() + half);
+    heap.reserve(N);
+    auto start = std::chrono::steady_clock::now();
+    heap.insertBatch(items.begin() + half, items.end());
+    std::cout << "insertBatch of " << (N - half) << " into " << half << ": "
+      << secondsSince(start) << " s"
+      << "  (min " << heap.removeMin() << ")" << std::endl;
+  }
+}
+
+// A 32-byte item with a 64-bit key. It isn't a number type, so the heap
+// uses the plain loop to find the smallest child.
+struct Record32 {
+  long long key;
+  char payload[24];
+  Record32() : key(0) { }
+  Record32(long long k) : key(k) { }
+  bool operator<(const Record32& other) const { return key < other.key; }
+};
+
+long long keyOf(long long item) { return item; }
+long long keyOf(const Record32& item) { return item.key; }
+
+// Fill the heap, and then do a steady mix of one insert and one removeMin
+// per step, so the heap stays the same size. Report the time per operation.
+template <typename T, unsigned ARITY>
+double runMixBenchmark(const std::vector<long long>& keys) {
+  const std::size_t N = keys.size() / 2;
+  Heap<T, NoHeapTrace, ARITY> heap(keys.begin(), keys.begin() + N);
+
+  long long sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = N; i < keys.size(); i++) {
+    // Add to the last key removed, like a scheduler adding the next event
+    // after the current one.
+    T removed = heap.removeMin();
+    sum += keyOf(removed);
+    heap.insert(T(keyOf(removed) + keys[i] % 1000000));
+  }
+  const double elapsed = secondsSince(start);
+  if (sum == 42) std::cout << "";  // keep the compiler from skipping the loop
+  return elapsed * 1e9 / (2.0 * (keys.size() - N));
+}
+
+template <typename T>
+void runArityRow(const char* label, const std::vector<long long>& keys) {
+  std::cout << label << std::fixed << std::setprecision(1)
+    << std::setw(9) << runMixBenchmark<T, 2>(keys)
+    << std::setw(9) << runMixBenchmark<T, 4>(keys)
+    << std::setw(9) << runMixBenchmark<T, 8>(keys)
+    << std::setw(9) << runMixBenchmark<T, 16>(keys) << std::endl;
+  std::cout.unsetf(std::ios::fixed);
+}
+
+int main(int argc, char* argv[]) {
+  const long N = (argc > 1) ? std::atol(argv[1]) : 10000000;
+
+  // Random 63-bit "timestamps".
+  std::vector<long long> items(N);
+  std::mt19937_64 rng(42);
+  for (long long& item : items) {
+    item = (long long)(rng() >> 1);
+  }
+
+  runFillBenchmark(items);
+
+  // Keys small enough that adding to them can't overflow any of the types.
+  std::vector<long long> keys(items);
+  for (long long& key : keys) {
+    key %= 1000000000;
+  }
+  std::cout << "\nHeap ARITY sweep: ns per operation, half insert and half removeMin, "
+    << (N / 2) << " items" << std::endl;
+  std::cout << "item type           ARITY=2        4        8       16" << std::endl;
+  runArityRow<int>(      "int (4 bytes)      ", keys);
+  runArityRow<long long>("long long (8 bytes)", keys);
+  runArityRow<double>(   "double (8 bytes)   ", keys);
+  runArityRow<Record32>( "Record32 (32 bytes)", keys);
+
+  return 0;
+}
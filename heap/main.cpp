@@ -6,10 +6,268 @@
  */
 
 #include "Heap.h"
+#include "AddressableHeap.h"
+#include "MultiQueue.h"
+#include "HeapSort.h"
+#include "TopK.h"
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <set>
 #include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// drainAndCheck: Remove everything from the heap, and make sure the items
+// come out in the same order as the sorted "expected" vector.
+template <typename HeapType, typename T>
+void drainAndCheck(HeapType & heap, std::vector<T> expected) {
+  std::sort(expected.begin(), expected.end());
+  if (heap.size() != expected.size()) {
+    throw std::runtime_error("Heap test failed: wrong size");
+  }
+  for (const T & value : expected) {
+    if (heap.removeMin() != value) {
+      throw std::runtime_error("Heap test failed: items came out in the wrong order");
+    }
+  }
+}
+
+// checkAddressableHeap: A random mix of inserts, decreaseKeys, erases and
+// removeMins, checked against a std::set of (key, handle) pairs.
+template <unsigned ARITY>
+void checkAddressableHeap(unsigned seed) {
+  AddressableHeap<int, NoHeapTrace, ARITY> heap;
+  std::set<std::pair<int, unsigned>> expected;
+  std::map<unsigned, int> keyOf;
+  std::vector<unsigned> live;
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> keyDist(0, 100000);
+
+  for (int step = 0; step < 20000; step++) {
+    const unsigned op = rng() % 4;
+    if (op == 0 || live.empty()) {
+      const int key = keyDist(rng);
+      const unsigned handle = heap.insert(key);
+      expected.insert(std::make_pair(key, handle));
+      keyOf[handle] = key;
+      live.push_back(handle);
+    } else {
+      const unsigned pick = rng() % live.size();
+      const unsigned handle = live[pick];
+      if (op == 1) {
+        const int newKey = keyOf[handle] - (int)(rng() % 5000);
+        heap.decreaseKey(handle, newKey);
+        expected.erase(std::make_pair(keyOf[handle], handle));
+        expected.insert(std::make_pair(newKey, handle));
+        keyOf[handle] = newKey;
+      } else {
+        unsigned removed = handle;
+        if (op == 2) {
+          heap.erase(handle);
+        } else {
+          // Several items can share the smallest key; any of them is right.
+          removed = heap.topHandle();
+          if (heap.removeMin() != expected.begin()->first) {
+            throw std::runtime_error("AddressableHeap test failed: removeMin() returned the wrong key");
+          }
+        }
+        expected.erase(std::make_pair(keyOf[removed], removed));
+        keyOf.erase(removed);
+        live.erase(std::find(live.begin(), live.end(), removed));
+        if (heap.contains(removed)) {
+          throw std::runtime_error("AddressableHeap test failed: removed handle is still in the heap");
+        }
+      }
+    }
+
+    if (heap.size() != expected.size()) {
+      throw std::runtime_error("AddressableHeap test failed: wrong size");
+    }
+    if (!expected.empty() && heap.top() != expected.begin()->first) {
+      throw std::runtime_error("AddressableHeap test failed: wrong top()");
+    }
+  }
+  for (unsigned handle : live) {
+    if (heap.get(handle) != keyOf[handle]) {
+      throw std::runtime_error("AddressableHeap test failed: get() returned the wrong key");
+    }
+  }
+}
+
+// FragileItem: An item whose copies throw while failCopies is set, like a
+// copy that runs out of memory would.
+struct FragileItem {
+  static bool failCopies;
+  int value;
+  FragileItem(int v = 0) : value(v) { }
+  FragileItem(const FragileItem & other) : value(other.value) { _check(); }
+  FragileItem & operator=(const FragileItem & other) { _check(); value = other.value; return *this; }
+  bool operator<(const FragileItem & other) const { return value < other.value; }
+  static void _check() {
+    if (failCopies) { throw std::runtime_error("FragileItem: copy failed"); }
+  }
+};
+bool FragileItem::failCopies = false;
+
+// checkMultiQueue: Several producer threads insert distinct items while
+// several consumer threads remove them. Every item must come out exactly
+// once: none lost, none duplicated. Then, with a single thread, check that
+// the relaxed removeMin stays close to the true minimum.
+void checkMultiQueue() {
+  const int PRODUCERS = 4, CONSUMERS = 4, ITEMS_PER_PRODUCER = 20000;
+  MultiQueue<int> queue(PRODUCERS + CONSUMERS);
+  std::atomic<int> producersDone(0);
+  std::vector<std::vector<int>> removed(CONSUMERS);
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < PRODUCERS; p++) {
+    threads.push_back(std::thread([&queue, &producersDone, p]() {
+      for (int i = 0; i < ITEMS_PER_PRODUCER; i++) {
+        queue.insert(p * ITEMS_PER_PRODUCER + i);
+      }
+      producersDone++;
+    }));
+  }
+  for (int c = 0; c < CONSUMERS; c++) {
+    threads.push_back(std::thread([&queue, &producersDone, &removed, c]() {
+      int item;
+      while (true) {
+        // Read "done" before trying, so that if the queue looks empty after
+        // all producers finished, it really is empty.
+        const bool done = (producersDone == PRODUCERS);
+        if (queue.tryRemoveMin(item)) {
+          removed[c].push_back(item);
+        } else if (done) {
+          return;
+        }
+      }
+    }));
+  }
+  for (std::thread & t : threads) {
+    t.join();
+  }
+
+  std::vector<int> all;
+  for (const std::vector<int> & r : removed) {
+    all.insert(all.end(), r.begin(), r.end());
+  }
+  std::sort(all.begin(), all.end());
+  if (all.size() != (std::size_t)(PRODUCERS * ITEMS_PER_PRODUCER) || queue.size() != 0) {
+    throw std::runtime_error("MultiQueue test failed: items were lost or duplicated");
+  }
+  for (std::size_t i = 0; i < all.size(); i++) {
+    if (all[i] != (int)i) {
+      throw std::runtime_error("MultiQueue test failed: items were lost or duplicated");
+    }
+  }
+
+  // Quality: how many smaller items were still in the queue when each item
+  // came out? (For an exact priority queue, that's always 0.)
+  MultiQueue<int> relaxed(4);
+  std::vector<int> items(2000);
+  for (int i = 0; i < 2000; i++) { items[i] = i; }
+  std::shuffle(items.begin(), items.end(), std::mt19937(5));
+  for (int item : items) { relaxed.insert(item); }
+  std::set<int> remaining(items.begin(), items.end());
+  double totalRankError = 0;
+  int item;
+  while (relaxed.tryRemoveMin(item)) {
+    totalRankError += std::distance(remaining.begin(), remaining.find(item));
+    remaining.erase(item);
+  }
+  const double averageRankError = totalRankError / items.size();
+  std::cout << "MultiQueue with 8 heaps: average rank error " << averageRankError << std::endl;
+  if (!remaining.empty() || averageRankError > 8) {
+    throw std::runtime_error("MultiQueue test failed: removeMin is too far from the minimum");
+  }
+
+  // If a heap operation throws while its heap is locked, the lock must
+  // still be released. Otherwise size() and the full scan in tryRemoveMin
+  // would wait for it forever.
+  MultiQueue<FragileItem> fragile(1);
+  for (int i = 0; i < 10; i++) { fragile.insert(FragileItem(i)); }
+  FragileItem::failCopies = true;
+  for (int i = 0; i < 10; i++) {
+    try {
+      fragile.insert(FragileItem(100 + i));
+      throw std::logic_error("MultiQueue test failed: the copy should have thrown");
+    } catch (const std::runtime_error &) { }
+    FragileItem out;
+    try {
+      fragile.tryRemoveMin(out);
+      throw std::logic_error("MultiQueue test failed: the copy should have thrown");
+    } catch (const std::runtime_error &) { }
+  }
+  FragileItem::failCopies = false;
+  FragileItem out;
+  unsigned drained = 0;
+  while (fragile.tryRemoveMin(out)) { drained++; }
+  if (drained == 0 || fragile.size() != 0) {
+    throw std::runtime_error("MultiQueue test failed: a heap stayed locked after an exception");
+  }
+}
+
+// checkSorting: heapSort, partialSort and parallelHeapSort must agree with
+// std::sort, and TopK and parallelTopK with the end of the sorted items.
+void checkSorting() {
+  std::mt19937 rng(77);
+  std::uniform_int_distribution<int> dist(-50000, 50000);
+  std::vector<int> items(20001);
+  for (int& item : items) { item = dist(rng); }
+  std::vector<int> sorted(items);
+  std::sort(sorted.begin(), sorted.end());
+
+  std::vector<int> a(items);
+  heapSort(a.begin(), a.end());
+  std::vector<int> b(items);
+  heapSort<4>(b.begin(), b.end());
+  std::vector<int> c(items);
+  parallelHeapSort(c.begin(), c.end(), 3);
+  if (a != sorted || b != sorted || c != sorted) {
+    throw std::runtime_error("heapSort test failed: the items are not sorted");
+  }
+
+  for (std::size_t k : { 0, 1, 100, 20001, 30000 }) {
+    std::vector<int> partial(items);
+    partialSort(partial.begin(), partial.end(), k);
+    const std::size_t kept = std::min(k, items.size());
+    std::vector<int> rest(partial.begin() + kept, partial.end());
+    std::sort(rest.begin(), rest.end());
+    if (!std::equal(partial.begin(), partial.begin() + kept, sorted.begin()) ||
+        !std::equal(rest.begin(), rest.end(), sorted.begin() + kept)) {
+      throw std::runtime_error("partialSort test failed");
+    }
+  }
+
+  const unsigned K = 50;
+  std::vector<int> largest(sorted.rbegin(), sorted.rbegin() + K);
+  TopK<int> topK(K);
+  topK.push(items.begin(), items.end());
+  if (topK.size() != K || topK.take() != largest || topK.size() != 0) {
+    throw std::runtime_error("TopK test failed");
+  }
+  for (unsigned threads = 1; threads <= 4; threads++) {
+    if (parallelTopK<4>(items.begin(), items.end(), K, threads) != largest) {
+      throw std::runtime_error("parallelTopK test failed");
+    }
+  }
+  // Asking for more than there are keeps them all.
+  std::vector<std::string> words = { "b", "d", "a", "c" };
+  TopK<std::string> topWords(10);
+  topWords.push(words.begin(), words.end());
+  if (topWords.take() != std::vector<std::string>({ "d", "c", "b", "a" })) {
+    throw std::runtime_error("TopK test failed");
+  }
+}
 
 int main() {
-  Heap<int> heap;
+  // PrintingHeapTrace prints the array after every insert, so we can watch
+  // the heap work. (The default trace policy prints nothing.)
+  Heap<int, PrintingHeapTrace> heap;
 
   std::cout << " === 10 calls to heap.insert() === " << std::endl;
   heap.insert(4);
@@ -36,5 +294,87 @@ int main() {
   std::cout << heap.removeMin() << std::endl;
   std::cout << heap.removeMin() << std::endl;
 
+  // Building a heap from a range, and adding batches of items. These heaps
+  // use the default trace policy, so they don't print anything.
+  std::mt19937 rng(2020);
+  std::uniform_int_distribution<int> dist(-1000, 1000);
+  std::vector<int> items(5000);
+  for (int& item : items) { item = dist(rng); }
+
+  Heap<int> built(items.begin(), items.end());
+  drainAndCheck(built, items);
+
+  // A big batch into a small heap (rebuilds), then a small batch into a big
+  // heap (one item at a time).
+  Heap<int> batched(items.begin(), items.begin() + 10);
+  batched.reserve(6000);
+  batched.insertBatch(items.begin() + 10, items.end());
+  std::vector<int> extra = { 7, -3000, 3000, 7 };
+  batched.insertBatch(extra.begin(), extra.end());
+  std::vector<int> expected(items);
+  expected.insert(expected.end(), extra.begin(), extra.end());
+  drainAndCheck(batched, expected);
+
+  std::cout << std::endl << "Heap batch tests passed." << std::endl;
+
+  // Heaps with more children per node. The int and double heaps use the
+  // branchless search for the smallest child; the std::string heap doesn't.
+  {
+    Heap<int, NoHeapTrace, 3> heap3(items.begin(), items.end());
+    drainAndCheck(heap3, items);
+
+    Heap<int, NoHeapTrace, 16> heap16;
+    for (int item : items) { heap16.insert(item); }
+    drainAndCheck(heap16, items);
+
+    std::vector<double> doubles(items.begin(), items.end());
+    Heap<double, NoHeapTrace, 8> heap8;
+    heap8.insertBatch(doubles.begin(), doubles.begin() + 100);
+    heap8.insertBatch(doubles.begin() + 100, doubles.end());
+    drainAndCheck(heap8, doubles);
+
+    std::vector<std::string> strings;
+    for (int item : items) { strings.push_back(std::to_string(item)); }
+    Heap<std::string, NoHeapTrace, 4> heap4(strings.begin(), strings.end());
+    drainAndCheck(heap4, strings);
+  }
+  std::cout << "d-ary heap tests passed." << std::endl;
+
+  checkAddressableHeap<2>(11);
+  checkAddressableHeap<4>(12);
+  std::cout << "AddressableHeap tests passed." << std::endl;
+
+  checkMultiQueue();
+  std::cout << "MultiQueue tests passed." << std::endl;
+
+  checkSorting();
+  std::cout << "heapSort and TopK tests passed." << std::endl;
+
+  // CountingHeapTrace counts the heap's work instead of printing it.
+  Heap<int, CountingHeapTrace> counted;
+  for (int item : items) {
+    counted.insert(item);
+  }
+  const CountingHeapTrace & stats = counted.trace();
+  std::cout << "Inserting " << items.size() << " items: "
+    << stats.comparisons() << " comparisons, "
+    << stats.swaps() << " swaps, "
+    << stats.grows() << " grow events, "
+    << "max depth " << stats.maxDepth() << std::endl;
+  // 5000 items fill levels 0 through 12, since 2^12 <= 5000 < 2^13.
+  if (stats.maxDepth() != 12 || stats.grows() == 0 || stats.comparisons() < stats.swaps()) {
+    throw std::runtime_error("Heap test failed: CountingHeapTrace counters are wrong");
+  }
+
+  // The O(n) batch paths reach the same depth, and insertBatch's reserve()
+  // is a grow event too.
+  Heap<int, CountingHeapTrace> fromRange(items.begin(), items.end());
+  Heap<int, CountingHeapTrace> countedBatch;
+  countedBatch.insertBatch(items.begin(), items.end());
+  if (fromRange.trace().maxDepth() != 12 || countedBatch.trace().maxDepth() != 12 ||
+      countedBatch.trace().grows() == 0) {
+    throw std::runtime_error("Heap test failed: CountingHeapTrace missed the batch paths");
+  }
+
   return 0;
 }
\ No newline at end of file